@@ -0,0 +1,291 @@
+#!/bin/sh
+# Banc d'essai de bout en bout sur la boucle locale
+#
+# Pour chaque combinaison de résolution, de taille de paquet, de profondeur
+# des files du client, de méthode d'envoi, d'envois en vol et de profil de
+# dégradation, lance le serveur, le
+# relais éventuel et le client (source synthétique), puis résume les lignes
+# « metrics » des deux côtés en une ligne « bench clé=valeur ... ». L'ordre
+# et le nom des clés ne changent pas : seules des clés peuvent s'ajouter à
+# la fin, pour comparer les résultats d'une version à l'autre.
+#
+# Les binaires viennent de build/<taille>/ (make PACKET_SIZES="1000 1400").
+#
+# Usage : loopback.sh [-r résolutions] [-p tailles] [-q profondeurs]
+#                     [-b méthodes] [-d envois] [-i profils] [-n images]
+#                     [-S motif] [-P port]
+#                     [-c "options client"] [-s "options serveur"] [-k]
+#
+# Un profil est « none » (pas de relais) ou une liste séparée par des
+# virgules parmi drop=%, dup=%, reorder=%[:ms], delay=ms, jitter=ms, seed=N
+# et both (dégrade aussi les retours du serveur), par exemple
+# « drop=1,reorder=2:1,delay=1 ».
+#
+# Les méthodes d'envoi sont celles de l'option -z du client (zc, iovec,
+# copy, mmsg) ; -d fixe le nombre d'envois en vol (option -Q). La clé
+# pps_per_core rapporte les paquets envoyés par seconde de CPU du thread
+# d'envoi. Les clés publish_* ne sont remplies que si le serveur publie ses
+# images en mémoire partagée (-s "-F /nom"). Sous réordonnancement
+# (reorder=%:ms), complete_pct se lit avec held (paquets d'images suivantes
+# mis de côté par le serveur), held_expired (images terminées incomplètes
+# faute d'attendre plus) et stale (paquets arrivés après leur image) ;
+# expired compte les images terminées incomplètes, plus aucun paquet.
+
+set -eu
+
+here=$(cd "$(dirname "$0")" && pwd)
+
+resolutions="1280x720 1920x1080"
+sizes="1000 1400"
+queues="1 2"
+backends="zc mmsg"
+depths=32
+profiles="none drop=1,dup=0.5,reorder=1,delay=1"
+frames=60
+pattern=scroll
+port=18080
+client_args=
+server_args=
+keep=0
+
+usage()
+{
+    sed -n '2,/^$/s/^# \{0,1\}//p' "$0" >&2
+    exit 1
+}
+
+while getopts "r:p:q:b:d:i:n:S:P:c:s:kh" opt
+do
+    case $opt in
+    r) resolutions=$OPTARG ;;
+    p) sizes=$OPTARG ;;
+    q) queues=$OPTARG ;;
+    b) backends=$OPTARG ;;
+    d) depths=$OPTARG ;;
+    i) profiles=$OPTARG ;;
+    n) frames=$OPTARG ;;
+    S) pattern=$OPTARG ;;
+    P) port=$OPTARG ;;
+    c) client_args=$OPTARG ;;
+    s) server_args=$OPTARG ;;
+    k) keep=1 ;;
+    *) usage ;;
+    esac
+done
+
+work=$(mktemp -d "${TMPDIR:-/tmp}/loopback.XXXXXX")
+pids=
+
+cleanup()
+{
+    for pid in $pids
+    do
+        kill "$pid" 2>/dev/null || true
+    done
+    if [ "$keep" = 1 ]
+    then
+        echo "# journaux dans $work" >&2
+    else
+        rm -rf "$work"
+    fi
+}
+trap cleanup EXIT
+trap 'exit 130' INT TERM
+
+# Attend qu'une ligne contenant $2 apparaisse dans le fichier $1 (5 s au plus)
+wait_for()
+{
+    tries=50
+    until grep -q -- "$2" "$1" 2>/dev/null
+    do
+        tries=$((tries - 1))
+        [ "$tries" -gt 0 ] || return 1
+        sleep 0.1
+    done
+}
+
+# Attend la fin du processus $1, le tue au bout de $2 secondes
+wait_pid()
+{
+    tries=$(($2 * 10))
+    while kill -0 "$1" 2>/dev/null
+    do
+        tries=$((tries - 1))
+        if [ "$tries" -le 0 ]
+        then
+            kill "$1" 2>/dev/null || true
+            break
+        fi
+        sleep 0.1
+    done
+    wait "$1" 2>/dev/null || true
+}
+
+# Valeur de la clé $2 dans la ligne clé=valeur $1 (0 si absente)
+field()
+{
+    printf '%s\n' "$1" | tr ' ' '\n' | sed -n "s/^$2=//p" | grep . || echo 0
+}
+
+# Options du relais pour un profil
+relay_flags()
+{
+    flags=
+    for item in $(printf '%s' "$1" | tr ',' ' ')
+    do
+        case $item in
+        drop=*)    flags="$flags -d ${item#*=}" ;;
+        dup=*)     flags="$flags -u ${item#*=}" ;;
+        reorder=*) flags="$flags -r ${item#*=}" ;;
+        delay=*)   flags="$flags -D ${item#*=}" ;;
+        jitter=*)  flags="$flags -j ${item#*=}" ;;
+        seed=*)    flags="$flags -s ${item#*=}" ;;
+        both)      flags="$flags -b" ;;
+        *) echo "Profil invalide : $1" >&2; return 1 ;;
+        esac
+    done
+    echo "$flags"
+}
+
+run_one()
+{
+    res=$1 size=$2 queue=$3 backend=$4 depth=$5 profile=$6
+    bin=$here/build/$size
+    dir=$work/$res-$size-$queue-$backend-$depth-$(printf '%s' "$profile" | tr ',:=' '_._')
+    mkdir -p "$dir/images"
+
+    if [ ! -x "$bin/client" ] || [ ! -x "$bin/server" ]
+    then
+        echo "Binaires absents dans $bin (make PACKET_SIZES=\"$size\")" >&2
+        return 1
+    fi
+
+    # Le serveur enregistre les images dans un dossier vidé après la mesure
+    (cd "$dir/images" && exec "$bin/server" -P "$port" -w 1 -m 3600 $server_args) \
+        > "$dir/server.log" 2>&1 &
+    server=$!
+    pids="$server"
+    # Sa sortie n'est pas vidée ligne à ligne : on guette la socket liée
+    if ! wait_for /proc/net/udp "$(printf ':%04X ' "$port")"
+    then
+        echo "Le serveur n'a pas démarré, voir $dir/server.log" >&2
+        keep=1
+        return 1
+    fi
+
+    dest=$port
+    relay=
+    if [ "$profile" != none ]
+    then
+        dest=$((port + 1))
+        "$here/relay" -l "$dest" -t "127.0.0.1:$port" $(relay_flags "$profile") \
+            > "$dir/relay.log" 2>&1 &
+        relay=$!
+        pids="$pids $relay"
+        wait_for "$dir/relay.log" "relay:" || { keep=1; return 1; }
+    fi
+
+    # -i 3600 : une seule ligne « metrics », à la fin, sur toute la durée
+    "$bin/client" -a "127.0.0.1:$dest" -s -n "$frames" -q "$queue" -i 3600 -m \
+        -z "$backend" -Q "$depth" -S "synth:$pattern:$res" $client_args \
+        > "$dir/client.log" 2>&1 || true
+
+    # Le relais garde au plus quelques millisecondes de datagrammes, le
+    # serveur s'arrête seul après quelques secondes sans paquets
+    if [ -n "$relay" ]
+    then
+        kill -TERM "$relay" 2>/dev/null || true
+        wait_pid "$relay" 5
+    fi
+    wait_pid "$server" 30
+    pids=
+    rm -rf "$dir/images"
+
+    cli=$(grep '^metrics ' "$dir/client.log" | tail -n 1 || true)
+    srv=$(grep '^metrics ' "$dir/server.log" | tail -n 1 || true)
+    rel=$(grep '^relay ' "$dir/relay.log" 2>/dev/null | tail -n 1 || true)
+    if [ -z "$cli" ] || [ -z "$srv" ]
+    then
+        echo "Pas de ligne metrics, voir $dir" >&2
+        keep=1
+        return 1
+    fi
+
+    awk -v res="$res" -v size="$size" -v queue="$queue" -v profile="$profile" \
+        -v frames="$frames" -v backend="$backend" -v depth="$depth" \
+        -v sent="$(field "$cli" envoi_frames)" \
+        -v packets="$(field "$cli" packets)" \
+        -v bytes="$(field "$cli" bytes)" \
+        -v send_s="$(field "$cli" send_wall_s)" \
+        -v cpu_s="$(field "$cli" send_cpu_s)" \
+        -v errors="$(field "$cli" errors)" \
+        -v lat50="$(field "$cli" latency_p50_us)" \
+        -v lat99="$(field "$cli" latency_p99_us)" \
+        -v nacks="$(field "$cli" nacks)" \
+        -v resent="$(field "$cli" resent)" \
+        -v images="$(field "$srv" images)" \
+        -v incomplete="$(field "$srv" incomplete)" \
+        -v lost="$(field "$srv" lost)" \
+        -v datagrams="$(field "$srv" datagrams)" \
+        -v drops="$(field "$srv" socket_drops)" \
+        -v dups="$(field "$srv" duplicates)" \
+        -v re50="$(field "$srv" reassembly_p50_us)" \
+        -v re99="$(field "$srv" reassembly_p99_us)" \
+        -v pub50="$(field "$srv" publish_p50_us)" \
+        -v pub99="$(field "$srv" publish_p99_us)" \
+        -v held="$(field "$srv" held)" \
+        -v expired="$(field "$srv" held_expired)" \
+        -v stale="$(field "$srv" stale)" \
+        -v expired_idle="$(field "$srv" expired)" \
+        -v rdrop="$(field "$rel" up_dropped)" \
+        -v rdup="$(field "$rel" up_duplicated)" \
+        -v rreorder="$(field "$rel" up_reordered)" \
+        'BEGIN {
+            printf "bench resolution=%s packet_size=%s queue=%s impair=%s frames=%s " \
+                   "sent_frames=%d throughput_mbps=%.1f pps=%.0f " \
+                   "latency_p50_us=%d latency_p99_us=%d " \
+                   "reassembly_p50_us=%d reassembly_p99_us=%d " \
+                   "complete_pct=%.2f lost_packets=%d loss_pct=%.3f " \
+                   "packets=%d datagrams=%d send_errors=%d socket_drops=%d duplicates=%d " \
+                   "nacks=%d resent=%d relay_dropped=%d relay_duplicated=%d relay_reordered=%d " \
+                   "backend=%s send_depth=%s pps_per_core=%.0f " \
+                   "publish_p50_us=%d publish_p99_us=%d " \
+                   "held=%d held_expired=%d stale=%d expired=%d\n",
+                   res, size, queue, profile, frames,
+                   sent, (send_s > 0 ? bytes * 8 / send_s / 1e6 : 0),
+                   (send_s > 0 ? packets / send_s : 0),
+                   lat50, lat99, re50, re99,
+                   (sent > 0 ? 100 * (images - incomplete) / sent : 0),
+                   lost, (packets > 0 ? 100 * lost / packets : 0),
+                   packets, datagrams, errors, drops, dups,
+                   nacks, resent, rdrop, rdup, rreorder,
+                   backend, depth, (cpu_s > 0 ? packets / cpu_s : 0),
+                   pub50, pub99, held, expired, stale, expired_idle
+        }'
+}
+
+commit=$(git -C "$here" rev-parse --short HEAD 2>/dev/null || echo inconnu)
+echo "# bench loopback commit=$commit frames=$frames pattern=$pattern"
+
+status=0
+for res in $resolutions
+do
+    for size in $sizes
+    do
+        for queue in $queues
+        do
+            for backend in $backends
+            do
+                for depth in $depths
+                do
+                    for profile in $profiles
+                    do
+                        run_one "$res" "$size" "$queue" "$backend" "$depth" \
+                            "$profile" || status=1
+                    done
+                done
+            done
+        done
+    done
+done
+exit $status
@@ -0,0 +1,530 @@
+// Relais UDP qui dégrade le trafic entre le client et le serveur
+//
+// Le client envoie au relais (-a 127.0.0.1:PORT), qui transmet au serveur.
+// Les retours du serveur (NACK, bilans) repartent vers le dernier émetteur
+// vu. Sur le trajet client -> serveur (et sur le retour avec -b), chaque
+// datagramme peut être jeté, dupliqué, retardé ou retenu pour arriver après
+// les suivants. Un seul client à la fois.
+//
+// Usage : relay [-l port] [-t adresse:port] [-d %] [-u %] [-r %[:ms]]
+//               [-D ms] [-j ms] [-b] [-s graine] [-i secondes]
+//
+// À l'arrêt (SIGINT, SIGTERM ou inactivité), affiche une ligne
+// « relay clé=valeur ... » au format stable.
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DATAGRAM_MAX  65536
+#define RECV_BATCH    64
+#define DRAIN_ROUNDS  16        // Lots lus d'affilée sur une socket
+#define QUEUE_MAX     65536     // Datagrammes retardés à la fois (au-delà : jetés)
+
+// Un sens de circulation et ce qu'il a subi
+struct direction {
+    int in, out;                // Socket de réception et d'envoi
+    struct sockaddr_in *to;     // Destination (NULL = sendto sur socket connectée)
+    int impaired;
+    uint64_t received, forwarded, dropped, duplicated, reordered, overflow;
+};
+
+// Datagramme en attente de son heure d'envoi
+struct delayed {
+    uint64_t due_ns;
+    uint64_t order;             // Départage les égalités : ordre d'arrivée
+    struct direction *dir;
+    size_t len;
+    uint8_t *data;
+};
+
+struct impairment {
+    double drop, duplicate, reorder; // Probabilités (0 à 1)
+    uint64_t reorder_ns;        // Retard d'un datagramme retenu
+    uint64_t delay_ns, jitter_ns;
+};
+
+static volatile sig_atomic_t running = 1;
+
+static struct delayed *queue;   // Tas binaire ordonné par due_ns puis order
+static unsigned queued;
+static uint64_t next_order;
+static uint64_t rng_state;
+
+static void on_signal(int sig)
+{
+    (void)sig;
+    running = 0;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// xorshift64* : reproductible d'une exécution à l'autre avec la même graine
+static uint64_t rng_next(void)
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1Dull;
+}
+
+// Tirage uniforme dans [0, 1[
+static double rng_uniform(void)
+{
+    return (rng_next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static int earlier(const struct delayed *a, const struct delayed *b)
+{
+    return a->due_ns < b->due_ns || (a->due_ns == b->due_ns && a->order < b->order);
+}
+
+static void queue_push(struct delayed item)
+{
+    unsigned i = queued++;
+    while (i && earlier(&item, &queue[(i - 1) / 2]))
+    {
+        queue[i] = queue[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    queue[i] = item;
+}
+
+static struct delayed queue_pop(void)
+{
+    struct delayed top = queue[0];
+    struct delayed last = queue[--queued];
+    unsigned i = 0;
+
+    for (;;)
+    {
+        unsigned child = 2 * i + 1;
+        if (child >= queued)
+        {
+            break;
+        }
+        if (child + 1 < queued && earlier(&queue[child + 1], &queue[child]))
+        {
+            child++;
+        }
+        if (!earlier(&queue[child], &last))
+        {
+            break;
+        }
+        queue[i] = queue[child];
+        i = child;
+    }
+    if (queued)
+    {
+        queue[i] = last;
+    }
+    return top;
+}
+
+static void send_datagram(struct direction *dir, const void *data, size_t len)
+{
+    ssize_t sent = dir->to
+        ? sendto(dir->out, data, len, 0, (struct sockaddr *)dir->to, sizeof(*dir->to))
+        : send(dir->out, data, len, 0);
+
+    // Buffer plein ou serveur pas encore prêt : le datagramme est perdu,
+    // comme il le serait sur le réseau
+    if (sent < 0)
+    {
+        dir->dropped++;
+        return;
+    }
+    dir->forwarded++;
+}
+
+// Retarde un exemplaire du datagramme jusqu'à due_ns
+static void delay_datagram(struct direction *dir, const uint8_t *data, size_t len,
+                           uint64_t due_ns)
+{
+    struct delayed item = { .due_ns = due_ns, .order = next_order++, .dir = dir, .len = len };
+
+    if (queued == QUEUE_MAX || !(item.data = malloc(len)))
+    {
+        dir->overflow++;
+        return;
+    }
+    memcpy(item.data, data, len);
+    queue_push(item);
+}
+
+// Applique les dégradations à un datagramme reçu
+static void relay_datagram(struct direction *dir, const struct impairment *imp,
+                           const uint8_t *data, size_t len, uint64_t now)
+{
+    dir->received++;
+    if (!dir->impaired)
+    {
+        send_datagram(dir, data, len);
+        return;
+    }
+    if (imp->drop > 0 && rng_uniform() < imp->drop)
+    {
+        dir->dropped++;
+        return;
+    }
+
+    unsigned copies = 1;
+    if (imp->duplicate > 0 && rng_uniform() < imp->duplicate)
+    {
+        dir->duplicated++;
+        copies = 2;
+    }
+
+    for (unsigned c = 0; c < copies; c++)
+    {
+        uint64_t delay = imp->delay_ns;
+        if (imp->jitter_ns)
+        {
+            delay += rng_next() % (imp->jitter_ns + 1);
+        }
+        if (c == 0 && imp->reorder > 0 && rng_uniform() < imp->reorder)
+        {
+            dir->reordered++;
+            delay += imp->reorder_ns;
+        }
+
+        // Pas de retard : envoyé tout de suite, devant les datagrammes retenus
+        if (!delay)
+        {
+            send_datagram(dir, data, len);
+        }
+        else
+        {
+            delay_datagram(dir, data, len, now + delay);
+        }
+    }
+}
+
+// Envoie les datagrammes dont l'heure est passée
+static void flush_due(uint64_t now)
+{
+    while (queued && queue[0].due_ns <= now)
+    {
+        struct delayed item = queue_pop();
+        send_datagram(item.dir, item.data, item.len);
+        free(item.data);
+    }
+}
+
+// Lit ce qui attend sur la socket de dir, par lots et sans monopoliser la
+// boucle : les datagrammes retardés doivent pouvoir partir à l'heure.
+// Retourne le nombre de datagrammes reçus.
+static int drain(struct direction *dir, const struct impairment *imp,
+                 struct sockaddr_in *client, uint8_t (*bufs)[DATAGRAM_MAX])
+{
+    struct mmsghdr msgs[RECV_BATCH];
+    struct iovec iov[RECV_BATCH];
+    struct sockaddr_in from[RECV_BATCH];
+    int total = 0;
+
+    for (unsigned round = 0; round < DRAIN_ROUNDS; round++)
+    {
+        for (unsigned i = 0; i < RECV_BATCH; i++)
+        {
+            iov[i] = (struct iovec) { .iov_base = bufs[i], .iov_len = DATAGRAM_MAX };
+            msgs[i].msg_hdr = (struct msghdr) {
+                .msg_name = &from[i],
+                .msg_namelen = sizeof(from[i]),
+                .msg_iov = &iov[i],
+                .msg_iovlen = 1
+            };
+        }
+
+        int n = recvmmsg(dir->in, msgs, RECV_BATCH, MSG_DONTWAIT, NULL);
+        if (n <= 0)
+        {
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR &&
+                errno != ECONNREFUSED)
+            {
+                perror("recvmmsg");
+            }
+            return total;
+        }
+
+        uint64_t now = now_ns();
+        for (int i = 0; i < n; i++)
+        {
+            // Les retours repartent vers le dernier client vu
+            if (client)
+            {
+                *client = from[i];
+            }
+            relay_datagram(dir, imp, bufs[i], msgs[i].msg_len, now);
+        }
+        total += n;
+    }
+    return total;
+}
+
+static int parse_percent(const char *arg, double *p)
+{
+    char *end;
+    double v = strtod(arg, &end);
+
+    if (end == arg || (*end && *end != ':') || v < 0 || v > 100)
+    {
+        return -1;
+    }
+    *p = v / 100;
+    return 0;
+}
+
+static int parse_ms(const char *arg, uint64_t *ns)
+{
+    char *end;
+    double v = strtod(arg, &end);
+
+    if (end == arg || *end || v < 0)
+    {
+        return -1;
+    }
+    *ns = v * 1e6;
+    return 0;
+}
+
+static int parse_address(const char *arg, struct sockaddr_in *addr)
+{
+    char host[INET_ADDRSTRLEN];
+    const char *colon = strchr(arg, ':');
+    char *end;
+
+    if (!colon || (size_t)(colon - arg) >= sizeof(host))
+    {
+        return -1;
+    }
+    memcpy(host, arg, colon - arg);
+    host[colon - arg] = '\0';
+
+    unsigned long port = strtoul(colon + 1, &end, 10);
+    if (end == colon + 1 || *end || !port || port > 65535)
+    {
+        return -1;
+    }
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons(port);
+    return inet_pton(AF_INET, host, &addr->sin_addr) == 1 ? 0 : -1;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [-l port] [-t adresse:port] [-d %%] [-u %%] [-r %%[:ms]]\n"
+            "          [-D ms] [-j ms] [-b] [-s graine] [-i secondes]\n"
+            "  -l port       port d'écoute, côté client (défaut 9080)\n"
+            "  -t adresse    serveur destinataire (défaut 127.0.0.1:8080)\n"
+            "  -d %%          datagrammes perdus\n"
+            "  -u %%          datagrammes dupliqués\n"
+            "  -r %%[:ms]     datagrammes retenus ms millisecondes (défaut 1), ils\n"
+            "                arrivent après ceux envoyés entre-temps\n"
+            "  -D ms         délai ajouté à chaque datagramme\n"
+            "  -j ms         gigue : délai supplémentaire tiré entre 0 et ms\n"
+            "  -b            dégrade aussi les retours du serveur (NACK, bilans)\n"
+            "  -s graine     graine du tirage (défaut 1)\n"
+            "  -i secondes   s'arrête après ce temps sans trafic (défaut 0 = jamais)\n",
+            prog);
+}
+
+int main(int argc, char **argv)
+{
+    struct impairment imp = { .reorder_ns = 1000000 };
+    struct sockaddr_in listen_addr = { .sin_family = AF_INET, .sin_port = htons(9080),
+                                       .sin_addr = { .s_addr = htonl(INADDR_ANY) } };
+    struct sockaddr_in server, client = { 0 };
+    unsigned idle_timeout = 0;
+    int both = 0;
+
+    parse_address("127.0.0.1:8080", &server);
+    rng_state = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "l:t:d:u:r:D:j:bs:i:h")) != -1)
+    {
+        int bad = 0;
+        switch (opt)
+        {
+        case 'l':
+        {
+            unsigned long port = strtoul(optarg, NULL, 10);
+            bad = !port || port > 65535;
+            listen_addr.sin_port = htons(port);
+            break;
+        }
+        case 't':
+            bad = parse_address(optarg, &server) < 0;
+            break;
+        case 'd':
+            bad = parse_percent(optarg, &imp.drop) < 0 || strchr(optarg, ':');
+            break;
+        case 'u':
+            bad = parse_percent(optarg, &imp.duplicate) < 0 || strchr(optarg, ':');
+            break;
+        case 'r':
+            bad = parse_percent(optarg, &imp.reorder) < 0 ||
+                  (strchr(optarg, ':') && parse_ms(strchr(optarg, ':') + 1, &imp.reorder_ns) < 0);
+            break;
+        case 'D':
+            bad = parse_ms(optarg, &imp.delay_ns) < 0;
+            break;
+        case 'j':
+            bad = parse_ms(optarg, &imp.jitter_ns) < 0;
+            break;
+        case 'b':
+            both = 1;
+            break;
+        case 's':
+            // Une graine nulle bloquerait xorshift sur 0
+            rng_state = strtoull(optarg, NULL, 10) | 1ull << 63;
+            break;
+        case 'i':
+            idle_timeout = strtoul(optarg, NULL, 10);
+            break;
+        default:
+            bad = 1;
+        }
+        if (bad)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    queue = malloc(QUEUE_MAX * sizeof(*queue));
+    uint8_t (*bufs)[DATAGRAM_MAX] = malloc(RECV_BATCH * sizeof(*bufs));
+    if (!queue || !bufs)
+    {
+        perror("malloc");
+        return 1;
+    }
+
+    // Côté client : la socket d'écoute. Côté serveur : une socket connectée,
+    // qui ne reçoit que les retours du serveur.
+    int front = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    int back = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    int bufsize = 32 * 1024 * 1024;
+    if (front < 0 || back < 0)
+    {
+        perror("socket");
+        return 1;
+    }
+    setsockopt(front, SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof(bufsize));
+    setsockopt(back, SOL_SOCKET, SO_SNDBUF, &bufsize, sizeof(bufsize));
+    if (bind(front, (struct sockaddr *)&listen_addr, sizeof(listen_addr)) < 0)
+    {
+        perror("bind");
+        return 1;
+    }
+    if (connect(back, (struct sockaddr *)&server, sizeof(server)) < 0)
+    {
+        perror("connect");
+        return 1;
+    }
+
+    struct direction up = { .in = front, .out = back, .impaired = 1 };
+    struct direction down = { .in = back, .out = front, .to = &client,
+                              .impaired = both };
+
+    struct sigaction sa = { .sa_handler = on_signal };
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    char server_text[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &server.sin_addr, server_text, sizeof(server_text));
+    printf("relay: écoute sur le port %u, vers %s:%u\n", ntohs(listen_addr.sin_port),
+           server_text, ntohs(server.sin_port));
+    fflush(stdout);
+
+    uint64_t last_traffic = 0;
+    while (running)
+    {
+        struct pollfd pfd[2] = {
+            { .fd = front, .events = POLLIN },
+            { .fd = back, .events = POLLIN },
+        };
+
+        // Attente jusqu'au prochain datagramme retardé, ou 100 ms pour
+        // surveiller l'inactivité
+        struct timespec timeout = { .tv_nsec = 100000000 };
+        if (queued)
+        {
+            uint64_t now = now_ns();
+            uint64_t wait = queue[0].due_ns > now ? queue[0].due_ns - now : 0;
+            if (wait < 100000000)
+            {
+                timeout.tv_nsec = wait;
+            }
+        }
+
+        if (ppoll(pfd, 2, &timeout, NULL) < 0 && errno != EINTR)
+        {
+            perror("ppoll");
+            break;
+        }
+
+        int traffic = 0;
+        if (pfd[0].revents)
+        {
+            traffic += drain(&up, &imp, &client, bufs);
+        }
+        if (pfd[1].revents && client.sin_port)
+        {
+            traffic += drain(&down, &imp, NULL, bufs);
+        }
+
+        uint64_t now = now_ns();
+        flush_due(now);
+
+        if (traffic)
+        {
+            last_traffic = now;
+        }
+        else if (idle_timeout && last_traffic && !queued &&
+                 now - last_traffic >= idle_timeout * 1000000000ull)
+        {
+            break;
+        }
+    }
+
+    // Les datagrammes encore retenus partent avant la fin
+    while (queued)
+    {
+        struct delayed item = queue_pop();
+        send_datagram(item.dir, item.data, item.len);
+        free(item.data);
+    }
+
+    printf("relay up_received=%llu up_forwarded=%llu up_dropped=%llu up_duplicated=%llu "
+           "up_reordered=%llu up_overflow=%llu down_received=%llu down_forwarded=%llu "
+           "down_dropped=%llu down_duplicated=%llu down_reordered=%llu down_overflow=%llu\n",
+           (unsigned long long)up.received, (unsigned long long)up.forwarded,
+           (unsigned long long)up.dropped, (unsigned long long)up.duplicated,
+           (unsigned long long)up.reordered, (unsigned long long)up.overflow,
+           (unsigned long long)down.received, (unsigned long long)down.forwarded,
+           (unsigned long long)down.dropped, (unsigned long long)down.duplicated,
+           (unsigned long long)down.reordered, (unsigned long long)down.overflow);
+
+    close(front);
+    close(back);
+    free(bufs);
+    free(queue);
+    return 0;
+}
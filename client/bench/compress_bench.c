@@ -0,0 +1,199 @@
+// Micro-benchmark de la compression des tuiles
+//
+// Compresse une image clé complète (toutes les tuiles, comme la première
+// image d'un flux) de contenus synthétiques : bureau fixe, bureau avec une
+// zone de bruit (vidéo), bruit seul. Pour chaque codec et niveau, donne le
+// taux de compression, le débit sur un thread, le temps d'une image sur
+// tous les coeurs et le temps de décompression de toutes ses tuiles sur un
+// thread (le récepteur les décompresse au fil des paquets) : la somme des
+// deux est la latence ajoutée à l'image.
+// Usage : compress_bench [iterations]
+
+#include "compress.h"
+#include "frame_source.h"
+#include "parallel.h"
+#include <lz4.h>
+#include <zstd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const struct {
+    const char *name;
+    uint32_t width, height;
+} resolutions[] = {
+    { "1080p", 1920, 1080 },
+    { "4K",    3840, 2160 },
+};
+
+// Contenus de synth:MOTIF
+static const char *const patterns[] = { "static", "partial", "noise" };
+
+static const struct {
+    enum tile_codec codec;
+    int level;
+} configs[] = {
+    { CODEC_LZ4,  1 },
+    { CODEC_LZ4,  8 },
+    { CODEC_ZSTD, -1 },
+    { CODEC_ZSTD, 1 },
+    { CODEC_ZSTD, 3 },
+    { CODEC_ZSTD, 9 },
+};
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Compresse l'image une fois : les tuiles de ef sont remises à leur état
+// d'origine (tiles) avant chaque passage
+static double run_compress(struct tile_compressor *c, struct encoded_frame *ef,
+                           const struct tile_ref *tiles, int iterations)
+{
+    double total = 0;
+
+    for (int i = 0; i < iterations; i++)
+    {
+        free(ef->packed);
+        ef->packed = NULL;
+        memcpy(ef->tiles, tiles, ef->nb_tiles * sizeof(*tiles));
+
+        double t0 = now_s();
+        compress_frame(c, ef);
+        total += now_s() - t0;
+    }
+    return total * 1000.0 / iterations;
+}
+
+// Décompresse une tuile, retourne sa taille (0 si invalide)
+static size_t decompress_tile(enum tile_codec codec, ZSTD_DCtx *dctx,
+                              const struct tile_ref *t, uint8_t *out, size_t capacity)
+{
+    if (codec == CODEC_LZ4)
+    {
+        int n = LZ4_decompress_safe((const char *)t->data, (char *)out, tile_bytes(t), capacity);
+        return n < 0 ? 0 : (size_t)n;
+    }
+    size_t n = ZSTD_decompressDCtx(dctx, out, capacity, t->data, tile_bytes(t));
+    return ZSTD_isError(n) ? 0 : n;
+}
+
+// Vérifie qu'on retrouve les tuiles originales, puis mesure la
+// décompression de toutes les tuiles. Retourne le temps moyen en
+// millisecondes, -1 si une tuile diffère.
+static double run_decompress(enum tile_codec codec, const struct encoded_frame *ef,
+                             const struct tile_ref *tiles, int iterations)
+{
+    static uint8_t out[TILE_SIZE * TILE_SIZE * 4], ref[TILE_SIZE * TILE_SIZE * 4];
+    ZSTD_DCtx *dctx = ZSTD_createDCtx();
+
+    for (uint32_t i = 0; i < ef->nb_tiles; i++)
+    {
+        if (!ef->tiles[i].compressed)
+        {
+            continue;
+        }
+        size_t n = decompress_tile(codec, dctx, &ef->tiles[i], out, sizeof(out));
+        tile_copy(&tiles[i], 0, ref, tile_bytes(&tiles[i]));
+        if (n != tile_bytes(&tiles[i]) || memcmp(out, ref, n) != 0)
+        {
+            ZSTD_freeDCtx(dctx);
+            return -1;
+        }
+    }
+
+    double t0 = now_s();
+    for (int it = 0; it < iterations; it++)
+    {
+        for (uint32_t i = 0; i < ef->nb_tiles; i++)
+        {
+            if (ef->tiles[i].compressed)
+            {
+                decompress_tile(codec, dctx, &ef->tiles[i], out, sizeof(out));
+            }
+        }
+    }
+    ZSTD_freeDCtx(dctx);
+    return (now_s() - t0) * 1000.0 / iterations;
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 20;
+    if (iterations <= 0)
+    {
+        iterations = 1;
+    }
+    unsigned cores = cpu_count();
+
+    printf("%-6s %-8s %-8s %8s %10s %12s %14s %12s\n", "res", "contenu", "codec",
+           "ratio", "Mo/s (1t)", "ms/image", "décomp. ms", "ms ajoutées");
+    for (size_t r = 0; r < sizeof(resolutions) / sizeof(resolutions[0]); r++)
+    {
+        for (size_t p = 0; p < sizeof(patterns) / sizeof(patterns[0]); p++)
+        {
+            struct frame_source *src = synthetic_source_open(patterns[p], resolutions[r].width,
+                                                             resolutions[r].height);
+            struct screen_data sd = {0};
+            if (!src || src->next(src, &sd) != 0)
+            {
+                return 1;
+            }
+
+            struct delta_encoder enc;
+            struct encoded_frame ef;
+            delta_encoder_init(&enc, 0, 0);
+            if (delta_encode(&enc, &sd, 0, &ef) < 0)
+            {
+                return 1;
+            }
+            struct tile_ref *tiles = malloc(ef.nb_tiles * sizeof(*tiles));
+            if (!tiles)
+            {
+                perror("malloc");
+                return 1;
+            }
+            memcpy(tiles, ef.tiles, ef.nb_tiles * sizeof(*tiles));
+
+            for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++)
+            {
+                struct tile_compressor one, all;
+                char label[16];
+
+                compressor_init(&one, configs[c].codec, configs[c].level, 1);
+                compressor_init(&all, configs[c].codec, configs[c].level, cores);
+                snprintf(label, sizeof(label), "%s:%d", codec_name(configs[c].codec),
+                         configs[c].level);
+
+                // Un thread pour le débit d'un coeur, puis tous les coeurs
+                // pour la latence (les tuiles de ef restent compressées par
+                // ce dernier passage pour la décompression)
+                double ms1 = run_compress(&one, &ef, tiles, iterations);
+                double ms = run_compress(&all, &ef, tiles, iterations);
+                double dms = run_decompress(configs[c].codec, &ef, tiles, iterations);
+                if (dms < 0)
+                {
+                    fprintf(stderr, "%s : tuile décompressée différente\n", label);
+                    return 1;
+                }
+
+                printf("%-6s %-8s %-8s %8.2f %10.0f %12.2f %14.2f %12.2f\n",
+                       resolutions[r].name, patterns[p], label,
+                       (double)all.raw_bytes / all.packed_bytes,
+                       one.raw_bytes / (double)one.frames / (1024.0 * 1024.0) / (ms1 / 1000.0),
+                       ms, dms, ms + dms);
+            }
+
+            encoded_frame_clear(&ef);
+            free(tiles);
+            free(sd.data);
+            delta_encoder_destroy(&enc);
+            src->close(src);
+        }
+    }
+    return 0;
+}
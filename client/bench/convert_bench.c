@@ -0,0 +1,178 @@
+// Micro-benchmark des noyaux de conversion RGB(A) -> BGRx, puis BGRx vers
+// les formats réseau compacts
+//
+// Pour chaque résolution et chaque nombre de canaux (ou format), mesure
+// chaque noyau supporté par le CPU sur un thread, puis le meilleur sur tous
+// les coeurs.
+// Usage : convert_bench [iterations]
+
+#include "convert.h"
+#include "parallel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static const struct {
+    const char *name;
+    uint32_t width, height;
+} resolutions[] = {
+    { "720p",  1280,  720 },
+    { "1080p", 1920, 1080 },
+    { "1440p", 2560, 1440 },
+    { "4K",    3840, 2160 },
+    { "8K",    7680, 4320 },
+};
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Formats réseau mesurés (BGRx n'a pas de conversion)
+static const enum pixel_format formats[] = {
+    PIXEL_FORMAT_BGR24, PIXEL_FORMAT_RGB565, PIXEL_FORMAT_YUV420
+};
+
+// Retourne le temps moyen d'une conversion en millisecondes
+static double run(const struct convert_kernel *k, const uint8_t *src,
+                  uint32_t rowstride, int channels, uint32_t w, uint32_t h,
+                  uint8_t *dst, unsigned threads, int iterations)
+{
+    // Un tour à vide pour charger les caches et les pages
+    convert_image(k, src, rowstride, channels, w, h, dst, threads);
+
+    double t0 = now_s();
+    for (int i = 0; i < iterations; i++)
+    {
+        convert_image(k, src, rowstride, channels, w, h, dst, threads);
+    }
+    return (now_s() - t0) * 1000.0 / iterations;
+}
+
+static double run_format(const struct convert_kernel *k, enum pixel_format fmt,
+                         const uint8_t *src, uint32_t w, uint32_t h, uint8_t *dst,
+                         unsigned threads, int iterations)
+{
+    convert_pixels(k, fmt, src, w, h, dst, threads);
+
+    double t0 = now_s();
+    for (int i = 0; i < iterations; i++)
+    {
+        convert_pixels(k, fmt, src, w, h, dst, threads);
+    }
+    return (now_s() - t0) * 1000.0 / iterations;
+}
+
+// BGRx -> formats réseau, avec le volume envoyé par image clé
+static int bench_formats(const struct convert_kernel *kernels, unsigned nb_kernels,
+                         unsigned cores, int iterations)
+{
+    printf("\n%-6s %-7s %-14s %10s %10s %10s\n", "res", "format", "noyau",
+           "ms/image", "Mpix/s", "Mo/image");
+
+    for (size_t r = 0; r < sizeof(resolutions) / sizeof(resolutions[0]); r++)
+    {
+        uint32_t w = resolutions[r].width, h = resolutions[r].height;
+        uint8_t *src = malloc((size_t)w * h * 4);
+        uint8_t *dst = malloc((size_t)w * h * 4);
+
+        if (!src || !dst)
+        {
+            perror("malloc");
+            return -1;
+        }
+        for (size_t i = 0; i < (size_t)w * h * 4; i++)
+        {
+            src[i] = (uint8_t)(i * 131);
+        }
+
+        double mpix = (double)w * h / 1e6;
+        for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++)
+        {
+            double mb = pixel_image_bytes(formats[f], w, h) / 1e6;
+            for (unsigned k = 0; k < nb_kernels; k++)
+            {
+                double ms = run_format(&kernels[k], formats[f], src, w, h, dst, 1, iterations);
+                printf("%-6s %-7s %-14s %10.3f %10.1f %10.2f\n", resolutions[r].name,
+                       pixel_format_name(formats[f]), kernels[k].name, ms,
+                       mpix / (ms / 1000.0), mb);
+            }
+
+            if (cores > 1)
+            {
+                char label[32];
+                const struct convert_kernel *best = &kernels[nb_kernels - 1];
+                double ms = run_format(best, formats[f], src, w, h, dst, cores, iterations);
+                snprintf(label, sizeof(label), "%s x%u", best->name, cores);
+                printf("%-6s %-7s %-14s %10.3f %10.1f %10.2f\n", resolutions[r].name,
+                       pixel_format_name(formats[f]), label, ms, mpix / (ms / 1000.0), mb);
+            }
+        }
+
+        free(src);
+        free(dst);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 20;
+    unsigned nb_kernels;
+    const struct convert_kernel *kernels = convert_kernels(&nb_kernels);
+    unsigned cores = cpu_count();
+
+    if (iterations <= 0)
+    {
+        iterations = 1;
+    }
+
+    printf("%-6s %-3s %-14s %10s %10s\n", "res", "ch", "noyau", "ms/image", "Mpix/s");
+
+    for (size_t r = 0; r < sizeof(resolutions) / sizeof(resolutions[0]); r++)
+    {
+        uint32_t w = resolutions[r].width, h = resolutions[r].height;
+
+        for (int channels = 3; channels <= 4; channels++)
+        {
+            // Lignes alignées sur 4 octets comme celles de GdkPixbuf
+            uint32_t rowstride = (w * channels + 3) & ~3u;
+            uint8_t *src = malloc((size_t)rowstride * h);
+            uint8_t *dst = malloc((size_t)w * h * 4);
+
+            if (!src || !dst)
+            {
+                perror("malloc");
+                return 1;
+            }
+            for (size_t i = 0; i < (size_t)rowstride * h; i++)
+            {
+                src[i] = (uint8_t)(i * 131);
+            }
+
+            double mpix = (double)w * h / 1e6;
+            for (unsigned k = 0; k < nb_kernels; k++)
+            {
+                double ms = run(&kernels[k], src, rowstride, channels, w, h, dst, 1, iterations);
+                printf("%-6s %-3d %-14s %10.3f %10.1f\n", resolutions[r].name,
+                       channels, kernels[k].name, ms, mpix / (ms / 1000.0));
+            }
+
+            if (cores > 1)
+            {
+                char label[32];
+                const struct convert_kernel *best = &kernels[nb_kernels - 1];
+                double ms = run(best, src, rowstride, channels, w, h, dst, cores, iterations);
+                snprintf(label, sizeof(label), "%s x%u", best->name, cores);
+                printf("%-6s %-3d %-14s %10.3f %10.1f\n", resolutions[r].name,
+                       channels, label, ms, mpix / (ms / 1000.0));
+            }
+
+            free(src);
+            free(dst);
+        }
+    }
+    return bench_formats(kernels, nb_kernels, cores, iterations) < 0 ? 1 : 0;
+}
@@ -0,0 +1,307 @@
+// Micro-benchmark du décodage PNG avant l'envoi
+//
+// Compare le décodage de l'image entière (comme convert_png_to_raw : pixels
+// RGB décodés, puis convertis en BGRx dans un second buffer) et le décodage
+// par bandes de 64 lignes de png_stream. Mesure le délai avant la première
+// bande prête (le premier paquet pourrait partir), le temps total et le pic
+// mémoire, chaque méthode tournant dans son propre processus.
+// Usage : decode_bench [fichier.png]   (sans fichier : images synthétiques)
+
+#include "convert.h"
+#include "png_stream.h"
+#include <png.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BAND_ROWS 64
+
+static const struct {
+    const char *name;
+    uint32_t width, height;
+} resolutions[] = {
+    { "1080p", 1920, 1080 },
+    { "4K",    3840, 2160 },
+};
+
+struct png_file {
+    uint8_t *data;
+    size_t length, capacity;
+};
+
+// Résultat d'une mesure, renvoyé au parent par un tube
+struct result {
+    double first_ms, total_ms;
+};
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void write_memory(png_structp png, png_bytep in, png_size_t len)
+{
+    struct png_file *f = png_get_io_ptr(png);
+
+    if (f->length + len > f->capacity)
+    {
+        f->capacity = (f->length + len) * 2;
+        f->data = realloc(f->data, f->capacity);
+        if (!f->data)
+        {
+            png_error(png, "realloc");
+        }
+    }
+    memcpy(f->data + f->length, in, len);
+    f->length += len;
+}
+
+static void flush_memory(png_structp png)
+{
+    (void)png;
+}
+
+// Image de bureau synthétique encodée en PNG RGB : aplats, dégradés et un
+// peu de bruit, pour que zlib ait un travail réaliste
+static int make_png(uint32_t w, uint32_t h, struct png_file *f)
+{
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    png_infop info = png ? png_create_info_struct(png) : NULL;
+    uint8_t *row = malloc((size_t)w * 3);
+    if (!info || !row || setjmp(png_jmpbuf(png)))
+    {
+        png_destroy_write_struct(&png, info ? &info : NULL);
+        free(row);
+        return -1;
+    }
+
+    memset(f, 0, sizeof(*f));
+    png_set_write_fn(png, f, write_memory, flush_memory);
+    png_set_IHDR(png, info, w, h, 8, PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
+                 PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png, info);
+
+    uint32_t seed = 1;
+    for (uint32_t y = 0; y < h; y++)
+    {
+        for (uint32_t x = 0; x < w; x++)
+        {
+            uint8_t *p = row + x * 3;
+            if (x < w / 4)
+            {
+                // Barre latérale unie
+                p[0] = 0x30; p[1] = 0x34; p[2] = 0x3A;
+            }
+            else if (y < h / 2)
+            {
+                p[0] = x * 255 / w; p[1] = y * 255 / h; p[2] = 0x80;
+            }
+            else
+            {
+                seed = seed * 1103515245 + 12345;
+                p[0] = p[1] = p[2] = (seed >> 16) & 0xFF;
+            }
+        }
+        png_write_row(png, row);
+    }
+    png_write_end(png, info);
+    png_destroy_write_struct(&png, &info);
+    free(row);
+    return 0;
+}
+
+// Décodage complet puis conversion, comme convert_png_to_raw
+static int decode_whole(const struct png_file *f, struct result *r, double t0)
+{
+    png_image img;
+    memset(&img, 0, sizeof(img));
+    img.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_memory(&img, f->data, f->length))
+    {
+        return -1;
+    }
+    img.format = PNG_FORMAT_RGB;
+    uint8_t *rgb = malloc(PNG_IMAGE_SIZE(img));
+    uint8_t *raw = malloc((size_t)img.width * img.height * 4);
+    if (!rgb || !raw || !png_image_finish_read(&img, NULL, rgb, 0, NULL))
+    {
+        return -1;
+    }
+    convert_to_bgrx(rgb, img.width * 3, 3, img.width, img.height, raw);
+    free(rgb);
+
+    // La première bande n'est disponible qu'une fois toute l'image prête
+    r->first_ms = r->total_ms = (now_s() - t0) * 1000.0;
+    free(raw);
+    return 0;
+}
+
+// Décodage par bandes directement dans l'image BGRx
+static int decode_bands(const struct png_file *f, struct result *r, double t0)
+{
+    struct png_stream ps;
+    if (png_stream_open(&ps, f->data, f->length) < 0 || ps.interlaced)
+    {
+        return -1;
+    }
+    size_t stride = (size_t)ps.width * 4;
+    uint8_t *raw = malloc(stride * ps.height);
+    if (!raw)
+    {
+        return -1;
+    }
+    for (uint32_t y = 0; y < ps.height; y += BAND_ROWS)
+    {
+        uint32_t rows = ps.height - y < BAND_ROWS ? ps.height - y : BAND_ROWS;
+        if (png_stream_read(&ps, raw + y * stride, stride, rows) < 0)
+        {
+            return -1;
+        }
+        if (y == 0)
+        {
+            r->first_ms = (now_s() - t0) * 1000.0;
+        }
+    }
+    r->total_ms = (now_s() - t0) * 1000.0;
+    png_stream_close(&ps);
+    free(raw);
+    return 0;
+}
+
+static int decode_none(const struct png_file *f, struct result *r, double t0)
+{
+    (void)f;
+    (void)t0;
+    r->first_ms = r->total_ms = 0;
+    return 0;
+}
+
+static const struct {
+    const char *name;
+    int (*run)(const struct png_file *f, struct result *r, double t0);
+} methods[] = {
+    { "entier", decode_whole },
+    { "bandes", decode_bands },
+};
+
+// Lance la méthode dans un processus fils : son ru_maxrss ne compte que
+// sa propre mémoire (plus celle héritée du parent, mesurée à part)
+static int measure(int (*run)(const struct png_file *, struct result *, double),
+                   const struct png_file *f, struct result *r, long *maxrss_kb)
+{
+    int fds[2];
+    if (pipe(fds) < 0)
+    {
+        perror("pipe");
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        perror("fork");
+        return -1;
+    }
+    if (pid == 0)
+    {
+        close(fds[0]);
+        struct result res;
+        int ret = run(f, &res, now_s());
+        if (ret == 0 && write(fds[1], &res, sizeof(res)) != sizeof(res))
+        {
+            ret = -1;
+        }
+        _exit(ret == 0 ? 0 : 1);
+    }
+
+    close(fds[1]);
+    ssize_t n = read(fds[0], r, sizeof(*r));
+    close(fds[0]);
+
+    int status;
+    struct rusage ru;
+    if (wait4(pid, &status, 0, &ru) < 0 || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0 || n != sizeof(*r))
+    {
+        fprintf(stderr, "Échec du décodage\n");
+        return -1;
+    }
+    *maxrss_kb = ru.ru_maxrss;
+    return 0;
+}
+
+static int bench(const char *name, const struct png_file *f)
+{
+    struct result r;
+    long base_kb, rss_kb;
+
+    if (measure(decode_none, f, &r, &base_kb) < 0)
+    {
+        return -1;
+    }
+    for (size_t m = 0; m < sizeof(methods) / sizeof(methods[0]); m++)
+    {
+        if (measure(methods[m].run, f, &r, &rss_kb) < 0)
+        {
+            return -1;
+        }
+        printf("%-6s %8.1f %-8s %14.2f %12.2f %12.1f\n", name, f->length / 1e6,
+               methods[m].name, r.first_ms, r.total_ms, (rss_kb - base_kb) / 1024.0);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    convert_init(0);
+
+    printf("%-6s %8s %-8s %14s %12s %12s\n", "image", "PNG Mo", "decodage",
+           "1re bande ms", "total ms", "pic Mo");
+
+    if (argc > 1)
+    {
+        struct png_file f = {0};
+        FILE *fp = fopen(argv[1], "rb");
+        if (!fp)
+        {
+            perror(argv[1]);
+            return 1;
+        }
+        fseek(fp, 0, SEEK_END);
+        f.length = ftell(fp);
+        fseek(fp, 0, SEEK_SET);
+        f.data = malloc(f.length);
+        if (!f.data || fread(f.data, 1, f.length, fp) != f.length)
+        {
+            perror("fread");
+            fclose(fp);
+            return 1;
+        }
+        fclose(fp);
+        int ret = bench("fichier", &f);
+        free(f.data);
+        return ret < 0 ? 1 : 0;
+    }
+
+    for (size_t i = 0; i < sizeof(resolutions) / sizeof(resolutions[0]); i++)
+    {
+        struct png_file f;
+        if (make_png(resolutions[i].width, resolutions[i].height, &f) < 0)
+        {
+            fprintf(stderr, "Encodage PNG impossible\n");
+            return 1;
+        }
+        int ret = bench(resolutions[i].name, &f);
+        free(f.data);
+        if (ret < 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,166 @@
+// Micro-benchmark de la correction d'erreurs
+//
+// Mesure chaque noyau de multiplication-accumulation GF(2^8) supporté par
+// le CPU, puis le coût du calcul des parités d'une image 1080p pour
+// plusieurs tailles de groupe, sur un thread.
+// Usage : fec_bench [iterations]
+
+#include "fec.h"
+#include "gf256.h"
+#include "network.h"
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const struct {
+    unsigned k, m;
+} configs[] = {
+    { 64, 1 },
+    { 32, 1 },
+    { 32, 2 },
+    { 16, 2 },
+    { 32, 4 },
+    { 64, 8 },
+};
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Débit d'un noyau en Go/s sur des symboles de FEC_SYMBOL octets
+static double run_kernel(const struct gf256_kernel *k, const uint8_t *src,
+                         uint8_t *dst, size_t symbols, int iterations)
+{
+    double t0 = now_s();
+    for (int it = 0; it < iterations; it++)
+    {
+        for (size_t s = 0; s < symbols; s++)
+        {
+            k->mul_add(dst, src + s * FEC_SYMBOL, FEC_SYMBOL, (uint8_t)(s | 2));
+        }
+    }
+    return (double)symbols * FEC_SYMBOL * iterations / (now_s() - t0) / 1e9;
+}
+
+// Calcule les parités de toutes les tuiles de l'image comme send_image_data.
+// Retourne le nombre d'octets de pixels protégés.
+static size_t encode_frame(struct fec_encoder *fec, const struct encoded_frame *ef)
+{
+    size_t bytes = 0;
+    uint32_t seq = 0;
+
+    fec_begin(fec, 0);
+    for (uint32_t i = 0; i < ef->nb_tiles; i++)
+    {
+        const struct tile_ref *t = &ef->tiles[i];
+        for (size_t offset = 0; offset < tile_bytes(t); offset += PACKET_PAYLOAD)
+        {
+            size_t size = tile_bytes(t) - offset < PACKET_PAYLOAD ?
+                          tile_bytes(t) - offset : PACKET_PAYLOAD;
+            struct tile_header th = {
+                .tile_id = htonl(t->tile_id),
+                .offset = htonl(tile_wire_offset(t, offset))
+            };
+
+            fec_add(fec, (const uint8_t *)&th, t, offset, size);
+            bytes += size;
+            if (++seq % fec->k == 0)
+            {
+                fec_begin(fec, seq);
+            }
+        }
+    }
+    return bytes;
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 200;
+    if (iterations <= 0)
+    {
+        iterations = 1;
+    }
+
+    unsigned nb_kernels;
+    const struct gf256_kernel *kernels = gf256_kernels(&nb_kernels);
+
+    // 256 Ko de symboles : tiennent dans le cache, on mesure le calcul seul
+    // (le coût mémoire apparaît dans la mesure sur une image complète)
+    size_t symbols = 256 * 1024 / FEC_SYMBOL;
+    uint8_t *src = malloc(symbols * FEC_SYMBOL);
+    uint8_t dst[FEC_SYMBOL] = {0};
+    if (!src)
+    {
+        perror("malloc");
+        return 1;
+    }
+    for (size_t i = 0; i < symbols * FEC_SYMBOL; i++)
+    {
+        src[i] = (uint8_t)(i * 131);
+    }
+
+    printf("%-10s %10s\n", "noyau", "Go/s");
+    for (unsigned k = 0; k < nb_kernels; k++)
+    {
+        printf("%-10s %10.2f\n", kernels[k].name,
+               run_kernel(&kernels[k], src, dst, symbols, iterations));
+    }
+    free(src);
+
+    // Image 1080p complète (image clé) découpée comme par le client
+    struct screen_data sd = { .width = 1920, .height = 1080 };
+    sd.length = (size_t)sd.width * sd.height * PIXEL_BYTES;
+    sd.data = malloc(sd.length);
+    if (!sd.data)
+    {
+        perror("malloc");
+        return 1;
+    }
+    for (size_t i = 0; i < sd.length; i++)
+    {
+        sd.data[i] = (uint8_t)(i * 7);
+    }
+
+    struct delta_encoder enc;
+    struct encoded_frame ef;
+    delta_encoder_init(&enc, 0, 0);
+    if (delta_encode(&enc, &sd, 0, &ef) < 0)
+    {
+        return 1;
+    }
+
+    printf("\n%-8s %10s %12s %16s\n", "k+m", "surcoût", "Gbit/s", "coeur à 10 Gbit/s");
+    for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++)
+    {
+        struct fec_encoder fec;
+        char label[16];
+
+        if (fec_init(&fec, configs[c].k, configs[c].m) < 0)
+        {
+            return 1;
+        }
+
+        size_t bytes = encode_frame(&fec, &ef);
+        double t0 = now_s();
+        for (int it = 0; it < iterations / 10 + 1; it++)
+        {
+            encode_frame(&fec, &ef);
+        }
+        double gbits = (double)bytes * 8 * (iterations / 10 + 1) / (now_s() - t0) / 1e9;
+
+        snprintf(label, sizeof(label), "%u+%u", configs[c].k, configs[c].m);
+        printf("%-8s %9.1f%% %12.2f %15.1f%%\n", label,
+               100.0 * configs[c].m / configs[c].k, gbits, 100.0 * 10.0 / gbits);
+        fec_destroy(&fec);
+    }
+
+    encoded_frame_clear(&ef);
+    delta_encoder_destroy(&enc);
+    free(sd.data);
+    return 0;
+}
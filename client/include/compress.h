@@ -0,0 +1,51 @@
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "delta.h"
+
+// Compression des tuiles avant l'envoi. Chaque tuile est compressée seule :
+// le récepteur la décompresse dès que ses paquets sont arrivés, et un paquet
+// perdu n'abîme que sa tuile. Une tuile que la compression n'a pas réduite
+// part brute.
+enum tile_codec {
+    CODEC_NONE,
+    CODEC_LZ4,                 // Rapide, pour la latence
+    CODEC_ZSTD,                // Plus compact, pour les liens lents
+    CODEC_COUNT
+};
+
+// Niveau par défaut de chaque codec (accélération pour LZ4)
+#define LZ4_DEFAULT_LEVEL  1
+#define ZSTD_DEFAULT_LEVEL 3
+
+struct tile_compressor {
+    enum tile_codec codec;
+    int      level;            // Niveau Zstd, ou accélération LZ4
+    unsigned threads;          // Threads qui se partagent les tuiles
+    // Statistiques cumulées (accès atomique : lues par le thread principal)
+    uint64_t frames;
+    uint64_t tiles;            // Tuiles traitées
+    uint64_t raw_tiles;        // Tuiles envoyées brutes (incompressibles)
+    uint64_t raw_bytes;        // Octets avant compression
+    uint64_t packed_bytes;     // Octets envoyés (tuiles brutes comprises)
+    uint64_t busy_ns;          // Temps passé dans compress_frame
+};
+
+// threads = 0 : un par coeur
+void compressor_init(struct tile_compressor *c, enum tile_codec codec, int level,
+                     unsigned threads);
+
+// Compresse les tuiles de ef en parallèle dans ef->packed et les fait
+// pointer sur leurs données compressées
+int compress_frame(struct tile_compressor *c, struct encoded_frame *ef);
+
+// Taux de compression et débit depuis le démarrage
+void compressor_report(const struct tile_compressor *c, FILE *out);
+
+// "lz4", "zstd" ou "none", suivi de :niveau. Retourne -1 si invalide.
+int codec_parse(const char *arg, enum tile_codec *codec, int *level);
+const char *codec_name(enum tile_codec codec);
+
+#endif // COMPRESS_H
@@ -0,0 +1,52 @@
+#ifndef CONVERT_H
+#define CONVERT_H
+
+#include <stdint.h>
+#include "pixel_format.h"
+
+// Convertit une ligne de width pixels : RGB (3 octets) ou RGBA (4 octets)
+// en BGRx (4 octets, X = 0xFF), ou BGRx vers un format réseau plus compact
+typedef void (*convert_row_fn)(const uint8_t *src, uint8_t *dst, uint32_t width);
+
+// Convertit deux lignes BGRx de width pixels en une ligne de blocs 2x2
+typedef void (*convert_pair_fn)(const uint8_t *row0, const uint8_t *row1,
+                                uint8_t *dst, uint32_t width);
+
+// Jeu de noyaux de conversion pour un niveau d'instructions
+struct convert_kernel {
+    const char *name;
+    convert_row_fn rgb;
+    convert_row_fn rgba;
+    convert_row_fn bgr24;      // BGRx -> PIXEL_FORMAT_BGR24
+    convert_row_fn rgb565;     // BGRx -> PIXEL_FORMAT_RGB565
+    convert_pair_fn yuv420;    // BGRx -> PIXEL_FORMAT_YUV420
+};
+
+// Choisit le meilleur noyau supporté par le CPU et le nombre de threads
+// utilisés pour convertir une image (0 = un par coeur)
+void convert_init(unsigned threads);
+
+// Noyau choisi par convert_init
+const struct convert_kernel *convert_kernel(void);
+
+// Tous les noyaux supportés par le CPU, du plus simple au plus rapide
+const struct convert_kernel *convert_kernels(unsigned *count);
+
+// Convertit une image entière, les lignes étant réparties sur les threads
+void convert_image(const struct convert_kernel *k, const uint8_t *pixels,
+                   uint32_t rowstride, int channels, uint32_t width,
+                   uint32_t height, uint8_t *dst, unsigned threads);
+
+// Convertit une image BGRx vers le format réseau fmt (pixel_image_bytes
+// octets dans dst), les lignes étant réparties sur les threads
+void convert_pixels(const struct convert_kernel *k, enum pixel_format fmt,
+                    const uint8_t *bgrx, uint32_t width, uint32_t height,
+                    uint8_t *dst, unsigned threads);
+
+// Convertit une image avec le noyau et les threads de convert_init
+void convert_to_bgrx(const uint8_t *pixels, uint32_t rowstride, int channels,
+                     uint32_t width, uint32_t height, uint8_t *dst);
+void convert_to_format(enum pixel_format fmt, const uint8_t *bgrx, uint32_t width,
+                       uint32_t height, uint8_t *dst);
+
+#endif // CONVERT_H
@@ -0,0 +1,74 @@
+#ifndef DELTA_H
+#define DELTA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+#include "screenshot.h"
+
+// Côté d'une tuile en pixels (les tuiles du bord droit/bas peuvent être
+// plus petites), soit TILE_SIZE / 2 blocs en 4:2:0
+#define TILE_SIZE 64
+
+// Une image clé est envoyée toutes les KEYFRAME_INTERVAL images par défaut
+#define KEYFRAME_INTERVAL 60
+
+// Drapeaux d'une image (champ flags du header)
+#define FRAME_FLAG_KEYFRAME (1u << 0)   // Toutes les tuiles sont présentes
+
+// Format des pixels de l'image (enum pixel_format), bits 4 à 7 des drapeaux
+#define FRAME_FLAG_FORMAT(fmt) ((uint32_t)(fmt) << 4)
+
+// Compression des tuiles de l'image (enum tile_codec), bits 2 et 3
+#define FRAME_FLAG_CODEC(codec) ((uint32_t)(codec) << 2)
+
+// Une tuile à envoyer : rows lignes de row_bytes octets espacées de stride
+struct tile_ref {
+    uint32_t tile_id;          // Index de la tuile (ligne * tiles_x + colonne)
+    const uint8_t *data;       // Premier octet de la tuile
+    size_t   stride;           // Distance entre deux lignes dans data
+    uint32_t row_bytes;        // Octets utiles par ligne
+    uint32_t rows;             // Nombre de lignes
+    int      compressed;       // Données compressées (une seule « ligne »)
+};
+
+// Image découpée en tuiles modifiées, prête à être mise en paquets
+struct encoded_frame {
+    uint32_t image_id;
+    uint32_t width, height;
+    uint32_t flags;            // FRAME_FLAG_*
+    uint32_t nb_tiles;         // Nombre de tuiles à envoyer
+    struct tile_ref *tiles;
+    uint8_t *packed;           // Tuiles compressées (compress_frame), NULL sinon
+};
+
+// Mémorise les pixels de la dernière image envoyée
+struct delta_encoder {
+    uint32_t width, height;
+    uint32_t tiles_x, tiles_y;
+    enum pixel_format format;  // Format des pixels de l'image précédente
+    uint8_t  *previous;        // Copie des tuiles envoyées, même stride que l'image
+    unsigned keyframe_interval;
+    unsigned since_keyframe;   // Images envoyées depuis la dernière clé
+    int      need_keyframe;
+    int      interleave;       // Tuiles dans l'ordre entrelacé plutôt que des lignes
+};
+
+void delta_encoder_init(struct delta_encoder *enc, unsigned keyframe_interval, int interleave);
+int delta_encode(struct delta_encoder *enc, const struct screen_data *sd,
+                 uint32_t image_id, struct encoded_frame *out);
+int delta_keyframe(const struct screen_data *sd, uint32_t image_id,
+                   struct encoded_frame *out);
+void delta_encoder_destroy(struct delta_encoder *enc);
+void encoded_frame_clear(struct encoded_frame *ef);
+
+static inline size_t tile_bytes(const struct tile_ref *t)
+{
+    return (size_t)t->row_bytes * t->rows;
+}
+
+void tile_copy(const struct tile_ref *t, size_t offset, uint8_t *dst, size_t len);
+unsigned tile_iov(const struct tile_ref *t, size_t offset, size_t len,
+                  struct iovec *iov);
+
+#endif // DELTA_H
@@ -0,0 +1,38 @@
+#ifndef FEC_H
+#define FEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "delta.h"
+
+// Correction d'erreurs par groupes : après k paquets de données consécutifs,
+// m paquets de parité permettent au serveur de reconstruire jusqu'à m
+// paquets perdus du groupe sans aller-retour. Le code est un Reed-Solomon
+// systématique à matrice de Cauchy sur GF(2^8), dont la première ligne ne
+// contient que des 1 : avec m = 1, la parité est un simple XOR.
+#define FEC_MAX_K 128
+#define FEC_MAX_M 32
+
+// Calcul des parités du groupe en cours
+struct fec_encoder {
+    unsigned k, m;             // 0 = pas de correction d'erreurs
+    uint32_t first;            // Premier paquet du groupe
+    unsigned count;            // Paquets de données déjà pris en compte
+    uint8_t *parity;           // m symboles de FEC_SYMBOL octets (network.h)
+};
+
+int fec_init(struct fec_encoder *fec, unsigned k, unsigned m);
+void fec_destroy(struct fec_encoder *fec);
+
+// Coefficient du paquet de données i dans la parité j
+uint8_t fec_coef(unsigned j, unsigned i);
+
+// Commence un groupe au paquet first
+void fec_begin(struct fec_encoder *fec, uint32_t first);
+
+// Ajoute au groupe le paquet suivant : son tile_header tel qu'envoyé puis
+// size octets de la tuile à partir de offset (complétés par des zéros)
+void fec_add(struct fec_encoder *fec, const uint8_t *tile_header,
+             const struct tile_ref *t, size_t offset, size_t size);
+
+#endif // FEC_H
@@ -0,0 +1,34 @@
+#ifndef FRAME_SOURCE_H
+#define FRAME_SOURCE_H
+
+#include "screenshot.h"
+
+// Résolution maximale acceptée par les sources synthétiques (8K)
+#define SOURCE_MAX_WIDTH  7680
+#define SOURCE_MAX_HEIGHT 4320
+
+// Une source d'images. next() remplit sd avec une nouvelle image (PNG ou
+// BGRx selon sd->format) dont l'appelant devient propriétaire.
+struct frame_source {
+    const char *name;
+    int  (*next)(struct frame_source *src, struct screen_data *sd);
+    void (*close)(struct frame_source *src);
+    void *priv;
+};
+
+// Ouvre une source à partir de sa description :
+//   portal                      capture via xdg-desktop-portal (défaut)
+//   files:CHEMIN                fichiers .ppm/.png d'un dossier, en boucle
+//   synth:MOTIF:LxH             générateur synthétique, MOTIF parmi
+//                               static, scroll, noise, partial
+struct frame_source *frame_source_open(const char *spec);
+
+int frame_source_next(struct frame_source *src, struct screen_data *sd);
+void frame_source_close(struct frame_source *src);
+
+struct frame_source *portal_source_open(void);
+struct frame_source *file_source_open(const char *path);
+struct frame_source *synthetic_source_open(const char *pattern,
+                                           guint32 width, guint32 height);
+
+#endif // FRAME_SOURCE_H
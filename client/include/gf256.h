@@ -0,0 +1,30 @@
+#ifndef GF256_H
+#define GF256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Arithmétique dans GF(2^8) (polynôme 0x11D) pour les codes correcteurs
+
+// dst ^= c * src sur len octets
+typedef void (*gf256_mul_add_fn)(uint8_t *dst, const uint8_t *src, size_t len, uint8_t c);
+
+// Noyau de multiplication-accumulation pour un niveau d'instructions
+struct gf256_kernel {
+    const char *name;
+    gf256_mul_add_fn mul_add;
+};
+
+// Construit les tables et choisit le meilleur noyau supporté par le CPU
+void gf256_init(void);
+
+// Tous les noyaux supportés par le CPU, du plus simple au plus rapide
+const struct gf256_kernel *gf256_kernels(unsigned *count);
+
+uint8_t gf256_mul(uint8_t a, uint8_t b);
+uint8_t gf256_inv(uint8_t a);
+
+// dst ^= c * src avec le noyau choisi par gf256_init
+void gf256_mul_add(uint8_t *dst, const uint8_t *src, size_t len, uint8_t c);
+
+#endif // GF256_H
@@ -0,0 +1,53 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define METRICS_BUCKETS 32
+
+// Histogramme par puissances de 2 : le seau i compte les valeurs de
+// [2^(i-1), 2^i[, le seau 0 les valeurs nulles. Un seul thread l'écrit,
+// sans verrou ; les autres peuvent le lire à tout moment.
+struct metrics_hist {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t buckets[METRICS_BUCKETS];
+};
+
+// Mise à jour d'un compteur par le seul thread qui l'écrit : une lecture et
+// une écriture simples (pas d'instruction atomique verrouillée)
+#define METRIC_ADD(field, n) \
+    __atomic_store_n(&(field), (field) + (n), __ATOMIC_RELAXED)
+
+static inline void metrics_hist_add(struct metrics_hist *h, uint64_t value)
+{
+    unsigned b = value ? 64 - __builtin_clzll(value) : 0;
+    if (b >= METRICS_BUCKETS)
+    {
+        b = METRICS_BUCKETS - 1;
+    }
+    METRIC_ADD(h->count, 1);
+    METRIC_ADD(h->sum, value);
+    METRIC_ADD(h->buckets[b], 1);
+}
+
+// Borne haute du seau qui contient le centile p (0 à 1)
+uint64_t metrics_hist_percentile(const struct metrics_hist *h, double p);
+
+// Socket Unix des statistiques : chaque connexion reçoit l'état courant
+// puis la socket est fermée
+struct metrics_endpoint {
+    int fd;                   // Socket d'écoute (-1 = aucune)
+    const char *path;
+};
+
+int metrics_listen(struct metrics_endpoint *ep, const char *path);
+
+// Attend au plus timeout_ms. Retourne 1 si un lecteur attend l'état
+// courant (à lui passer avec metrics_send).
+int metrics_poll(struct metrics_endpoint *ep, int timeout_ms);
+void metrics_send(struct metrics_endpoint *ep, const char *text, size_t len);
+void metrics_close(struct metrics_endpoint *ep);
+
+#endif // METRICS_H
@@ -2,13 +2,29 @@
 #define NETWORK_H
 
 #include <netinet/in.h>
+#include <sys/socket.h>
 #include <liburing.h>
 #include "screenshot.h"
+#include "delta.h"
+#include "retransmit.h"
+#include "fec.h"
+#include "pacing.h"
+#include "metrics.h"
 #include <stdint.h>
+#include <stdio.h>
 
-#define PIXEL_BYTES 4
+#define PIXEL_BYTES 4           // Pixel BGRx des sources, avant conversion
+
+// Taille d'un datagramme, la même que celle du serveur. Peut être changée à
+// la compilation (-DPACKET_SIZE=1400) pour comparer plusieurs tailles.
+#ifndef PACKET_SIZE
 #define PACKET_SIZE 1000
-#define SERVER_ADDR "192.168.1.241"
+#endif
+#if PACKET_SIZE < 128 || PACKET_SIZE > 8192
+#error "PACKET_SIZE doit être compris entre 128 et 8192"
+#endif
+
+#define SERVER_ADDR "192.168.1.241" // Destination par défaut (option -a)
 #define SERVER_PORT 8080
 
 
@@ -18,10 +34,225 @@ struct __attribute__((packed)) packet_header {
     uint32_t total_packets;
     uint32_t width;
     uint32_t height;
+    uint32_t flags;            // FRAME_FLAG_* de l'image
+    uint32_t stream_id;        // Flux de l'émetteur (un par écran par exemple)
+};
+
+// Suit le packet_header : situe les données du paquet dans une tuile
+struct __attribute__((packed)) tile_header {
+    uint32_t tile_id;          // Index de la tuile (ligne * tiles_x + colonne)
+    uint32_t offset;           // Position des données dans la tuile (octets)
+};
+
+// Image compressée (FRAME_FLAG_CODEC) : les 16 bits de poids fort de offset
+// portent la taille compressée de la tuile, 0 pour une tuile envoyée brute
+static inline uint32_t tile_wire_offset(const struct tile_ref *t, size_t offset)
+{
+    return t->compressed ? (uint32_t)tile_bytes(t) << 16 | (uint32_t)offset : (uint32_t)offset;
+}
+
+// Paquet renvoyé à la demande du récepteur (champ flags, avec FRAME_FLAG_*)
+#define PACKET_FLAG_RETRANSMIT (1u << 8)
+
+// Paquet de parité : seq est le premier paquet de son groupe, les données
+// sont la parité des tile_header et des pixels des paquets du groupe
+#define PACKET_FLAG_PARITY     (1u << 9)
+
+// Taille k des groupes de correction d'erreurs (0 = aucune) et, pour une
+// parité, son numéro dans le groupe
+#define PACKET_FEC_K(k)        ((uint32_t)(k) << 24)
+#define PACKET_FEC_INDEX(j)    ((uint32_t)(j) << 16)
+
+// Retour du récepteur : plages de paquets manquants d'une image
+#define NACK_MAGIC 0x4E41434Bu    // "NACK"
+
+struct __attribute__((packed)) nack_header {
+    uint32_t magic;
+    uint32_t stream_id;
+    uint32_t image_id;
+    uint32_t nb_ranges;        // Nombre de nack_range qui suivent
+};
+
+struct __attribute__((packed)) nack_range {
+    uint32_t seq;              // Premier paquet manquant
+    uint32_t count;            // Nombre de paquets manquants consécutifs
 };
 
-int setup_socket(struct sockaddr_in *dest);
+#define NACK_MAX_RANGES ((PACKET_SIZE - sizeof(struct nack_header)) / sizeof(struct nack_range))
+
+// Retour du récepteur : bilan d'une image terminée, pour régler le débit
+#define REPORT_MAGIC 0x52505254u  // "RPRT"
+
+struct __attribute__((packed)) report_packet {
+    uint32_t magic;
+    uint32_t stream_id;
+    uint32_t image_id;
+    uint32_t total_packets;    // Paquets de données de l'image
+    uint32_t received;         // Arrivés du premier coup (ni renvoyés, ni reconstruits)
+    uint32_t parity;           // Paquets de parité arrivés
+    uint32_t span_us;          // Entre la première et la dernière arrivée
+};
+
+// Octets de pixels transportés par un paquet
+#define PACKET_PAYLOAD (PACKET_SIZE - sizeof(struct packet_header) - sizeof(struct tile_header))
+
+// Taille des deux headers en tête de chaque paquet
+#define PACKET_HEADERS (sizeof(struct packet_header) + sizeof(struct tile_header))
+
+// Symbole protégé par la correction d'erreurs : tile_header et pixels d'un
+// paquet (complétés par des zéros), soit tout ce qui suit le packet_header
+#define FEC_SYMBOL (PACKET_SIZE - sizeof(struct packet_header))
+
+// Nombre d'envois en vol par défaut (option -Q) et au plus. La ring
+// io_uring a deux entrées par envoi : les complétions du zero-copy vont
+// par deux.
+#define SENDER_QUEUE_DEPTH 32
+#define SENDER_MAX_DEPTH   4096
+
+// Inactivité après laquelle le thread SQPOLL du noyau s'endort (ms)
+#define SENDER_SQPOLL_IDLE 50
+
+// Complétions lues d'un coup dans la ring
+#define SENDER_CQE_BATCH   64
+
+// Un paquet pointe au plus sur une ligne par ligne de tuile, plus le header
+#define PACKET_MAX_IOV (1 + TILE_SIZE)
+
+// Avec UDP_SEGMENT, un envoi regroupe jusqu'à GSO_MAX_SEGMENTS paquets que le
+// noyau redécoupe (limite UDP_MAX_SEGMENTS des anciens noyaux, et autant de
+// paquets de PACKET_SIZE que peut en contenir un datagramme de 64 Ko)
+#define GSO_MAX_SEGMENTS (65000 / PACKET_SIZE < 64 ? 65000 / PACKET_SIZE : 64)
+
+// Nombre maximal d'iovec d'un envoi (UIO_MAXIOV)
+#define SLOT_MAX_IOV 1024
+
+// En zero-copy, chaque morceau de page référencé devient un fragment du
+// datagramme et le noyau en accepte au plus MAX_SKB_FRAGS (17 par défaut)
+#define ZC_MAX_FRAGS 16
+
+// Façon de remettre les paquets au noyau
+enum send_mode {
+    SEND_COPY,                 // Copie header + pixels dans un buffer du slot
+    SEND_IOVEC,                // sendmsg avec des iovec pointant dans l'image
+    SEND_ZEROCOPY,             // sendmsg zero-copy (IORING_OP_SENDMSG_ZC)
+    SEND_MMSG                  // sendmmsg par lots, sans io_uring
+};
+
+// Un envoi en vol : un paquet, ou plusieurs paquets consécutifs en GSO. Le
+// msghdr, les iovec et les headers restent valides jusqu'à ce que le noyau
+// n'en ait plus besoin (notification pour le zero-copy), le slot n'est
+// recyclé qu'à ce moment-là.
+struct tx_slot {
+    struct msghdr msgh;
+    struct iovec iov[SLOT_MAX_IOV];
+    unsigned nb_iov;
+    unsigned nb_packets;       // Paquets regroupés dans cet envoi
+    unsigned nb_frags;         // Pages référencées (limite du zero-copy)
+    uint8_t headers[GSO_MAX_SEGMENTS][PACKET_HEADERS];
+    uint8_t *bounce;           // Buffer de copie (mode SEND_COPY uniquement)
+    uint8_t *parity;           // Parités d'un groupe (correction d'erreurs active)
+    unsigned nb_parity;        // Paquets de parité dans cet envoi
+    uint8_t control[CMSG_SPACE(sizeof(uint64_t))]; // Heure de départ (SO_TXTIME)
+    int zerocopy;              // Envoyé avec IORING_OP_SENDMSG_ZC
+    unsigned pending;          // Complétions encore attendues (envoi, notification)
+};
+
+// État de l'émetteur : socket, ring et pool de slots préalloués
+struct udp_sender {
+    int sock;
+    struct io_uring ring;      // Inutilisée en mode SEND_MMSG
+    int sqpoll;                // Soumissions lues par un thread du noyau
+    int fixed_file;            // Socket enregistrée dans la ring (IOSQE_FIXED_FILE)
+    struct sockaddr_in dest;
+    enum send_mode mode;
+    int gso;                   // Segmentation UDP_SEGMENT active
+    uint32_t stream_id;        // Identifiant du flux placé dans chaque paquet
+    unsigned depth;            // Envois en vol au plus (taille du pool de slots)
+    struct tx_slot *slots;
+    struct tx_slot **free_slots;
+    unsigned nb_free;
+    // Mode SEND_MMSG : envois préparés, remis au noyau par un seul sendmmsg
+    struct mmsghdr *mmsg;
+    struct tx_slot **mmsg_slots;
+    unsigned nb_mmsg;
+    // Dernières images envoyées et réception des NACK du serveur
+    struct retx_buffer retx;
+    // Correction d'erreurs : parités du groupe en cours et envoi de celles
+    // d'un groupe terminé (à partir de fec_next)
+    struct fec_encoder fec;
+    int fec_ready;
+    unsigned fec_next;
+    // Image en cours d'envoi : prochain paquet, sa tuile et sa position
+    // dans la tuile (l'envoi peut se faire en plusieurs fois)
+    struct retx_frame *cur;
+    uint32_t cur_seq;
+    uint32_t cur_tile;
+    size_t cur_offset;
+    // Étalement des envois et régulation du débit
+    struct pacer pacer;
+    uint8_t feedback[PACKET_SIZE];
+    struct sockaddr_in fb_from;
+    struct iovec fb_iov;
+    struct msghdr fb_msgh;
+    int fb_armed;              // Réception des NACK en attente dans la ring
+    // Statistiques cumulées depuis le démarrage
+    uint64_t packets;          // Paquets remis au noyau
+    uint64_t sends;            // Envois soumis (un par SQE)
+    uint64_t bytes;            // Octets de pixels envoyés
+    uint64_t errors;           // Paquets en échec
+    uint64_t zc_fallbacks;     // Envois refaits sans zero-copy
+    uint64_t parity_packets;   // Paquets de parité envoyés
+    uint64_t wall_ns;          // Temps passé dans send_image_data
+    uint64_t cpu_ns;           // Temps CPU du thread d'envoi
+    struct metrics_hist cqe_batch; // Complétions traitées par réveil
+    struct metrics_hist in_flight; // Envois en vol à chaque attente
+};
+
+// Remplit dest à partir de "adresse[:port]" (port SERVER_PORT par défaut)
+int parse_address(const char *arg, struct sockaddr_in *dest);
+
+int setup_socket(void);
+
+// Prépare l'émetteur vers dest, avec au plus depth envois en vol. Avec
+// sqpoll, un thread du noyau lit les soumissions (sans appel système).
+int sender_init(struct udp_sender *tx, const struct sockaddr_in *dest,
+                enum send_mode mode, int gso, unsigned depth, int sqpoll);
+
+// Ajoute m paquets de parité après chaque groupe de k paquets de données
+int sender_set_fec(struct udp_sender *tx, unsigned k, unsigned m);
+
+// Étale les envois au débit rate (octets/s, 0 = au plus vite), ajusté
+// d'après les bilans du récepteur si adaptive (jusqu'à max_rate)
+void sender_set_pacing(struct udp_sender *tx, enum pacing_mode mode, uint64_t rate,
+                       int adaptive, uint64_t max_rate);
+void sender_destroy(struct udp_sender *tx);
+void sender_report(const struct udp_sender *tx, FILE *out);
+
+// Paires clé=valeur des compteurs de l'émetteur, pour la ligne « metrics ».
+// Retourne la longueur écrite (comme snprintf).
+int sender_metrics(const struct udp_sender *tx, char *buf, size_t size);
+
+size_t frame_packet_count(const struct encoded_frame *ef);
+
+// Envoie toutes les tuiles de l'image, après les paquets que le serveur a
+// redemandés. L'émetteur prend possession des tuiles (ef est remis à zéro) et
+// des pixels : ils sont gardés pour les retransmissions puis libérés.
+void send_image_data(struct udp_sender *tx, struct encoded_frame *ef,
+                     uint8_t *pixels);
+
+// Envoi progressif d'une image dont les tuiles sont remplies dans l'ordre
+// pendant l'envoi (le nombre de paquets doit être connu d'avance : tuiles
+// brutes). sender_begin_image prend possession de ef et des pixels comme
+// send_image_data, sender_send_tiles envoie les paquets des ready_tiles
+// premières tuiles sans attendre la fin des envois, et sender_finish_image
+// envoie le reste et attend comme send_image_data. Retourne -1 si l'image
+// n'a aucun paquet à envoyer.
+int sender_begin_image(struct udp_sender *tx, struct encoded_frame *ef, uint8_t *pixels);
+void sender_send_tiles(struct udp_sender *tx, uint32_t ready_tiles);
+void sender_finish_image(struct udp_sender *tx);
 
-void send_image_data(int sock, struct io_uring *ring, struct screen_data *SD, const struct sockaddr_in *dest);
+// Continue de servir les demandes de retransmission pendant ms millisecondes
+// (après la dernière image, avant de fermer l'émetteur)
+void sender_linger(struct udp_sender *tx, unsigned ms);
 
 #endif // NETWORK_H
@@ -0,0 +1,38 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <stddef.h>
+#include "network.h"
+#include "compress.h"
+
+// Options de la ligne de commande du client
+struct client_options {
+    int      stream;          // 0 = une seule capture, 1 = flux continu
+    struct sockaddr_in server; // Adresse et port du serveur
+    unsigned long max_frames; // Nombre d'images à envoyer en flux (0 = infini)
+    unsigned queue_depth;     // Profondeur des files entre les étages
+    unsigned stats_interval;  // Période d'affichage des stats (secondes)
+    const char *source;       // Description de la source d'images
+    unsigned keyframe_interval; // Une image clé toutes les N images (0 = jamais)
+    int      interleave;      // Tuiles envoyées dans l'ordre entrelacé
+    unsigned convert_threads; // Threads de conversion des pixels (0 = un par coeur)
+    enum pixel_format pixel_format; // Format des pixels sur le réseau
+    enum tile_codec codec;    // Compression des tuiles
+    int      codec_level;     // Niveau Zstd ou accélération LZ4
+    enum send_mode send_mode; // Copie, iovec, zero-copy ou sendmmsg
+    unsigned send_depth;      // Envois en vol au plus
+    int      sqpoll;          // Soumissions io_uring lues par un thread du noyau
+    int      gso;             // Regrouper les paquets avec UDP_SEGMENT
+    unsigned stream_id;       // Identifiant du flux (plusieurs écrans par serveur)
+    unsigned fec_k, fec_m;    // m parités par groupe de k paquets (0 = aucune)
+    enum pacing_mode pacing;  // Qui étale les envois : client ou noyau
+    uint64_t pacing_rate;     // Débit visé en octets/s (0 = au plus vite)
+    int      pacing_adaptive; // Débit réglé d'après les bilans du récepteur
+    uint64_t pacing_max;      // Plafond du mode adaptatif (0 = aucun)
+    int      metrics;         // Ligne « metrics » lisible par programme à chaque relevé
+    const char *metrics_socket; // Socket Unix des statistiques (NULL = aucune)
+};
+
+int parse_options(int argc, char **argv, struct client_options *opts);
+
+#endif // OPTIONS_H
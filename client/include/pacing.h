@@ -0,0 +1,101 @@
+#ifndef PACING_H
+#define PACING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Étalement des envois dans le temps : sans lui, chaque image part d'un bloc
+// au débit de la carte et déborde les files des switchs et du récepteur
+
+// Rafale tolérée en espace utilisateur (avance permise sur le calendrier),
+// qui borne aussi la taille d'un envoi GSO
+#define PACER_BURST_NS 200000ull
+
+// Quand le noyau espace lui-même les paquets, on le laisse prendre jusqu'à
+// PACER_HORIZON_NS d'avance, sans dépasser PACER_HORIZON_SENDS envois dans
+// sa file (fq jette au-delà de 100 paquets par flux)
+#define PACER_HORIZON_NS 2000000ull
+#define PACER_HORIZON_SENDS 64
+
+// En dessous, l'attente se fait en boucle active plutôt qu'avec un timer
+#define PACER_SPIN_NS 50000ull
+
+// Débit de départ et plancher du mode adaptatif (octets/s)
+#define PACER_START_RATE (1000ull * 1000 * 1000 / 8)
+#define PACER_MIN_RATE (10ull * 1000 * 1000 / 8)
+
+// Bilans ignorés par le mode adaptatif : trop peu de paquets pour mesurer
+#define PACER_MIN_REPORT 16
+
+// Images envoyées dont on attend le bilan du récepteur
+#define PACER_HISTORY 64
+
+enum pacing_mode {
+    PACING_USER,               // Attente en espace utilisateur entre les envois
+    PACING_FQ,                 // SO_MAX_PACING_RATE, appliqué par le qdisc fq
+    PACING_TXTIME              // SO_TXTIME : heure de départ de chaque envoi
+};
+
+// Une image envoyée, en attendant son bilan
+struct pacer_frame {
+    uint32_t image_id;
+    uint32_t total;            // Paquets de données
+    uint64_t send_ns;          // Durée de l'envoi (0 = en cours)
+    uint64_t rate;             // Débit visé pendant son envoi
+    int pending;               // Bilan pas encore reçu
+};
+
+struct pacer {
+    enum pacing_mode mode;
+    int sock;
+    uint64_t rate;             // Débit visé en octets/s (0 = pas d'étalement)
+    int adaptive;              // Débit ajusté d'après les bilans du récepteur
+    uint64_t max_rate;         // Plafond du mode adaptatif
+    uint64_t next_ns;          // Départ au plus tôt du prochain envoi
+    struct pacer_frame history[PACER_HISTORY];
+    unsigned history_next;     // Prochaine entrée à remplacer
+    // Statistiques
+    uint64_t waits;            // Attentes imposées aux envois
+    uint64_t wait_ns;          // Temps passé à attendre
+    uint64_t sent;             // Paquets de données des images envoyées
+    uint64_t reports;          // Bilans d'image reçus
+    uint64_t lost_frames;      // Images jamais vues par le récepteur
+    uint64_t received;         // Paquets arrivés du premier coup
+    uint64_t delivered_bytes;  // Octets arrivés, et durée de leur réception
+    uint64_t delivered_ns;
+    uint64_t decreases, increases;
+};
+
+// rate en octets/s, 0 sans étalement (sauf en mode adaptatif, qui part de
+// PACER_START_RATE). Les modes noyau se rabattent sur PACING_USER si la
+// socket les refuse.
+void pacer_init(struct pacer *p, int sock, enum pacing_mode mode, uint64_t rate,
+                int adaptive, uint64_t max_rate);
+
+static inline int pacer_enabled(const struct pacer *p)
+{
+    return p->rate != 0;
+}
+
+// Nombre maximal de paquets d'un envoi GSO au débit actuel
+unsigned pacer_segments(const struct pacer *p, unsigned max);
+
+// Temps à attendre avant de pouvoir soumettre l'envoi suivant (0 = tout de suite)
+uint64_t pacer_delay(const struct pacer *p, uint64_t now_ns);
+
+// Réserve bytes octets dans le calendrier. Retourne l'heure de départ prévue
+// (pour SO_TXTIME).
+uint64_t pacer_consume(struct pacer *p, uint64_t now_ns, size_t bytes);
+
+// Début de l'envoi d'une image de total paquets de données, puis sa durée
+// une fois tous ses paquets partis (son bilan peut arriver entre les deux)
+void pacer_frame_start(struct pacer *p, uint32_t image_id, uint32_t total);
+void pacer_frame_done(struct pacer *p, uint64_t send_ns);
+
+// Bilan d'une image par le récepteur : received paquets de données arrivés
+// du premier coup et parity paquets de parité, étalés sur recv_ns. Règle le
+// débit en mode adaptatif.
+void pacer_report(struct pacer *p, uint32_t image_id, uint32_t received,
+                  uint32_t parity, uint64_t recv_ns);
+
+#endif // PACING_H
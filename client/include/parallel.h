@@ -0,0 +1,16 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#define PARALLEL_MAX_THREADS 64
+
+// Traite les éléments [begin, end) d'un découpage
+typedef void (*parallel_fn)(void *ctx, unsigned begin, unsigned end);
+
+// Découpe [0, count) en tranches contiguës réparties sur threads threads
+// (le thread appelant traite la première) et attend qu'elles soient finies
+void parallel_for(unsigned count, unsigned threads, parallel_fn fn, void *ctx);
+
+// Nombre de coeurs disponibles
+unsigned cpu_count(void);
+
+#endif // PARALLEL_H
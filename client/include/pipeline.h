@@ -0,0 +1,104 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include "screenshot.h"
+#include "delta.h"
+#include "metrics.h"
+
+#define PIPELINE_MAX_STAGES 8
+#define PIPELINE_MAX_DEPTH  64   // Images par file entre deux étages, au plus (-q)
+
+// Une image qui traverse le pipeline capture -> conversion -> envoi
+struct frame {
+    uint32_t image_id;        // Identifiant de l'image (incrémenté à chaque capture)
+    uint64_t capture_ns;      // Instant de début de capture (horloge monotone)
+    struct screen_data sd;    // Données de l'image (PNG ou pixels bruts, voir sd.format)
+    struct encoded_frame enc; // Tuiles modifiées, pointent dans sd.data
+};
+
+// Comportement d'une file pleine
+enum queue_policy {
+    QUEUE_DROP_OLDEST,        // On jette l'image la plus ancienne (périmée)
+    QUEUE_BLOCK               // On bloque l'étage précédent
+};
+
+// File bornée d'images entre deux étages
+struct frame_queue {
+    struct frame **slots;     // Tableau circulaire de capacity images
+    unsigned capacity;
+    unsigned head;            // Index de la plus ancienne image
+    unsigned count;           // Nombre d'images dans la file
+    enum queue_policy policy;
+    int closed;               // L'étage précédent a terminé
+    uint64_t dropped;         // Images jetées faute de place
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+};
+
+struct pipeline;
+
+// Traite une image. Retourne 0 si l'image continue dans le pipeline.
+// Pour le premier étage (source), une valeur non nulle arrête le flux.
+typedef int (*stage_fn)(struct frame *frame, void *ctx);
+
+// Un étage du pipeline, exécuté par son propre thread
+struct pipeline_stage {
+    const char *name;
+    stage_fn process;
+    void *ctx;
+    struct frame_queue *in;   // NULL pour la source
+    struct frame_queue *out;  // NULL pour le dernier étage
+    struct pipeline *pipeline;
+    pthread_t thread;
+    uint64_t frames;          // Images traitées (accès atomique)
+    uint64_t busy_ns;         // Temps passé à travailler (accès atomique)
+    uint64_t errors;          // Images abandonnées sur erreur
+    struct metrics_hist time_us; // Durée de traitement de chaque image
+    uint64_t last_frames;     // Dernier relevé pour les stats par intervalle
+    uint64_t last_busy_ns;
+};
+
+struct pipeline {
+    struct pipeline_stage stages[PIPELINE_MAX_STAGES];
+    struct frame_queue queues[PIPELINE_MAX_STAGES - 1];
+    unsigned nb_stages;
+    unsigned queue_depth;
+    unsigned long max_frames; // 0 = infini
+    uint32_t next_image_id;
+    volatile int running;
+    unsigned finished;        // Nombre d'étages terminés (accès atomique)
+    uint64_t start_ns;
+    uint64_t last_report_ns;
+    struct metrics_hist latency_us; // De la capture à la fin du dernier étage
+};
+
+// Horloge monotone en nanosecondes
+static inline uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void frame_free(struct frame *frame);
+
+void pipeline_init(struct pipeline *p, unsigned queue_depth, unsigned long max_frames);
+int pipeline_add_stage(struct pipeline *p, const char *name, stage_fn process,
+                       void *ctx, enum queue_policy policy);
+int pipeline_start(struct pipeline *p);
+void pipeline_stop(struct pipeline *p);
+int pipeline_done(struct pipeline *p);
+void pipeline_join(struct pipeline *p);
+void pipeline_report(struct pipeline *p, FILE *out, int final);
+
+// Paires clé=valeur des compteurs de chaque étage, pour la ligne
+// « metrics ». Retourne la longueur écrite (comme snprintf).
+int pipeline_metrics(struct pipeline *p, char *buf, size_t size);
+void pipeline_destroy(struct pipeline *p);
+
+#endif // PIPELINE_H
@@ -0,0 +1,58 @@
+#ifndef PIXEL_FORMAT_H
+#define PIXEL_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Format des pixels sur le réseau, choisi par l'émetteur et annoncé dans les
+// drapeaux de chaque image. Le 4:2:0 regroupe les pixels en blocs de 2x2 :
+// les tuiles, les lignes et les paquets comptent alors des blocs à la place
+// des pixels, le reste du découpage ne change pas.
+enum pixel_format {
+    PIXEL_FORMAT_BGRX,         // 4 octets par pixel, X inutilisé (défaut)
+    PIXEL_FORMAT_BGR24,        // 3 octets par pixel
+    PIXEL_FORMAT_RGB565,       // 2 octets par pixel (petit-boutiste, R en poids fort)
+    PIXEL_FORMAT_YUV420,       // Blocs de 2x2 pixels : Y00 Y01 Y10 Y11 Cb Cr
+    PIXEL_FORMAT_COUNT
+};
+
+// Côté d'un bloc en pixels
+static inline uint32_t pixel_block(enum pixel_format fmt)
+{
+    return fmt == PIXEL_FORMAT_YUV420 ? 2 : 1;
+}
+
+// Octets d'un bloc
+static inline uint32_t pixel_block_bytes(enum pixel_format fmt)
+{
+    switch (fmt)
+    {
+    case PIXEL_FORMAT_BGR24:
+        return 3;
+    case PIXEL_FORMAT_RGB565:
+        return 2;
+    case PIXEL_FORMAT_YUV420:
+        return 6;
+    default:
+        return 4;
+    }
+}
+
+// Nombre de blocs couvrant n pixels (le dernier bloc peut déborder)
+static inline uint32_t pixel_blocks(enum pixel_format fmt, uint32_t n)
+{
+    return (n + pixel_block(fmt) - 1) / pixel_block(fmt);
+}
+
+// Taille d'une image width x height dans ce format
+static inline size_t pixel_image_bytes(enum pixel_format fmt, uint32_t width, uint32_t height)
+{
+    return (size_t)pixel_blocks(fmt, width) * pixel_blocks(fmt, height) * pixel_block_bytes(fmt);
+}
+
+// Nom du format pour les options et les statistiques, et l'inverse (-1 si
+// inconnu)
+const char *pixel_format_name(enum pixel_format fmt);
+int pixel_format_parse(const char *name);
+
+#endif // PIXEL_FORMAT_H
@@ -0,0 +1,33 @@
+#ifndef PNG_STREAM_H
+#define PNG_STREAM_H
+
+#include <png.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Décodage d'un PNG en mémoire ligne par ligne, directement en BGRx
+// (X = 0xFF) : pas d'image intermédiaire, l'appelant récupère les lignes au
+// fur et à mesure (pour les envoyer avant la fin du décodage).
+struct png_stream {
+    png_structp png;
+    png_infop   info;
+    const uint8_t *data;       // Fichier PNG complet
+    size_t length;
+    size_t pos;                // Octets déjà passés à libpng
+    uint32_t width, height;
+    uint32_t rows_done;        // Lignes déjà décodées
+    int interlaced;            // Adam7 : pas décodable ligne par ligne
+};
+
+// Lit l'en-tête et prépare les transformations vers BGRx. Un PNG entrelacé
+// n'est pas décodé par png_stream_read (interlaced est mis) : il faut
+// passer par un décodage complet.
+int png_stream_open(struct png_stream *ps, const uint8_t *data, size_t length);
+
+// Décode les rows lignes suivantes dans dst (stride octets entre deux
+// lignes). Retourne -1 si le PNG est invalide ou tronqué.
+int png_stream_read(struct png_stream *ps, uint8_t *dst, size_t stride, uint32_t rows);
+
+void png_stream_close(struct png_stream *ps);
+
+#endif // PNG_STREAM_H
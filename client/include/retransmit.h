@@ -0,0 +1,77 @@
+#ifndef RETRANSMIT_H
+#define RETRANSMIT_H
+
+#include <stdint.h>
+#include "delta.h"
+
+// Images gardées pour répondre aux demandes de retransmission
+#define RETX_FRAMES 3
+
+// Au-delà, une image est trop vieille pour être réparée : les paquets
+// demandés sont abandonnés (le récepteur est déjà passé à la suivante)
+#define RETX_DEADLINE_MS 200
+
+// Plages de paquets en attente de retransmission
+#define RETX_QUEUE 256
+
+// Une image déjà envoyée : ses tuiles et ses pixels restent valides tant
+// qu'elle est dans le buffer
+struct retx_frame {
+    struct encoded_frame enc;
+    uint8_t *pixels;           // Données de l'image (libérées avec g_free)
+    uint32_t *first_seq;       // Premier paquet de chaque tuile (nb_tiles + 1)
+    uint64_t sent_ns;          // Début de l'envoi
+};
+
+// Plage de paquets [seq, seq + count) d'une image à renvoyer
+struct retx_range {
+    struct retx_frame *frame;
+    uint32_t seq;
+    uint32_t count;
+};
+
+struct retx_buffer {
+    struct retx_frame frames[RETX_FRAMES];
+    unsigned next;             // Prochain emplacement à réutiliser
+    struct retx_range queue[RETX_QUEUE];
+    unsigned head, count;
+    // Statistiques
+    uint64_t nacks;            // Demandes reçues
+    uint64_t requested;        // Paquets demandés
+    uint64_t resent;           // Paquets renvoyés
+    uint64_t abandoned;        // Paquets demandés trop tard
+};
+
+void retx_init(struct retx_buffer *rb);
+void retx_destroy(struct retx_buffer *rb);
+
+// Prend possession des tuiles de ef et des pixels (ef est remis à zéro).
+// L'image la plus ancienne est libérée pour faire de la place. Retourne
+// NULL pour une image sans tuile (libérée aussitôt) ou en cas d'erreur.
+struct retx_frame *retx_store(struct retx_buffer *rb, struct encoded_frame *ef,
+                              uint8_t *pixels, uint64_t now_ns);
+
+// Nombre de paquets de l'image
+static inline uint32_t retx_total(const struct retx_frame *f)
+{
+    return f->first_seq[f->enc.nb_tiles];
+}
+
+// Ajoute une demande du récepteur pour l'image image_id
+void retx_request(struct retx_buffer *rb, uint32_t image_id, uint32_t seq,
+                  uint32_t count, uint64_t now_ns);
+
+// Prochain paquet à renvoyer. Retourne 0 s'il n'y en a plus.
+int retx_next(struct retx_buffer *rb, uint64_t now_ns,
+              struct retx_frame **frame, uint32_t *seq);
+
+static inline int retx_pending(const struct retx_buffer *rb)
+{
+    return rb->count > 0;
+}
+
+// Tuile et position dans la tuile du paquet seq
+void retx_locate(const struct retx_frame *f, uint32_t seq, uint32_t *tile,
+                 size_t *offset);
+
+#endif // RETRANSMIT_H
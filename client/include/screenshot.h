@@ -3,6 +3,13 @@
 
 #include <glib.h>
 #include <libportal/portal.h>
+#include "pixel_format.h"
+
+// Contenu du buffer data
+enum sd_format {
+    SD_FORMAT_PNG,             //Fichier PNG compressé (à convertir)
+    SD_FORMAT_RAW              //Pixels bruts au format pixel_format
+};
 
 struct screen_data {
 	GMainLoop *loop;           //GLIB event loop pour gérer l'async
@@ -10,10 +17,13 @@ struct screen_data {
     gsize      length;         //Taille du buffer
     guint32    width, height;  //Les dimensions de l'image
     XdpPortal *portal;         //Le portail
+    enum sd_format format;     //Format du contenu de data
+    enum pixel_format pixel_format; //Format des pixels bruts (BGRx par défaut)
 };
 
 int capture_screenshot(struct screen_data *sd);
 void on_screenshot_ready(GObject *source, GAsyncResult *res, gpointer user_data);
 int convert_png_to_raw(struct screen_data *sd);
+int convert_raw_to_format(struct screen_data *sd, enum pixel_format fmt);
 
 #endif // SCREENSHOT_H
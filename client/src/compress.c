@@ -0,0 +1,193 @@
+#include "compress.h"
+#include "parallel.h"
+#include "pipeline.h"
+#include <lz4.h>
+#include <zstd.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Plus grande tuile brute : TILE_SIZE x TILE_SIZE pixels BGRx
+#define TILE_MAX_BYTES (TILE_SIZE * TILE_SIZE * 4)
+
+static const char *const codec_names[CODEC_COUNT] = { "none", "lz4", "zstd" };
+
+// Tuile rendue contiguë, et contexte Zstd gardé d'une image à l'autre :
+// chaque thread du pool a les siens
+static __thread uint8_t tile_buf[TILE_MAX_BYTES];
+static __thread ZSTD_CCtx *zstd_ctx;
+
+struct compress_job {
+    const struct tile_compressor *c;
+    struct encoded_frame *ef;
+    const size_t *slots;       // Début de la place de chaque tuile dans ef->packed
+    uint64_t raw_tiles;        // Tuiles laissées brutes (accès atomique)
+    uint64_t packed_bytes;
+};
+
+// Compresse une tuile dans dst (au plus capacity octets). Retourne la
+// taille compressée, 0 si elle ne tient pas.
+static size_t compress_tile(const struct tile_compressor *c, const uint8_t *src,
+                            size_t len, uint8_t *dst, size_t capacity)
+{
+    if (c->codec == CODEC_LZ4)
+    {
+        int n = LZ4_compress_fast((const char *)src, (char *)dst, len, capacity, c->level);
+        return n > 0 ? (size_t)n : 0;
+    }
+
+    if (!zstd_ctx && !(zstd_ctx = ZSTD_createCCtx()))
+    {
+        return 0;
+    }
+    size_t n = ZSTD_compressCCtx(zstd_ctx, dst, capacity, src, len, c->level);
+    return ZSTD_isError(n) ? 0 : n;
+}
+
+static void compress_tiles(void *ctx, unsigned begin, unsigned end)
+{
+    struct compress_job *job = ctx;
+    uint64_t raw_tiles = 0, packed = 0;
+
+    for (unsigned i = begin; i < end; i++)
+    {
+        struct tile_ref *t = &job->ef->tiles[i];
+        size_t len = tile_bytes(t);
+        uint8_t *dst = job->ef->packed + job->slots[i];
+
+        // La place réservée est d'un octet plus petite que la tuile : ce
+        // qui ne tient pas ne gagnerait rien et part brut
+        tile_copy(t, 0, tile_buf, len);
+        size_t n = compress_tile(job->c, tile_buf, len, dst, job->slots[i + 1] - job->slots[i]);
+        if (!n)
+        {
+            raw_tiles++;
+            packed += len;
+            continue;
+        }
+
+        t->data       = dst;
+        t->stride     = n;
+        t->row_bytes  = n;
+        t->rows       = 1;
+        t->compressed = 1;
+        packed += n;
+    }
+
+    __atomic_fetch_add(&job->raw_tiles, raw_tiles, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&job->packed_bytes, packed, __ATOMIC_RELAXED);
+}
+
+void compressor_init(struct tile_compressor *c, enum tile_codec codec, int level,
+                     unsigned threads)
+{
+    memset(c, 0, sizeof(*c));
+    c->codec = codec;
+    c->level = level;
+    c->threads = threads ? threads : cpu_count();
+}
+
+int compress_frame(struct tile_compressor *c, struct encoded_frame *ef)
+{
+    if (c->codec == CODEC_NONE || !ef->nb_tiles)
+    {
+        return 0;
+    }
+
+    uint64_t t0 = now_ns();
+    size_t *slots = malloc((ef->nb_tiles + 1) * sizeof(*slots));
+    if (!slots)
+    {
+        perror("malloc");
+        return -1;
+    }
+
+    // Chaque tuile a sa place dans un seul buffer, gardé avec les tuiles
+    // pour les retransmissions
+    size_t raw = 0;
+    slots[0] = 0;
+    for (uint32_t i = 0; i < ef->nb_tiles; i++)
+    {
+        raw += tile_bytes(&ef->tiles[i]);
+        slots[i + 1] = slots[i] + tile_bytes(&ef->tiles[i]) - 1;
+    }
+    ef->packed = malloc(slots[ef->nb_tiles] + 1);
+    if (!ef->packed)
+    {
+        perror("malloc");
+        free(slots);
+        return -1;
+    }
+
+    struct compress_job job = { .c = c, .ef = ef, .slots = slots };
+    parallel_for(ef->nb_tiles, c->threads, compress_tiles, &job);
+    free(slots);
+
+    ef->flags |= FRAME_FLAG_CODEC(c->codec);
+
+    __atomic_fetch_add(&c->frames, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&c->tiles, ef->nb_tiles, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&c->raw_tiles, job.raw_tiles, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&c->raw_bytes, raw, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&c->packed_bytes, job.packed_bytes, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&c->busy_ns, now_ns() - t0, __ATOMIC_RELAXED);
+    return 0;
+}
+
+void compressor_report(const struct tile_compressor *c, FILE *out)
+{
+    uint64_t frames = __atomic_load_n(&c->frames, __ATOMIC_RELAXED);
+    uint64_t tiles = __atomic_load_n(&c->tiles, __ATOMIC_RELAXED);
+    uint64_t raw_tiles = __atomic_load_n(&c->raw_tiles, __ATOMIC_RELAXED);
+    uint64_t raw = __atomic_load_n(&c->raw_bytes, __ATOMIC_RELAXED);
+    uint64_t packed = __atomic_load_n(&c->packed_bytes, __ATOMIC_RELAXED);
+    uint64_t busy = __atomic_load_n(&c->busy_ns, __ATOMIC_RELAXED);
+
+    fprintf(out, "[compression] %s niveau %d, %u threads | %llu images, %llu tuiles "
+            "(%llu brutes) | %.1f MB -> %.1f MB, ratio %.2f | %.0f MB/s, %.2f ms/image\n",
+            codec_name(c->codec), c->level, c->threads, (unsigned long long)frames,
+            (unsigned long long)tiles, (unsigned long long)raw_tiles,
+            raw / (1024.0 * 1024.0), packed / (1024.0 * 1024.0),
+            packed ? (double)raw / packed : 0.0,
+            busy ? raw / (1024.0 * 1024.0) / (busy / 1e9) : 0.0,
+            frames ? busy / 1e6 / frames : 0.0);
+}
+
+int codec_parse(const char *arg, enum tile_codec *codec, int *level)
+{
+    const char *colon = strchr(arg, ':');
+    size_t len = colon ? (size_t)(colon - arg) : strlen(arg);
+
+    for (int i = 0; i < CODEC_COUNT; i++)
+    {
+        if (strlen(codec_names[i]) != len || strncmp(arg, codec_names[i], len) != 0)
+        {
+            continue;
+        }
+
+        *codec = i;
+        *level = i == CODEC_ZSTD ? ZSTD_DEFAULT_LEVEL : LZ4_DEFAULT_LEVEL;
+        if (!colon)
+        {
+            return 0;
+        }
+
+        // Zstd accepte des niveaux négatifs (plus rapides), LZ4 une
+        // accélération d'au moins 1
+        char *end;
+        long v = strtol(colon + 1, &end, 10);
+        if (i == CODEC_NONE || end == colon + 1 || *end ||
+            (i == CODEC_LZ4 && (v < 1 || v > 65537)) ||
+            (i == CODEC_ZSTD && (v < ZSTD_minCLevel() || v > ZSTD_maxCLevel())))
+        {
+            return -1;
+        }
+        *level = v;
+        return 0;
+    }
+    return -1;
+}
+
+const char *codec_name(enum tile_codec codec)
+{
+    return codec < CODEC_COUNT ? codec_names[codec] : "?";
+}
@@ -0,0 +1,653 @@
+#include "convert.h"
+#include "parallel.h"
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CONVERT_X86 1
+#endif
+
+// En dessous de ce nombre de pixels, lancer des threads coûte plus cher que
+// la conversion elle-même
+#define CONVERT_PARALLEL_MIN_PIXELS (512 * 1024)
+
+// Version scalaire : toujours disponible, sert aussi pour les fins de ligne
+static void rgb_scalar(const uint8_t *src, uint8_t *dst, uint32_t width)
+{
+    for (uint32_t x = 0; x < width; x++, src += 3, dst += 4)
+    {
+        dst[0] = src[2];    // B
+        dst[1] = src[1];    // G
+        dst[2] = src[0];    // R
+        dst[3] = 0xFF;      // X
+    }
+}
+
+static void rgba_scalar(const uint8_t *src, uint8_t *dst, uint32_t width)
+{
+    for (uint32_t x = 0; x < width; x++, src += 4, dst += 4)
+    {
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = src[0];
+        dst[3] = 0xFF;
+    }
+}
+
+// BGRx -> BGR24 : l'octet X n'est pas transmis
+static void bgr24_scalar(const uint8_t *src, uint8_t *dst, uint32_t width)
+{
+    for (uint32_t x = 0; x < width; x++, src += 4, dst += 3)
+    {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+    }
+}
+
+// BGRx -> RGB565 : on garde les bits de poids fort de chaque composante
+static void rgb565_scalar(const uint8_t *src, uint8_t *dst, uint32_t width)
+{
+    for (uint32_t x = 0; x < width; x++, src += 4, dst += 2)
+    {
+        uint16_t v = (uint16_t)((src[2] >> 3) << 11 | (src[1] >> 2) << 5 | src[0] >> 3);
+        dst[0] = (uint8_t)v;
+        dst[1] = (uint8_t)(v >> 8);
+    }
+}
+
+// YCbCr BT.601 pleine échelle (celui du JPEG), coefficients sur 7 bits pour
+// que les produits tiennent dans les entiers 16 bits signés de pmaddubsw.
+// Dans l'ordre des octets d'un pixel : B, G, R, X.
+#define YUV_Y   15,  75,  38, 0
+#define YUV_CB  64, -42, -22, 0
+#define YUV_CR -10, -54,  64, 0
+
+static inline uint8_t yuv_luma(const uint8_t *p)
+{
+    return (uint8_t)((15 * p[0] + 75 * p[1] + 38 * p[2] + 64) >> 7);
+}
+
+// sum : somme des deux colonnes du bloc (chacune moyennée sur ses deux
+// lignes), soit 256 fois la chrominance
+static inline uint8_t yuv_chroma(int sum)
+{
+    int v = ((sum + 128) >> 8) + 128;
+    return v > 255 ? 255 : (uint8_t)v;
+}
+
+// Deux lignes BGRx -> une ligne de blocs 4:2:0. Les noyaux SIMD font
+// exactement les mêmes arrondis.
+static void yuv420_scalar(const uint8_t *row0, const uint8_t *row1, uint8_t *dst,
+                          uint32_t width)
+{
+    for (uint32_t x = 0; x < width; x += 2, row0 += 8, row1 += 8, dst += 6)
+    {
+        // Largeur impaire : le dernier pixel est dupliqué
+        unsigned next = x + 1 < width ? 4 : 0;
+        const uint8_t *p[4] = { row0, row0 + next, row1, row1 + next };
+        int cb = 0, cr = 0;
+
+        for (int i = 0; i < 4; i++)
+        {
+            dst[i] = yuv_luma(p[i]);
+        }
+        for (int i = 0; i < 2; i++)
+        {
+            int b = (p[i][0] + p[i + 2][0] + 1) >> 1;
+            int g = (p[i][1] + p[i + 2][1] + 1) >> 1;
+            int r = (p[i][2] + p[i + 2][2] + 1) >> 1;
+            cb += 64 * b - 42 * g - 22 * r;
+            cr += -10 * b - 54 * g + 64 * r;
+        }
+        dst[4] = yuv_chroma(cb);
+        dst[5] = yuv_chroma(cr);
+    }
+}
+
+#ifdef CONVERT_X86
+
+// Masques pshufb : chaque groupe de 4 octets de sortie prend B, G, R dans
+// l'entrée ; 0x80 met l'octet X à 0, il est ensuite forcé à 0xFF par un OR
+#define SHUF_RGB  2, 1, 0, -128, 5, 4, 3, -128, 8, 7, 6, -128, 11, 10, 9, -128
+#define SHUF_RGBA 2, 1, 0, -128, 6, 5, 4, -128, 10, 9, 8, -128, 14, 13, 12, -128
+
+__attribute__((target("ssse3")))
+static void rgb_ssse3(const uint8_t *src, uint8_t *dst, uint32_t width)
+{
+    const __m128i shuf  = _mm_setr_epi8(SHUF_RGB);
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+    uint32_t x = 0;
+
+    // 4 pixels (12 octets utiles) par tour, mais on lit 16 octets :
+    // il faut 6 pixels restants pour ne pas lire après la ligne
+    for (; x + 6 <= width; x += 4, src += 12, dst += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)src);
+        _mm_storeu_si128((__m128i *)dst, _mm_or_si128(_mm_shuffle_epi8(v, shuf), alpha));
+    }
+    rgb_scalar(src, dst, width - x);
+}
+
+__attribute__((target("ssse3")))
+static void rgba_ssse3(const uint8_t *src, uint8_t *dst, uint32_t width)
+{
+    const __m128i shuf  = _mm_setr_epi8(SHUF_RGBA);
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+    uint32_t x = 0;
+
+    for (; x + 4 <= width; x += 4, src += 16, dst += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)src);
+        _mm_storeu_si128((__m128i *)dst, _mm_or_si128(_mm_shuffle_epi8(v, shuf), alpha));
+    }
+    rgba_scalar(src, dst, width - x);
+}
+
+__attribute__((target("avx2")))
+static void rgb_avx2(const uint8_t *src, uint8_t *dst, uint32_t width)
+{
+    const __m256i shuf  = _mm256_setr_epi8(SHUF_RGB, SHUF_RGB);
+    const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+    uint32_t x = 0;
+
+    // pshufb travaille par moitié de 128 bits : chaque moitié reçoit 4 pixels
+    // (la seconde charge 16 octets à partir de src + 12)
+    for (; x + 10 <= width; x += 8, src += 24, dst += 32)
+    {
+        __m128i lo = _mm_loadu_si128((const __m128i *)src);
+        __m128i hi = _mm_loadu_si128((const __m128i *)(src + 12));
+        __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        _mm256_storeu_si256((__m256i *)dst, _mm256_or_si256(_mm256_shuffle_epi8(v, shuf), alpha));
+    }
+    rgb_ssse3(src, dst, width - x);
+}
+
+__attribute__((target("avx2")))
+static void rgba_avx2(const uint8_t *src, uint8_t *dst, uint32_t width)
+{
+    const __m256i shuf  = _mm256_setr_epi8(SHUF_RGBA, SHUF_RGBA);
+    const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+    uint32_t x = 0;
+
+    for (; x + 8 <= width; x += 8, src += 32, dst += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)src);
+        _mm256_storeu_si256((__m256i *)dst, _mm256_or_si256(_mm256_shuffle_epi8(v, shuf), alpha));
+    }
+    rgba_ssse3(src, dst, width - x);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void rgb_avx512(const uint8_t *src, uint8_t *dst, uint32_t width)
+{
+    const __m512i shuf  = _mm512_broadcast_i32x4(_mm_setr_epi8(SHUF_RGB));
+    const __m512i alpha = _mm512_set1_epi32((int)0xFF000000);
+    // Répartit 48 octets sur quatre blocs de 128 bits décalés de 12 octets
+    const __m512i spread = _mm512_setr_epi32(0, 1, 2, 3, 3, 4, 5, 6,
+                                             6, 7, 8, 9, 9, 10, 11, 12);
+    uint32_t x = 0;
+
+    // 16 pixels par tour, on lit 64 octets : il faut 22 pixels restants
+    for (; x + 22 <= width; x += 16, src += 48, dst += 64)
+    {
+        __m512i v = _mm512_permutexvar_epi32(spread, _mm512_loadu_si512(src));
+        _mm512_storeu_si512(dst, _mm512_or_si512(_mm512_shuffle_epi8(v, shuf), alpha));
+    }
+    rgb_avx2(src, dst, width - x);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void rgba_avx512(const uint8_t *src, uint8_t *dst, uint32_t width)
+{
+    const __m512i shuf  = _mm512_broadcast_i32x4(_mm_setr_epi8(SHUF_RGBA));
+    const __m512i alpha = _mm512_set1_epi32((int)0xFF000000);
+    uint32_t x = 0;
+
+    for (; x + 16 <= width; x += 16, src += 64, dst += 64)
+    {
+        __m512i v = _mm512_loadu_si512(src);
+        _mm512_storeu_si512(dst, _mm512_or_si512(_mm512_shuffle_epi8(v, shuf), alpha));
+    }
+    rgba_avx2(src, dst, width - x);
+}
+
+// BGRx -> BGR24 : 4 pixels donnent 12 octets, mais on en écrit 16 (les 4
+// derniers sont recouverts au tour suivant) : il faut 6 pixels restants
+#define SHUF_BGR24 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -128, -128, -128, -128
+
+__attribute__((target("ssse3")))
+static void bgr24_ssse3(const uint8_t *src, uint8_t *dst, uint32_t width)
+{
+    const __m128i shuf = _mm_setr_epi8(SHUF_BGR24);
+    uint32_t x = 0;
+
+    for (; x + 6 <= width; x += 4, src += 16, dst += 12)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)src);
+        _mm_storeu_si128((__m128i *)dst, _mm_shuffle_epi8(v, shuf));
+    }
+    bgr24_scalar(src, dst, width - x);
+}
+
+// Chaque moitié de 128 bits donne 12 octets, regroupés en 24 octets
+// contigus ; on en écrit 32 : il faut 11 pixels restants
+__attribute__((target("avx2")))
+static void bgr24_avx2(const uint8_t *src, uint8_t *dst, uint32_t width)
+{
+    const __m256i shuf = _mm256_setr_epi8(SHUF_BGR24, SHUF_BGR24);
+    const __m256i pack = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+    uint32_t x = 0;
+
+    for (; x + 11 <= width; x += 8, src += 32, dst += 24)
+    {
+        __m256i v = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)src), shuf);
+        _mm256_storeu_si256((__m256i *)dst, _mm256_permutevar8x32_epi32(v, pack));
+    }
+    _mm256_zeroupper();
+    bgr24_ssse3(src, dst, width - x);
+}
+
+// Pixel BGRx lu comme un entier 32 bits -> RGB565 dans ses 16 bits de
+// poids faible ; pshufb garde ensuite ces deux octets de chaque pixel
+#define SHUF_565 0, 1, 4, 5, 8, 9, 12, 13, -128, -128, -128, -128, -128, -128, -128, -128
+
+__attribute__((target("ssse3")))
+static inline __m128i rgb565_4(__m128i p, __m128i shuf)
+{
+    __m128i r = _mm_and_si128(_mm_srli_epi32(p, 8), _mm_set1_epi32(0xF800));
+    __m128i g = _mm_and_si128(_mm_srli_epi32(p, 5), _mm_set1_epi32(0x07E0));
+    __m128i b = _mm_and_si128(_mm_srli_epi32(p, 3), _mm_set1_epi32(0x001F));
+    return _mm_shuffle_epi8(_mm_or_si128(_mm_or_si128(r, g), b), shuf);
+}
+
+__attribute__((target("ssse3")))
+static void rgb565_ssse3(const uint8_t *src, uint8_t *dst, uint32_t width)
+{
+    const __m128i shuf = _mm_setr_epi8(SHUF_565);
+    uint32_t x = 0;
+
+    for (; x + 8 <= width; x += 8, src += 32, dst += 16)
+    {
+        __m128i lo = rgb565_4(_mm_loadu_si128((const __m128i *)src), shuf);
+        __m128i hi = rgb565_4(_mm_loadu_si128((const __m128i *)(src + 16)), shuf);
+        _mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi64(lo, hi));
+    }
+    rgb565_scalar(src, dst, width - x);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i rgb565_8(__m256i p, __m256i shuf)
+{
+    __m256i r = _mm256_and_si256(_mm256_srli_epi32(p, 8), _mm256_set1_epi32(0xF800));
+    __m256i g = _mm256_and_si256(_mm256_srli_epi32(p, 5), _mm256_set1_epi32(0x07E0));
+    __m256i b = _mm256_and_si256(_mm256_srli_epi32(p, 3), _mm256_set1_epi32(0x001F));
+    return _mm256_shuffle_epi8(_mm256_or_si256(_mm256_or_si256(r, g), b), shuf);
+}
+
+__attribute__((target("avx2")))
+static void rgb565_avx2(const uint8_t *src, uint8_t *dst, uint32_t width)
+{
+    const __m256i shuf = _mm256_setr_epi8(SHUF_565, SHUF_565);
+    uint32_t x = 0;
+
+    for (; x + 16 <= width; x += 16, src += 64, dst += 32)
+    {
+        __m256i lo = rgb565_8(_mm256_loadu_si256((const __m256i *)src), shuf);
+        __m256i hi = rgb565_8(_mm256_loadu_si256((const __m256i *)(src + 32)), shuf);
+        // Par moitié : pixels 0-3 et 8-11 | 4-7 et 12-15, remis dans l'ordre
+        __m256i v = _mm256_unpacklo_epi64(lo, hi);
+        _mm256_storeu_si256((__m256i *)dst, _mm256_permute4x64_epi64(v, 0xD8));
+    }
+    _mm256_zeroupper();
+    rgb565_ssse3(src, dst, width - x);
+}
+
+// 4:2:0 par moitié de 128 bits : 8 pixels de chaque ligne donnent 4 blocs.
+// Les luminances (ligne 0 puis ligne 1) et les chrominances (Cb puis Cr)
+// sont rangées en blocs de 6 octets par deux pshufb, 16 puis 8 octets.
+#define SHUF_Y_LO  0, 1, 8, 9, -128, -128, 2, 3, 10, 11, -128, -128, 4, 5, 12, 13
+#define SHUF_C_LO  -128, -128, -128, -128, 0, 4, -128, -128, -128, -128, 1, 5, \
+                   -128, -128, -128, -128
+#define SHUF_Y_HI  -128, -128, 6, 7, 14, 15, -128, -128, \
+                   -128, -128, -128, -128, -128, -128, -128, -128
+#define SHUF_C_HI  2, 6, -128, -128, -128, -128, 3, 7, \
+                   -128, -128, -128, -128, -128, -128, -128, -128
+
+// Produit scalaire de chaque pixel avec les coefficients coef (entiers 32 bits)
+__attribute__((target("ssse3")))
+static inline __m128i yuv_dot4(__m128i p, __m128i coef)
+{
+    return _mm_madd_epi16(_mm_maddubs_epi16(p, coef), _mm_set1_epi16(1));
+}
+
+// Chrominance de 4 blocs à partir des 8 pixels moyennés sur les deux lignes
+__attribute__((target("ssse3")))
+static inline __m128i yuv_chroma4(__m128i c0, __m128i c1, __m128i coef)
+{
+    __m128i sum = _mm_hadd_epi32(yuv_dot4(c0, coef), yuv_dot4(c1, coef));
+    return _mm_srai_epi32(_mm_add_epi32(sum, _mm_set1_epi32(128)), 8);
+}
+
+__attribute__((target("ssse3")))
+static void yuv420_ssse3(const uint8_t *row0, const uint8_t *row1, uint8_t *dst,
+                         uint32_t width)
+{
+    const __m128i cy  = _mm_setr_epi8(YUV_Y, YUV_Y, YUV_Y, YUV_Y);
+    const __m128i ccb = _mm_setr_epi8(YUV_CB, YUV_CB, YUV_CB, YUV_CB);
+    const __m128i ccr = _mm_setr_epi8(YUV_CR, YUV_CR, YUV_CR, YUV_CR);
+    const __m128i round = _mm_set1_epi32(64);
+    const __m128i bias = _mm_set1_epi16(128);
+    const __m128i y_lo = _mm_setr_epi8(SHUF_Y_LO), c_lo = _mm_setr_epi8(SHUF_C_LO);
+    const __m128i y_hi = _mm_setr_epi8(SHUF_Y_HI), c_hi = _mm_setr_epi8(SHUF_C_HI);
+    uint32_t x = 0;
+
+    for (; x + 8 <= width; x += 8, row0 += 32, row1 += 32, dst += 24)
+    {
+        __m128i a0 = _mm_loadu_si128((const __m128i *)row0);
+        __m128i a1 = _mm_loadu_si128((const __m128i *)(row0 + 16));
+        __m128i b0 = _mm_loadu_si128((const __m128i *)row1);
+        __m128i b1 = _mm_loadu_si128((const __m128i *)(row1 + 16));
+
+        __m128i ya = _mm_packs_epi32(
+            _mm_srai_epi32(_mm_add_epi32(yuv_dot4(a0, cy), round), 7),
+            _mm_srai_epi32(_mm_add_epi32(yuv_dot4(a1, cy), round), 7));
+        __m128i yb = _mm_packs_epi32(
+            _mm_srai_epi32(_mm_add_epi32(yuv_dot4(b0, cy), round), 7),
+            _mm_srai_epi32(_mm_add_epi32(yuv_dot4(b1, cy), round), 7));
+        __m128i y = _mm_packus_epi16(ya, yb);
+
+        __m128i c0 = _mm_avg_epu8(a0, b0), c1 = _mm_avg_epu8(a1, b1);
+        __m128i c = _mm_add_epi16(_mm_packs_epi32(yuv_chroma4(c0, c1, ccb),
+                                                  yuv_chroma4(c0, c1, ccr)), bias);
+        c = _mm_packus_epi16(c, c);
+
+        _mm_storeu_si128((__m128i *)dst,
+                         _mm_or_si128(_mm_shuffle_epi8(y, y_lo), _mm_shuffle_epi8(c, c_lo)));
+        _mm_storel_epi64((__m128i *)(dst + 16),
+                         _mm_or_si128(_mm_shuffle_epi8(y, y_hi), _mm_shuffle_epi8(c, c_hi)));
+    }
+    yuv420_scalar(row0, row1, dst, width - x);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i yuv_dot8(__m256i p, __m256i coef)
+{
+    return _mm256_madd_epi16(_mm256_maddubs_epi16(p, coef), _mm256_set1_epi16(1));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i yuv_chroma8(__m256i c0, __m256i c1, __m256i coef)
+{
+    __m256i sum = _mm256_hadd_epi32(yuv_dot8(c0, coef), yuv_dot8(c1, coef));
+    return _mm256_srai_epi32(_mm256_add_epi32(sum, _mm256_set1_epi32(128)), 8);
+}
+
+// Même calcul que yuv420_ssse3 dans chaque moitié : la première reçoit les
+// pixels 0-7 de chaque ligne, la seconde les pixels 8-15
+__attribute__((target("avx2")))
+static void yuv420_avx2(const uint8_t *row0, const uint8_t *row1, uint8_t *dst,
+                        uint32_t width)
+{
+    const __m256i cy  = _mm256_setr_epi8(YUV_Y, YUV_Y, YUV_Y, YUV_Y,
+                                         YUV_Y, YUV_Y, YUV_Y, YUV_Y);
+    const __m256i ccb = _mm256_setr_epi8(YUV_CB, YUV_CB, YUV_CB, YUV_CB,
+                                         YUV_CB, YUV_CB, YUV_CB, YUV_CB);
+    const __m256i ccr = _mm256_setr_epi8(YUV_CR, YUV_CR, YUV_CR, YUV_CR,
+                                         YUV_CR, YUV_CR, YUV_CR, YUV_CR);
+    const __m256i round = _mm256_set1_epi32(64);
+    const __m256i bias = _mm256_set1_epi16(128);
+    const __m256i y_lo = _mm256_setr_epi8(SHUF_Y_LO, SHUF_Y_LO);
+    const __m256i c_lo = _mm256_setr_epi8(SHUF_C_LO, SHUF_C_LO);
+    const __m256i y_hi = _mm256_setr_epi8(SHUF_Y_HI, SHUF_Y_HI);
+    const __m256i c_hi = _mm256_setr_epi8(SHUF_C_HI, SHUF_C_HI);
+    uint32_t x = 0;
+
+    for (; x + 16 <= width; x += 16, row0 += 64, row1 += 64, dst += 48)
+    {
+        __m256i r0 = _mm256_loadu_si256((const __m256i *)row0);
+        __m256i r1 = _mm256_loadu_si256((const __m256i *)(row0 + 32));
+        __m256i s0 = _mm256_loadu_si256((const __m256i *)row1);
+        __m256i s1 = _mm256_loadu_si256((const __m256i *)(row1 + 32));
+        __m256i a0 = _mm256_permute2x128_si256(r0, r1, 0x20);
+        __m256i a1 = _mm256_permute2x128_si256(r0, r1, 0x31);
+        __m256i b0 = _mm256_permute2x128_si256(s0, s1, 0x20);
+        __m256i b1 = _mm256_permute2x128_si256(s0, s1, 0x31);
+
+        __m256i ya = _mm256_packs_epi32(
+            _mm256_srai_epi32(_mm256_add_epi32(yuv_dot8(a0, cy), round), 7),
+            _mm256_srai_epi32(_mm256_add_epi32(yuv_dot8(a1, cy), round), 7));
+        __m256i yb = _mm256_packs_epi32(
+            _mm256_srai_epi32(_mm256_add_epi32(yuv_dot8(b0, cy), round), 7),
+            _mm256_srai_epi32(_mm256_add_epi32(yuv_dot8(b1, cy), round), 7));
+        __m256i y = _mm256_packus_epi16(ya, yb);
+
+        __m256i c0 = _mm256_avg_epu8(a0, b0), c1 = _mm256_avg_epu8(a1, b1);
+        __m256i c = _mm256_add_epi16(_mm256_packs_epi32(yuv_chroma8(c0, c1, ccb),
+                                                        yuv_chroma8(c0, c1, ccr)), bias);
+        c = _mm256_packus_epi16(c, c);
+
+        __m256i lo = _mm256_or_si256(_mm256_shuffle_epi8(y, y_lo), _mm256_shuffle_epi8(c, c_lo));
+        __m256i hi = _mm256_or_si256(_mm256_shuffle_epi8(y, y_hi), _mm256_shuffle_epi8(c, c_hi));
+        _mm_storeu_si128((__m128i *)dst, _mm256_castsi256_si128(lo));
+        _mm_storel_epi64((__m128i *)(dst + 16), _mm256_castsi256_si128(hi));
+        _mm_storeu_si128((__m128i *)(dst + 24), _mm256_extracti128_si256(lo, 1));
+        _mm_storel_epi64((__m128i *)(dst + 40), _mm256_extracti128_si256(hi, 1));
+    }
+    _mm256_zeroupper();
+    yuv420_ssse3(row0, row1, dst, width - x);
+}
+
+static int has_ssse3(void)
+{
+    return __builtin_cpu_supports("ssse3");
+}
+
+static int has_avx2(void)
+{
+    return __builtin_cpu_supports("avx2");
+}
+
+static int has_avx512(void)
+{
+    return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+}
+
+#endif // CONVERT_X86
+
+// Du plus simple au plus rapide ; convert_init garde le dernier supporté
+static const struct {
+    struct convert_kernel kernel;
+    int (*supported)(void);    // NULL = toujours disponible
+} all_kernels[] = {
+    { { "scalar", rgb_scalar, rgba_scalar,
+          bgr24_scalar, rgb565_scalar, yuv420_scalar }, NULL },
+#ifdef CONVERT_X86
+    { { "ssse3",  rgb_ssse3,  rgba_ssse3,
+          bgr24_ssse3, rgb565_ssse3, yuv420_ssse3 }, has_ssse3 },
+    { { "avx2",   rgb_avx2,   rgba_avx2,
+          bgr24_avx2, rgb565_avx2, yuv420_avx2 },    has_avx2 },
+    // Les formats réseau n'ont pas de version AVX-512 : la mémoire limite
+    // déjà les noyaux AVX2
+    { { "avx512", rgb_avx512, rgba_avx512,
+          bgr24_avx2, rgb565_avx2, yuv420_avx2 },    has_avx512 },
+#endif
+};
+
+static struct convert_kernel supported[sizeof(all_kernels) / sizeof(all_kernels[0])];
+static unsigned nb_supported;
+static unsigned convert_threads = 1;
+
+// Détection des instructions disponibles (une seule fois)
+static void detect_kernels(void)
+{
+    if (nb_supported)
+    {
+        return;
+    }
+#ifdef CONVERT_X86
+    __builtin_cpu_init();
+#endif
+    for (unsigned i = 0; i < sizeof(all_kernels) / sizeof(all_kernels[0]); i++)
+    {
+        if (!all_kernels[i].supported || all_kernels[i].supported())
+        {
+            supported[nb_supported++] = all_kernels[i].kernel;
+        }
+    }
+}
+
+void convert_init(unsigned threads)
+{
+    detect_kernels();
+    convert_threads = threads ? threads : cpu_count();
+}
+
+const struct convert_kernel *convert_kernel(void)
+{
+    detect_kernels();
+    return &supported[nb_supported - 1];
+}
+
+const struct convert_kernel *convert_kernels(unsigned *count)
+{
+    detect_kernels();
+    *count = nb_supported;
+    return supported;
+}
+
+struct convert_job {
+    convert_row_fn row;
+    const uint8_t *pixels;
+    uint32_t rowstride;
+    uint32_t width;
+    uint8_t *dst;
+};
+
+static void convert_rows(void *ctx, unsigned begin, unsigned end)
+{
+    struct convert_job *job = ctx;
+    size_t dst_stride = (size_t)job->width * 4;
+
+    for (unsigned y = begin; y < end; y++)
+    {
+        job->row(job->pixels + (size_t)y * job->rowstride,
+                 job->dst + y * dst_stride, job->width);
+    }
+}
+
+void convert_image(const struct convert_kernel *k, const uint8_t *pixels,
+                   uint32_t rowstride, int channels, uint32_t width,
+                   uint32_t height, uint8_t *dst, unsigned threads)
+{
+    struct convert_job job = {
+        .row       = channels == 4 ? k->rgba : k->rgb,
+        .pixels    = pixels,
+        .rowstride = rowstride,
+        .width     = width,
+        .dst       = dst
+    };
+
+    if ((size_t)width * height < CONVERT_PARALLEL_MIN_PIXELS)
+    {
+        threads = 1;
+    }
+    parallel_for(height, threads, convert_rows, &job);
+}
+
+void convert_to_bgrx(const uint8_t *pixels, uint32_t rowstride, int channels,
+                     uint32_t width, uint32_t height, uint8_t *dst)
+{
+    convert_image(convert_kernel(), pixels, rowstride, channels, width, height,
+                  dst, convert_threads);
+}
+
+struct pack_job {
+    const struct convert_kernel *k;
+    enum pixel_format fmt;
+    const uint8_t *bgrx;
+    uint32_t width, height;
+    uint8_t *dst;
+};
+
+// Lignes de blocs [begin, end) : une ligne de pixels, ou deux en 4:2:0 (la
+// dernière ligne d'une hauteur impaire est dupliquée)
+static void pack_rows(void *ctx, unsigned begin, unsigned end)
+{
+    struct pack_job *job = ctx;
+    size_t src_stride = (size_t)job->width * 4;
+    size_t dst_stride = (size_t)pixel_blocks(job->fmt, job->width) * pixel_block_bytes(job->fmt);
+
+    for (unsigned y = begin; y < end; y++)
+    {
+        uint8_t *dst = job->dst + y * dst_stride;
+
+        switch (job->fmt)
+        {
+        case PIXEL_FORMAT_BGR24:
+            job->k->bgr24(job->bgrx + y * src_stride, dst, job->width);
+            break;
+        case PIXEL_FORMAT_RGB565:
+            job->k->rgb565(job->bgrx + y * src_stride, dst, job->width);
+            break;
+        case PIXEL_FORMAT_YUV420:
+        {
+            uint32_t y1 = 2 * y + 1 < job->height ? 2 * y + 1 : 2 * y;
+            job->k->yuv420(job->bgrx + 2 * y * src_stride, job->bgrx + y1 * src_stride,
+                           dst, job->width);
+            break;
+        }
+        default:
+            memcpy(dst, job->bgrx + y * src_stride, src_stride);
+            break;
+        }
+    }
+}
+
+void convert_pixels(const struct convert_kernel *k, enum pixel_format fmt,
+                    const uint8_t *bgrx, uint32_t width, uint32_t height,
+                    uint8_t *dst, unsigned threads)
+{
+    struct pack_job job = {
+        .k      = k,
+        .fmt    = fmt,
+        .bgrx   = bgrx,
+        .width  = width,
+        .height = height,
+        .dst    = dst
+    };
+
+    if ((size_t)width * height < CONVERT_PARALLEL_MIN_PIXELS)
+    {
+        threads = 1;
+    }
+    parallel_for(pixel_blocks(fmt, height), threads, pack_rows, &job);
+}
+
+void convert_to_format(enum pixel_format fmt, const uint8_t *bgrx, uint32_t width,
+                       uint32_t height, uint8_t *dst)
+{
+    convert_pixels(convert_kernel(), fmt, bgrx, width, height, dst, convert_threads);
+}
+
+static const char *const format_names[PIXEL_FORMAT_COUNT] = {
+    "bgrx", "bgr24", "rgb565", "yuv420"
+};
+
+const char *pixel_format_name(enum pixel_format fmt)
+{
+    return fmt < PIXEL_FORMAT_COUNT ? format_names[fmt] : "?";
+}
+
+int pixel_format_parse(const char *name)
+{
+    for (int i = 0; i < PIXEL_FORMAT_COUNT; i++)
+    {
+        if (strcmp(name, format_names[i]) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
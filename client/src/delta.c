@@ -0,0 +1,294 @@
+#include "delta.h"
+#include "network.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Vrai si les lignes de la tuile sont identiques à celles de previous, la
+// copie de l'image précédente (même stride, tuile au même décalage). memcmp
+// s'arrête au premier octet différent : une tuile modifiée est vite écartée.
+static int tile_unchanged(const struct tile_ref *t, const uint8_t *previous)
+{
+    for (uint32_t y = 0; y < t->rows; y++)
+    {
+        if (memcmp(t->data + y * t->stride, previous + y * t->stride, t->row_bytes))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Recopie les lignes de la tuile dans previous
+static void tile_store(const struct tile_ref *t, uint8_t *previous)
+{
+    for (uint32_t y = 0; y < t->rows; y++)
+    {
+        memcpy(previous + y * t->stride, t->data + y * t->stride, t->row_bytes);
+    }
+}
+
+// Copie len octets de la tuile à partir de offset (ordre ligne par ligne)
+void tile_copy(const struct tile_ref *t, size_t offset, uint8_t *dst, size_t len)
+{
+    size_t row = offset / t->row_bytes;
+    size_t col = offset % t->row_bytes;
+
+    while (len)
+    {
+        size_t chunk = t->row_bytes - col;
+        if (chunk > len)
+        {
+            chunk = len;
+        }
+        memcpy(dst, t->data + row * t->stride + col, chunk);
+        dst += chunk;
+        len -= chunk;
+        row++;
+        col = 0;
+    }
+}
+
+// Décrit len octets de la tuile à partir de offset sous forme d'iovec
+// pointant directement dans l'image (une par morceau de ligne, les morceaux
+// contigus en mémoire sont fusionnés). Retourne le nombre d'iovec remplies,
+// au plus t->rows + 1.
+unsigned tile_iov(const struct tile_ref *t, size_t offset, size_t len,
+                  struct iovec *iov)
+{
+    size_t row = offset / t->row_bytes;
+    size_t col = offset % t->row_bytes;
+    unsigned n = 0;
+
+    while (len)
+    {
+        size_t chunk = t->row_bytes - col;
+        if (chunk > len)
+        {
+            chunk = len;
+        }
+
+        const uint8_t *p = t->data + row * t->stride + col;
+        if (n && (const uint8_t *)iov[n - 1].iov_base + iov[n - 1].iov_len == p)
+        {
+            iov[n - 1].iov_len += chunk;
+        }
+        else
+        {
+            iov[n].iov_base = (void *)p;
+            iov[n].iov_len  = chunk;
+            n++;
+        }
+        len -= chunk;
+        row++;
+        col = 0;
+    }
+    return n;
+}
+
+void delta_encoder_init(struct delta_encoder *enc, unsigned keyframe_interval, int interleave)
+{
+    memset(enc, 0, sizeof(*enc));
+    enc->keyframe_interval = keyframe_interval;
+    enc->need_keyframe = 1;
+    enc->interleave = interleave;
+}
+
+// (Ré)alloue la copie de l'image quand la résolution ou le format change
+static int delta_resize(struct delta_encoder *enc, uint32_t width, uint32_t height,
+                        enum pixel_format format)
+{
+    uint32_t tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+    uint32_t tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+    uint8_t *previous = malloc(pixel_image_bytes(format, width, height));
+
+    if (!previous)
+    {
+        perror("malloc");
+        return -1;
+    }
+
+    free(enc->previous);
+    enc->previous = previous;
+    enc->width    = width;
+    enc->height   = height;
+    enc->tiles_x  = tiles_x;
+    enc->tiles_y  = tiles_y;
+    enc->format   = format;
+    enc->need_keyframe = 1;
+    return 0;
+}
+
+// Tuile (tx, ty) de l'image. Lignes, colonnes et tuiles sont comptées en
+// blocs du format (des pixels sauf en 4:2:0).
+static struct tile_ref tile_at(const struct screen_data *sd, uint32_t tiles_x,
+                               uint32_t tx, uint32_t ty)
+{
+    uint32_t bytes  = pixel_block_bytes(sd->pixel_format);
+    uint32_t tile   = TILE_SIZE / pixel_block(sd->pixel_format);
+    uint32_t width  = pixel_blocks(sd->pixel_format, sd->width);
+    uint32_t height = pixel_blocks(sd->pixel_format, sd->height);
+    size_t stride = (size_t)width * bytes;
+    uint32_t x0 = tx * tile, y0 = ty * tile;
+
+    return (struct tile_ref) {
+        .tile_id   = ty * tiles_x + tx,
+        .data      = sd->data + y0 * stride + (size_t)x0 * bytes,
+        .stride    = stride,
+        .row_bytes = (width - x0 < tile ? width - x0 : tile) * bytes,
+        .rows      = height - y0 < tile ? height - y0 : tile
+    };
+}
+
+// Range les count tuiles dans l'ordre « bit-reversal » de leur rang : 0,
+// count/2, count/4, 3count/4... Tout début de l'envoi couvre alors l'image
+// entière à intervalles réguliers au lieu d'une bande du haut, et le
+// récepteur peut combler le reste par interpolation. Retourne -1 en cas
+// d'erreur (tuiles laissées dans l'ordre des lignes).
+static int interleave_tiles(struct tile_ref *tiles, uint32_t count)
+{
+    unsigned bits = 0;
+    while ((1ULL << bits) < count)
+    {
+        bits++;
+    }
+    if (bits < 2)
+    {
+        return 0;
+    }
+
+    struct tile_ref *raster = malloc(count * sizeof(*raster));
+    if (!raster)
+    {
+        perror("malloc");
+        return -1;
+    }
+    memcpy(raster, tiles, count * sizeof(*raster));
+
+    uint32_t n = 0;
+    for (uint64_t i = 0; i < 1ULL << bits; i++)
+    {
+        uint32_t r = 0;
+        for (unsigned b = 0; b < bits; b++)
+        {
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        if (r < count)
+        {
+            tiles[n++] = raster[r];
+        }
+    }
+    free(raster);
+    return 0;
+}
+
+// Découpe l'image en tuiles et ne retient que celles dont les pixels ont
+// changé depuis l'image précédente. Les tuiles pointent dans sd->data qui
+// doit rester valide jusqu'à l'envoi.
+int delta_encode(struct delta_encoder *enc, const struct screen_data *sd,
+                 uint32_t image_id, struct encoded_frame *out)
+{
+    if (sd->width != enc->width || sd->height != enc->height ||
+        sd->pixel_format != enc->format || !enc->previous)
+    {
+        if (delta_resize(enc, sd->width, sd->height, sd->pixel_format) < 0)
+        {
+            return -1;
+        }
+    }
+
+    // Image clé : au démarrage, après un changement de résolution et
+    // périodiquement pour qu'un récepteur qui a perdu des données se recale
+    int keyframe = enc->need_keyframe ||
+        (enc->keyframe_interval && enc->since_keyframe >= enc->keyframe_interval);
+
+    size_t nb = (size_t)enc->tiles_x * enc->tiles_y;
+    struct tile_ref *tiles = malloc(nb * sizeof(*tiles));
+    if (!tiles)
+    {
+        perror("malloc");
+        return -1;
+    }
+
+    uint32_t count = 0;
+    for (uint32_t ty = 0; ty < enc->tiles_y; ty++)
+    {
+        for (uint32_t tx = 0; tx < enc->tiles_x; tx++)
+        {
+            struct tile_ref t = tile_at(sd, enc->tiles_x, tx, ty);
+            uint8_t *previous = enc->previous + (t.data - sd->data);
+
+            if (keyframe || !tile_unchanged(&t, previous))
+            {
+                tile_store(&t, previous);
+                tiles[count++] = t;
+            }
+        }
+    }
+
+    if (enc->interleave)
+    {
+        interleave_tiles(tiles, count);
+    }
+
+    out->image_id = image_id;
+    out->width    = sd->width;
+    out->height   = sd->height;
+    out->flags    = (keyframe ? FRAME_FLAG_KEYFRAME : 0) | FRAME_FLAG_FORMAT(sd->pixel_format);
+    out->nb_tiles = count;
+    out->tiles    = tiles;
+    out->packed   = NULL;
+
+    if (keyframe)
+    {
+        enc->since_keyframe = 0;
+        enc->need_keyframe = 0;
+    }
+    enc->since_keyframe++;
+    return 0;
+}
+
+// Image clé sans empreintes : toutes les tuiles, dans l'ordre des lignes.
+// Les pixels de sd->data ne sont pas lus et peuvent être remplis ensuite.
+int delta_keyframe(const struct screen_data *sd, uint32_t image_id,
+                   struct encoded_frame *out)
+{
+    uint32_t tiles_x = (sd->width + TILE_SIZE - 1) / TILE_SIZE;
+    uint32_t tiles_y = (sd->height + TILE_SIZE - 1) / TILE_SIZE;
+    struct tile_ref *tiles = malloc((size_t)tiles_x * tiles_y * sizeof(*tiles));
+    if (!tiles)
+    {
+        perror("malloc");
+        return -1;
+    }
+
+    for (uint32_t ty = 0; ty < tiles_y; ty++)
+    {
+        for (uint32_t tx = 0; tx < tiles_x; tx++)
+        {
+            tiles[ty * tiles_x + tx] = tile_at(sd, tiles_x, tx, ty);
+        }
+    }
+
+    out->image_id = image_id;
+    out->width    = sd->width;
+    out->height   = sd->height;
+    out->flags    = FRAME_FLAG_KEYFRAME | FRAME_FLAG_FORMAT(sd->pixel_format);
+    out->nb_tiles = tiles_x * tiles_y;
+    out->tiles    = tiles;
+    out->packed   = NULL;
+    return 0;
+}
+
+void encoded_frame_clear(struct encoded_frame *ef)
+{
+    free(ef->tiles);
+    free(ef->packed);
+    memset(ef, 0, sizeof(*ef));
+}
+
+void delta_encoder_destroy(struct delta_encoder *enc)
+{
+    free(enc->previous);
+    enc->previous = NULL;
+}
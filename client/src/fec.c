@@ -0,0 +1,73 @@
+#include "fec.h"
+#include "gf256.h"
+#include "network.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int fec_init(struct fec_encoder *fec, unsigned k, unsigned m)
+{
+    memset(fec, 0, sizeof(*fec));
+    if (!k || !m)
+    {
+        return 0;
+    }
+
+    gf256_init();
+    fec->parity = malloc(m * FEC_SYMBOL);
+    if (!fec->parity)
+    {
+        perror("malloc");
+        return -1;
+    }
+    fec->k = k;
+    fec->m = m;
+    return 0;
+}
+
+void fec_destroy(struct fec_encoder *fec)
+{
+    free(fec->parity);
+    fec->parity = NULL;
+}
+
+// Matrice de Cauchy 1 / (x_j + y_i) avec x_j = j et y_i = 128 + i, chaque
+// colonne multipliée par (x_0 + y_i) pour que la parité 0 soit un XOR.
+// Toute sous-matrice carrée reste inversible : m paquets quelconques du
+// groupe peuvent être reconstruits.
+uint8_t fec_coef(unsigned j, unsigned i)
+{
+    uint8_t y = 128 + i;
+    return gf256_mul(y, gf256_inv(j ^ y));
+}
+
+void fec_begin(struct fec_encoder *fec, uint32_t first)
+{
+    fec->first = first;
+    fec->count = 0;
+    memset(fec->parity, 0, fec->m * FEC_SYMBOL);
+}
+
+void fec_add(struct fec_encoder *fec, const uint8_t *tile_header,
+             const struct tile_ref *t, size_t offset, size_t size)
+{
+    struct iovec iov[PACKET_MAX_IOV];
+    unsigned n = tile_iov(t, offset, size, iov);
+    unsigned i = fec->count++;
+
+    // Les morceaux de lignes sont accumulés directement depuis l'image ; le
+    // reste du symbole vaut zéro et ne change pas la parité
+    for (unsigned j = 0; j < fec->m; j++)
+    {
+        uint8_t c = fec_coef(j, i);
+        uint8_t *p = fec->parity + j * FEC_SYMBOL;
+
+        gf256_mul_add(p, tile_header, sizeof(struct tile_header), c);
+        p += sizeof(struct tile_header);
+        for (unsigned v = 0; v < n; v++)
+        {
+            gf256_mul_add(p, iov[v].iov_base, iov[v].iov_len, c);
+            p += iov[v].iov_len;
+        }
+    }
+}
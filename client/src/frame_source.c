@@ -0,0 +1,101 @@
+#include "frame_source.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Source portail : garde une screen_data dont le portail est réutilisé
+static int portal_next(struct frame_source *src, struct screen_data *sd)
+{
+    struct screen_data *capture = src->priv;
+
+    capture->data = NULL;
+    capture->length = 0;
+
+    if (capture_screenshot(capture) != 0)
+    {
+        return -1;
+    }
+
+    // Le PNG capturé appartient désormais à l'appelant
+    sd->data   = capture->data;
+    sd->length = capture->length;
+    sd->format = SD_FORMAT_PNG;
+    capture->data = NULL;
+    return 0;
+}
+
+static void portal_close(struct frame_source *src)
+{
+    struct screen_data *capture = src->priv;
+
+    if (capture->portal)
+    {
+        g_object_unref(capture->portal);
+    }
+    free(capture);
+}
+
+struct frame_source *portal_source_open(void)
+{
+    struct frame_source *src = calloc(1, sizeof(*src));
+    struct screen_data *capture = calloc(1, sizeof(*capture));
+
+    if (!src || !capture)
+    {
+        perror("calloc");
+        free(src);
+        free(capture);
+        return NULL;
+    }
+
+    src->name  = "portal";
+    src->next  = portal_next;
+    src->close = portal_close;
+    src->priv  = capture;
+    return src;
+}
+
+struct frame_source *frame_source_open(const char *spec)
+{
+    if (!spec || strcmp(spec, "portal") == 0)
+    {
+        return portal_source_open();
+    }
+
+    if (strncmp(spec, "files:", 6) == 0)
+    {
+        return file_source_open(spec + 6);
+    }
+
+    if (strncmp(spec, "synth:", 6) == 0)
+    {
+        // synth:MOTIF:LxH
+        char pattern[32];
+        unsigned width, height;
+
+        if (sscanf(spec + 6, "%31[^:]:%ux%u", pattern, &width, &height) != 3)
+        {
+            fprintf(stderr, "Source synthétique invalide: %s (attendu synth:MOTIF:LxH)\n", spec);
+            return NULL;
+        }
+        return synthetic_source_open(pattern, width, height);
+    }
+
+    fprintf(stderr, "Source inconnue: %s\n", spec);
+    return NULL;
+}
+
+int frame_source_next(struct frame_source *src, struct screen_data *sd)
+{
+    return src->next(src, sd);
+}
+
+void frame_source_close(struct frame_source *src)
+{
+    if (!src)
+    {
+        return;
+    }
+    src->close(src);
+    free(src);
+}
@@ -1,58 +1,450 @@
 #include "screenshot.h"
+#include "frame_source.h"
+#include "convert.h"
+#include "compress.h"
 #include "network.h"
+#include "options.h"
+#include "pipeline.h"
+#include "png_stream.h"
+#include "metrics.h"
 #include <liburing.h>
+#include <signal.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
 #include <time.h>
+#include <unistd.h>
 
-int main(void)
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_signal(int sig)
 {
-    // Initialise screen_data qui contient les données de l'image
-    struct screen_data sd = {0};
+    (void)sig;
+    stop_requested = 1;
+}
 
-    // Lance une capture d'ecran qui sera stocke dans sd
-    if (capture_screenshot(&sd) != 0)
+// Étage 1 : récupère une image depuis la source (portail, fichiers, synthèse)
+static int capture_stage(struct frame *frame, void *ctx)
+{
+    return frame_source_next(ctx, &frame->sd);
+}
+
+// Étage 2 : décode le PNG en BGRx puis passe au format envoyé sur le réseau
+// (les sources BGRx envoyées telles quelles ne sont pas copiées)
+static int convert_stage(struct frame *frame, void *ctx)
+{
+    const enum pixel_format *format = ctx;
+
+    if (frame->sd.format == SD_FORMAT_PNG && convert_png_to_raw(&frame->sd) != 0)
     {
+        return -1;
+    }
+    return convert_raw_to_format(&frame->sd, *format);
+}
+
+// Étage 3 : ne garde que les tuiles modifiées depuis l'image précédente
+static int delta_stage(struct frame *frame, void *ctx)
+{
+    return delta_encode(ctx, &frame->sd, frame->image_id, &frame->enc);
+}
+
+// Étage 4 (optionnel) : compresse chaque tuile indépendamment des autres
+static int compress_stage(struct frame *frame, void *ctx)
+{
+    return compress_frame(ctx, &frame->enc);
+}
+
+// Étage 5 : découpe les tuiles en paquets UDP et les envoie
+// L'émetteur garde les pixels pour les retransmissions
+static int send_stage(struct frame *frame, void *ctx)
+{
+    send_image_data(ctx, &frame->enc, frame->sd.data);
+    frame->sd.data = NULL;
+    return 0;
+}
+
+// Image seule en PNG, sans compression des tuiles : le PNG est décodé par
+// bandes de TILE_SIZE lignes et les tuiles de chaque bande partent dès
+// qu'elle est décodée, au lieu d'attendre l'image entière. *first_packet
+// reçoit l'heure du premier envoi. Retourne 1 si le PNG ne se décode pas
+// ligne par ligne (entrelacé) et doit passer par convert_png_to_raw.
+static int send_png_progressive(struct udp_sender *tx, struct screen_data *sd,
+                                enum pixel_format fmt, uint64_t *first_packet)
+{
+    struct png_stream ps;
+    if (png_stream_open(&ps, sd->data, sd->length) < 0)
+    {
+        return -1;
+    }
+    if (ps.interlaced)
+    {
+        png_stream_close(&ps);
         return 1;
     }
 
-    // Convertit la capture d'ecran PNG en un buffer brut BGRx
-    if (convert_png_to_raw(&sd) != 0)
+    // Image au format réseau remplie bande par bande. Mise à zéro : si le
+    // décodage échoue en route, la fin de l'image part noire plutôt qu'avec
+    // le contenu précédent de la mémoire.
+    uint32_t width = ps.width, height = ps.height;
+    size_t size = pixel_image_bytes(fmt, width, height);
+    size_t stride = (size_t)pixel_blocks(fmt, width) * pixel_block_bytes(fmt);
+    uint8_t *frame = calloc(1, size);
+    // Les autres formats passent par une bande BGRx
+    uint8_t *band = NULL;
+    if (frame && fmt != PIXEL_FORMAT_BGRX)
+    {
+        band = malloc((size_t)width * PIXEL_BYTES * TILE_SIZE);
+    }
+    if (!frame || (fmt != PIXEL_FORMAT_BGRX && !band))
+    {
+        perror("malloc");
+        free(frame);
+        png_stream_close(&ps);
+        return -1;
+    }
+
+    struct screen_data raw = {
+        .data = frame, .length = size, .width = width, .height = height,
+        .format = SD_FORMAT_RAW, .pixel_format = fmt
+    };
+    struct encoded_frame ef;
+    if (delta_keyframe(&raw, 0, &ef) != 0)
+    {
+        free(band);
+        free(frame);
+        png_stream_close(&ps);
+        return -1;
+    }
+    // L'émetteur garde l'image pour les retransmissions
+    int ret = sender_begin_image(tx, &ef, frame);
+    uint32_t tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+
+    for (uint32_t y = 0; ret == 0 && y < height; y += TILE_SIZE)
+    {
+        uint32_t rows = height - y < TILE_SIZE ? height - y : TILE_SIZE;
+        uint8_t *dst = band ? band : frame + y * stride;
+
+        if (png_stream_read(&ps, dst, (size_t)width * PIXEL_BYTES, rows) < 0)
+        {
+            ret = -1;
+            break;
+        }
+        if (band)
+        {
+            convert_to_format(fmt, band, width, rows,
+                              frame + (y / pixel_block(fmt)) * stride);
+        }
+        sender_send_tiles(tx, (y / TILE_SIZE + 1) * tiles_x);
+        if (!*first_packet)
+        {
+            *first_packet = now_ns();
+        }
+    }
+    // Toutes les tuiles ont été annoncées : l'image part jusqu'au bout
+    sender_finish_image(tx);
+
+    free(band);
+    png_stream_close(&ps);
+    g_free(sd->data);
+    sd->data = NULL;
+    sd->length = size;
+    sd->width = width;
+    sd->height = height;
+    sd->format = SD_FORMAT_RAW;
+    sd->pixel_format = fmt;
+    return ret;
+}
+
+// Point de départ des débits d'une ligne « metrics »
+struct metrics_mark {
+    uint64_t ns;
+    uint64_t packets;
+    uint64_t bytes;
+};
+
+static struct metrics_mark metrics_mark(const struct udp_sender *tx)
+{
+    return (struct metrics_mark) { now_ns(), tx->packets, tx->bytes };
+}
+
+// Ligne « metrics » : paires clé=valeur, débits depuis since (avancé au
+// relevé si advance). L'ordre et le nom des clés ne changent pas, de
+// nouvelles clés s'ajoutent à la fin.
+static int format_metrics(char *buf, size_t size, const struct metrics_mark *start,
+                          struct metrics_mark *since, int advance, struct pipeline *p,
+                          const struct udp_sender *tx)
+{
+    struct metrics_mark now = metrics_mark(tx);
+    double elapsed = (now.ns - since->ns) / 1e9;
+    int n = snprintf(buf, size, "metrics uptime_s=%.3f interval_s=%.3f tx_pps=%.0f tx_bytes_s=%.0f ",
+                     (now.ns - start->ns) / 1e9, elapsed,
+                     elapsed > 0 ? (now.packets - since->packets) / elapsed : 0.0,
+                     elapsed > 0 ? (now.bytes - since->bytes) / elapsed : 0.0);
+    if (p && n < (int)size)
+    {
+        n += pipeline_metrics(p, buf + n, size - n);
+        if (n < (int)size)
+        {
+            n += snprintf(buf + n, size - n, " ");
+        }
+    }
+    if (n < (int)size)
+    {
+        n += sender_metrics(tx, buf + n, size - n);
+    }
+    if (n < (int)size)
+    {
+        n += snprintf(buf + n, size - n, "\n");
+    }
+    if (advance)
+    {
+        *since = now;
+    }
+    return n < (int)size ? n : (int)size - 1;
+}
+
+// Mode flux continu : les étages tournent en parallèle, l'image N+1 est
+// capturée et convertie pendant que l'image N est envoyée
+static int run_stream(const struct client_options *opts, struct frame_source *src,
+                      struct udp_sender *tx, struct tile_compressor *comp)
+{
+    struct pipeline p;
+    struct delta_encoder enc;
+
+    pipeline_init(&p, opts->queue_depth, opts->max_frames);
+    delta_encoder_init(&enc, opts->keyframe_interval, opts->interleave);
+
+    // Si l'envoi n'arrive pas à suivre, les images en attente sont périmées :
+    // on jette la plus ancienne plutôt que de laisser les files grossir.
+    // Une image déjà comparée à la précédente ne peut plus être jetée sans
+    // désynchroniser le récepteur : les files après le delta bloquent.
+    if (pipeline_add_stage(&p, "capture", capture_stage, src, QUEUE_DROP_OLDEST) < 0 ||
+        pipeline_add_stage(&p, "conversion", convert_stage, (void *)&opts->pixel_format,
+                           QUEUE_DROP_OLDEST) < 0 ||
+        pipeline_add_stage(&p, "delta", delta_stage, &enc, QUEUE_DROP_OLDEST) < 0 ||
+        (comp->codec != CODEC_NONE &&
+         pipeline_add_stage(&p, "compression", compress_stage, comp, QUEUE_BLOCK) < 0) ||
+        pipeline_add_stage(&p, "envoi", send_stage, tx, QUEUE_BLOCK) < 0)
+    {
+        pipeline_destroy(&p);
+        delta_encoder_destroy(&enc);
+        return -1;
+    }
+
+    struct sigaction sa = { .sa_handler = on_signal };
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    if (pipeline_start(&p) < 0)
+    {
+        pipeline_destroy(&p);
+        delta_encoder_destroy(&enc);
+        return -1;
+    }
+
+    // Le thread principal se contente d'afficher les statistiques, et de
+    // les donner aux lecteurs de la socket
+    struct metrics_endpoint ep = { .fd = -1 };
+    if (opts->metrics_socket)
+    {
+        metrics_listen(&ep, opts->metrics_socket);
+    }
+    struct metrics_mark start = metrics_mark(tx), last = start;
+    char line[4096];
+
+    uint64_t next_report = now_ns() + opts->stats_interval * 1000000000ull;
+    while (!pipeline_done(&p))
+    {
+        // Les lecteurs reçoivent les débits moyens depuis le démarrage
+        if (metrics_poll(&ep, 100))
+        {
+            struct metrics_mark since = start;
+            int len = format_metrics(line, sizeof(line), &start, &since, 0, &p, tx);
+            metrics_send(&ep, line, len);
+        }
+
+        if (stop_requested)
+        {
+            pipeline_stop(&p);
+        }
+        if (now_ns() >= next_report)
+        {
+            pipeline_report(&p, stdout, 0);
+            if (comp->codec != CODEC_NONE)
+            {
+                compressor_report(comp, stdout);
+            }
+            sender_report(tx, stdout);
+            if (opts->metrics)
+            {
+                format_metrics(line, sizeof(line), &start, &last, 1, &p, tx);
+                fputs(line, stdout);
+                fflush(stdout);
+            }
+            next_report += opts->stats_interval * 1000000000ull;
+        }
+    }
+
+    pipeline_join(&p);
+    metrics_close(&ep);
+
+    // Le serveur peut encore redemander des paquets de la dernière image
+    sender_linger(tx, RETX_DEADLINE_MS);
+    pipeline_report(&p, stdout, 1);
+    if (comp->codec != CODEC_NONE)
+    {
+        compressor_report(comp, stdout);
+    }
+    sender_report(tx, stdout);
+    if (opts->metrics)
+    {
+        format_metrics(line, sizeof(line), &start, &last, 0, &p, tx);
+        fputs(line, stdout);
+    }
+    pipeline_destroy(&p);
+    delta_encoder_destroy(&enc);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    struct client_options opts;
+    if (parse_options(argc, argv, &opts) < 0)
     {
         return 1;
     }
 
-    // Setup la socket UDP pour envoyer les données
-    struct sockaddr_in dest;
-    int sock = setup_socket(&dest);
+    // Choisit le noyau de conversion selon les instructions du CPU
+    convert_init(opts.convert_threads);
+
+    // Les tuiles sont compressées par les mêmes threads que la conversion
+    struct tile_compressor comp;
+    compressor_init(&comp, opts.codec, opts.codec_level, opts.convert_threads);
+
+    // Ouvre la source d'images (portail par défaut)
+    struct frame_source *src = frame_source_open(opts.source);
+    if (!src)
+    {
+        return 1;
+    }
 
-    if (sock < 0)
+    // Setup la socket UDP et io_uring pour envoyer les données
+    struct udp_sender tx;
+    if (sender_init(&tx, &opts.server, opts.send_mode, opts.gso, opts.send_depth,
+                    opts.sqpoll) < 0)
+    {
+        frame_source_close(src);
+        return 1;
+    }
+    tx.stream_id = opts.stream_id;
+    if (sender_set_fec(&tx, opts.fec_k, opts.fec_m) < 0)
     {
+        sender_destroy(&tx);
+        frame_source_close(src);
         return 1;
     }
+    sender_set_pacing(&tx, opts.pacing, opts.pacing_rate, opts.pacing_adaptive,
+                      opts.pacing_max);
+
+    if (opts.stream)
+    {
+        int ret = run_stream(&opts, src, &tx, &comp);
+        sender_destroy(&tx);
+        frame_source_close(src);
+        return ret < 0 ? 1 : 0;
+    }
 
-    // Setup io_uring avec 32 opérations asynchrones.
-    struct io_uring ring;
-    if (io_uring_queue_init(32, &ring, 0) < 0)
+    // Initialise screen_data qui contient les données de l'image
+    struct screen_data sd = {0};
+
+    // Récupère une image de la source qui sera stockée dans sd
+    if (frame_source_next(src, &sd) != 0)
     {
         return 1;
     }
 
-    double start = clock();
+    uint64_t captured = now_ns(), first_packet = 0;
+    struct delta_encoder enc;
+    delta_encoder_init(&enc, opts.keyframe_interval, opts.interleave);
+    // Durées en temps réel : clock() compterait le temps CPU du processus,
+    // pas celui passé à attendre le réseau
+    uint64_t start = now_ns();
+    int progressive = sd.format == SD_FORMAT_PNG && comp.codec == CODEC_NONE &&
+                      !opts.interleave;
+
+    // Sans compression, le nombre de paquets est connu dès l'en-tête du PNG :
+    // l'envoi commence pendant le décodage (les tuiles partent alors dans
+    // l'ordre des lignes, à mesure qu'elles sont décodées)
+    if (progressive)
+    {
+        int ret = send_png_progressive(&tx, &sd, opts.pixel_format, &first_packet);
+        if (ret < 0)
+        {
+            return 1;
+        }
+        progressive = ret == 0;
+    }
+
+    if (!progressive)
+    {
+        // Convertit la capture d'ecran PNG en un buffer brut BGRx
+        if (sd.format == SD_FORMAT_PNG && convert_png_to_raw(&sd) != 0)
+        {
+            return 1;
+        }
+
+        // Puis dans le format choisi pour le réseau
+        if (convert_raw_to_format(&sd, opts.pixel_format) != 0)
+        {
+            return 1;
+        }
+
+        // Une image seule est forcément une image clé : toutes les tuiles
+        struct encoded_frame ef;
+        if (delta_encode(&enc, &sd, 0, &ef) != 0 || compress_frame(&comp, &ef) != 0)
+        {
+            return 1;
+        }
+
+        start = first_packet = now_ns();
+
+        // Envoi de l'image capturée en plussieurs paquets UDP
+        send_image_data(&tx, &ef, sd.data);
+    }
+
+    double end = (now_ns() - start) / 1e9;
 
-    // Envoi de l'image capturée en plussieurs paquets UDP
-    send_image_data(sock, &ring, &sd, &dest);
+    // Le serveur peut encore redemander des paquets perdus
+    sender_linger(&tx, RETX_DEADLINE_MS);
 
-    double end = (clock() - start) / CLOCKS_PER_SEC;
-    
     // Affiche le temps d'envoi et le débit
     printf("Envoi terminé en %.2f s, débit %.2f MB/s\n",
            end, (sd.length/ (1024.0*1024.0))/end);
-   
+
+    // Délai entre la capture et le premier paquet, et mémoire maximale
+    // utilisée (ru_maxrss en Ko)
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    printf("Premier paquet %.1f ms après la capture (%s), pic mémoire %.1f Mo\n",
+           (first_packet - captured) / 1e6, progressive ? "décodage par bandes" : "image entière",
+           ru.ru_maxrss / 1024.0);
+    if (comp.codec != CODEC_NONE)
+    {
+        compressor_report(&comp, stdout);
+    }
+    sender_report(&tx, stdout);
+    if (opts.metrics)
+    {
+        char line[4096];
+        struct metrics_mark mark = { captured, 0, 0 };
+        format_metrics(line, sizeof(line), &mark, &mark, 0, NULL, &tx);
+        fputs(line, stdout);
+    }
+
     // Nettoyage des ressources
-    io_uring_queue_exit(&ring);
-    close(sock);
-    g_free(sd.data);
-    g_object_unref(sd.portal);
-    
+    sender_destroy(&tx);
+    delta_encoder_destroy(&enc);
+    frame_source_close(src);
+
     return 0;
 }
@@ -0,0 +1,104 @@
+#include "metrics.h"
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+uint64_t metrics_hist_percentile(const struct metrics_hist *h, double p)
+{
+    uint64_t count = __atomic_load_n(&h->count, __ATOMIC_RELAXED);
+    if (!count)
+    {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(p * count);
+    if (rank == 0)
+    {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (unsigned b = 0; b < METRICS_BUCKETS; b++)
+    {
+        seen += __atomic_load_n(&h->buckets[b], __ATOMIC_RELAXED);
+        if (seen >= rank)
+        {
+            return b ? (1ull << b) - 1 : 0;
+        }
+    }
+    return (1ull << (METRICS_BUCKETS - 1)) - 1;
+}
+
+int metrics_listen(struct metrics_endpoint *ep, const char *path)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+
+    ep->fd = -1;
+    ep->path = path;
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "Chemin de socket trop long : %s\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    // Socket laissée par une exécution précédente : remplacée. Tout autre
+    // fichier à cet endroit est laissé tel quel (bind échouera).
+    struct stat st;
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+    {
+        unlink(path);
+    }
+
+    ep->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (ep->fd < 0)
+    {
+        perror("socket(AF_UNIX)");
+        return -1;
+    }
+    if (bind(ep->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(ep->fd, 8) < 0)
+    {
+        fprintf(stderr, "Socket de statistiques %s : %s\n", path, strerror(errno));
+        close(ep->fd);
+        ep->fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+int metrics_poll(struct metrics_endpoint *ep, int timeout_ms)
+{
+    struct pollfd pfd = { .fd = ep->fd, .events = POLLIN };
+
+    // Sans socket, poll sert simplement d'attente
+    return poll(&pfd, ep->fd >= 0, timeout_ms) > 0;
+}
+
+void metrics_send(struct metrics_endpoint *ep, const char *text, size_t len)
+{
+    int client;
+
+    while ((client = accept(ep->fd, NULL, NULL)) >= 0)
+    {
+        // Quelques Ko tiennent dans le buffer de la socket : pas d'attente
+        if (send(client, text, len, MSG_NOSIGNAL | MSG_DONTWAIT) < 0)
+        {
+            perror("metrics : send");
+        }
+        close(client);
+    }
+}
+
+void metrics_close(struct metrics_endpoint *ep)
+{
+    if (ep->fd >= 0)
+    {
+        close(ep->fd);
+        unlink(ep->path);
+        ep->fd = -1;
+    }
+}
@@ -1,32 +1,68 @@
+#define _GNU_SOURCE            // sendmmsg
 #include "network.h"
 #include <sys/socket.h>
 #include <arpa/inet.h>
+#include <netinet/udp.h>
 #include <unistd.h>
 #include <string.h>
+#include <stdlib.h>
 #include <stdio.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
 
-int setup_socket(struct sockaddr_in *dest)
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+#ifndef SCM_TXTIME
+#define SCM_TXTIME 61
+#endif
+
+// Remplit dest à partir de "adresse[:port]" (port SERVER_PORT par défaut),
+// retourne -1 si l'adresse IPv4 ou le port est invalide
+int parse_address(const char *arg, struct sockaddr_in *dest)
 {
-    // Creation d'une socket UDP en IPv4
-    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    char host[INET_ADDRSTRLEN];
+    const char *colon = strchr(arg, ':');
+    size_t len = colon ? (size_t)(colon - arg) : strlen(arg);
+    unsigned long port = SERVER_PORT;
 
-    if (sock < 0)
+    if (len >= sizeof(host))
     {
-        perror("socket"); 
         return -1;
     }
+    memcpy(host, arg, len);
+    host[len] = '\0';
+
+    if (colon)
+    {
+        char *end;
+        port = strtoul(colon + 1, &end, 10);
+        if (end == colon + 1 || *end || port == 0 || port > 65535)
+        {
+            return -1;
+        }
+    }
 
     // Mise à 0 de la structure d'adresse de destination
     memset(dest, 0, sizeof(*dest));
-
-    // L'adresse est en IPv4, sur le port SERVER_PORT = 8080
     dest->sin_family = AF_INET;
-    dest->sin_port   = htons(SERVER_PORT);
+    dest->sin_port   = htons(port);
 
     // Conversion de l'adresse IP en format binaire
-    if (inet_pton(AF_INET, SERVER_ADDR, &dest->sin_addr) != 1)
+    return inet_pton(AF_INET, host, &dest->sin_addr) == 1 ? 0 : -1;
+}
+
+int setup_socket(void)
+{
+    // Creation d'une socket UDP en IPv4
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if (sock < 0)
     {
-        perror("inet_pton"); close(sock); return -1;
+        perror("socket"); 
+        return -1;
     }
 
     // Taille du buffer d'envoi (32Mo est adapte pour un flux d'image)
@@ -38,114 +74,1135 @@ int setup_socket(struct sockaddr_in *dest)
     return sock;
 }
 
-void send_image_data(int sock, struct io_uring *ring, struct screen_data* sd,
-const struct sockaddr_in *dest)
+// Active la segmentation UDP par le noyau : chaque envoi plus grand que
+// PACKET_SIZE est découpé en datagrammes de PACKET_SIZE octets
+static int enable_gso(int sock)
+{
+    int size = PACKET_SIZE;
+
+    if (setsockopt(sock, SOL_UDP, UDP_SEGMENT, &size, sizeof(size)) < 0)
+    {
+        perror("setsockopt(UDP_SEGMENT)");
+        return 0;
+    }
+    return 1;
+}
+
+// Socket à passer aux SQE : son indice si elle est enregistrée dans la ring
+static void prep_socket(const struct udp_sender *tx, struct io_uring_sqe *sqe)
+{
+    if (tx->fixed_file)
+    {
+        sqe->fd = 0;
+        io_uring_sqe_set_flags(sqe, IOSQE_FIXED_FILE);
+    }
+}
+
+// Une réception toujours en attente sur la socket d'envoi : le serveur y
+// répond avec les plages de paquets qu'il n'a pas reçus. En mode SEND_MMSG,
+// la socket est lue directement (read_feedback).
+static void arm_feedback(struct udp_sender *tx)
+{
+    struct io_uring_sqe *sqe;
+
+    if (tx->mode == SEND_MMSG || !(sqe = io_uring_get_sqe(&tx->ring)))
+    {
+        return;
+    }
+    tx->fb_iov.iov_base = tx->feedback;
+    tx->fb_iov.iov_len = sizeof(tx->feedback);
+    tx->fb_msgh = (struct msghdr) {
+        .msg_name = &tx->fb_from,
+        .msg_namelen = sizeof(tx->fb_from),
+        .msg_iov = &tx->fb_iov,
+        .msg_iovlen = 1
+    };
+    io_uring_prep_recvmsg(sqe, tx->sock, &tx->fb_msgh, 0);
+    prep_socket(tx, sqe);
+    io_uring_sqe_set_data(sqe, &tx->fb_msgh);
+    tx->fb_armed = 1;
+}
+
+// Ring avec deux entrées par envoi en vol, plus la réception des NACK. Le
+// thread SQPOLL peut être refusé (privilèges sur les anciens noyaux) : on
+// revient alors aux soumissions par appel système. La socket est
+// enregistrée dans la ring pour éviter de la résoudre à chaque envoi.
+static int setup_ring(struct udp_sender *tx, int sqpoll)
+{
+    struct io_uring_params params;
+
+    if (sqpoll)
+    {
+        memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_SQPOLL;
+        params.sq_thread_idle = SENDER_SQPOLL_IDLE;
+        int ret = io_uring_queue_init_params(tx->depth * 2, &tx->ring, &params);
+        if (ret == 0)
+        {
+            tx->sqpoll = 1;
+        }
+        else
+        {
+            fprintf(stderr, "SQPOLL refusé (%s), soumissions par appel système\n",
+                    strerror(-ret));
+        }
+    }
+    if (!tx->sqpoll && io_uring_queue_init(tx->depth * 2, &tx->ring, 0) < 0)
+    {
+        perror("io_uring_queue_init");
+        return -1;
+    }
+
+    tx->fixed_file = io_uring_register_files(&tx->ring, &tx->sock, 1) == 0;
+
+    if (tx->mode == SEND_ZEROCOPY)
+    {
+        struct io_uring_probe *probe = io_uring_get_probe_ring(&tx->ring);
+        if (!probe || !io_uring_opcode_supported(probe, IORING_OP_SENDMSG_ZC))
+        {
+            fprintf(stderr, "Zero-copy non supporté par le noyau, envoi par iovec\n");
+            tx->mode = SEND_IOVEC;
+        }
+        if (probe)
+        {
+            io_uring_free_probe(probe);
+        }
+    }
+    return 0;
+}
+
+// Prépare la ring, le pool de slots et vérifie que le noyau sait faire du
+// zero-copy (sinon on se rabat sur sendmsg avec iovec) et de la segmentation
+int sender_init(struct udp_sender *tx, const struct sockaddr_in *dest,
+                enum send_mode mode, int gso, unsigned depth, int sqpoll)
+{
+    memset(tx, 0, sizeof(*tx));
+    tx->mode = mode;
+    tx->dest = *dest;
+    tx->depth = depth;
+
+    // Setup la socket UDP pour envoyer les données
+    tx->sock = setup_socket();
+    if (tx->sock < 0)
+    {
+        return -1;
+    }
+
+    if (gso)
+    {
+        tx->gso = enable_gso(tx->sock);
+        if (!tx->gso)
+        {
+            fprintf(stderr, "GSO non supporté par le noyau, un paquet par envoi\n");
+        }
+    }
+
+    if (tx->mode != SEND_MMSG && setup_ring(tx, sqpoll) < 0)
+    {
+        close(tx->sock);
+        return -1;
+    }
+
+    tx->slots = calloc(tx->depth, sizeof(*tx->slots));
+    tx->free_slots = calloc(tx->depth, sizeof(*tx->free_slots));
+    if (tx->mode == SEND_MMSG)
+    {
+        tx->mmsg = calloc(tx->depth, sizeof(*tx->mmsg));
+        tx->mmsg_slots = calloc(tx->depth, sizeof(*tx->mmsg_slots));
+    }
+    if (!tx->slots || !tx->free_slots ||
+        (tx->mode == SEND_MMSG && (!tx->mmsg || !tx->mmsg_slots)))
+    {
+        perror("calloc");
+        sender_destroy(tx);
+        return -1;
+    }
+
+    for (unsigned i = 0; i < tx->depth; i++)
+    {
+        if (tx->mode == SEND_COPY)
+        {
+            tx->slots[i].bounce = malloc(GSO_MAX_SEGMENTS * PACKET_PAYLOAD);
+            if (!tx->slots[i].bounce)
+            {
+                perror("malloc");
+                sender_destroy(tx);
+                return -1;
+            }
+        }
+        tx->free_slots[tx->nb_free++] = &tx->slots[i];
+    }
+
+    retx_init(&tx->retx);
+    if (tx->mode != SEND_MMSG)
+    {
+        arm_feedback(tx);
+        io_uring_submit(&tx->ring);
+    }
+    return 0;
+}
+
+int sender_set_fec(struct udp_sender *tx, unsigned k, unsigned m)
+{
+    if (fec_init(&tx->fec, k, m) < 0)
+    {
+        return -1;
+    }
+    if (!tx->fec.k)
+    {
+        return 0;
+    }
+
+    // Chaque slot garde sa copie des parités jusqu'à la fin de l'envoi
+    for (unsigned i = 0; i < tx->depth; i++)
+    {
+        tx->slots[i].parity = malloc(m * FEC_SYMBOL);
+        if (!tx->slots[i].parity)
+        {
+            perror("malloc");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void sender_set_pacing(struct udp_sender *tx, enum pacing_mode mode, uint64_t rate,
+                       int adaptive, uint64_t max_rate)
+{
+    pacer_init(&tx->pacer, tx->sock, mode, rate, adaptive, max_rate);
+}
+
+void sender_destroy(struct udp_sender *tx)
+{
+    if (tx->slots)
+    {
+        for (unsigned i = 0; i < tx->depth; i++)
+        {
+            free(tx->slots[i].bounce);
+            free(tx->slots[i].parity);
+        }
+        free(tx->slots);
+        tx->slots = NULL;
+    }
+    free(tx->free_slots);
+    free(tx->mmsg);
+    free(tx->mmsg_slots);
+    if (tx->mode != SEND_MMSG)
+    {
+        io_uring_queue_exit(&tx->ring);
+    }
+    close(tx->sock);
+    retx_destroy(&tx->retx);
+    fec_destroy(&tx->fec);
+}
+
+// Débit et coût CPU de l'envoi depuis le démarrage
+void sender_report(const struct udp_sender *tx, FILE *out)
+{
+    static const char *modes[] = { "copie", "iovec", "zero-copy", "sendmmsg" };
+    double mb = tx->bytes / (1024.0 * 1024.0);
+    double secs = tx->wall_ns / 1e9;
+    double gb = tx->bytes / 1e9;
+    char fec[96] = "";
+    char pacing[256] = "";
+
+    if (tx->fec.k)
+    {
+        snprintf(fec, sizeof(fec), " | FEC %u+%u : %llu paquets de parité (+%.1f%%)",
+                 tx->fec.k, tx->fec.m, (unsigned long long)tx->parity_packets,
+                 tx->packets ? 100.0 * tx->parity_packets / tx->packets : 0.0);
+    }
+
+    // Étalement, et ce qu'en dit le récepteur : pertes au premier passage
+    // et débit auquel les images lui arrivent
+    const struct pacer *p = &tx->pacer;
+    if (pacer_enabled(p) || p->reports)
+    {
+        static const char *pacing_modes[] = { "utilisateur", "fq", "txtime" };
+        int n = 0;
+
+        if (pacer_enabled(p))
+        {
+            n = snprintf(pacing, sizeof(pacing), " | étalement %s à %.0f Mbit/s%s, %llu attentes (%.2f s)",
+                         pacing_modes[p->mode], p->rate * 8 / 1e6,
+                         p->adaptive ? " (adaptatif)" : "", (unsigned long long)p->waits,
+                         p->wait_ns / 1e9);
+        }
+        // Les images jamais vues par le récepteur comptent aussi : les
+        // pertes se mesurent sur tous les paquets envoyés
+        if (p->reports)
+        {
+            snprintf(pacing + n, sizeof(pacing) - n,
+                     " | récepteur : %llu bilans, %llu images jamais vues, "
+                     "%.2f%% perdus au premier envoi, %.0f Mbit/s reçus",
+                     (unsigned long long)p->reports, (unsigned long long)p->lost_frames,
+                     p->sent ? 100.0 * (p->sent - p->received) / p->sent : 0.0,
+                     p->delivered_ns ? p->delivered_bytes * 8 * 1e3 / p->delivered_ns : 0.0);
+        }
+    }
+
+    fprintf(out, "[envoi] mode %s%s%s, %u en vol | %llu paquets en %llu envois (%.1f/envoi), "
+            "%.1f MB en %.2f s | %.1f MB/s | "
+            "%.3f s CPU/GB | %llu erreurs, %llu renvois sans zero-copy | "
+            "NACK : %llu reçus, %llu paquets demandés, %llu renvoyés, %llu abandonnés%s%s\n",
+            modes[tx->mode], tx->gso ? " + GSO" : "", tx->sqpoll ? " + SQPOLL" : "",
+            tx->depth, (unsigned long long)tx->packets, (unsigned long long)tx->sends,
+            tx->sends ? (double)tx->packets / tx->sends : 0.0, mb, secs,
+            secs > 0 ? mb / secs : 0.0, gb > 0 ? tx->cpu_ns / 1e9 / gb : 0.0,
+            (unsigned long long)tx->errors, (unsigned long long)tx->zc_fallbacks,
+            (unsigned long long)tx->retx.nacks, (unsigned long long)tx->retx.requested,
+            (unsigned long long)tx->retx.resent, (unsigned long long)tx->retx.abandoned,
+            fec, pacing);
+}
+
+int sender_metrics(const struct udp_sender *tx, char *buf, size_t size)
+{
+    return snprintf(buf, size, "packets=%llu sends=%llu bytes=%llu errors=%llu "
+                    "zc_fallbacks=%llu parity=%llu nacks=%llu resent=%llu abandoned=%llu "
+                    "cqe_batch_p50=%llu cqe_batch_p99=%llu in_flight_p50=%llu "
+                    "in_flight_p99=%llu pacing_waits=%llu pacing_rate_bps=%.0f "
+                    "send_cpu_s=%.3f send_wall_s=%.3f",
+                    (unsigned long long)tx->packets, (unsigned long long)tx->sends,
+                    (unsigned long long)tx->bytes, (unsigned long long)tx->errors,
+                    (unsigned long long)tx->zc_fallbacks, (unsigned long long)tx->parity_packets,
+                    (unsigned long long)tx->retx.nacks, (unsigned long long)tx->retx.resent,
+                    (unsigned long long)tx->retx.abandoned,
+                    (unsigned long long)metrics_hist_percentile(&tx->cqe_batch, 0.5),
+                    (unsigned long long)metrics_hist_percentile(&tx->cqe_batch, 0.99),
+                    (unsigned long long)metrics_hist_percentile(&tx->in_flight, 0.5),
+                    (unsigned long long)metrics_hist_percentile(&tx->in_flight, 0.99),
+                    (unsigned long long)tx->pacer.waits, tx->pacer.rate * 8.0,
+                    tx->cpu_ns / 1e9, tx->wall_ns / 1e9);
+}
+
+static uint64_t thread_cpu_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static uint64_t wall_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Nombre de paquets nécessaires pour envoyer toutes les tuiles de l'image.
+// Un paquet ne contient jamais de données de deux tuiles différentes.
+size_t frame_packet_count(const struct encoded_frame *ef)
+{
+    size_t total = 0;
+
+    for (uint32_t i = 0; i < ef->nb_tiles; i++)
+    {
+        total += (tile_bytes(&ef->tiles[i]) + PACKET_PAYLOAD - 1) / PACKET_PAYLOAD;
+    }
+    return total;
+}
+
+// Écrit le packet_header d'un paquet de l'image dans dst
+static void write_header(const struct udp_sender *tx, const struct encoded_frame *ef,
+                         size_t seq, size_t total, uint32_t flags, uint8_t *dst)
+{
+    struct packet_header header = {
+        .image_id = htonl(ef->image_id),
+        .seq = htonl(seq),
+        .total_packets = htonl(total),
+        .width = htonl(ef->width),
+        .height = htonl(ef->height),
+        .flags = htonl(ef->flags | flags | PACKET_FEC_K(tx->fec.k)),
+        .stream_id = htonl(tx->stream_id)
+    };
+
+    memcpy(dst, &header, sizeof(header));
+}
+
+// Ajoute un paquet au slot : ses headers puis ses données. Les pixels ne
+// sont pas copiés (sauf en mode SEND_COPY) : les iovec pointent dans l'image.
+static void add_packet(struct udp_sender *tx, struct tx_slot *slot,
+                       const struct encoded_frame *ef, const struct tile_ref *t,
+                       size_t seq, size_t total, size_t tile_offset, size_t size,
+                       uint32_t flags)
+{
+    uint8_t *headers = slot->headers[slot->nb_packets];
+
+    // On prépare le header du paquet
+    write_header(tx, ef, seq, total, flags, headers);
+
+    // Et la position de ses données dans la tuile
+    struct tile_header th = {
+        .tile_id = htonl(t->tile_id),
+        .offset = htonl(tile_wire_offset(t, tile_offset))
+    };
+
+    memcpy(headers + sizeof(struct packet_header), &th, sizeof(th));
+
+    slot->iov[slot->nb_iov].iov_base = headers;
+    slot->iov[slot->nb_iov].iov_len = PACKET_HEADERS;
+    slot->nb_iov++;
+
+    if (tx->mode == SEND_COPY)
+    {
+        uint8_t *bounce = slot->bounce + slot->nb_packets * PACKET_PAYLOAD;
+        tile_copy(t, tile_offset, bounce, size);
+        slot->iov[slot->nb_iov].iov_base = bounce;
+        slot->iov[slot->nb_iov].iov_len = size;
+        slot->nb_iov++;
+    }
+    else
+    {
+        slot->nb_iov += tile_iov(t, tile_offset, size, &slot->iov[slot->nb_iov]);
+    }
+    slot->nb_packets++;
+}
+
+// Nombre de pages touchées par les iovec [first, slot->nb_iov)
+static unsigned iov_frags(const struct tx_slot *slot, unsigned first)
+{
+    const uintptr_t page = 4096;
+    unsigned frags = 0;
+
+    for (unsigned i = first; i < slot->nb_iov; i++)
+    {
+        uintptr_t start = (uintptr_t)slot->iov[i].iov_base;
+        uintptr_t end = start + slot->iov[i].iov_len - 1;
+        frags += end / page - start / page + 1;
+    }
+    return frags;
+}
+
+// Le dernier paquet ajouté (iovec à partir de first) tient-il dans l'envoi ?
+// Seul le zero-copy limite le nombre de fragments d'un datagramme GSO.
+static int slot_fits(const struct udp_sender *tx, struct tx_slot *slot, unsigned first)
 {
-    // Taille du header de notre paquet
-    size_t header_size = sizeof(struct packet_header);
-    
-    // Taille du payload de notre paquet
-    size_t payload_size = PACKET_SIZE - header_size;
+    if (tx->mode != SEND_ZEROCOPY)
+    {
+        return 1;
+    }
+    slot->nb_frags += iov_frags(slot, first);
+    return slot->nb_packets == 1 || slot->nb_frags <= ZC_MAX_FRAGS;
+}
+
+// Un paquet de plus peut-il rejoindre cet envoi ? Le noyau découpe l'envoi
+// en segments de PACKET_SIZE : seul le dernier paquet peut être plus court.
+static int slot_can_grow(const struct udp_sender *tx, const struct tx_slot *slot,
+                         size_t last_size)
+{
+    return tx->gso &&
+           last_size == PACKET_PAYLOAD &&
+           slot->nb_packets < pacer_segments(&tx->pacer, GSO_MAX_SEGMENTS) &&
+           slot->nb_iov + PACKET_MAX_IOV <= SLOT_MAX_IOV;
+}
+
+// Ajoute au slot les parités du groupe terminé, regroupées en GSO quand
+// c'est possible (elles font toutes PACKET_SIZE octets). Elles sont copiées
+// dans le slot : le groupe suivant réutilise l'accumulateur.
+static void add_parity(struct udp_sender *tx, struct tx_slot *slot,
+                       const struct encoded_frame *ef, size_t total)
+{
+    struct fec_encoder *fec = &tx->fec;
+
+    while (tx->fec_next < fec->m)
+    {
+        unsigned j = tx->fec_next;
+        uint8_t *headers = slot->headers[slot->nb_packets];
+        uint8_t *body = slot->parity + slot->nb_parity * FEC_SYMBOL;
+        unsigned first = slot->nb_iov;
+
+        write_header(tx, ef, fec->first, total,
+                     PACKET_FLAG_PARITY | PACKET_FEC_INDEX(j), headers);
+        memcpy(body, fec->parity + j * FEC_SYMBOL, FEC_SYMBOL);
+
+        slot->iov[slot->nb_iov].iov_base = headers;
+        slot->iov[slot->nb_iov].iov_len = sizeof(struct packet_header);
+        slot->iov[slot->nb_iov + 1].iov_base = body;
+        slot->iov[slot->nb_iov + 1].iov_len = FEC_SYMBOL;
+        slot->nb_iov += 2;
+        slot->nb_packets++;
+        slot->nb_parity++;
+
+        if (!slot_fits(tx, slot, first))
+        {
+            slot->nb_iov = first;
+            slot->nb_packets--;
+            slot->nb_parity--;
+            break;
+        }
+        tx->fec_next++;
+
+        if (!slot_can_grow(tx, slot, PACKET_PAYLOAD))
+        {
+            break;
+        }
+    }
+
+    // Toutes les parités sont parties : le groupe suivant commence
+    if (tx->fec_next == fec->m)
+    {
+        tx->fec_ready = 0;
+        fec_begin(fec, fec->first + fec->count);
+    }
+}
+
+static void prep_slot(struct udp_sender *tx, struct io_uring_sqe *sqe,
+                      struct tx_slot *slot)
+{
+    slot->zerocopy = tx->mode == SEND_ZEROCOPY;
+    if (slot->zerocopy)
+    {
+        io_uring_prep_sendmsg_zc(sqe, tx->sock, &slot->msgh, 0);
+    }
+    else
+    {
+        io_uring_prep_sendmsg(sqe, tx->sock, &slot->msgh, 0);
+    }
+    prep_socket(tx, sqe);
+    slot->pending++;
+    tx->sends++;
+
+    // On associe le slot à la SQE pour le recycler à la complétion
+    io_uring_sqe_set_data(sqe, slot);
+}
+
+// Résultat d'un envoi : res octets remis au noyau, ou -errno
+static void account_slot(struct udp_sender *tx, const struct tx_slot *slot, int res)
+{
+    if (res >= 0)
+    {
+        unsigned data = slot->nb_packets - slot->nb_parity;
+        tx->packets += data;
+        tx->parity_packets += slot->nb_parity;
+        tx->bytes += res - data * PACKET_HEADERS - slot->nb_parity * PACKET_SIZE;
+        return;
+    }
+
+    // Si le chemin réseau refuse la segmentation (pas de checksum
+    // matériel par exemple), les envois suivants se font paquet par
+    // paquet ; ceux de cet envoi sont perdus
+    if (slot->nb_packets > 1 && (res == -EIO || res == -EINVAL) && tx->gso)
+    {
+        int size = 0;
+        setsockopt(tx->sock, SOL_UDP, UDP_SEGMENT, &size, sizeof(size));
+        tx->gso = 0;
+        fprintf(stderr, "Envoi GSO refusé (%s), un paquet par envoi\n", strerror(-res));
+    }
+    tx->errors += slot->nb_packets;
+}
+
+// Traite une complétion. Retourne 1 si le slot peut être recyclé.
+static int complete_slot(struct udp_sender *tx, struct io_uring_cqe *cqe)
+{
+    struct tx_slot *slot = io_uring_cqe_get_data(cqe);
+
+    // En zero-copy, IORING_CQE_F_MORE annonce une notification qui arrivera
+    // quand le noyau aura fini de lire les pages (IORING_CQE_F_NOTIF)
+    if (!(cqe->flags & IORING_CQE_F_NOTIF))
+    {
+        if (cqe->flags & IORING_CQE_F_MORE)
+        {
+            slot->pending++;
+        }
+
+        if (slot->zerocopy && (cqe->res == -EOPNOTSUPP || cqe->res == -EINVAL))
+        {
+            // Le noyau refuse le zero-copy pour cette socket : on renvoie ce
+            // paquet et les suivants avec un sendmsg classique
+            struct io_uring_sqe *sqe = io_uring_get_sqe(&tx->ring);
+            tx->mode = SEND_IOVEC;
+            if (sqe)
+            {
+                tx->zc_fallbacks++;
+                prep_slot(tx, sqe, slot);
+            }
+            else
+            {
+                tx->errors += slot->nb_packets;
+            }
+        }
+        else
+        {
+            account_slot(tx, slot, cqe->res);
+        }
+    }
+
+    return --slot->pending == 0;
+}
+
+// Demande de retransmission du serveur : les plages sont mises en file
+static void handle_nack(struct udp_sender *tx, size_t len)
+{
+    struct nack_header nh;
+
+    if (len < sizeof(nh))
+    {
+        return;
+    }
+    memcpy(&nh, tx->feedback, sizeof(nh));
+
+    uint32_t nb_ranges = ntohl(nh.nb_ranges);
+    if (ntohl(nh.stream_id) != tx->stream_id ||
+        nb_ranges > NACK_MAX_RANGES ||
+        len < sizeof(nh) + nb_ranges * sizeof(struct nack_range))
+    {
+        return;
+    }
+
+    uint64_t now = wall_ns();
+    tx->retx.nacks++;
+    for (uint32_t i = 0; i < nb_ranges; i++)
+    {
+        struct nack_range r;
+        memcpy(&r, tx->feedback + sizeof(nh) + i * sizeof(r), sizeof(r));
+        retx_request(&tx->retx, ntohl(nh.image_id), ntohl(r.seq), ntohl(r.count), now);
+    }
+}
+
+// Bilan d'une image : comparé à la durée de son envoi, il règle le débit
+static void handle_report(struct udp_sender *tx, size_t len)
+{
+    struct report_packet rp;
+
+    if (len < sizeof(rp))
+    {
+        return;
+    }
+    memcpy(&rp, tx->feedback, sizeof(rp));
+
+    if (ntohl(rp.stream_id) != tx->stream_id)
+    {
+        return;
+    }
+    pacer_report(&tx->pacer, ntohl(rp.image_id), ntohl(rp.received), ntohl(rp.parity),
+                 ntohl(rp.span_us) * 1000ull);
+}
+
+// Message du serveur : on vérifie qu'il vient bien de lui avant de le lire
+static void handle_feedback(struct udp_sender *tx, size_t len)
+{
+    uint32_t magic;
+
+    if (len < sizeof(magic) ||
+        tx->fb_from.sin_addr.s_addr != tx->dest.sin_addr.s_addr ||
+        tx->fb_from.sin_port != tx->dest.sin_port)
+    {
+        return;
+    }
+    memcpy(&magic, tx->feedback, sizeof(magic));
+
+    if (ntohl(magic) == NACK_MAGIC)
+    {
+        handle_nack(tx, len);
+    }
+    else if (ntohl(magic) == REPORT_MAGIC)
+    {
+        handle_report(tx, len);
+    }
+}
+
+// Traite une complétion : un envoi terminé ou un NACK reçu
+static void complete_cqe(struct udp_sender *tx, struct io_uring_cqe *cqe)
+{
+    if (io_uring_cqe_get_data(cqe) == &tx->fb_msgh)
+    {
+        tx->fb_armed = 0;
+        if (cqe->res > 0)
+        {
+            handle_feedback(tx, cqe->res);
+        }
+        arm_feedback(tx);
+        return;
+    }
+
+    if (complete_slot(tx, cqe))
+    {
+        tx->free_slots[tx->nb_free++] = io_uring_cqe_get_data(cqe);
+    }
+}
+
+// Traite les complétions arrivées, lues par lots dans la ring. Retourne
+// leur nombre.
+static unsigned reap_completions(struct udp_sender *tx)
+{
+    struct io_uring_cqe *cqes[SENDER_CQE_BATCH];
+    unsigned total = 0, n;
+
+    while ((n = io_uring_peek_batch_cqe(&tx->ring, cqes, SENDER_CQE_BATCH)) > 0)
+    {
+        for (unsigned i = 0; i < n; i++)
+        {
+            complete_cqe(tx, cqes[i]);
+        }
+        io_uring_cq_advance(&tx->ring, n);
+        total += n;
+    }
+    return total;
+}
+
+// Mode SEND_MMSG : lit les messages du serveur arrivés sur la socket.
+// Retourne leur nombre.
+static unsigned read_feedback(struct udp_sender *tx)
+{
+    unsigned n = 0;
+
+    for (;;)
+    {
+        socklen_t len = sizeof(tx->fb_from);
+        ssize_t r = recvfrom(tx->sock, tx->feedback, sizeof(tx->feedback), MSG_DONTWAIT,
+                             (struct sockaddr *)&tx->fb_from, &len);
+        if (r < 0)
+        {
+            return n;
+        }
+        handle_feedback(tx, r);
+        n++;
+    }
+}
+
+// Mode SEND_MMSG : attend au plus timeout_ms un message du serveur
+static unsigned wait_feedback(struct udp_sender *tx, int timeout_ms)
+{
+    struct pollfd pfd = { .fd = tx->sock, .events = POLLIN };
+
+    poll(&pfd, 1, timeout_ms);
+    return read_feedback(tx);
+}
+
+// Mode SEND_MMSG : l'envoi attend le prochain sendmmsg
+static void queue_mmsg(struct udp_sender *tx, struct tx_slot *slot)
+{
+    tx->mmsg[tx->nb_mmsg].msg_hdr = slot->msgh;
+    tx->mmsg_slots[tx->nb_mmsg++] = slot;
+    tx->sends++;
+}
+
+// Mode SEND_MMSG : remet au noyau les envois préparés, un appel système par
+// lot. Les données sont copiées au retour, les slots aussitôt libres.
+// Retourne le nombre d'envois.
+static unsigned flush_mmsg(struct udp_sender *tx)
+{
+    unsigned done = 0;
+
+    while (done < tx->nb_mmsg)
+    {
+        int n = sendmmsg(tx->sock, tx->mmsg + done, tx->nb_mmsg - done, 0);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0)
+        {
+            // Le premier envoi du lot est en échec : on passe au suivant
+            account_slot(tx, tx->mmsg_slots[done], -errno);
+            n = 1;
+        }
+        else
+        {
+            for (int i = 0; i < n; i++)
+            {
+                account_slot(tx, tx->mmsg_slots[done + i], tx->mmsg[done + i].msg_len);
+            }
+        }
+        done += n;
+    }
+
+    for (unsigned i = 0; i < tx->nb_mmsg; i++)
+    {
+        tx->free_slots[tx->nb_free++] = tx->mmsg_slots[i];
+    }
+    tx->nb_mmsg = 0;
+    return done;
+}
+
+// Attente imposée par l'étalement avant l'envoi suivant (les envois
+// préparés partent d'abord). Retourne le nombre de complétions ou de
+// messages du serveur arrivés entre-temps.
+static unsigned pacing_wait(struct udp_sender *tx, uint64_t now, uint64_t wait)
+{
+    uint64_t wait0 = wall_ns();
+
+    // Les timers du noyau sont trop imprécis pour les attentes courtes
+    if (wait < PACER_SPIN_NS)
+    {
+        if (tx->mode != SEND_MMSG)
+        {
+            io_uring_submit(&tx->ring);
+        }
+        while (wall_ns() < now + wait)
+        {
+        }
+    }
+    else if (tx->mode == SEND_MMSG)
+    {
+        struct timespec ts = {
+            .tv_sec = wait / 1000000000ull,
+            .tv_nsec = wait % 1000000000ull
+        };
+        nanosleep(&ts, NULL);
+    }
+    else
+    {
+        // Soumission et attente en un seul appel système
+        struct __kernel_timespec ts = {
+            .tv_sec = wait / 1000000000ull,
+            .tv_nsec = wait % 1000000000ull
+        };
+        struct io_uring_cqe *cqe;
+        io_uring_submit_and_wait_timeout(&tx->ring, &cqe, 1, &ts, NULL);
+    }
+    tx->pacer.waits++;
+    tx->pacer.wait_ns += wall_ns() - wait0;
+
+    return tx->mode == SEND_MMSG ? read_feedback(tx) : reap_completions(tx);
+}
+
+// Envoie les paquets redemandés puis ceux de l'image en cours (tx->cur, qui
+// peut être NULL : retransmissions seules) jusqu'au paquet limit. Tant que
+// limit n'est pas le dernier paquet, on rend la main dès que les paquets
+// disponibles sont partis ou que l'étalement fait attendre.
+static void send_packets(struct udp_sender *tx, uint32_t limit)
+{
+    struct retx_frame *cur = tx->cur;
 
     // Nombre total de paquets à envoyer
-    size_t total = (sd->length + payload_size - 1) / payload_size;
+    uint32_t total = cur ? retx_total(cur) : 0;
 
     // La sequence de l'image
-    size_t seq = 0;
+    uint32_t seq = tx->cur_seq;
 
-    // Nombre de paquets en cours d'envoi
-    int inflight = 0;
+    // Tuile en cours d'envoi et position dans cette tuile
+    uint32_t tile = tx->cur_tile;
+    size_t tile_offset = tx->cur_offset;
 
-    // Envoi des paquets jusqu'à ce que tous soient traités
-    while (seq < total)
+    // Envoi des paquets jusqu'à ce que tous soient traités et que le noyau
+    // ait rendu tous les slots (les pixels de l'image ne sont alors plus
+    // référencés)
+    for (;;)
     {
-        // Tant qu'il y a moins de 32 paquets en cours d'envoi et
-        // qu'il reste des paquets à envoyer
-        while (inflight < 32 && seq < total)
+        uint64_t now = wall_ns();
+
+        // Attente imposée par l'étalement avant l'envoi suivant
+        uint64_t wait = 0;
+
+        // Tant qu'il reste des slots libres et des paquets à envoyer
+        while (tx->nb_free > 0 &&
+               (tx->mode == SEND_MMSG || io_uring_sq_space_left(&tx->ring) > 0))
         {
-            // On traite un nouveau paquet en récupérant un SQE de io_uring
-            struct io_uring_sqe *sqe = io_uring_get_sqe(ring);
+            wait = pacer_delay(&tx->pacer, now);
+            if (wait)
+            {
+                break;
+            }
+
+            // Les paquets redemandés passent avant les nouveaux. Ils sont
+            // envoyés un par un : ils ne sont en général pas consécutifs.
+            // Viennent ensuite les parités d'un groupe terminé.
+            struct retx_frame *rf;
+            uint32_t rseq;
+            int resend = retx_next(&tx->retx, now, &rf, &rseq);
 
-            // Si on n'a plus de SQE, on sort de la boucle
-            if (!sqe)
+            if (!resend && !tx->fec_ready && seq == limit)
             {
                 break;
             }
 
-            // On prépare le header du paquet
-            struct packet_header header = {
-                .image_id = htonl(0),
-                .seq = htonl(seq),
-                .total_packets = htonl(total),
-                .width = htonl(sd->width),
-                .height = htonl(sd->height)
+            struct tx_slot *slot = tx->free_slots[--tx->nb_free];
+            slot->nb_iov = 0;
+            slot->nb_packets = 0;
+            slot->nb_frags = 0;
+            slot->nb_parity = 0;
+
+            if (resend)
+            {
+                uint32_t rtile;
+                size_t roffset;
+                retx_locate(rf, rseq, &rtile, &roffset);
+
+                const struct tile_ref *t = &rf->enc.tiles[rtile];
+                size_t size = PACKET_PAYLOAD;
+                if (roffset + size > tile_bytes(t))
+                {
+                    size = tile_bytes(t) - roffset;
+                }
+                add_packet(tx, slot, &rf->enc, t, rseq, retx_total(rf), roffset,
+                           size, PACKET_FLAG_RETRANSMIT);
+            }
+            else if (tx->fec_ready)
+            {
+                add_parity(tx, slot, &cur->enc, total);
+            }
+            else
+            {
+                const struct encoded_frame *ef = &cur->enc;
+
+                // On regroupe les paquets consécutifs tant que le GSO le permet
+                for (;;)
+                {
+                    const struct tile_ref *t = &ef->tiles[tile];
+
+                    // On calcule la taille des données de ce paquet
+                    // Si on dépasse la fin de la tuile, on réduit la taille
+                    size_t size = PACKET_PAYLOAD;
+                    if (tile_offset + size > tile_bytes(t))
+                    {
+                        size = tile_bytes(t) - tile_offset;
+                    }
+
+                    // Trop de fragments : le paquet ira dans l'envoi suivant
+                    unsigned first = slot->nb_iov;
+                    add_packet(tx, slot, ef, t, seq, total, tile_offset, size, 0);
+                    if (!slot_fits(tx, slot, first))
+                    {
+                        slot->nb_iov = first;
+                        slot->nb_packets--;
+                        break;
+                    }
+
+                    if (tx->fec.k)
+                    {
+                        fec_add(&tx->fec, slot->headers[slot->nb_packets - 1] +
+                                sizeof(struct packet_header), t, tile_offset, size);
+                    }
+
+                    // On passe à la tuile suivante quand celle-ci est terminée
+                    tile_offset += size;
+                    if (tile_offset == tile_bytes(t))
+                    {
+                        tile++;
+                        tile_offset = 0;
+                    }
+                    seq++;
+
+                    // Groupe terminé : ses parités partent avant la suite
+                    if (tx->fec.k && (tx->fec.count == tx->fec.k || seq == total))
+                    {
+                        tx->fec_ready = 1;
+                        tx->fec_next = 0;
+                        break;
+                    }
+
+                    if (seq == limit || !slot_can_grow(tx, slot, size))
+                    {
+                        break;
+                    }
+                }
+            }
+
+            // Structure de l'envoi UDP à passer à io_uring
+            slot->msgh = (struct msghdr) {
+                .msg_name = (void*)&tx->dest,
+                .msg_namelen = sizeof(tx->dest),
+                .msg_iov = slot->iov,
+                .msg_iovlen = slot->nb_iov
             };
 
-            char *packet = malloc(PACKET_SIZE);
+            // Place de l'envoi dans le calendrier ; avec SO_TXTIME, le
+            // noyau le retient jusqu'à son heure de départ
+            uint64_t departure = pacer_consume(&tx->pacer, now,
+                                               (size_t)slot->nb_packets * PACKET_SIZE);
+            if (pacer_enabled(&tx->pacer) && tx->pacer.mode == PACING_TXTIME)
+            {
+                slot->msgh.msg_control = slot->control;
+                slot->msgh.msg_controllen = sizeof(slot->control);
 
-            if (!packet)
+                struct cmsghdr *cmsg = CMSG_FIRSTHDR(&slot->msgh);
+                cmsg->cmsg_level = SOL_SOCKET;
+                cmsg->cmsg_type = SCM_TXTIME;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(departure));
+                memcpy(CMSG_DATA(cmsg), &departure, sizeof(departure));
+            }
+            if (tx->mode == SEND_MMSG)
             {
-                continue;
+                queue_mmsg(tx, slot);
+            }
+            else
+            {
+                prep_slot(tx, io_uring_get_sqe(&tx->ring), slot);
             }
+        }
 
-            // On copie le header dans le paquet
-            memcpy(packet, &header, header_size);
+        if (!tx->fb_armed)
+        {
+            arm_feedback(tx);
+        }
 
-            // Calcul la position de la sequence dans l'image
-            size_t offset = (size_t)seq * payload_size;
+        // sendmmsg termine les envois préparés tout de suite. Avec
+        // io_uring, leur soumission se fait avec l'attente qui suit.
+        unsigned flushed = tx->mode == SEND_MMSG ? flush_mmsg(tx) : 0;
 
-            // On calcule la taille des données à copier dans ce paquet
-            // Si on dépasse la fin de l'image, on réduit la taille copiée
-            size_t copy_size = payload_size;
-            if (offset + copy_size > sd->length)
+        // Plus rien à envoyer ni en vol (la réception des NACK reste armée),
+        // ou envoi partiel : la suite de l'image n'est pas encore prête, les
+        // envois en vol se terminent pendant qu'on la prépare
+        if ((seq == total && !retx_pending(&tx->retx) && !tx->fec_ready &&
+             tx->nb_free == tx->depth) ||
+            (limit < total && ((seq == limit && !tx->fec_ready) || wait)))
+        {
+            if (tx->mode != SEND_MMSG)
             {
-                copy_size = sd->length - offset;
+                io_uring_submit(&tx->ring);
             }
-            
-            // On copie les donnees de la sequence de l'image dans le paquet
-            memcpy(packet + header_size, sd->data + offset, copy_size);
-            
-            // Contenu à envoyer par io_uring
-            struct iovec iov = {
-                .iov_base = packet,
-                .iov_len = header_size + copy_size
-            };
-            
-            // Structure du paquet UDP à envoyer par io_uring
-            struct msghdr msgh = {
-                .msg_name = (void*)dest,
-                .msg_namelen = sizeof(*dest),
-                .msg_iov = &iov,
-                .msg_iovlen = 1
-            };
+            break;
+        }
 
-            // On prépare l'envoi du paquet UDP avec io_uring en l'associant
-            // au SQE
-            io_uring_prep_sendmsg(sqe, sock, &msgh, 0);
+        unsigned in_flight = tx->depth - tx->nb_free;
+        metrics_hist_add(&tx->in_flight, in_flight);
 
-            // On associe notre packet à la SQE pour le free plus tard 
-            io_uring_sqe_set_data(sqe, packet);
+        // Les complétions arrivées pendant l'attente sont traitées dans la
+        // foulée, avant de remplir les slots libérés. Si l'étalement retient
+        // l'envoi suivant, l'attente s'arrête à son heure de départ.
+        unsigned batch;
+        if (wait)
+        {
+            batch = pacing_wait(tx, now, wait);
+        }
+        else if (tx->mode == SEND_MMSG)
+        {
+            // Rien n'est parti : seules des retransmissions pas encore dues
+            // restent, on attend un message du serveur
+            batch = flushed ? read_feedback(tx) : wait_feedback(tx, 1);
+        }
+        else
+        {
+            // Soumission et attente en un seul appel système. Avec beaucoup
+            // d'envois en vol, le réveil n'a lieu qu'une fois un quart
+            // d'entre eux terminés : les slots libérés sont remplis par lots.
+            unsigned wait_nr = in_flight / 4 ? in_flight / 4 : 1;
+            int ret = io_uring_submit_and_wait(&tx->ring, wait_nr);
+            if (ret < 0 && ret != -EINTR)
+            {
+                break;
+            }
+            batch = reap_completions(tx);
+        }
+        metrics_hist_add(&tx->cqe_batch, batch);
+    }
+
+    tx->cur_seq = seq;
+    tx->cur_tile = tile;
+    tx->cur_offset = tile_offset;
 
-            inflight++;
-            seq++;
+    // Durée de l'envoi, que l'étalement adaptatif compare à celle de la
+    // réception
+    if (cur && seq == total)
+    {
+        pacer_frame_done(&tx->pacer, wall_ns() - cur->sent_ns);
+    }
+}
+
+// Traite les complétions déjà arrivées (NACK reçus entre deux images)
+static void reap_feedback(struct udp_sender *tx)
+{
+    if (tx->mode == SEND_MMSG)
+    {
+        read_feedback(tx);
+    }
+    else
+    {
+        reap_completions(tx);
+    }
+}
+
+int sender_begin_image(struct udp_sender *tx, struct encoded_frame *ef, uint8_t *pixels)
+{
+    uint64_t wall0 = wall_ns(), cpu0 = thread_cpu_ns();
+
+    reap_feedback(tx);
+
+    // L'image est gardée pour les retransmissions ; la plus ancienne du
+    // buffer est libérée (aucun envoi n'est en vol entre deux images)
+    tx->cur = retx_store(&tx->retx, ef, pixels, wall0);
+    tx->cur_seq = 0;
+    tx->cur_tile = 0;
+    tx->cur_offset = 0;
+    if (tx->cur)
+    {
+        pacer_frame_start(&tx->pacer, tx->cur->enc.image_id, retx_total(tx->cur));
+        if (tx->fec.k)
+        {
+            fec_begin(&tx->fec, 0);
         }
+    }
 
-        // Des qu'on a 32 paquets en cours ou qu'on a traité tous les paquets
-        // On les envoie dans io_uring
-        io_uring_submit(ring);
+    tx->wall_ns += wall_ns() - wall0;
+    tx->cpu_ns += thread_cpu_ns() - cpu0;
+    return tx->cur ? 0 : -1;
+}
 
-        // On attend une reponse de nos SQE de la part de io_uring sous forme
-        // de CQE (Completion Queue Entry)
-        struct io_uring_cqe *cqe;
-        io_uring_wait_cqe(ring, &cqe);
+void sender_send_tiles(struct udp_sender *tx, uint32_t ready_tiles)
+{
+    if (!tx->cur)
+    {
+        return;
+    }
+    uint64_t wall0 = wall_ns(), cpu0 = thread_cpu_ns();
+
+    if (ready_tiles < tx->cur->enc.nb_tiles)
+    {
+        send_packets(tx, tx->cur->first_seq[ready_tiles]);
+    }
+    else
+    {
+        send_packets(tx, retx_total(tx->cur));
+    }
 
-        // Une fois qu'on a une reponse de io_uring, on free notre packet
-        free(io_uring_cqe_get_data(cqe));
+    tx->wall_ns += wall_ns() - wall0;
+    tx->cpu_ns += thread_cpu_ns() - cpu0;
+}
+
+void sender_finish_image(struct udp_sender *tx)
+{
+    if (tx->cur)
+    {
+        sender_send_tiles(tx, tx->cur->enc.nb_tiles);
+    }
+
+    // Plus d'image en cours : seules des retransmissions peuvent partir
+    tx->cur = NULL;
+    tx->cur_seq = 0;
+}
+
+void send_image_data(struct udp_sender *tx, struct encoded_frame *ef,
+                     uint8_t *pixels)
+{
+    sender_begin_image(tx, ef, pixels);
+    sender_finish_image(tx);
+}
+
+void sender_linger(struct udp_sender *tx, unsigned ms)
+{
+    uint64_t deadline = wall_ns() + ms * 1000000ull;
+
+    for (;;)
+    {
+        uint64_t now = wall_ns();
+        if (now >= deadline)
+        {
+            break;
+        }
 
-        // On marque la CQE comme traitée
-        io_uring_cqe_seen(ring, cqe);
+        if (tx->mode == SEND_MMSG)
+        {
+            wait_feedback(tx, (deadline - now + 999999) / 1000000);
+        }
+        else
+        {
+            struct __kernel_timespec ts = {
+                .tv_sec = (deadline - now) / 1000000000ull,
+                .tv_nsec = (deadline - now) % 1000000000ull
+            };
+            struct io_uring_cqe *cqe;
+            if (io_uring_wait_cqe_timeout(&tx->ring, &cqe, &ts) < 0)
+            {
+                continue;
+            }
+            reap_completions(tx);
+        }
 
-        // On a un paquet de moins en cours d'envoi
-        inflight--;
+        if (retx_pending(&tx->retx))
+        {
+            tx->cur = NULL;
+            send_packets(tx, 0);
+        }
     }
 }
@@ -0,0 +1,323 @@
+#include "options.h"
+#include "delta.h"
+#include "compress.h"
+#include "fec.h"
+#include "pixel_format.h"
+#include "parallel.h"
+#include "pipeline.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <getopt.h>
+#include <string.h>
+#include <errno.h>
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [-a adresse[:port]] [-s] [-n images] [-q profondeur]\n"
+            "          [-i secondes] [-S source] [-k intervalle] [-O] [-j threads] [-z mode]\n"
+            "          [-Q envois] [-U] [-G] [-I flux] [-F k:m]\n"
+            "          [-r débit] [-P étalement] [-f format] [-c compression]\n"
+            "          [-m] [-M chemin]\n"
+            "  -a adresse     serveur destinataire, adresse IPv4 et port éventuel\n"
+            "                 (défaut %s:%d)\n"
+            "  -s             mode flux continu (capture -> conversion -> envoi)\n"
+            "  -n images      nombre d'images à envoyer en flux (0 = infini)\n"
+            "  -q profondeur  taille des files entre les étages (défaut 2, au plus %d)\n"
+            "  -i secondes    période d'affichage des statistiques (défaut 1)\n"
+            "  -S source      portal (défaut), files:CHEMIN ou synth:MOTIF:LxH\n"
+            "                 MOTIF parmi static, scroll, noise, partial\n"
+            "  -k intervalle  une image clé complète toutes les N images (défaut %d,\n"
+            "                 0 = seulement la première)\n"
+            "  -O             tuiles dans un ordre entrelacé (bit-reversal) : une\n"
+            "                 image coupée par des pertes reste utilisable, le\n"
+            "                 serveur comble les trous par interpolation\n"
+            "  -j threads     threads de conversion et de compression des pixels\n"
+            "                 (défaut 0 = un par coeur, au plus %d)\n"
+            "  -z mode        envoi des paquets : copy, iovec, zc (défaut, zero-copy) ou\n"
+            "                 mmsg (sendmmsg par lots, sans io_uring)\n"
+            "  -Q envois      envois en vol au plus (défaut %d, au plus %d)\n"
+            "  -U             io_uring avec SQPOLL : un thread du noyau lit les\n"
+            "                 soumissions, sans appel système\n"
+            "  -G             un paquet par envoi (désactive la segmentation GSO)\n"
+            "  -I flux        identifiant du flux, distinct pour chaque écran envoyé\n"
+            "                 au même serveur (défaut 0)\n"
+            "  -F k:m         m paquets de parité après chaque groupe de k paquets :\n"
+            "                 jusqu'à m pertes par groupe réparées sans aller-retour\n"
+            "                 (k <= %d, m <= %d, défaut : pas de correction)\n"
+            "  -r débit       étale les envois à ce débit en Mbit/s (défaut 0 = au plus\n"
+            "                 vite) ; auto[:max] l'ajuste d'après les pertes et les\n"
+            "                 délais vus par le récepteur\n"
+            "  -P étalement   user (défaut, attente dans le client), fq\n"
+            "                 (SO_MAX_PACING_RATE) ou txtime (SO_TXTIME) ; les deux\n"
+            "                 derniers demandent le qdisc fq sur l'interface de sortie\n"
+            "  -f format      pixels envoyés : bgrx (défaut, 4 octets), bgr24 (3),\n"
+            "                 rgb565 (2) ou yuv420 (1,5 : couleur par blocs de 2x2)\n"
+            "  -c compression none (défaut), lz4[:accélération] (défaut %d) ou\n"
+            "                 zstd[:niveau] (défaut %d) : chaque tuile est compressée\n"
+            "                 seule, un paquet perdu n'abîme que la sienne\n"
+            "  -m             ajoute à chaque relevé une ligne « metrics clé=valeur ... »\n"
+            "                 destinée aux programmes (format stable)\n"
+            "  -M chemin      en flux, donne ces compteurs à chaque connexion sur la\n"
+            "                 socket Unix chemin\n",
+            prog, SERVER_ADDR, SERVER_PORT, PIPELINE_MAX_DEPTH, KEYFRAME_INTERVAL,
+            PARALLEL_MAX_THREADS, SENDER_QUEUE_DEPTH, SENDER_MAX_DEPTH, FEC_MAX_K, FEC_MAX_M, LZ4_DEFAULT_LEVEL,
+            ZSTD_DEFAULT_LEVEL);
+}
+
+// Débit en Mbit/s vers des octets/s, -1 si invalide
+static int parse_rate(const char *arg, uint64_t *rate)
+{
+    char *end;
+    double mbits = strtod(arg, &end);
+
+    if (end == arg || *end || mbits < 0)
+    {
+        return -1;
+    }
+    *rate = mbits * 1e6 / 8;
+    return 0;
+}
+
+// Entier décimal entre min et max, -1 si invalide (signe, texte après le
+// nombre, dépassement)
+static int parse_count(const char *arg, unsigned long min, unsigned long max,
+                       unsigned long *value)
+{
+    char *end;
+    errno = 0;
+    unsigned long v = strtoul(arg, &end, 10);
+
+    if (*arg < '0' || *arg > '9' || *end || errno == ERANGE || v < min || v > max)
+    {
+        return -1;
+    }
+    *value = v;
+    return 0;
+}
+
+// Remplit opts à partir de argv, retourne -1 si un argument est invalide
+int parse_options(int argc, char **argv, struct client_options *opts)
+{
+    // Valeurs par défaut : une seule capture comme avant
+    opts->stream         = 0;
+    parse_address(SERVER_ADDR, &opts->server);
+    opts->max_frames     = 0;
+    opts->queue_depth    = 2;
+    opts->stats_interval = 1;
+    opts->source         = "portal";
+    opts->keyframe_interval = KEYFRAME_INTERVAL;
+    opts->interleave     = 0;
+    opts->convert_threads = 0;
+    opts->pixel_format   = PIXEL_FORMAT_BGRX;
+    opts->codec          = CODEC_NONE;
+    opts->codec_level    = 0;
+    opts->send_mode      = SEND_ZEROCOPY;
+    opts->send_depth     = SENDER_QUEUE_DEPTH;
+    opts->sqpoll         = 0;
+    opts->gso            = 1;
+    opts->stream_id      = 0;
+    opts->fec_k          = 0;
+    opts->fec_m          = 0;
+    opts->pacing         = PACING_USER;
+    opts->pacing_rate    = 0;
+    opts->pacing_adaptive = 0;
+    opts->pacing_max     = 0;
+    opts->metrics        = 0;
+    opts->metrics_socket = NULL;
+
+    int opt;
+    unsigned long value;
+    while ((opt = getopt(argc, argv, "a:sn:q:i:S:k:Oj:z:Q:UGI:F:r:P:f:c:mM:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'a':
+            if (parse_address(optarg, &opts->server) < 0)
+            {
+                fprintf(stderr, "Adresse du serveur invalide : %s\n", optarg);
+                usage(argv[0]);
+                return -1;
+            }
+            break;
+        case 's':
+            opts->stream = 1;
+            break;
+        case 'n':
+            if (parse_count(optarg, 0, ULONG_MAX, &opts->max_frames) < 0)
+            {
+                fprintf(stderr, "Nombre d'images invalide : %s\n", optarg);
+                usage(argv[0]);
+                return -1;
+            }
+            break;
+        case 'q':
+            if (parse_count(optarg, 1, PIPELINE_MAX_DEPTH, &value) < 0)
+            {
+                fprintf(stderr, "Profondeur des files invalide : %s\n", optarg);
+                usage(argv[0]);
+                return -1;
+            }
+            opts->queue_depth = value;
+            break;
+        case 'i':
+            if (parse_count(optarg, 1, UINT_MAX, &value) < 0)
+            {
+                fprintf(stderr, "Période des statistiques invalide : %s\n", optarg);
+                usage(argv[0]);
+                return -1;
+            }
+            opts->stats_interval = value;
+            break;
+        case 'S':
+            opts->source = optarg;
+            break;
+        case 'k':
+            if (parse_count(optarg, 0, UINT_MAX, &value) < 0)
+            {
+                fprintf(stderr, "Intervalle des images clés invalide : %s\n", optarg);
+                usage(argv[0]);
+                return -1;
+            }
+            opts->keyframe_interval = value;
+            break;
+        case 'O':
+            opts->interleave = 1;
+            break;
+        case 'j':
+            if (parse_count(optarg, 0, PARALLEL_MAX_THREADS, &value) < 0)
+            {
+                fprintf(stderr, "Nombre de threads invalide : %s\n", optarg);
+                usage(argv[0]);
+                return -1;
+            }
+            opts->convert_threads = value;
+            break;
+        case 'z':
+            if (strcmp(optarg, "copy") == 0)
+            {
+                opts->send_mode = SEND_COPY;
+            }
+            else if (strcmp(optarg, "iovec") == 0)
+            {
+                opts->send_mode = SEND_IOVEC;
+            }
+            else if (strcmp(optarg, "zc") == 0)
+            {
+                opts->send_mode = SEND_ZEROCOPY;
+            }
+            else if (strcmp(optarg, "mmsg") == 0)
+            {
+                opts->send_mode = SEND_MMSG;
+            }
+            else
+            {
+                fprintf(stderr, "Mode d'envoi inconnu : %s\n", optarg);
+                usage(argv[0]);
+                return -1;
+            }
+            break;
+        case 'Q':
+            if (parse_count(optarg, 1, SENDER_MAX_DEPTH, &value) < 0)
+            {
+                fprintf(stderr, "Nombre d'envois en vol invalide : %s\n", optarg);
+                usage(argv[0]);
+                return -1;
+            }
+            opts->send_depth = value;
+            break;
+        case 'U':
+            opts->sqpoll = 1;
+            break;
+        case 'G':
+            opts->gso = 0;
+            break;
+        case 'I':
+            if (parse_count(optarg, 0, UINT32_MAX, &value) < 0)
+            {
+                fprintf(stderr, "Identifiant de flux invalide : %s\n", optarg);
+                usage(argv[0]);
+                return -1;
+            }
+            opts->stream_id = value;
+            break;
+        case 'F':
+            if (sscanf(optarg, "%u:%u", &opts->fec_k, &opts->fec_m) != 2 ||
+                opts->fec_k == 0 || opts->fec_k > FEC_MAX_K ||
+                opts->fec_m == 0 || opts->fec_m > FEC_MAX_M)
+            {
+                fprintf(stderr, "Correction d'erreurs invalide : %s\n", optarg);
+                usage(argv[0]);
+                return -1;
+            }
+            break;
+        case 'r':
+            if (strncmp(optarg, "auto", 4) == 0 &&
+                (optarg[4] == '\0' ||
+                 (optarg[4] == ':' && parse_rate(optarg + 5, &opts->pacing_max) == 0)))
+            {
+                opts->pacing_adaptive = 1;
+            }
+            else if (parse_rate(optarg, &opts->pacing_rate) < 0)
+            {
+                fprintf(stderr, "Débit invalide : %s\n", optarg);
+                usage(argv[0]);
+                return -1;
+            }
+            break;
+        case 'P':
+            if (strcmp(optarg, "user") == 0)
+            {
+                opts->pacing = PACING_USER;
+            }
+            else if (strcmp(optarg, "fq") == 0)
+            {
+                opts->pacing = PACING_FQ;
+            }
+            else if (strcmp(optarg, "txtime") == 0)
+            {
+                opts->pacing = PACING_TXTIME;
+            }
+            else
+            {
+                fprintf(stderr, "Étalement inconnu : %s\n", optarg);
+                usage(argv[0]);
+                return -1;
+            }
+            break;
+        case 'f':
+        {
+            int format = pixel_format_parse(optarg);
+            if (format < 0)
+            {
+                fprintf(stderr, "Format de pixels inconnu : %s\n", optarg);
+                usage(argv[0]);
+                return -1;
+            }
+            opts->pixel_format = format;
+            break;
+        }
+        case 'c':
+            if (codec_parse(optarg, &opts->codec, &opts->codec_level) < 0)
+            {
+                fprintf(stderr, "Compression invalide : %s\n", optarg);
+                usage(argv[0]);
+                return -1;
+            }
+            break;
+        case 'm':
+            opts->metrics = 1;
+            break;
+        case 'M':
+            opts->metrics_socket = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return -1;
+        }
+    }
+
+    return 0;
+}
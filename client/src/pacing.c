@@ -0,0 +1,256 @@
+#include "pacing.h"
+#include "network.h"
+#include <sys/socket.h>
+#include <linux/net_tstamp.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef SO_MAX_PACING_RATE
+#define SO_MAX_PACING_RATE 47
+#endif
+#ifndef SO_TXTIME
+#define SO_TXTIME 61
+#endif
+
+// Plafond du mode adaptatif sans limite donnée (100 Gbit/s)
+#define PACER_MAX_RATE (100ull * 1000 * 1000 * 1000 / 8)
+
+// Le qdisc fq applique le débit de la socket à chacun de ses paquets
+static int set_kernel_rate(struct pacer *p)
+{
+    // Option sur 32 bits pour les anciens noyaux (~34 Gbit/s au plus)
+    uint32_t rate = p->rate < UINT32_MAX ? p->rate : UINT32_MAX - 1;
+
+    if (setsockopt(p->sock, SOL_SOCKET, SO_MAX_PACING_RATE, &rate, sizeof(rate)) < 0)
+    {
+        perror("setsockopt(SO_MAX_PACING_RATE)");
+        return -1;
+    }
+    return 0;
+}
+
+void pacer_init(struct pacer *p, int sock, enum pacing_mode mode, uint64_t rate,
+                int adaptive, uint64_t max_rate)
+{
+    memset(p, 0, sizeof(*p));
+    p->sock = sock;
+    p->mode = mode;
+    p->adaptive = adaptive;
+    p->max_rate = max_rate ? max_rate : PACER_MAX_RATE;
+    p->rate = rate;
+    if (adaptive && !p->rate)
+    {
+        p->rate = PACER_START_RATE < p->max_rate ? PACER_START_RATE : p->max_rate;
+    }
+    if (!p->rate)
+    {
+        return;
+    }
+
+    // Le noyau ne dit pas si un qdisc fq (ou etf) est en place : sans lui,
+    // ces options sont acceptées mais les paquets partent sans attendre
+    if (mode == PACING_FQ && set_kernel_rate(p) < 0)
+    {
+        p->mode = PACING_USER;
+    }
+    else if (mode == PACING_TXTIME)
+    {
+        struct sock_txtime cfg = { .clockid = CLOCK_MONOTONIC, .flags = 0 };
+        if (setsockopt(sock, SOL_SOCKET, SO_TXTIME, &cfg, sizeof(cfg)) < 0)
+        {
+            perror("setsockopt(SO_TXTIME)");
+            p->mode = PACING_USER;
+        }
+    }
+    if (p->mode != mode)
+    {
+        fprintf(stderr, "Étalement par le noyau indisponible, attente en espace utilisateur\n");
+    }
+}
+
+// Durée d'émission de bytes octets au débit visé
+static uint64_t send_time(const struct pacer *p, uint64_t bytes)
+{
+    return bytes * 1000000000ull / p->rate;
+}
+
+unsigned pacer_segments(const struct pacer *p, unsigned max)
+{
+    if (!p->rate)
+    {
+        return max;
+    }
+
+    // Un envoi GSO part d'un bloc, même quand fq espace les envois
+    uint64_t burst = p->rate * PACER_BURST_NS / 1000000000ull / PACKET_SIZE;
+    if (burst < 1)
+    {
+        return 1;
+    }
+    return burst < max ? burst : max;
+}
+
+uint64_t pacer_delay(const struct pacer *p, uint64_t now_ns)
+{
+    if (!p->rate)
+    {
+        return 0;
+    }
+
+    uint64_t slack = PACER_BURST_NS;
+    if (p->mode != PACING_USER)
+    {
+        slack = send_time(p, (uint64_t)PACER_HORIZON_SENDS *
+                          pacer_segments(p, GSO_MAX_SEGMENTS) * PACKET_SIZE);
+        if (slack > PACER_HORIZON_NS)
+        {
+            slack = PACER_HORIZON_NS;
+        }
+    }
+    return p->next_ns > now_ns + slack ? p->next_ns - slack - now_ns : 0;
+}
+
+uint64_t pacer_consume(struct pacer *p, uint64_t now_ns, size_t bytes)
+{
+    if (!p->rate)
+    {
+        return now_ns;
+    }
+
+    // Pas de crédit accumulé pendant une pause (entre deux images) : la
+    // reprise ne part pas en rafale
+    uint64_t start = p->next_ns > now_ns ? p->next_ns : now_ns;
+    p->next_ns = start + send_time(p, bytes);
+    return start;
+}
+
+// Ajuste le débit d'après le bilan d'une image (recv_ns = 0 : jamais vue).
+// Seules les images envoyées au débit actuel comptent : celles parties avant
+// un changement décrivent un débit qui n'est plus le bon (une seule baisse
+// par vague d'images, comme TCP).
+static void adapt_rate(struct pacer *p, const struct pacer_frame *f, uint32_t received,
+                       uint32_t parity, uint64_t recv_ns)
+{
+    uint32_t total = f->total;
+    uint64_t send_ns = f->send_ns;
+
+    if (!p->adaptive || f->rate != p->rate || total < PACER_MIN_REPORT || received > total)
+    {
+        return;
+    }
+    double loss = 1.0 - (double)received / total;
+    uint64_t rate = p->rate;
+
+    // L'image a mis plus de temps à arriver qu'à partir : un goulet la
+    // retient, son débit de sortie est celui que le chemin accepte. En
+    // dessous d'une milliseconde, l'horloge du récepteur est trop grossière.
+    // Un bilan arrivé avant la fin de l'envoi ne dit rien du goulet.
+    if (send_ns && recv_ns >= 1000000 && recv_ns > send_ns + send_ns / 8)
+    {
+        uint64_t delivered = (uint64_t)(received + parity) * PACKET_SIZE * 1000000000ull / recv_ns;
+        if (delivered < rate)
+        {
+            rate = delivered - delivered / 20;
+        }
+    }
+
+    // Pertes : baisse proportionnelle au-delà de 10 %, on tente plus haut
+    // en dessous de 2 % si le chemin ne freine pas déjà
+    if (loss > 0.10)
+    {
+        uint64_t cut = rate * (1.0 - loss / 2);
+        rate = cut < rate ? cut : rate;
+    }
+    else if (loss < 0.02 && rate == p->rate)
+    {
+        rate += rate / 20;
+    }
+
+    if (rate < PACER_MIN_RATE)
+    {
+        rate = PACER_MIN_RATE;
+    }
+    if (rate > p->max_rate)
+    {
+        rate = p->max_rate;
+    }
+    if (rate == p->rate)
+    {
+        return;
+    }
+
+    if (rate < p->rate)
+    {
+        p->decreases++;
+    }
+    else
+    {
+        p->increases++;
+    }
+    p->rate = rate;
+    if (p->mode == PACING_FQ)
+    {
+        set_kernel_rate(p);
+    }
+}
+
+void pacer_frame_start(struct pacer *p, uint32_t image_id, uint32_t total)
+{
+    struct pacer_frame *f = &p->history[p->history_next];
+    p->history_next = (p->history_next + 1) % PACER_HISTORY;
+
+    f->image_id = image_id;
+    f->total = total;
+    f->send_ns = 0;
+    f->rate = p->rate;
+    f->pending = 1;
+    p->sent += total;
+}
+
+void pacer_frame_done(struct pacer *p, uint64_t send_ns)
+{
+    p->history[(p->history_next + PACER_HISTORY - 1) % PACER_HISTORY].send_ns = send_ns;
+}
+
+void pacer_report(struct pacer *p, uint32_t image_id, uint32_t received,
+                  uint32_t parity, uint64_t recv_ns)
+{
+    struct pacer_frame *f = NULL;
+
+    for (unsigned i = 0; i < PACER_HISTORY; i++)
+    {
+        if (p->history[i].pending && p->history[i].image_id == image_id)
+        {
+            f = &p->history[i];
+            break;
+        }
+    }
+    if (!f)
+    {
+        return;
+    }
+
+    // Les bilans arrivent dans l'ordre des images : une image plus ancienne
+    // restée sans bilan n'a jamais été vue par le récepteur
+    for (unsigned i = 0; i < PACER_HISTORY; i++)
+    {
+        struct pacer_frame *old = &p->history[i];
+        if (old->pending && (int32_t)(old->image_id - image_id) < 0)
+        {
+            old->pending = 0;
+            p->lost_frames++;
+            adapt_rate(p, old, 0, 0, 0);
+        }
+    }
+
+    f->pending = 0;
+    p->reports++;
+    p->received += received;
+    if (recv_ns)
+    {
+        p->delivered_bytes += (uint64_t)(received + parity) * PACKET_SIZE;
+        p->delivered_ns += recv_ns;
+    }
+    adapt_rate(p, f, received, parity, recv_ns);
+}
@@ -0,0 +1,175 @@
+#include "parallel.h"
+#include <pthread.h>
+#include <unistd.h>
+
+// Un appel de parallel_for : ses tranches sont prises une à une par les
+// workers du pool et par le thread appelant
+struct parallel_job {
+    parallel_fn fn;
+    void *ctx;
+    unsigned count, threads;
+    unsigned next;             // Prochaine tranche à prendre
+    unsigned done;             // Tranches terminées
+    pthread_cond_t finished;
+    struct parallel_job *next_job;
+};
+
+// Pool de workers créés au premier appel et gardés jusqu'à la fin du
+// programme : plusieurs étages du pipeline (conversion, compression)
+// peuvent y déposer leurs tranches en même temps
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    struct parallel_job *head, *tail; // Appels qui ont encore des tranches libres
+    unsigned workers;
+} pool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .work = PTHREAD_COND_INITIALIZER
+};
+
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+
+// Retire job de la liste une fois toutes ses tranches prises (verrou tenu)
+static void unlink_job(struct parallel_job *job)
+{
+    struct parallel_job **p = &pool.head;
+    struct parallel_job *prev = NULL;
+
+    while (*p && *p != job)
+    {
+        prev = *p;
+        p = &(*p)->next_job;
+    }
+    if (!*p)
+    {
+        return;
+    }
+    *p = job->next_job;
+    if (pool.tail == job)
+    {
+        pool.tail = prev;
+    }
+}
+
+// Prend la tranche suivante de job et l'exécute hors du verrou (tenu à
+// l'entrée et à la sortie)
+static void run_next_slice(struct parallel_job *job)
+{
+    unsigned i = job->next++;
+    if (job->next == job->threads)
+    {
+        unlink_job(job);
+    }
+
+    pthread_mutex_unlock(&pool.lock);
+    job->fn(job->ctx,
+            (unsigned)((unsigned long long)job->count * i / job->threads),
+            (unsigned)((unsigned long long)job->count * (i + 1) / job->threads));
+    pthread_mutex_lock(&pool.lock);
+
+    if (++job->done == job->threads)
+    {
+        pthread_cond_signal(&job->finished);
+    }
+}
+
+static void *worker_thread(void *arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&pool.lock);
+    for (;;)
+    {
+        while (!pool.head)
+        {
+            pthread_cond_wait(&pool.work, &pool.lock);
+        }
+        run_next_slice(pool.head);
+    }
+    return NULL;
+}
+
+// Un worker par coeur en plus du thread appelant
+static void pool_start(void)
+{
+    unsigned n = cpu_count() - 1;
+    if (n > PARALLEL_MAX_THREADS - 1)
+    {
+        n = PARALLEL_MAX_THREADS - 1;
+    }
+
+    for (unsigned i = 0; i < n; i++)
+    {
+        pthread_t tid;
+        if (pthread_create(&tid, NULL, worker_thread, NULL) != 0)
+        {
+            break;
+        }
+        pthread_detach(tid);
+        pool.workers++;
+    }
+}
+
+void parallel_for(unsigned count, unsigned threads, parallel_fn fn, void *ctx)
+{
+    if (threads > PARALLEL_MAX_THREADS)
+    {
+        threads = PARALLEL_MAX_THREADS;
+    }
+    if (threads > count)
+    {
+        threads = count;
+    }
+    if (threads > 1)
+    {
+        pthread_once(&pool_once, pool_start);
+    }
+    if (threads <= 1 || !pool.workers)
+    {
+        // Pas de worker disponible : on traite tout nous-mêmes
+        if (count)
+        {
+            fn(ctx, 0, count);
+        }
+        return;
+    }
+
+    struct parallel_job job = {
+        .fn      = fn,
+        .ctx     = ctx,
+        .count   = count,
+        .threads = threads
+    };
+    pthread_cond_init(&job.finished, NULL);
+
+    pthread_mutex_lock(&pool.lock);
+    if (pool.tail)
+    {
+        pool.tail->next_job = &job;
+    }
+    else
+    {
+        pool.head = &job;
+    }
+    pool.tail = &job;
+    pthread_cond_broadcast(&pool.work);
+
+    // L'appelant prend lui aussi des tranches de son appel, puis attend
+    // celles que les workers n'ont pas encore finies
+    while (job.next < job.threads)
+    {
+        run_next_slice(&job);
+    }
+    while (job.done < job.threads)
+    {
+        pthread_cond_wait(&job.finished, &pool.lock);
+    }
+    pthread_mutex_unlock(&pool.lock);
+    pthread_cond_destroy(&job.finished);
+}
+
+unsigned cpu_count(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (unsigned)n : 1;
+}
@@ -0,0 +1,402 @@
+#include "pipeline.h"
+#include <stdlib.h>
+#include <string.h>
+
+void frame_free(struct frame *frame)
+{
+    if (!frame)
+    {
+        return;
+    }
+    encoded_frame_clear(&frame->enc);
+    g_free(frame->sd.data);
+    free(frame);
+}
+
+// Initialise une file bornée de capacity images
+static int queue_init(struct frame_queue *q, unsigned capacity,
+                      enum queue_policy policy)
+{
+    memset(q, 0, sizeof(*q));
+    q->slots = calloc(capacity, sizeof(*q->slots));
+    if (!q->slots)
+    {
+        perror("calloc");
+        return -1;
+    }
+    q->capacity = capacity;
+    q->policy   = policy;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->not_empty, NULL);
+    pthread_cond_init(&q->not_full, NULL);
+    return 0;
+}
+
+static void queue_destroy(struct frame_queue *q)
+{
+    if (!q->slots)
+    {
+        return;
+    }
+
+    // Libère les images restées dans la file
+    while (q->count)
+    {
+        frame_free(q->slots[q->head]);
+        q->head = (q->head + 1) % q->capacity;
+        q->count--;
+    }
+    free(q->slots);
+    q->slots = NULL;
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->not_empty);
+    pthread_cond_destroy(&q->not_full);
+}
+
+// Ajoute une image en fin de file. Si la file est pleine, on jette la plus
+// ancienne (QUEUE_DROP_OLDEST) ou on attend qu'une place se libère.
+static void queue_push(struct frame_queue *q, struct frame *frame)
+{
+    struct frame *stale = NULL;
+
+    pthread_mutex_lock(&q->lock);
+
+    if (q->count == q->capacity)
+    {
+        if (q->policy == QUEUE_DROP_OLDEST)
+        {
+            // L'image la plus ancienne est périmée : on la remplace
+            stale = q->slots[q->head];
+            q->head = (q->head + 1) % q->capacity;
+            q->count--;
+            q->dropped++;
+        }
+        else
+        {
+            while (q->count == q->capacity)
+            {
+                pthread_cond_wait(&q->not_full, &q->lock);
+            }
+        }
+    }
+
+    q->slots[(q->head + q->count) % q->capacity] = frame;
+    q->count++;
+
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+
+    // On libère l'image jetée hors du verrou
+    frame_free(stale);
+}
+
+// Retire la plus ancienne image, NULL quand la file est fermée et vide
+static struct frame *queue_pop(struct frame_queue *q)
+{
+    pthread_mutex_lock(&q->lock);
+
+    while (q->count == 0 && !q->closed)
+    {
+        pthread_cond_wait(&q->not_empty, &q->lock);
+    }
+
+    struct frame *frame = NULL;
+    if (q->count)
+    {
+        frame = q->slots[q->head];
+        q->head = (q->head + 1) % q->capacity;
+        q->count--;
+        pthread_cond_signal(&q->not_full);
+    }
+
+    pthread_mutex_unlock(&q->lock);
+    return frame;
+}
+
+// Signale qu'aucune image ne sera plus ajoutée
+static void queue_close(struct frame_queue *q)
+{
+    pthread_mutex_lock(&q->lock);
+    q->closed = 1;
+    pthread_cond_broadcast(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+// Exécute une fois process et comptabilise le temps de travail
+static int run_process(struct pipeline_stage *st, struct frame *frame)
+{
+    uint64_t t0 = now_ns();
+    int ret = st->process(frame, st->ctx);
+    uint64_t t1 = now_ns();
+    __atomic_fetch_add(&st->busy_ns, t1 - t0, __ATOMIC_RELAXED);
+    metrics_hist_add(&st->time_us, (t1 - t0) / 1000);
+
+    // Le dernier étage mesure le trajet complet de l'image
+    if (ret == 0 && !st->out)
+    {
+        metrics_hist_add(&st->pipeline->latency_us, (t1 - frame->capture_ns) / 1000);
+    }
+    return ret;
+}
+
+// Boucle du premier étage : produit des images tant que le flux continue
+static void run_source(struct pipeline_stage *st)
+{
+    struct pipeline *p = st->pipeline;
+    unsigned long produced = 0;
+
+    while (p->running && (p->max_frames == 0 || produced < p->max_frames))
+    {
+        struct frame *frame = calloc(1, sizeof(*frame));
+        if (!frame)
+        {
+            perror("calloc");
+            break;
+        }
+        frame->image_id   = p->next_image_id++;
+        frame->capture_ns = now_ns();
+
+        if (run_process(st, frame) != 0)
+        {
+            frame_free(frame);
+            __atomic_fetch_add(&st->errors, 1, __ATOMIC_RELAXED);
+            break;
+        }
+
+        __atomic_fetch_add(&st->frames, 1, __ATOMIC_RELAXED);
+        produced++;
+        queue_push(st->out, frame);
+    }
+}
+
+// Boucle d'un étage intermédiaire ou final : consomme sa file d'entrée
+static void run_filter(struct pipeline_stage *st)
+{
+    struct frame *frame;
+
+    while ((frame = queue_pop(st->in)) != NULL)
+    {
+        if (run_process(st, frame) != 0)
+        {
+            frame_free(frame);
+            __atomic_fetch_add(&st->errors, 1, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        __atomic_fetch_add(&st->frames, 1, __ATOMIC_RELAXED);
+
+        if (st->out)
+        {
+            queue_push(st->out, frame);
+        }
+        else
+        {
+            frame_free(frame);
+        }
+    }
+}
+
+static void *stage_thread(void *arg)
+{
+    struct pipeline_stage *st = arg;
+
+    if (st->in)
+    {
+        run_filter(st);
+    }
+    else
+    {
+        run_source(st);
+    }
+
+    // On réveille l'étage suivant pour qu'il termine après avoir vidé sa file
+    if (st->out)
+    {
+        queue_close(st->out);
+    }
+    __atomic_fetch_add(&st->pipeline->finished, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+void pipeline_init(struct pipeline *p, unsigned queue_depth, unsigned long max_frames)
+{
+    memset(p, 0, sizeof(*p));
+    p->queue_depth = queue_depth;
+    p->max_frames  = max_frames;
+    p->running     = 1;
+}
+
+// Ajoute un étage en fin de pipeline. policy décrit la file qui le relie à
+// l'étage précédent (ignorée pour le premier étage).
+int pipeline_add_stage(struct pipeline *p, const char *name, stage_fn process,
+                       void *ctx, enum queue_policy policy)
+{
+    if (p->nb_stages == PIPELINE_MAX_STAGES)
+    {
+        return -1;
+    }
+
+    struct pipeline_stage *st = &p->stages[p->nb_stages];
+    st->name     = name;
+    st->process  = process;
+    st->ctx      = ctx;
+    st->pipeline = p;
+
+    if (p->nb_stages > 0)
+    {
+        struct frame_queue *q = &p->queues[p->nb_stages - 1];
+        if (queue_init(q, p->queue_depth, policy) < 0)
+        {
+            return -1;
+        }
+        p->stages[p->nb_stages - 1].out = q;
+        st->in = q;
+    }
+
+    p->nb_stages++;
+    return 0;
+}
+
+int pipeline_start(struct pipeline *p)
+{
+    p->start_ns = p->last_report_ns = now_ns();
+
+    for (unsigned i = 0; i < p->nb_stages; i++)
+    {
+        if (pthread_create(&p->stages[i].thread, NULL, stage_thread, &p->stages[i]) != 0)
+        {
+            perror("pthread_create");
+            p->running = 0;
+
+            // Les étages déjà lancés doivent pouvoir se terminer
+            for (unsigned j = 0; j < i; j++)
+            {
+                if (p->stages[j].out)
+                {
+                    queue_close(p->stages[j].out);
+                }
+            }
+            for (unsigned j = 0; j < i; j++)
+            {
+                pthread_join(p->stages[j].thread, NULL);
+            }
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Demande l'arrêt : la source s'arrête, les autres étages vident leur file
+void pipeline_stop(struct pipeline *p)
+{
+    p->running = 0;
+}
+
+int pipeline_done(struct pipeline *p)
+{
+    return __atomic_load_n(&p->finished, __ATOMIC_ACQUIRE) == p->nb_stages;
+}
+
+void pipeline_join(struct pipeline *p)
+{
+    for (unsigned i = 0; i < p->nb_stages; i++)
+    {
+        pthread_join(p->stages[i].thread, NULL);
+    }
+}
+
+// Affiche le débit en images/s et le taux d'occupation de chaque étage,
+// depuis le dernier relevé ou depuis le début si final est vrai
+void pipeline_report(struct pipeline *p, FILE *out, int final)
+{
+    uint64_t now = now_ns();
+    uint64_t since = final ? p->start_ns : p->last_report_ns;
+    double elapsed = (now - since) / 1e9;
+
+    if (elapsed <= 0)
+    {
+        return;
+    }
+
+    struct pipeline_stage *last = &p->stages[p->nb_stages - 1];
+    uint64_t sent = __atomic_load_n(&last->frames, __ATOMIC_RELAXED);
+    uint64_t sent_ref = final ? 0 : last->last_frames;
+
+    fprintf(out, "%s %.2f img/s |", final ? "[total]" : "[stats]",
+            (sent - sent_ref) / elapsed);
+
+    for (unsigned i = 0; i < p->nb_stages; i++)
+    {
+        struct pipeline_stage *st = &p->stages[i];
+        uint64_t frames = __atomic_load_n(&st->frames, __ATOMIC_RELAXED);
+        uint64_t busy = __atomic_load_n(&st->busy_ns, __ATOMIC_RELAXED);
+        uint64_t busy_ref = final ? 0 : st->last_busy_ns;
+
+        // Occupation = part du temps où l'étage travaillait sur une image
+        fprintf(out, " %s %.0f%%", st->name, 100.0 * (busy - busy_ref) / (now - since));
+
+        if (!final)
+        {
+            st->last_frames  = frames;
+            st->last_busy_ns = busy;
+        }
+    }
+
+    fprintf(out, " | images jetées:");
+    for (unsigned i = 0; i + 1 < p->nb_stages; i++)
+    {
+        pthread_mutex_lock(&p->queues[i].lock);
+        uint64_t dropped = p->queues[i].dropped;
+        pthread_mutex_unlock(&p->queues[i].lock);
+        fprintf(out, " %s %llu", p->stages[i + 1].name, (unsigned long long)dropped);
+    }
+    fprintf(out, "\n");
+
+    if (!final)
+    {
+        p->last_report_ns = now;
+    }
+}
+
+int pipeline_metrics(struct pipeline *p, char *buf, size_t size)
+{
+    size_t n = 0;
+
+    for (unsigned i = 0; i < p->nb_stages && n < size; i++)
+    {
+        struct pipeline_stage *st = &p->stages[i];
+        uint64_t dropped = 0;
+
+        // Images jetées dans la file d'entrée de l'étage
+        if (st->in)
+        {
+            pthread_mutex_lock(&st->in->lock);
+            dropped = st->in->dropped;
+            pthread_mutex_unlock(&st->in->lock);
+        }
+        n += snprintf(buf + n, size - n, "%s%s_frames=%llu %s_errors=%llu %s_dropped=%llu "
+                      "%s_p50_us=%llu %s_p99_us=%llu",
+                      i ? " " : "", st->name,
+                      (unsigned long long)__atomic_load_n(&st->frames, __ATOMIC_RELAXED),
+                      st->name,
+                      (unsigned long long)__atomic_load_n(&st->errors, __ATOMIC_RELAXED),
+                      st->name, (unsigned long long)dropped,
+                      st->name, (unsigned long long)metrics_hist_percentile(&st->time_us, 0.5),
+                      st->name, (unsigned long long)metrics_hist_percentile(&st->time_us, 0.99));
+    }
+    if (n < size)
+    {
+        n += snprintf(buf + n, size - n, " latency_p50_us=%llu latency_p99_us=%llu",
+                      (unsigned long long)metrics_hist_percentile(&p->latency_us, 0.5),
+                      (unsigned long long)metrics_hist_percentile(&p->latency_us, 0.99));
+    }
+    return (int)n;
+}
+
+void pipeline_destroy(struct pipeline *p)
+{
+    for (unsigned i = 0; i + 1 < p->nb_stages; i++)
+    {
+        queue_destroy(&p->queues[i]);
+    }
+}
@@ -1,5 +1,6 @@
 #include "screenshot.h"
 #include "network.h"
+#include "convert.h"
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <stdlib.h>
 
@@ -68,25 +69,10 @@ int convert_png_to_raw(struct screen_data *sd)
     // On recupère les pixels de l'image
     guchar *pixels = gdk_pixbuf_get_pixels(pix_buf);
 
-    // On itere sur la hauteur et la largeur de l'image pour chaque pixel
-    for (int y = 0; y < image_height; y++)
-    {
-        // Calcul de la ligne de pixels
-        guchar *row = pixels + (y * octet_per_line);
-
-        for (int x = 0; x < image_width; x++)
-        {
-            guchar *pixel = row + x * nb_channel;
-
-            // Offset = (ligne * largeur + colonne) * taille d'un pixel
-            size_t off = (y * image_width + x) * PIXEL_BYTES;
-
-            raw[off + 0] = pixel[2];    // B
-            raw[off + 1] = pixel[1];    // G
-            raw[off + 2] = pixel[0];    // R
-            raw[off + 3] = 0xFF;        // X
-        }
-    }
+    // Conversion RGB(A) -> BGRx avec le noyau SIMD choisi au démarrage,
+    // les lignes étant réparties sur plusieurs coeurs
+    convert_to_bgrx(pixels, octet_per_line, nb_channel, image_width,
+                    image_height, raw);
 
     // On free notre pixbuf
     g_object_unref(pix_buf);
@@ -100,6 +86,38 @@ int convert_png_to_raw(struct screen_data *sd)
     sd->length = raw_size;
     sd->width = image_width;
     sd->height = image_height;
+    sd->format = SD_FORMAT_RAW;
+    sd->pixel_format = PIXEL_FORMAT_BGRX;
     
     return 0;
 }
+
+// Convertit des pixels bruts BGRx vers le format envoyé sur le réseau
+int convert_raw_to_format(struct screen_data *sd, enum pixel_format fmt)
+{
+    if (sd->pixel_format == fmt)
+    {
+        return 0;
+    }
+    if (sd->format != SD_FORMAT_RAW || sd->pixel_format != PIXEL_FORMAT_BGRX)
+    {
+        g_printerr("Conversion de format impossible : pixels BGRx attendus\n");
+        return -1;
+    }
+
+    size_t size = pixel_image_bytes(fmt, sd->width, sd->height);
+    guchar *packed = malloc(size);
+    if (!packed)
+    {
+        perror("malloc");
+        return -1;
+    }
+
+    convert_to_format(fmt, sd->data, sd->width, sd->height, packed);
+
+    g_free(sd->data);
+    sd->data = packed;
+    sd->length = size;
+    sd->pixel_format = fmt;
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include "png_stream.h"
+#include <stdio.h>
+#include <string.h>
+
+// libpng lit le fichier par morceaux depuis la mémoire
+static void read_memory(png_structp png, png_bytep out, png_size_t len)
+{
+    struct png_stream *ps = png_get_io_ptr(png);
+
+    if (len > ps->length - ps->pos)
+    {
+        png_error(png, "PNG tronqué");
+    }
+    memcpy(out, ps->data + ps->pos, len);
+    ps->pos += len;
+}
+
+static void on_error(png_structp png, png_const_charp msg)
+{
+    fprintf(stderr, "Erreur PNG : %s\n", msg);
+    png_longjmp(png, 1);
+}
+
+static void on_warning(png_structp png, png_const_charp msg)
+{
+    (void)png;
+    (void)msg;
+}
+
+int png_stream_open(struct png_stream *ps, const uint8_t *data, size_t length)
+{
+    memset(ps, 0, sizeof(*ps));
+    ps->data = data;
+    ps->length = length;
+
+    ps->png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, on_error, on_warning);
+    if (ps->png)
+    {
+        ps->info = png_create_info_struct(ps->png);
+    }
+    if (!ps->info)
+    {
+        fprintf(stderr, "png_create_read_struct : mémoire insuffisante\n");
+        png_stream_close(ps);
+        return -1;
+    }
+
+    if (setjmp(png_jmpbuf(ps->png)))
+    {
+        png_stream_close(ps);
+        return -1;
+    }
+
+    png_set_read_fn(ps->png, ps, read_memory);
+    png_read_info(ps->png, ps->info);
+
+    ps->width = png_get_image_width(ps->png, ps->info);
+    ps->height = png_get_image_height(ps->png, ps->info);
+    ps->interlaced = png_get_interlace_type(ps->png, ps->info) != PNG_INTERLACE_NONE;
+
+    // Palette, gris et 16 bits ramenés à du RGB 8 bits, alpha ignoré comme
+    // dans convert_to_bgrx, puis octets remis dans l'ordre BGRx
+    png_set_expand(ps->png);
+    png_set_strip_16(ps->png);
+    png_set_gray_to_rgb(ps->png);
+    png_set_strip_alpha(ps->png);
+    png_set_filler(ps->png, 0xFF, PNG_FILLER_AFTER);
+    png_set_bgr(ps->png);
+    png_read_update_info(ps->png, ps->info);
+
+    if (png_get_rowbytes(ps->png, ps->info) != (size_t)ps->width * 4)
+    {
+        fprintf(stderr, "PNG : conversion en BGRx impossible\n");
+        png_stream_close(ps);
+        return -1;
+    }
+    return 0;
+}
+
+int png_stream_read(struct png_stream *ps, uint8_t *dst, size_t stride, uint32_t rows)
+{
+    if (ps->interlaced || rows > ps->height - ps->rows_done)
+    {
+        return -1;
+    }
+    if (setjmp(png_jmpbuf(ps->png)))
+    {
+        return -1;
+    }
+
+    for (uint32_t y = 0; y < rows; y++)
+    {
+        png_read_row(ps->png, dst + y * stride, NULL);
+    }
+    ps->rows_done += rows;
+    return 0;
+}
+
+void png_stream_close(struct png_stream *ps)
+{
+    if (ps->png)
+    {
+        png_destroy_read_struct(&ps->png, ps->info ? &ps->info : NULL, NULL);
+    }
+    ps->png = NULL;
+    ps->info = NULL;
+}
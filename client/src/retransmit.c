@@ -0,0 +1,166 @@
+#include "retransmit.h"
+#include "network.h"
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RETX_DEADLINE_NS (RETX_DEADLINE_MS * 1000000ull)
+
+void retx_init(struct retx_buffer *rb)
+{
+    memset(rb, 0, sizeof(*rb));
+}
+
+static void retx_free_frame(struct retx_buffer *rb, struct retx_frame *f)
+{
+    // Les demandes encore en attente pour cette image ne seront pas servies
+    for (unsigned i = 0; i < rb->count; i++)
+    {
+        struct retx_range *r = &rb->queue[(rb->head + i) % RETX_QUEUE];
+        if (r->frame == f)
+        {
+            rb->abandoned += r->count;
+            r->frame = NULL;
+            r->count = 0;
+        }
+    }
+
+    encoded_frame_clear(&f->enc);
+    g_free(f->pixels);
+    free(f->first_seq);
+    memset(f, 0, sizeof(*f));
+}
+
+void retx_destroy(struct retx_buffer *rb)
+{
+    for (unsigned i = 0; i < RETX_FRAMES; i++)
+    {
+        retx_free_frame(rb, &rb->frames[i]);
+    }
+    rb->count = 0;
+}
+
+struct retx_frame *retx_store(struct retx_buffer *rb, struct encoded_frame *ef,
+                              uint8_t *pixels, uint64_t now_ns)
+{
+    // Une image sans tuile modifiée n'a aucun paquet à renvoyer : elle ne
+    // prend pas la place d'une image utile
+    if (ef->nb_tiles == 0)
+    {
+        encoded_frame_clear(ef);
+        g_free(pixels);
+        return NULL;
+    }
+
+    struct retx_frame *f = &rb->frames[rb->next];
+    rb->next = (rb->next + 1) % RETX_FRAMES;
+    retx_free_frame(rb, f);
+
+    f->enc = *ef;
+    f->pixels = pixels;
+    f->sent_ns = now_ns;
+    memset(ef, 0, sizeof(*ef));
+
+    // Numéro du premier paquet de chaque tuile, pour retrouver la tuile
+    // d'un paquet demandé par recherche dichotomique
+    f->first_seq = malloc((f->enc.nb_tiles + 1) * sizeof(*f->first_seq));
+    if (!f->first_seq)
+    {
+        perror("malloc");
+        encoded_frame_clear(&f->enc);
+        g_free(f->pixels);
+        memset(f, 0, sizeof(*f));
+        return NULL;
+    }
+
+    uint32_t seq = 0;
+    for (uint32_t i = 0; i < f->enc.nb_tiles; i++)
+    {
+        f->first_seq[i] = seq;
+        seq += (tile_bytes(&f->enc.tiles[i]) + PACKET_PAYLOAD - 1) / PACKET_PAYLOAD;
+    }
+    f->first_seq[f->enc.nb_tiles] = seq;
+    return f;
+}
+
+void retx_request(struct retx_buffer *rb, uint32_t image_id, uint32_t seq,
+                  uint32_t count, uint64_t now_ns)
+{
+    struct retx_frame *f = NULL;
+
+    rb->requested += count;
+    for (unsigned i = 0; i < RETX_FRAMES; i++)
+    {
+        if (rb->frames[i].first_seq && rb->frames[i].enc.image_id == image_id)
+        {
+            f = &rb->frames[i];
+            break;
+        }
+    }
+
+    // Image sortie du buffer, trop vieille, plage invalide ou file pleine
+    if (!f || now_ns - f->sent_ns > RETX_DEADLINE_NS ||
+        seq >= retx_total(f) || count > retx_total(f) - seq ||
+        rb->count == RETX_QUEUE)
+    {
+        rb->abandoned += count;
+        return;
+    }
+
+    struct retx_range *r = &rb->queue[(rb->head + rb->count) % RETX_QUEUE];
+    r->frame = f;
+    r->seq = seq;
+    r->count = count;
+    rb->count++;
+}
+
+int retx_next(struct retx_buffer *rb, uint64_t now_ns,
+              struct retx_frame **frame, uint32_t *seq)
+{
+    while (rb->count > 0)
+    {
+        struct retx_range *r = &rb->queue[rb->head];
+
+        if (r->count > 0 && now_ns - r->frame->sent_ns > RETX_DEADLINE_NS)
+        {
+            rb->abandoned += r->count;
+            r->count = 0;
+        }
+        if (r->count == 0)
+        {
+            rb->head = (rb->head + 1) % RETX_QUEUE;
+            rb->count--;
+            continue;
+        }
+
+        *frame = r->frame;
+        *seq = r->seq++;
+        r->count--;
+        rb->resent++;
+        return 1;
+    }
+    return 0;
+}
+
+void retx_locate(const struct retx_frame *f, uint32_t seq, uint32_t *tile,
+                 size_t *offset)
+{
+    uint32_t lo = 0, hi = f->enc.nb_tiles;
+
+    // Dernière tuile dont le premier paquet est <= seq
+    while (hi - lo > 1)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (f->first_seq[mid] <= seq)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    *tile = lo;
+    *offset = (size_t)(seq - f->first_seq[lo]) * PACKET_PAYLOAD;
+}
@@ -63,8 +63,12 @@ int capture_screenshot(struct screen_data* sd)
     //Stocke la GLIB event loop dans la struct
     sd->loop = loop;
 
-    //Créer le portail XDG et le stocke dans la struct
-    sd->portal = xdp_portal_new();
+    //Créer le portail XDG et le stocke dans la struct (il est réutilisé
+    //pour les captures suivantes en mode flux)
+    if (!sd->portal)
+    {
+        sd->portal = xdp_portal_new();
+    }
 
     // Démarre la capture d’écran de façon asynchrone :
     // - sd->portal   : Objet qui gère la capture (notre portail)
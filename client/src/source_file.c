@@ -0,0 +1,217 @@
+#include "frame_source.h"
+#include "convert.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+// Source fichiers : liste triée de .ppm/.png rejouée en boucle
+struct file_source {
+    char **paths;
+    int    count;
+    int    next;
+};
+
+static int has_suffix(const char *name, const char *suffix)
+{
+    size_t n = strlen(name), s = strlen(suffix);
+    return n >= s && strcasecmp(name + n - s, suffix) == 0;
+}
+
+static int image_filter(const struct dirent *e)
+{
+    return has_suffix(e->d_name, ".ppm") || has_suffix(e->d_name, ".png");
+}
+
+// Lit le prochain entier d'un en-tête PPM en sautant espaces et commentaires
+static int ppm_read_uint(const guchar *buf, gsize len, gsize *pos, guint32 *value)
+{
+    while (*pos < len)
+    {
+        if (buf[*pos] == '#')
+        {
+            while (*pos < len && buf[*pos] != '\n')
+            {
+                (*pos)++;
+            }
+        }
+        else if (buf[*pos] == ' ' || buf[*pos] == '\t' || buf[*pos] == '\r' || buf[*pos] == '\n')
+        {
+            (*pos)++;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    if (*pos >= len || buf[*pos] < '0' || buf[*pos] > '9')
+    {
+        return -1;
+    }
+
+    *value = 0;
+    while (*pos < len && buf[*pos] >= '0' && buf[*pos] <= '9')
+    {
+        *value = *value * 10 + (buf[*pos] - '0');
+        (*pos)++;
+    }
+    return 0;
+}
+
+// Décode un PPM binaire (P6, 8 bits) en BGRx
+static int load_ppm(const guchar *buf, gsize len, struct screen_data *sd)
+{
+    gsize pos = 2;
+    guint32 width, height, maxval;
+
+    if (len < 2 || buf[0] != 'P' || buf[1] != '6' ||
+        ppm_read_uint(buf, len, &pos, &width) < 0 ||
+        ppm_read_uint(buf, len, &pos, &height) < 0 ||
+        ppm_read_uint(buf, len, &pos, &maxval) < 0 ||
+        maxval != 255 || width == 0 || height == 0)
+    {
+        fprintf(stderr, "En-tête PPM non supporté (P6 8 bits attendu)\n");
+        return -1;
+    }
+
+    // Un seul blanc sépare l'en-tête des pixels
+    pos++;
+
+    size_t pixels = (size_t)width * height;
+    if (pos > len || len - pos < pixels * 3)
+    {
+        fprintf(stderr, "Fichier PPM tronqué\n");
+        return -1;
+    }
+
+    guchar *raw = malloc(pixels * 4);
+    if (!raw)
+    {
+        perror("malloc");
+        return -1;
+    }
+
+    convert_to_bgrx(buf + pos, width * 3, 3, width, height, raw);
+
+    sd->data   = raw;
+    sd->length = pixels * 4;
+    sd->width  = width;
+    sd->height = height;
+    sd->format = SD_FORMAT_RAW;
+    sd->pixel_format = PIXEL_FORMAT_BGRX;
+    return 0;
+}
+
+static int file_next(struct frame_source *src, struct screen_data *sd)
+{
+    struct file_source *fs = src->priv;
+    const char *path = fs->paths[fs->next];
+    fs->next = (fs->next + 1) % fs->count;
+
+    gchar *content;
+    gsize length;
+    GError *error = NULL;
+
+    if (!g_file_get_contents(path, &content, &length, &error))
+    {
+        g_printerr("Échec de la lecture de %s: %s\n", path, error->message);
+        g_error_free(error);
+        return -1;
+    }
+
+    // Les PNG sont décodés par l'étage de conversion, comme ceux du portail
+    if (has_suffix(path, ".png"))
+    {
+        sd->data   = (guchar *)content;
+        sd->length = length;
+        sd->format = SD_FORMAT_PNG;
+        return 0;
+    }
+
+    int ret = load_ppm((guchar *)content, length, sd);
+    g_free(content);
+    return ret;
+}
+
+static void file_close(struct frame_source *src)
+{
+    struct file_source *fs = src->priv;
+
+    for (int i = 0; i < fs->count; i++)
+    {
+        g_free(fs->paths[i]);
+    }
+    free(fs->paths);
+    free(fs);
+}
+
+struct frame_source *file_source_open(const char *path)
+{
+    struct stat st;
+    if (stat(path, &st) < 0)
+    {
+        perror(path);
+        return NULL;
+    }
+
+    struct frame_source *src = calloc(1, sizeof(*src));
+    struct file_source *fs = calloc(1, sizeof(*fs));
+    if (!src || !fs)
+    {
+        perror("calloc");
+        free(src);
+        free(fs);
+        return NULL;
+    }
+
+    if (S_ISDIR(st.st_mode))
+    {
+        // Les images d'un dossier sont jouées dans l'ordre alphabétique
+        struct dirent **entries;
+        int n = scandir(path, &entries, image_filter, alphasort);
+        if (n < 0)
+        {
+            perror("scandir");
+            free(src);
+            free(fs);
+            return NULL;
+        }
+
+        fs->paths = calloc(n ? n : 1, sizeof(*fs->paths));
+        for (int i = 0; i < n; i++)
+        {
+            if (fs->paths)
+            {
+                fs->paths[fs->count++] = g_build_filename(path, entries[i]->d_name, NULL);
+            }
+            free(entries[i]);
+        }
+        free(entries);
+    }
+    else
+    {
+        fs->paths = calloc(1, sizeof(*fs->paths));
+        if (fs->paths)
+        {
+            fs->paths[fs->count++] = g_strdup(path);
+        }
+    }
+
+    if (fs->count == 0)
+    {
+        fprintf(stderr, "Aucune image .ppm/.png dans %s\n", path);
+        free(fs->paths);
+        free(fs);
+        free(src);
+        return NULL;
+    }
+
+    src->name  = "files";
+    src->next  = file_next;
+    src->close = file_close;
+    src->priv  = fs;
+    return src;
+}
@@ -0,0 +1,233 @@
+#include "frame_source.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Nombre de lignes défilées à chaque image en mode scroll
+#define SCROLL_STEP 8
+
+enum synth_pattern {
+    SYNTH_STATIC,             // Même image à chaque fois
+    SYNTH_SCROLL,             // Bureau qui défile verticalement
+    SYNTH_NOISE,              // Bruit aléatoire, rien n'est compressible
+    SYNTH_PARTIAL             // Bureau fixe avec une zone qui change
+};
+
+// Générateur synthétique déterministe : les mêmes paramètres produisent
+// toujours la même séquence d'images
+struct synthetic_source {
+    enum synth_pattern pattern;
+    guint32 width, height;
+    guchar *base;             // Image de fond BGRx générée une fois
+    uint64_t frame;           // Numéro de l'image suivante
+};
+
+// xorshift64* : rapide et suffisant pour du contenu de test
+static uint64_t next_random(uint64_t *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1Dull;
+}
+
+static void fill_rect(guchar *img, guint32 stride, guint32 x0, guint32 y0,
+                      guint32 w, guint32 h, uint32_t bgrx)
+{
+    for (guint32 y = y0; y < y0 + h; y++)
+    {
+        uint32_t *row = (uint32_t *)(img + (size_t)y * stride) + x0;
+        for (guint32 x = 0; x < w; x++)
+        {
+            row[x] = bgrx;
+        }
+    }
+}
+
+// Remplit une zone de bruit, graine dérivée du numéro d'image
+static void fill_noise(guchar *img, guint32 stride, guint32 x0, guint32 y0,
+                       guint32 w, guint32 h, uint64_t seed)
+{
+    uint64_t state = seed * 0x9E3779B97F4A7C15ull + 1;
+
+    for (guint32 y = y0; y < y0 + h; y++)
+    {
+        uint32_t *row = (uint32_t *)(img + (size_t)y * stride) + x0;
+        for (guint32 x = 0; x < w; x++)
+        {
+            row[x] = (uint32_t)next_random(&state) | 0xFF000000u;
+        }
+    }
+}
+
+// Dessine un faux bureau : dégradé de fond, fenêtres, lignes de "texte"
+static void draw_desktop(guchar *img, guint32 width, guint32 height)
+{
+    guint32 stride = width * 4;
+    uint64_t state = 0x5EED5EEDull;
+
+    for (guint32 y = 0; y < height; y++)
+    {
+        guchar shade = 40 + (guchar)(80u * y / height);
+        fill_rect(img, stride, 0, y, width, 1,
+                  0xFF000000u | (shade + 40) | (shade << 8) | ((shade / 2u) << 16));
+    }
+
+    for (int i = 0; i < 6; i++)
+    {
+        guint32 w = width / 4 + next_random(&state) % (width / 3 + 1);
+        guint32 h = height / 4 + next_random(&state) % (height / 3 + 1);
+        guint32 x = next_random(&state) % (width - w + 1);
+        guint32 y = next_random(&state) % (height - h + 1);
+        guint32 bar = h / 16 + 1;
+
+        if (h <= bar)
+        {
+            continue;
+        }
+
+        // Barre de titre puis contenu clair
+        fill_rect(img, stride, x, y, w, bar, 0xFF303030u);
+        fill_rect(img, stride, x, y + bar, w, h - bar, 0xFFF4F4F4u);
+
+        // Lignes de texte : suites de petits blocs sombres
+        for (guint32 ty = y + bar + 4; ty + 10 < y + h; ty += 16)
+        {
+            for (guint32 tx = x + 6; tx + 8 < x + w; tx += 7)
+            {
+                if (next_random(&state) % 5)
+                {
+                    fill_rect(img, stride, tx, ty, 5, 9, 0xFF202020u);
+                }
+            }
+        }
+    }
+}
+
+static int synthetic_next(struct frame_source *src, struct screen_data *sd)
+{
+    struct synthetic_source *ss = src->priv;
+    guint32 stride = ss->width * 4;
+    size_t size = (size_t)stride * ss->height;
+
+    guchar *img = malloc(size);
+    if (!img)
+    {
+        perror("malloc");
+        return -1;
+    }
+
+    switch (ss->pattern)
+    {
+    case SYNTH_STATIC:
+        memcpy(img, ss->base, size);
+        break;
+    case SYNTH_SCROLL:
+    {
+        // La ligne y de l'image est la ligne y + shift du fond (en boucle)
+        size_t shift = (ss->frame * SCROLL_STEP) % ss->height * stride;
+        memcpy(img, ss->base + shift, size - shift);
+        memcpy(img + size - shift, ss->base, shift);
+        break;
+    }
+    case SYNTH_NOISE:
+        fill_noise(img, stride, 0, 0, ss->width, ss->height, ss->frame);
+        break;
+    case SYNTH_PARTIAL:
+    {
+        // Un bloc de 1/8 x 1/8 de l'écran se déplace en diagonale
+        guint32 bw = ss->width / 8 ? ss->width / 8 : 1;
+        guint32 bh = ss->height / 8 ? ss->height / 8 : 1;
+        guint32 bx = (guint32)(ss->frame * (bw / 4 + 1)) % (ss->width - bw + 1);
+        guint32 by = (guint32)(ss->frame * (bh / 4 + 1)) % (ss->height - bh + 1);
+
+        memcpy(img, ss->base, size);
+        fill_noise(img, stride, bx, by, bw, bh, ss->frame);
+        break;
+    }
+    }
+
+    ss->frame++;
+
+    sd->data   = img;
+    sd->length = size;
+    sd->width  = ss->width;
+    sd->height = ss->height;
+    sd->format = SD_FORMAT_RAW;
+    sd->pixel_format = PIXEL_FORMAT_BGRX;
+    return 0;
+}
+
+static void synthetic_close(struct frame_source *src)
+{
+    struct synthetic_source *ss = src->priv;
+    free(ss->base);
+    free(ss);
+}
+
+struct frame_source *synthetic_source_open(const char *pattern,
+                                           guint32 width, guint32 height)
+{
+    static const struct {
+        const char *name;
+        enum synth_pattern pattern;
+    } patterns[] = {
+        { "static",  SYNTH_STATIC },
+        { "scroll",  SYNTH_SCROLL },
+        { "noise",   SYNTH_NOISE },
+        { "partial", SYNTH_PARTIAL },
+    };
+
+    if (width == 0 || height == 0 || width > SOURCE_MAX_WIDTH || height > SOURCE_MAX_HEIGHT)
+    {
+        fprintf(stderr, "Résolution %ux%u invalide (max %ux%u)\n",
+                width, height, SOURCE_MAX_WIDTH, SOURCE_MAX_HEIGHT);
+        return NULL;
+    }
+
+    struct frame_source *src = calloc(1, sizeof(*src));
+    struct synthetic_source *ss = calloc(1, sizeof(*ss));
+    if (!src || !ss)
+    {
+        perror("calloc");
+        free(src);
+        free(ss);
+        return NULL;
+    }
+
+    size_t i;
+    for (i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++)
+    {
+        if (strcmp(pattern, patterns[i].name) == 0)
+        {
+            ss->pattern = patterns[i].pattern;
+            break;
+        }
+    }
+    if (i == sizeof(patterns) / sizeof(patterns[0]))
+    {
+        fprintf(stderr, "Motif inconnu: %s (static, scroll, noise, partial)\n", pattern);
+        free(src);
+        free(ss);
+        return NULL;
+    }
+
+    ss->width  = width;
+    ss->height = height;
+    ss->base   = malloc((size_t)width * height * 4);
+    if (!ss->base)
+    {
+        perror("malloc");
+        free(src);
+        free(ss);
+        return NULL;
+    }
+    draw_desktop(ss->base, width, height);
+
+    src->name  = "synth";
+    src->next  = synthetic_next;
+    src->close = synthetic_close;
+    src->priv  = ss;
+    return src;
+}
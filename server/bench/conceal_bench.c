@@ -0,0 +1,218 @@
+// Qualité d'une image coupée en cours d'envoi
+//
+// Découpe une image clé en paquets comme le client (tuiles de 64x64,
+// PACKET_PAYLOAD octets par paquet), dans l'ordre des lignes ou dans l'ordre
+// entrelacé (-O du client), ne garde que les premiers paquets puis mesure
+// le PSNR de l'image reçue par rapport à l'originale : telle quelle (noir là
+// où rien n'est arrivé), puis comblée par conceal_fill.
+// Usage : conceal_bench [pas en %]
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "conceal.h"
+#include "pixel_format.h"
+
+static const struct {
+    const char *name;
+    uint32_t width, height;
+} resolutions[] = {
+    { "720p",  1280, 720 },
+    { "1080p", 1920, 1080 },
+};
+
+// Une tuile de l'image et son premier paquet
+typedef struct tile {
+    uint32_t id;
+    uint32_t first;
+} tile_t;
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Faux bureau BGRx : fond en dégradé, fenêtres claires couvertes de lignes
+// de « texte »
+static void fill_desktop(uint8_t *pixels, uint32_t width, uint32_t height)
+{
+    for (uint32_t y = 0; y < height; y++)
+    {
+        for (uint32_t x = 0; x < width; x++)
+        {
+            uint8_t *p = pixels + ((size_t)y * width + x) * 4;
+            p[0] = 96 + 96 * x / width;
+            p[1] = 64 + 64 * y / height;
+            p[2] = 48;
+            p[3] = 0;
+
+            int window = (x / 320 + y / 240) % 3 != 0;
+            if (window && x % 320 > 16 && y % 240 > 24)
+            {
+                uint32_t h = (x / 3) * 2654435761u ^ (y / 14) * 40503u;
+                int ink = y % 14 >= 4 && y % 14 < 11 && (h >> 13) % 3 == 0;
+                p[0] = p[1] = p[2] = ink ? 32 : 236;
+            }
+        }
+    }
+}
+
+// Ordre des tuiles du client : rangs dans l'ordre des lignes, ou
+// « bit-reversal » des rangs (même calcul que delta.c)
+static void order_tiles(tile_t *tiles, uint32_t count, int interleave)
+{
+    unsigned bits = 0;
+    while ((1ULL << bits) < count)
+    {
+        bits++;
+    }
+
+    uint32_t n = 0;
+    for (uint64_t i = 0; n < count; i++)
+    {
+        uint32_t r = i;
+        if (interleave)
+        {
+            r = 0;
+            for (unsigned b = 0; b < bits; b++)
+            {
+                r |= ((i >> b) & 1) << (bits - 1 - b);
+            }
+        }
+        if (r < count)
+        {
+            tiles[n++].id = r;
+        }
+    }
+}
+
+// Applique à canvas les paquets [0, packets[ de la tuile t, comme
+// apply_tile_data côté serveur
+static void apply_tile(conceal_map_t *map, const uint8_t *src, uint8_t *canvas, size_t stride,
+                       const tile_t *t, uint32_t packets)
+{
+    uint32_t x0 = (t->id % map->tiles_x) * map->tile;
+    uint32_t y0 = (t->id / map->tiles_x) * map->tile;
+    size_t row_bytes = (size_t)(map->width - x0 < map->tile ? map->width - x0 : map->tile) * 4;
+    uint32_t rows = map->height - y0 < map->tile ? map->height - y0 : map->tile;
+    size_t len = packets * PACKET_PAYLOAD;
+
+    if (len > row_bytes * rows)
+    {
+        len = row_bytes * rows;
+    }
+    for (size_t done = 0, row = 0; done < len; row++)
+    {
+        size_t chunk = len - done < row_bytes ? len - done : row_bytes;
+        size_t offset = (y0 + row) * stride + (size_t)x0 * 4;
+        memcpy(canvas + offset, src + offset, chunk);
+        conceal_received(map, t->id, row, chunk, row_bytes);
+        done += chunk;
+    }
+}
+
+static double psnr(const uint8_t *a, const uint8_t *b, size_t pixels)
+{
+    uint64_t sum = 0;
+    for (size_t i = 0; i < pixels * 4; i++)
+    {
+        if (i % 4 != 3)
+        {
+            int d = a[i] - b[i];
+            sum += d * d;
+        }
+    }
+    if (!sum)
+    {
+        return 99.99;
+    }
+    return 10 * log10(255.0 * 255.0 * pixels * 3 / sum);
+}
+
+int main(int argc, char **argv)
+{
+    int step = argc > 1 ? atoi(argv[1]) : 10;
+    if (step <= 0 || step > 100)
+    {
+        step = 10;
+    }
+
+    printf("%-6s %-10s %8s %12s %12s %10s\n", "res", "ordre", "reçus %", "PSNR brut",
+           "PSNR comblé", "comblage ms");
+
+    for (size_t r = 0; r < sizeof(resolutions) / sizeof(resolutions[0]); r++)
+    {
+        uint32_t width = resolutions[r].width, height = resolutions[r].height;
+        size_t stride = (size_t)width * 4, bytes = stride * height;
+        uint8_t *image = malloc(bytes), *canvas = malloc(bytes);
+        conceal_map_t map;
+        if (!image || !canvas || conceal_init(&map, PIXEL_FORMAT_BGRX, width, height) < 0)
+        {
+            perror("malloc");
+            return 1;
+        }
+        fill_desktop(image, width, height);
+
+        uint32_t count = map.tiles_x * map.tiles_y;
+        tile_t *tiles = malloc(count * sizeof(*tiles));
+        if (!tiles)
+        {
+            perror("malloc");
+            return 1;
+        }
+
+        for (int interleave = 0; interleave < 2; interleave++)
+        {
+            // Premiers paquets de chaque tuile dans l'ordre d'envoi
+            order_tiles(tiles, count, interleave);
+            uint32_t total = 0;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                uint32_t x0 = (tiles[i].id % map.tiles_x) * map.tile;
+                uint32_t y0 = (tiles[i].id / map.tiles_x) * map.tile;
+                size_t size = (size_t)(width - x0 < map.tile ? width - x0 : map.tile) * 4 *
+                              (height - y0 < map.tile ? height - y0 : map.tile);
+                tiles[i].first = total;
+                total += (size + PACKET_PAYLOAD - 1) / PACKET_PAYLOAD;
+            }
+
+            for (int pct = step; pct <= 100; pct += step)
+            {
+                // Image clé reçue sur un canvas neuf (noir, rien de valide),
+                // coupée après pct % des paquets
+                uint32_t received = (uint64_t)total * pct / 100;
+                memset(canvas, 0, bytes);
+                conceal_free(&map);
+                if (conceal_init(&map, PIXEL_FORMAT_BGRX, width, height) < 0)
+                {
+                    return 1;
+                }
+                conceal_begin(&map);
+                for (uint32_t i = 0; i < count && tiles[i].first < received; i++)
+                {
+                    apply_tile(&map, image, canvas, stride, &tiles[i], received - tiles[i].first);
+                }
+
+                double raw = psnr(image, canvas, (size_t)width * height);
+                double start = now_s();
+                conceal_fill(&map, canvas, stride);
+                double fill_ms = (now_s() - start) * 1e3;
+
+                printf("%-6s %-10s %8d %12.2f %12.2f %10.2f\n", resolutions[r].name,
+                       interleave ? "entrelacé" : "lignes", pct, raw,
+                       psnr(image, canvas, (size_t)width * height), fill_ms);
+            }
+        }
+
+        free(tiles);
+        conceal_free(&map);
+        free(image);
+        free(canvas);
+    }
+    return 0;
+}
@@ -0,0 +1,118 @@
+// Micro-benchmark de la réserve de buffers
+//
+// Coût d'une image pour le serveur : un buffer de la taille de l'image est
+// obtenu, rempli (copie du canvas) puis rendu. Compare malloc/free, qui
+// rend les grands blocs au noyau à chaque fois, et la réserve, et compte
+// les défauts de page par image.
+// Usage : pool_bench [images] [-H]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include "buffer_pool.h"
+
+static const struct {
+    const char *name;
+    uint32_t width, height;
+} resolutions[] = {
+    { "1080p", 1920, 1080 },
+    { "4K",    3840, 2160 },
+};
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long minor_faults(void)
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_minflt;
+}
+
+static void *malloc_alloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void malloc_free(void *ptr, size_t size)
+{
+    (void)size;
+    free(ptr);
+}
+
+static const struct {
+    const char *name;
+    void *(*alloc)(size_t size);
+    void (*free)(void *ptr, size_t size);
+} allocators[] = {
+    { "malloc", malloc_alloc, malloc_free },
+    { "pool",   pool_alloc,   pool_free },
+};
+
+int main(int argc, char **argv)
+{
+    int images = argc > 1 ? atoi(argv[1]) : 100;
+    if (images <= 0)
+    {
+        images = 1;
+    }
+    pool_init(argc > 2 && strcmp(argv[2], "-H") == 0, 0, 0);
+
+    printf("%-6s %-8s %12s %14s %14s\n", "res", "alloc", "us/image", "faults/image",
+           "1re image us");
+
+    for (size_t r = 0; r < sizeof(resolutions) / sizeof(resolutions[0]); r++)
+    {
+        size_t bytes = (size_t)resolutions[r].width * resolutions[r].height * 4;
+        uint8_t *canvas = malloc(bytes);
+        if (!canvas)
+        {
+            perror("malloc");
+            return 1;
+        }
+        memset(canvas, 0x5A, bytes);
+
+        for (size_t a = 0; a < sizeof(allocators) / sizeof(allocators[0]); a++)
+        {
+            double first = 0, t0 = 0;
+            long faults = 0;
+
+            for (int i = 0; i <= images; i++)
+            {
+                // La première image paie la création du buffer : comptée à part
+                if (i == 1)
+                {
+                    t0 = now_s();
+                    faults = minor_faults();
+                }
+                double start = now_s();
+                uint8_t *copy = allocators[a].alloc(bytes);
+                if (!copy)
+                {
+                    return 1;
+                }
+                memcpy(copy, canvas, bytes);
+                allocators[a].free(copy, bytes);
+                if (i == 0)
+                {
+                    first = now_s() - start;
+                }
+            }
+            double elapsed = now_s() - t0;
+            faults = minor_faults() - faults;
+
+            printf("%-6s %-8s %12.1f %14.1f %14.1f\n", resolutions[r].name, allocators[a].name,
+                   elapsed * 1e6 / images, (double)faults / images, first * 1e6);
+        }
+        free(canvas);
+    }
+    pool_report();
+    return 0;
+}
@@ -0,0 +1,151 @@
+// Retransmission arrivée après le début de l'image suivante
+//
+// Rejoue sur les modules de réception un flux d'une tuile 64x64 : l'image 1
+// perd un paquet, l'image 2 arrive complète 16 ms plus tard et reste de
+// côté, puis le paquet perdu arrive renvoyé (NACK). Avec les NACK, il doit
+// encore compléter l'image 1 ; sans, l'image 1 est déjà terminée et il est
+// compté parmi les paquets en retard. Les images enregistrées sont relevées
+// dans la file du writer, sans l'écrire. Le code de sortie est non nul si
+// un scénario échoue.
+// Usage : reorder_check
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "streams.h"
+#include "writer.h"
+#include "metrics.h"
+#include "pixel_format.h"
+#include "buffer_pool.h"
+
+#define WIDTH   64
+#define HEIGHT  64
+#define BYTES   (WIDTH * HEIGHT * 4)
+#define PACKETS ((BYTES + PACKET_PAYLOAD - 1) / PACKET_PAYLOAD)
+#define LOST    3       // Paquet perdu de l'image 1
+#define START_US 1000000 // 0 veut dire « pas d'échéance » pour la table
+
+static void at_ms(stream_table_t *streams, uint64_t ms)
+{
+    streams->now_us = START_US + ms * 1000;
+}
+
+static void send_packet(stream_table_t *streams, uint32_t image, uint32_t seq, uint32_t flags)
+{
+    struct sockaddr_in from = {
+        .sin_family = AF_INET,
+        .sin_port = htons(40000),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK)
+    };
+    struct packet_header hdr = {
+        .image_id = htonl(image),
+        .seq = htonl(seq),
+        .total_packets = htonl(PACKETS),
+        .width = htonl(WIDTH),
+        .height = htonl(HEIGHT),
+        .flags = htonl(flags | PIXEL_FORMAT_BGRX << 4),
+        .stream_id = htonl(1)
+    };
+    struct tile_header th = {
+        .tile_id = htonl(0),
+        .offset = htonl(seq * PACKET_PAYLOAD)
+    };
+    size_t len = BYTES - seq * PACKET_PAYLOAD;
+    if (len > PACKET_PAYLOAD)
+    {
+        len = PACKET_PAYLOAD;
+    }
+
+    char packet[PACKET_SIZE];
+    memcpy(packet, &hdr, sizeof(hdr));
+    memcpy(packet + sizeof(hdr), &th, sizeof(th));
+    memset(packet + sizeof(hdr) + sizeof(th), image, len);
+    process_packet(streams, &from, packet, sizeof(hdr) + sizeof(th) + len);
+}
+
+// Le scénario, le paquet perdu renvoyé à retransmit_ms. Retourne 0 si
+// l'image 1 est complète exactement quand landed est vrai.
+static int run(const char *name, int nack, uint64_t retransmit_ms, int landed)
+{
+    stream_table_t streams;
+    rx_metrics_t stats = { 0 };
+    frame_writer_t writer = { 0 };
+    pthread_mutex_init(&writer.lock, NULL);
+    pthread_cond_init(&writer.room, NULL);
+    pthread_cond_init(&writer.work, NULL);
+
+    stream_table_init(&streams, MAX_STREAMS, MAX_STREAM_MEMORY);
+    streams.writer = &writer;
+    streams.stats = &stats;
+    if (nack)
+    {
+        stream_table_nack(&streams);
+    }
+
+    // Image 1 sans son paquet LOST, puis l'image 2 complète
+    at_ms(&streams, 0);
+    for (uint32_t seq = 0; seq < PACKETS; seq++)
+    {
+        if (seq != LOST)
+        {
+            send_packet(&streams, 1, seq, FRAME_FLAG_KEYFRAME);
+        }
+    }
+    at_ms(&streams, 16);
+    for (uint32_t seq = 0; seq < PACKETS; seq++)
+    {
+        send_packet(&streams, 2, seq, 0);
+    }
+
+    // La boucle des workers examine les échéances en attendant
+    for (uint64_t ms = 16; ms < retransmit_ms; ms += NACK_INTERVAL_MS)
+    {
+        at_ms(&streams, ms);
+        expire_frames(&streams, streams.now_us);
+    }
+    at_ms(&streams, retransmit_ms);
+    send_packet(&streams, 1, LOST, FRAME_FLAG_KEYFRAME | PACKET_FLAG_RETRANSMIT);
+    expire_frames(&streams, streams.now_us);
+    close_all_streams(&streams);
+
+    // Images enregistrées, dans l'ordre
+    int errors = 0;
+    uint32_t expected = 1;
+    const char *first = "";
+    write_job_t *next;
+    for (write_job_t *job = writer.head; job; job = next)
+    {
+        next = job->next;
+        if (job->image_id != expected++)
+        {
+            errors++;
+        }
+        if (job->image_id == 1)
+        {
+            int complete = strstr(job->details, "100.0% complete") != NULL;
+            first = complete ? "complete" : "incomplete";
+            errors += complete != landed;
+        }
+        pool_free(job->pixels, job->bytes);
+        free(job);
+    }
+    errors += expected != 3;
+    errors += (stats.stale != 0) == landed;
+
+    printf("reorder_check %s: retransmission at %llu ms, image 1 %s, stale=%llu: %s\n", name,
+           (unsigned long long)retransmit_ms, first, (unsigned long long)stats.stale,
+           errors ? "FAILED" : "ok");
+    return errors;
+}
+
+int main(void)
+{
+    int errors = 0;
+
+    // 54 ms après le début de l'image 2 : après la première relance d'un
+    // NACK, bien avant NACK_DEADLINE_MS
+    errors += run("nack", 1, 70, 1);
+    errors += run("no-nack", 0, 70, 0);
+    return errors != 0;
+}
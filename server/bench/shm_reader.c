@@ -0,0 +1,165 @@
+// Lecteur de la mémoire partagée du serveur (option -F)
+//
+// Attend chaque nouvelle image, la lit sur place (somme de ses octets, sans
+// copie) et vérifie qu'elle n'a pas changé pendant la lecture. Mesure le
+// délai entre la fin de l'image côté serveur et sa publication, puis entre
+// sa publication et le réveil du lecteur. S'arrête quand le serveur ferme
+// la zone, ou au bout de la durée donnée.
+// Usage : shm_reader /nom [secondes]
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include "frame_shm.h"
+
+#define MAX_SAMPLES 65536
+
+static uint64_t monotonic_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static uint64_t percentile(uint64_t *values, unsigned count, double p)
+{
+    if (!count)
+    {
+        return 0;
+    }
+    qsort(values, count, sizeof(*values), compare_u64);
+    unsigned rank = p * count;
+    return values[rank < count ? rank : count - 1];
+}
+
+// Attend une image plus récente que seen (100 ms au plus)
+static void wait_frame(frame_shm_header_t *hdr, uint32_t seen)
+{
+    struct timespec timeout = { 0, 100 * 1000000 };
+
+    __atomic_add_fetch(&hdr->waiters, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&hdr->generation, __ATOMIC_SEQ_CST) == seen &&
+        !__atomic_load_n(&hdr->closed, __ATOMIC_SEQ_CST))
+    {
+        syscall(SYS_futex, &hdr->generation, FUTEX_WAIT, seen, &timeout, NULL, 0);
+    }
+    __atomic_sub_fetch(&hdr->waiters, 1, __ATOMIC_SEQ_CST);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s /name [seconds]\n", argv[0]);
+        return 1;
+    }
+    double duration = argc > 2 ? atof(argv[2]) : 0;
+
+    // Le serveur crée la zone à son démarrage : on l'attend
+    int fd;
+    while ((fd = shm_open(argv[1], O_RDWR, 0)) < 0 && errno == ENOENT)
+    {
+        usleep(10000);
+    }
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(frame_shm_header_t))
+    {
+        perror(argv[1]);
+        return 1;
+    }
+    frame_shm_header_t *hdr = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (hdr == MAP_FAILED)
+    {
+        perror("mmap");
+        return 1;
+    }
+    while (__atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) != FRAME_SHM_MAGIC)
+    {
+        usleep(1000);
+    }
+    if (hdr->version != FRAME_SHM_VERSION)
+    {
+        fprintf(stderr, "%s: version %u, expected %u\n", argv[1], hdr->version,
+                FRAME_SHM_VERSION);
+        return 1;
+    }
+
+    static uint64_t publish_us[MAX_SAMPLES], wake_us[MAX_SAMPLES];
+    unsigned samples = 0;
+    unsigned long long frames = 0, missed = 0, torn = 0, incomplete = 0;
+    uint64_t sum = 0;
+    uint64_t start = monotonic_us();
+    uint32_t seen = __atomic_load_n(&hdr->generation, __ATOMIC_ACQUIRE);
+
+    while (!__atomic_load_n(&hdr->closed, __ATOMIC_ACQUIRE) &&
+           (!duration || monotonic_us() - start < duration * 1e6))
+    {
+        uint32_t generation = __atomic_load_n(&hdr->generation, __ATOMIC_ACQUIRE);
+        if (generation == seen)
+        {
+            wait_frame(hdr, seen);
+            continue;
+        }
+        uint64_t woken = monotonic_us();
+
+        // Lecture de la place sur place, recommencée si le serveur l'a
+        // réécrite entre-temps
+        const frame_shm_slot_t *slot = frame_shm_slot(hdr, generation);
+        uint32_t seq = frame_shm_read_begin(slot);
+        frame_shm_slot_t meta = *slot;
+        uint64_t bytes = meta.bytes < hdr->capacity ? meta.bytes : hdr->capacity;
+        const uint8_t *pixels = frame_shm_pixels(slot);
+        uint64_t checksum = 0;
+        for (uint64_t i = 0; i < bytes; i += 64)
+        {
+            checksum += pixels[i];
+        }
+        if (!frame_shm_read_valid(slot, seq) || meta.generation != generation)
+        {
+            torn++;
+            continue;
+        }
+
+        sum += checksum;
+        frames++;
+        missed += generation - seen - 1;
+        seen = generation;
+        if (meta.flags & FRAME_SHM_INCOMPLETE)
+        {
+            incomplete++;
+        }
+        if (meta.complete_us && samples < MAX_SAMPLES)
+        {
+            publish_us[samples] = meta.published_us - meta.complete_us;
+            wake_us[samples] = woken > meta.published_us ? woken - meta.published_us : 0;
+            samples++;
+        }
+    }
+
+    printf("shm_reader frames=%llu missed=%llu torn=%llu incomplete=%llu "
+           "publish_p50_us=%llu publish_p99_us=%llu wake_p50_us=%llu wake_p99_us=%llu "
+           "checksum=%llu\n",
+           frames, missed, torn, incomplete,
+           (unsigned long long)percentile(publish_us, samples, 0.5),
+           (unsigned long long)percentile(publish_us, samples, 0.99),
+           (unsigned long long)percentile(wake_us, samples, 0.5),
+           (unsigned long long)percentile(wake_us, samples, 0.99),
+           (unsigned long long)sum);
+    munmap(hdr, st.st_size);
+    return 0;
+}
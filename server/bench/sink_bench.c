@@ -0,0 +1,219 @@
+// Micro-benchmark des formats de sortie
+//
+// Mesure chaque noyau de conversion BGRx -> RGB, puis l'enregistrement
+// d'une image complète dans chaque format (et avec l'ancienne écriture PPM
+// par fputc, pour comparaison) sur un faux bureau et sur du bruit. Les
+// fichiers sont écrits dans un memfd : le coût de l'écriture est compté,
+// pas celui du disque.
+// Usage : sink_bench [iterations]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include "sink.h"
+
+static const struct {
+    const char *name;
+    uint32_t width, height;
+} resolutions[] = {
+    { "1080p", 1920, 1080 },
+    { "4K",    3840, 2160 },
+};
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t next_random(uint64_t *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1Dull;
+}
+
+static void fill_rect(uint8_t *img, uint32_t width, uint32_t x0, uint32_t y0,
+                      uint32_t w, uint32_t h, uint32_t bgrx)
+{
+    for (uint32_t y = y0; y < y0 + h; y++)
+    {
+        uint32_t *row = (uint32_t *)(img + (size_t)y * width * 4) + x0;
+        for (uint32_t x = 0; x < w; x++)
+        {
+            row[x] = bgrx;
+        }
+    }
+}
+
+// Faux bureau : dégradé de fond, fenêtres claires et lignes de "texte"
+static void draw_desktop(uint8_t *img, uint32_t width, uint32_t height)
+{
+    uint64_t state = 0x5EED5EEDull;
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        uint8_t shade = 40 + (uint8_t)(80u * y / height);
+        fill_rect(img, width, 0, y, width, 1,
+                  0xFF000000u | (shade + 40) | (shade << 8) | ((shade / 2u) << 16));
+    }
+    for (int i = 0; i < 6; i++)
+    {
+        uint32_t w = width / 4 + next_random(&state) % (width / 3);
+        uint32_t h = height / 4 + next_random(&state) % (height / 3);
+        uint32_t x = next_random(&state) % (width - w);
+        uint32_t y = next_random(&state) % (height - h);
+
+        fill_rect(img, width, x, y, w, h / 16, 0xFF303030u);
+        fill_rect(img, width, x, y + h / 16, w, h - h / 16, 0xFFF4F4F4u);
+        for (uint32_t ty = y + h / 16 + 4; ty + 10 < y + h; ty += 16)
+        {
+            for (uint32_t tx = x + 6; tx + 8 < x + w; tx += 7)
+            {
+                if (next_random(&state) % 5)
+                {
+                    fill_rect(img, width, tx, ty, 5, 9, 0xFF202020u);
+                }
+            }
+        }
+    }
+}
+
+static void draw_noise(uint8_t *img, uint32_t width, uint32_t height)
+{
+    uint64_t state = 1;
+    for (size_t i = 0; i < (size_t)width * height; i++)
+    {
+        ((uint32_t *)img)[i] = (uint32_t)next_random(&state) | 0xFF000000u;
+    }
+}
+
+// L'ancienne sauvegarde : trois fputc par pixel
+static int stdio_write(const frame_image_t *img, int fd)
+{
+    FILE *f = fdopen(dup(fd), "wb");
+    if (!f)
+    {
+        return -1;
+    }
+    fprintf(f, "P6 %u %u 255\n", img->width, img->height);
+    for (uint32_t y = 0; y < img->height; y++)
+    {
+        const uint8_t *row = img->pixels + y * img->stride;
+        for (uint32_t x = 0; x < img->width; x++)
+        {
+            fputc(row[4 * x + 2], f);
+            fputc(row[4 * x + 1], f);
+            fputc(row[4 * x + 0], f);
+        }
+    }
+    return fclose(f);
+}
+
+// Temps moyen d'un enregistrement en millisecondes, et taille du fichier.
+// Sans format, c'est l'ancienne sauvegarde qui est mesurée.
+static double run_sink(const frame_sink_t *sink, const frame_image_t *img, int fd,
+                       int iterations, off_t *size)
+{
+    double total = 0;
+
+    for (int i = 0; i < iterations; i++)
+    {
+        if (ftruncate(fd, 0) < 0 || lseek(fd, 0, SEEK_SET) < 0)
+        {
+            perror("ftruncate");
+            return -1;
+        }
+        double t0 = now_s();
+        if ((sink ? sink_write(sink, img, fd) : stdio_write(img, fd)) < 0)
+        {
+            return -1;
+        }
+        total += now_s() - t0;
+    }
+    *size = lseek(fd, 0, SEEK_END);
+    return total * 1000.0 / iterations;
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 5;
+    if (iterations <= 0)
+    {
+        iterations = 1;
+    }
+
+    sink_init();
+    int fd = memfd_create("sink_bench", 0);
+    if (fd < 0)
+    {
+        perror("memfd_create");
+        return 1;
+    }
+
+    // Conversion seule, sur une ligne 4K qui tient dans le cache
+    unsigned nb_kernels;
+    const swizzle_kernel_t *kernels = swizzle_kernels(&nb_kernels);
+    static uint8_t line[3840 * 4], rgb[3840 * 3];
+    memset(line, 0x5A, sizeof(line));
+
+    printf("%-10s %10s\n", "noyau", "Gpix/s");
+    for (unsigned k = 0; k < nb_kernels; k++)
+    {
+        double t0 = now_s();
+        for (int i = 0; i < 20000; i++)
+        {
+            kernels[k].bgrx_to_rgb(line, rgb, 3840);
+        }
+        printf("%-10s %10.2f\n", kernels[k].name, 3840.0 * 20000 / (now_s() - t0) / 1e9);
+    }
+
+    static const frame_sink_t *const sinks[] = { NULL, &ppm_sink, &qoi_sink, &png_sink };
+    printf("\n%-6s %-8s %-10s %10s %10s %10s (%u coeurs)\n", "res", "contenu", "format",
+           "ms/image", "Mpix/s", "Mo", sink_cores());
+
+    for (size_t r = 0; r < sizeof(resolutions) / sizeof(resolutions[0]); r++)
+    {
+        uint32_t w = resolutions[r].width, h = resolutions[r].height;
+        uint8_t *pixels = malloc((size_t)w * h * 4);
+        if (!pixels)
+        {
+            perror("malloc");
+            return 1;
+        }
+
+        for (int content = 0; content < 2; content++)
+        {
+            if (content == 0)
+            {
+                draw_desktop(pixels, w, h);
+            }
+            else
+            {
+                draw_noise(pixels, w, h);
+            }
+            frame_image_t img = { .width = w, .height = h, .pixels = pixels, .stride = (size_t)w * 4 };
+
+            for (size_t s = 0; s < sizeof(sinks) / sizeof(sinks[0]); s++)
+            {
+                off_t size = 0;
+                double ms = run_sink(sinks[s], &img, fd, iterations, &size);
+                if (ms < 0)
+                {
+                    return 1;
+                }
+                printf("%-6s %-8s %-10s %10.2f %10.1f %10.2f\n", resolutions[r].name,
+                       content ? "bruit" : "bureau", sinks[s] ? sinks[s]->name : "ppm-stdio", ms,
+                       (double)w * h / ms / 1e3, size / 1e6);
+            }
+        }
+        free(pixels);
+    }
+    close(fd);
+    return 0;
+}
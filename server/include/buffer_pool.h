@@ -0,0 +1,30 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <stddef.h>
+
+// Réserve de grands buffers (canvas, copies d'images, fichiers encodés)
+// partagée par tous les threads. Les buffers sont des mappings anonymes
+// alignés sur POOL_ALIGN, en pages énormes transparentes (ou MAP_HUGETLB),
+// dont les pages sont touchées à la création : rendus à la réserve plutôt
+// qu'au noyau, ils resservent d'une image à l'autre sans défaut de page ni
+// remise à zéro. Leur contenu n'est pas effacé entre deux utilisations.
+#define POOL_ALIGN      (2UL * 1024 * 1024) // Taille d'une page énorme x86-64
+#define POOL_MIN_SIZE   (256UL * 1024)      // En dessous : malloc ordinaire
+#define POOL_MAX_FREE   64                  // Buffers gardés en réserve
+#define POOL_MAX_CACHED (1024UL * 1024 * 1024) // Octets gardés en réserve
+
+// Choisit MAP_HUGETLB (pages réservées par vm.nr_hugepages) ou les pages
+// énormes transparentes, puis prépare count buffers de size octets
+void pool_init(int hugetlb, size_t size, unsigned count);
+
+// Buffer d'au moins size octets, aligné sur 4096. NULL en cas d'erreur.
+void *pool_alloc(size_t size);
+
+// Rend un buffer ; size est celle passée à pool_alloc
+void pool_free(void *ptr, size_t size);
+
+// Affiche l'usage de la réserve et les défauts de page du processus
+void pool_report(void);
+
+#endif // BUFFER_POOL_H
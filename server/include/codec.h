@@ -0,0 +1,22 @@
+#ifndef CODEC_H
+#define CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Compression des tuiles, annoncée par l'émetteur dans les drapeaux de
+// l'image (FRAME_CODEC). Chaque tuile est compressée seule : elle est
+// décompressée dans le canvas dès que ses paquets sont tous arrivés.
+#define TILE_CODEC_NONE 0
+#define TILE_CODEC_LZ4  1
+#define TILE_CODEC_ZSTD 2
+#define TILE_CODECS     3
+
+const char *codec_name(uint32_t codec);
+
+// Décompresse len octets de src dans dst. Retourne la taille décompressée,
+// 0 si les données sont invalides ou ne tiennent pas dans capacity octets.
+size_t codec_decompress(uint32_t codec, const uint8_t *src, size_t len,
+                        uint8_t *dst, size_t capacity);
+
+#endif // CODEC_H
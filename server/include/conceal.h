@@ -0,0 +1,70 @@
+#ifndef CONCEAL_H
+#define CONCEAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "packet.h"
+
+// Dissimulation des pertes : pour chaque tuile du canvas, les lignes de
+// blocs dont le contenu est à jour. Une tuile touchée par l'image en cours
+// ne garde que les lignes reçues entières pour cette image ; les autres
+// mélangeraient deux images. Une image incomplète peut alors être comblée
+// à partir des lignes valides voisines.
+#define CONCEAL_ROWS TILE_SIZE // Lignes de blocs d'une tuile, au plus
+
+typedef struct conceal_map {
+    uint32_t format; // PIXEL_FORMAT_* du canvas
+    uint32_t width, height; // En blocs
+    uint32_t tile; // Côté d'une tuile en blocs
+    uint32_t tiles_x, tiles_y;
+    uint32_t frame; // Numéro de l'image en cours (0 avant la première)
+    uint64_t *valid; // Bit r : ligne r de la tuile valide
+    uint16_t *filled; // Octets reçus de chaque ligne pour l'image en cours
+    uint32_t *stamp; // Dernière image qui a touché chaque tuile
+} conceal_map_t;
+
+// Mémoire utilisée pour un canvas width x height
+size_t conceal_size(uint32_t format, uint32_t width, uint32_t height);
+
+// Prépare la carte d'un nouveau canvas : aucune ligne valide. Retourne -1
+// en cas d'erreur.
+int conceal_init(conceal_map_t *m, uint32_t format, uint32_t width, uint32_t height);
+void conceal_free(conceal_map_t *m);
+
+// Début d'une nouvelle image
+static inline void conceal_begin(conceal_map_t *m)
+{
+    if (!++m->frame)
+    {
+        memset(m->stamp, 0, (size_t)m->tiles_x * m->tiles_y * sizeof(*m->stamp));
+        m->frame = 1;
+    }
+}
+
+// bytes octets de la ligne row (row_bytes octets) de la tuile reçus
+static inline void conceal_received(conceal_map_t *m, uint32_t tile, size_t row, size_t bytes,
+                                    size_t row_bytes)
+{
+    uint16_t *filled = m->filled + (size_t)tile * CONCEAL_ROWS;
+
+    if (m->stamp[tile] != m->frame)
+    {
+        m->stamp[tile] = m->frame;
+        m->valid[tile] = 0;
+        memset(filled, 0, CONCEAL_ROWS * sizeof(*filled));
+    }
+    filled[row] += bytes;
+    if (filled[row] >= row_bytes)
+    {
+        m->valid[tile] |= 1ULL << row;
+    }
+}
+
+// Comble les lignes invalides du canvas : interpolation entre les lignes
+// valides les plus proches au-dessus et au-dessous dans la même colonne de
+// tuiles, puis, pour les colonnes sans aucune ligne valide, entre les
+// colonnes voisines. Retourne le nombre de tuiles comblées.
+uint32_t conceal_fill(const conceal_map_t *m, uint8_t *canvas, size_t stride);
+
+#endif // CONCEAL_H
@@ -1,10 +1,43 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
-#define PORT             8080
+#define PORT             8080   // Port par défaut (option -P)
+
+// Taille d'un datagramme, la même que celle du client. Peut être changée à
+// la compilation (-DPACKET_SIZE=1400) pour comparer plusieurs tailles.
+#ifndef PACKET_SIZE
 #define PACKET_SIZE      1000
+#endif
+#if PACKET_SIZE < 128 || PACKET_SIZE > 8192
+#error "PACKET_SIZE must be between 128 and 8192"
+#endif
 #define PIXEL_BYTES      4
-#define RECV_BUFFERS     1000
+#define RECV_BUFFERS     1024  // Puissance de 2 (ring de buffers fournis)
+#define GRO_BUFFERS      256
+#define GRO_BUFFER_SIZE  65536
+#define RX_BUFFER_GROUP  0
+#define RX_CQ_ENTRIES    4096
+#define RX_CQE_BATCH     256
 #define SHUTDOWN_TIMEOUT 1
+#define MAX_DIMENSION    8192
+#define MAX_STREAMS      64     // Flux reçus simultanément
+#define STREAM_BUCKETS   256    // Puissance de 2 (table de hachage des flux)
+#define STREAM_IDLE_TIMEOUT 2   // Un flux muet depuis N sec est sauvé et libéré
+#define MAX_STREAM_MEMORY (1024UL * 1024 * 1024) // Canvas + masques de tous les flux
+#define NACK_INTERVAL_MS 5      // Fréquence d'examen des images incomplètes
+#define NACK_RETRY_MS    40     // Délai avant de redemander les mêmes paquets
+#define NACK_DEADLINE_MS 200    // Au-delà, les paquets manquants sont abandonnés
+#define FRAME_TIMEOUT_MS 50     // Image incomplète sans nouveau paquet depuis N ms : terminée
+#define REORDER_WINDOW   4      // Images d'un flux en cours à la fois (la courante et les suivantes)
+#define REORDER_BYTES    (4UL * 1024 * 1024) // Paquets des images suivantes gardés par flux
+#define REORDER_TIMEOUT_MS 20   // Attente des paquets manquants une fois l'image suivante arrivée
+#define NACK_RTT_MARGIN_MS 20   // Aller-retour d'une demande de retransmission, au plus
+#define REORDER_RESYNC   1024   // Recul d'ID au-delà duquel l'émetteur a recommencé sa numérotation
+#define REPORT_BACKLOG   4      // Bilans d'image en attente d'envoi, par flux
+#define WRITER_QUEUE     8      // Images en attente d'enregistrement (au-delà : perdues)
+#define WRITER_DEPTH     4      // Écritures de fichiers en cours à la fois
+#define FRAME_SHM_SLOTS  3      // Images gardées en mémoire partagée (option -F)
+#define FRAME_SHM_WIDTH  1920   // Taille des places sans -R
+#define FRAME_SHM_HEIGHT 1080
 
 #endif // CONFIG_H
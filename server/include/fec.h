@@ -0,0 +1,35 @@
+#ifndef FEC_H
+#define FEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "packet.h"
+#include "reception.h"
+
+struct stream_table;
+
+// Correction d'erreurs : l'émetteur ajoute des paquets de parité après
+// chaque groupe de k paquets de données (Reed-Solomon systématique à
+// matrice de Cauchy sur GF(2^8), première parité = XOR). Tant qu'aucun
+// paquet n'est perdu, les parités sont ignorées ; sinon un groupe est
+// reconstruit dès qu'il a reçu autant de parités que de pertes.
+#define FEC_MAX_K       128  // Limite des coefficients de la matrice
+#define FEC_MAX_LOST    32   // Pertes reconstruites au plus par groupe
+#define FEC_MAX_PENDING 64   // Parités gardées par flux (plein : le plus ancien groupe part)
+
+// Parité d'un groupe encore incomplet
+typedef struct fec_parity {
+    uint32_t first; // Premier paquet du groupe
+    uint32_t index; // Numéro de la parité dans le groupe
+    int used;
+    uint8_t symbol[FEC_SYMBOL];
+} fec_parity_t;
+
+int fec_begin_image(struct stream_table *streams, reception_state_t *rx);
+void fec_free(reception_state_t *rx);
+uint8_t fec_coef(unsigned j, unsigned i);
+void fec_parity_received(reception_state_t *rx, uint32_t first, uint32_t index,
+                         const uint8_t *symbol, size_t len);
+void fec_data_received(reception_state_t *rx, uint32_t seq);
+
+#endif // FEC_H
@@ -0,0 +1,106 @@
+#ifndef FRAME_SHM_H
+#define FRAME_SHM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+// Dernières images reçues, publiées en mémoire partagée (shm_open) pour les
+// lecteurs locaux : visionneuse, enregistreur... Ce fichier décrit aussi le
+// format de la zone pour ces lecteurs.
+//
+// La zone commence par un frame_shm_header_t, suivi de slots places de
+// slot_size octets. Chaque image publiée reçoit un numéro de publication
+// (generation, à partir de 1) et va dans la place generation % slots : la
+// plus récente reste intacte pendant les slots - 1 publications suivantes.
+//
+// Lecture sans appel système : lire generation, puis la place
+// correspondante entre frame_shm_read_begin et frame_shm_read_valid
+// (verrou de séquence). Si l'image a changé pendant la lecture, on
+// recommence avec la nouvelle generation. Pour attendre une image, un
+// lecteur incrémente waiters, vérifie generation et closed, dort sur
+// generation (futex FUTEX_WAIT non privé, avec un délai : l'arrêt du serveur
+// ne change pas generation) puis décrémente waiters.
+#define FRAME_SHM_MAGIC   0x53534631 // "SSF1"
+#define FRAME_SHM_VERSION 1
+#define FRAME_SHM_ALIGN   64 // Alignement des en-têtes et des pixels
+
+// Drapeaux d'une image publiée
+#define FRAME_SHM_KEYFRAME   0x1 // Image clé
+#define FRAME_SHM_INCOMPLETE 0x2 // Des paquets manquent : tuiles de l'image précédente
+#define FRAME_SHM_UNSYNCED   0x4 // Pas encore d'image clé complète dans ce flux
+
+typedef struct frame_shm_header {
+    uint32_t magic; // FRAME_SHM_MAGIC, écrit en dernier à la création
+    uint32_t version;
+    uint32_t slots; // Nombre de places
+    uint32_t closed; // Le serveur s'est arrêté
+    uint64_t slot_size; // Octets d'une place, en-tête compris
+    uint64_t capacity; // Octets de pixels que peut contenir une place
+    uint32_t generation; // Dernière image publiée (0 = aucune), mot du futex
+    uint32_t waiters; // Lecteurs endormis sur generation
+} __attribute__((aligned(FRAME_SHM_ALIGN))) frame_shm_header_t;
+
+// En-tête d'une place, suivi des pixels (FRAME_SHM_ALIGN octets plus loin)
+typedef struct frame_shm_slot {
+    uint32_t seq; // Verrou de séquence : impair pendant l'écriture
+    uint32_t generation; // Numéro de publication de l'image
+    uint32_t stream; // Numéro du flux (celui des fichiers)
+    uint32_t image_id;
+    uint32_t width, height;
+    uint32_t format; // PIXEL_FORMAT_* (pixel_format.h), pixels tels que reçus
+    uint32_t flags; // FRAME_SHM_*
+    uint64_t stride; // Octets d'une ligne de blocs
+    uint64_t bytes; // Octets de pixels
+    uint64_t complete_us; // Image complète (CLOCK_MONOTONIC), 0 si incomplète
+    uint64_t published_us; // Image visible des lecteurs (CLOCK_MONOTONIC)
+} __attribute__((aligned(FRAME_SHM_ALIGN))) frame_shm_slot_t;
+
+static inline frame_shm_slot_t *frame_shm_slot(const frame_shm_header_t *hdr, uint32_t generation)
+{
+    return (frame_shm_slot_t *)((uint8_t *)hdr + sizeof(*hdr) +
+                                (generation % hdr->slots) * hdr->slot_size);
+}
+
+static inline const uint8_t *frame_shm_pixels(const frame_shm_slot_t *slot)
+{
+    return (const uint8_t *)(slot + 1);
+}
+
+// Début d'une lecture : à passer à frame_shm_read_valid (impair = en
+// cours d'écriture, lire une autre place)
+static inline uint32_t frame_shm_read_begin(const frame_shm_slot_t *slot)
+{
+    return __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+}
+
+// Vrai si rien n'a été écrit dans la place depuis frame_shm_read_begin
+static inline int frame_shm_read_valid(const frame_shm_slot_t *slot, uint32_t seq)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return !(seq & 1) && __atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == seq;
+}
+
+// Côté serveur : une zone partagée par tous les workers, qui publient
+// chacun leur tour
+typedef struct frame_publisher {
+    const char *name; // Nom shm_open (supprimé à l'arrêt)
+    frame_shm_header_t *hdr;
+    size_t map_size;
+    pthread_mutex_t lock; // Un seul worker écrit à la fois
+} frame_publisher_t;
+
+// Crée la zone name de slots places pouvant contenir width x height
+// pixels BGRx (le plus gros format). Retourne -1 en cas d'erreur.
+int publisher_start(frame_publisher_t *pub, const char *name, unsigned slots,
+                    uint32_t width, uint32_t height);
+
+// Copie l'image décrite par meta dans la place suivante et réveille les
+// lecteurs. Remplit generation et published_us de meta. Retourne -1 si elle
+// ne tient pas dans une place.
+int publisher_publish(frame_publisher_t *pub, frame_shm_slot_t *meta, const uint8_t *pixels);
+
+// Marque la zone fermée, réveille les lecteurs et la supprime
+void publisher_stop(frame_publisher_t *pub);
+
+#endif // FRAME_SHM_H
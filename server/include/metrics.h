@@ -0,0 +1,91 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define METRICS_BUCKETS 32
+
+// Histogramme par puissances de 2 : le seau i compte les valeurs de
+// [2^(i-1), 2^i[, le seau 0 les valeurs nulles
+typedef struct metrics_hist {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t buckets[METRICS_BUCKETS];
+} metrics_hist_t;
+
+// Compteurs d'un worker. Un seul thread les écrit (celui du worker), sans
+// verrou ni instruction atomique coûteuse. Le thread principal les relève
+// pendant la réception. Il n'y a que des uint64_t : les relevés des workers
+// s'additionnent champ par champ.
+typedef struct rx_metrics {
+    uint64_t datagrams; // Paquets reçus
+    uint64_t bytes; // Octets de ces paquets
+    uint64_t completions; // Complétions io_uring
+    uint64_t batches; // Lots de complétions traités
+    uint64_t rearms; // Requêtes multishot relancées
+    uint64_t no_buffers; // Plus de buffer fourni libre (ENOBUFS)
+    uint64_t socket_drops; // Jetés par le noyau, buffer de la socket plein (SO_RXQ_OVFL)
+    uint64_t duplicates; // Paquets déjà reçus
+    uint64_t stale; // Paquets arrivés après l'enregistrement de leur image (hors parités)
+    uint64_t nacks; // NACK envoyés
+    uint64_t reports; // Bilans d'image envoyés
+    uint64_t images; // Images terminées
+    uint64_t incomplete; // Dont images avec des paquets manquants
+    uint64_t lost; // Paquets manquants de ces images
+    uint64_t streams; // Flux ouverts (jauge)
+    uint64_t published; // Images publiées en mémoire partagée
+    uint64_t publish_skipped; // Images trop grandes pour ses places
+    uint64_t concealed; // Images incomplètes comblées par interpolation
+    uint64_t held; // Paquets d'images suivantes mis de côté puis rejoués
+    uint64_t held_expired; // Images terminées incomplètes faute de paquets à temps
+    uint64_t expired; // Images terminées incomplètes, plus aucun paquet depuis FRAME_TIMEOUT_MS
+    metrics_hist_t batch; // Complétions par lot
+    metrics_hist_t reassembly_us; // Du premier paquet d'une image à son enregistrement
+    metrics_hist_t publish_us; // Du dernier paquet d'une image à sa publication
+} rx_metrics_t;
+
+// Mise à jour par le seul thread propriétaire du compteur : une lecture et
+// une écriture simples, que le thread principal peut lire à tout moment
+#define METRIC_ADD(field, n) \
+    __atomic_store_n(&(field), (field) + (n), __ATOMIC_RELAXED)
+#define METRIC_SET(field, v) \
+    __atomic_store_n(&(field), (v), __ATOMIC_RELAXED)
+
+static inline void metrics_hist_add(metrics_hist_t *h, uint64_t value)
+{
+    unsigned b = value ? 64 - __builtin_clzll(value) : 0;
+    if (b >= METRICS_BUCKETS)
+    {
+        b = METRICS_BUCKETS - 1;
+    }
+    METRIC_ADD(h->count, 1);
+    METRIC_ADD(h->sum, value);
+    METRIC_ADD(h->buckets[b], 1);
+}
+
+uint64_t metrics_hist_percentile(const metrics_hist_t *h, double p);
+
+struct worker;
+struct frame_writer;
+
+// Relevés du serveur : ligne périodique (-m) et socket Unix (-M) qui donne
+// l'état courant à chaque connexion
+typedef struct metrics_reporter {
+    struct worker *workers;
+    unsigned nb_workers;
+    struct frame_writer *writer;
+    unsigned interval; // Période de la ligne « metrics » en secondes (0 = aucune)
+    const char *path; // Socket Unix (NULL = aucune)
+    int listen_fd;
+    uint64_t start_us;
+    uint64_t last_us; // Dernière ligne périodique
+    rx_metrics_t last; // Et ses compteurs, pour les débits
+} metrics_reporter_t;
+
+int metrics_start(metrics_reporter_t *mr, struct worker *workers, unsigned nb_workers,
+                  struct frame_writer *writer, unsigned interval, const char *path);
+void metrics_wait(metrics_reporter_t *mr, int timeout_ms);
+void metrics_stop(metrics_reporter_t *mr);
+
+#endif // METRICS_H
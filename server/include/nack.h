@@ -0,0 +1,17 @@
+#ifndef NACK_H
+#define NACK_H
+
+#include <stdint.h>
+#include "streams.h"
+
+// Examine les images incomplètes de tous les flux de la table et envoie à
+// chaque émetteur, par la socket sock, les plages de paquets manquants.
+// Retourne le nombre de NACK envoyés et note dans streams->nack_due_us
+// l'heure du prochain examen utile.
+unsigned send_nacks(stream_table_t *streams, int sock, uint64_t now_ms);
+
+// Envoie aux émetteurs les bilans d'image prêts (pertes et étalement des
+// arrivées), qui règlent leur débit. Retourne le nombre de bilans envoyés.
+unsigned send_reports(stream_table_t *streams, int sock);
+
+#endif // NACK_H
@@ -0,0 +1,24 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <stdint.h>
+
+// Options de la ligne de commande du serveur
+typedef struct server_options {
+    uint16_t port; // Port UDP d'écoute
+    int gro; // Recevoir les paquets regroupés par le noyau (UDP_GRO)
+    unsigned workers; // Threads de réception (0 = un par coeur)
+    int pin; // Épingler chaque thread sur un coeur
+    int nack; // Redemander les paquets perdus aux émetteurs
+    const struct frame_sink *sink; // Format des images enregistrées
+    int direct; // Écrire les images en O_DIRECT
+    int hugetlb; // Buffers d'images en pages énormes réservées (MAP_HUGETLB)
+    uint32_t prefault_width, prefault_height; // Résolution attendue (0 = aucune)
+    unsigned metrics_interval; // Période de la ligne « metrics » en secondes (0 = aucune)
+    const char *metrics_socket; // Socket Unix des statistiques (NULL = aucune)
+    const char *shm_name; // Mémoire partagée des dernières images (NULL = aucune)
+} server_options_t;
+
+int parse_options(int argc, char **argv, server_options_t *opts);
+
+#endif // OPTIONS_H
@@ -2,6 +2,39 @@
 #define PACKET_H
 
 #include <stdint.h>
+#include "config.h"
+
+// Côté d'une tuile en pixels (les tuiles du bord droit/bas peuvent être
+// plus petites), soit TILE_SIZE / 2 blocs en 4:2:0
+#define TILE_SIZE 64
+
+// Plus grande tuile : TILE_SIZE x TILE_SIZE pixels BGRx (les autres formats
+// sont plus compacts)
+#define TILE_MAX_BYTES (TILE_SIZE * TILE_SIZE * PIXEL_BYTES)
+
+// Drapeaux d'une image (champ flags)
+#define FRAME_FLAG_KEYFRAME (1u << 0)   // Toutes les tuiles sont présentes
+
+// Seuls les 8 bits de poids faible décrivent l'image
+#define FRAME_FLAGS_MASK 0xFFu
+
+// Format des pixels de l'image (PIXEL_FORMAT_*), bits 4 à 7
+#define FRAME_FORMAT(flags) (((flags) >> 4) & 0xFu)
+
+// Compression des tuiles de l'image (TILE_CODEC_*), bits 2 et 3
+#define FRAME_CODEC(flags) (((flags) >> 2) & 0x3u)
+
+// Paquet renvoyé par le client suite à un NACK
+#define PACKET_FLAG_RETRANSMIT (1u << 8)
+
+// Paquet de parité : seq est le premier paquet de son groupe, les données
+// sont la parité des tile_header et des pixels des paquets du groupe
+#define PACKET_FLAG_PARITY     (1u << 9)
+
+// Taille des groupes de correction d'erreurs (0 = aucune), et numéro d'une
+// parité dans son groupe
+#define PACKET_FEC_K(flags)     ((flags) >> 24)
+#define PACKET_FEC_INDEX(flags) (((flags) >> 16) & 0xFFu)
 
 struct packet_header {
     uint32_t image_id;
@@ -9,6 +42,57 @@ struct packet_header {
     uint32_t total_packets;
     uint32_t width;
     uint32_t height;
+    uint32_t flags;
+    uint32_t stream_id;    // Flux de l'émetteur (un par écran par exemple)
+};
+
+// Suit le packet_header : situe les données du paquet dans une tuile
+struct tile_header {
+    uint32_t tile_id;      // Index de la tuile (ligne * tiles_x + colonne)
+    uint32_t offset;       // Position des données dans la tuile (octets)
+};
+
+// Image compressée : les 16 bits de poids fort de offset portent la taille
+// compressée de la tuile, 0 pour une tuile envoyée brute
+#define TILE_PACKED_SIZE(offset)   ((offset) >> 16)
+#define TILE_PACKED_OFFSET(offset) ((offset) & 0xFFFFu)
+
+// Octets de pixels d'un paquet de données
+#define PACKET_PAYLOAD (PACKET_SIZE - sizeof(struct packet_header) - sizeof(struct tile_header))
+
+// Symbole protégé par la correction d'erreurs : tout ce qui suit le
+// packet_header (tile_header et pixels complétés par des zéros)
+#define FEC_SYMBOL (PACKET_SIZE - sizeof(struct packet_header))
+
+// Retour vers le client : plages de paquets manquants d'une image
+#define NACK_MAGIC 0x4E41434Bu    // "NACK"
+
+struct nack_header {
+    uint32_t magic;
+    uint32_t stream_id;
+    uint32_t image_id;
+    uint32_t nb_ranges;    // Nombre de nack_range qui suivent
+};
+
+struct nack_range {
+    uint32_t seq;          // Premier paquet manquant
+    uint32_t count;        // Nombre de paquets manquants consécutifs
+};
+
+#define NACK_MAX_RANGES ((PACKET_SIZE - sizeof(struct nack_header)) / sizeof(struct nack_range))
+
+// Retour vers le client : bilan d'une image terminée, qui lui sert à régler
+// son débit
+#define REPORT_MAGIC 0x52505254u  // "RPRT"
+
+struct report_packet {
+    uint32_t magic;
+    uint32_t stream_id;
+    uint32_t image_id;
+    uint32_t total_packets; // Paquets de données de l'image
+    uint32_t received;     // Arrivés du premier coup (ni renvoyés, ni reconstruits)
+    uint32_t parity;       // Paquets de parité arrivés
+    uint32_t span_us;      // Entre la première et la dernière arrivée
 };
 
-#endif // PACKET_H
\ No newline at end of file
+#endif // PACKET_H
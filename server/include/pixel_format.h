@@ -0,0 +1,62 @@
+#ifndef PIXEL_FORMAT_H
+#define PIXEL_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Format des pixels d'une image, annoncé par l'émetteur dans ses drapeaux
+// (FRAME_FORMAT). Le canvas garde les pixels dans ce format, ils ne sont
+// convertis qu'à la sauvegarde. En 4:2:0 les pixels vont par blocs de 2x2
+// (Y00 Y01 Y10 Y11 Cb Cr) : les tuiles et leurs lignes comptent des blocs.
+#define PIXEL_FORMAT_BGRX   0   // 4 octets par pixel, X inutilisé
+#define PIXEL_FORMAT_BGR24  1   // 3 octets par pixel
+#define PIXEL_FORMAT_RGB565 2   // 2 octets par pixel (petit-boutiste, R en poids fort)
+#define PIXEL_FORMAT_YUV420 3   // 6 octets par bloc de 2x2 pixels (BT.601 pleine échelle)
+#define PIXEL_FORMATS       4
+
+// Côté d'un bloc en pixels
+static inline uint32_t pixel_block(uint32_t format)
+{
+    return format == PIXEL_FORMAT_YUV420 ? 2 : 1;
+}
+
+// Octets d'un bloc
+static inline uint32_t pixel_block_bytes(uint32_t format)
+{
+    switch (format)
+    {
+    case PIXEL_FORMAT_BGR24:
+        return 3;
+    case PIXEL_FORMAT_RGB565:
+        return 2;
+    case PIXEL_FORMAT_YUV420:
+        return 6;
+    default:
+        return 4;
+    }
+}
+
+// Nombre de blocs couvrant n pixels
+static inline uint32_t pixel_blocks(uint32_t format, uint32_t n)
+{
+    return (n + pixel_block(format) - 1) / pixel_block(format);
+}
+
+// Taille d'une image width x height dans ce format
+static inline size_t pixel_image_bytes(uint32_t format, uint32_t width, uint32_t height)
+{
+    return (size_t)pixel_blocks(format, width) * pixel_blocks(format, height) *
+           pixel_block_bytes(format);
+}
+
+const char *pixel_format_name(uint32_t format);
+
+// Remplit bytes octets de pixels de noir
+void pixel_clear(uint32_t format, uint8_t *pixels, size_t bytes);
+
+// Convertit une ligne de blocs couvrant width pixels en pixel_block(format)
+// lignes BGRx de width pixels, espacées de dst_stride octets
+void pixel_row_to_bgrx(uint32_t format, const uint8_t *src, uint32_t width,
+                       uint8_t *dst, size_t dst_stride);
+
+#endif // PIXEL_FORMAT_H
@@ -2,28 +2,99 @@
 #define RECEPTION_H
 
 #include <stdint.h>
-#include <time.h>
 #include <sys/types.h>
+#include <netinet/in.h>
 #include "packet.h"
+#include "config.h"
+#include "conceal.h"
 
+struct stream_table;
+struct fec_parity;
+
+// Identifie un flux : adresse et port de l'émetteur, et flux choisi par
+// l'émetteur (un client peut envoyer plusieurs écrans)
+typedef struct stream_key {
+    uint32_t addr; // Adresse IPv4 (ordre réseau)
+    uint16_t port; // Port source (ordre réseau)
+    uint32_t stream_id; // Champ stream_id des paquets
+} stream_key_t;
+
+// État de réception d'un flux
 typedef struct reception_state {
+    stream_key_t key; // Flux auquel appartient cet état
+    unsigned index; // Numéro attribué au flux par le serveur (noms de fichiers)
     uint32_t current_image_id; // ID de l'image en cours de réception
     uint32_t total_packets; // Nombre total de paquets attendus
     uint32_t width, height; // Dimensions de l'image
-    uint8_t *image_buffer; // Buffer pour stocker l'image reçue
+    uint32_t flags; // Drapeaux de l'image en cours (FRAME_FLAG_*)
+    uint32_t tiles_x, tiles_y; // Nombre de tuiles en largeur et en hauteur
+    uint32_t format; // Format des pixels du canvas (PIXEL_FORMAT_*)
+    size_t stride; // Octets d'une ligne de blocs du canvas
+    uint32_t codec; // Compression des tuiles de l'image en cours (TILE_CODEC_*)
+    uint8_t *canvas; // Image persistante sur laquelle on applique les tuiles
     uint8_t *received_mask; // Masque pour suivre les paquets reçus
+    uint32_t mask_capacity; // Taille allouée du masque
     uint32_t packets_received; // Nombre de paquets reçus
-    size_t packet_payload_size; // Taille du payload d'un paquet (données de l'image)
-    time_t last_activity; // Dernière activité (timestamp)
+    uint32_t next_seq; // Plus grand seq reçu + 1 (hors retransmissions)
+    uint32_t recovered; // Paquets manquants arrivés après un NACK
+    // Demandes de retransmission de l'image en cours (nack.c)
+    uint64_t nack_deadline_ms; // Fin des demandes (0 = image pas encore vue)
+    uint64_t nack_last_ms; // Dernière demande envoyée
+    uint64_t nack_rescan_ms; // Dernier examen depuis le début du masque
+    uint32_t nack_next; // Les trous avant ce seq ont déjà été demandés
+    uint32_t nack_progress; // packets_received au dernier examen
+    uint32_t nack_counted; // Les trous avant ce seq sont déjà comptés dans nacked
+    uint32_t nacked; // Paquets demandés pour cette image, chacun compté une fois
+    // Correction d'erreurs de l'image en cours (fec.c)
+    uint32_t fec_k; // Taille des groupes (0 = pas de parité)
+    uint8_t *tile_headers; // tile_header de chaque paquet reçu, pour refaire les symboles
+    uint32_t headers_capacity; // Paquets que peut décrire tile_headers
+    struct fec_parity *parities; // Parités en attente d'un groupe incomplet
+    unsigned parities_pending; // Entrées utilisées dans parities
+    uint32_t parity_received; // Paquets de parité reçus
+    uint32_t fec_recovered; // Paquets reconstruits à partir des parités
+    // Tuiles compressées de l'image en cours : leurs octets s'accumulent
+    // dans une place de TILE_MAX_BYTES par tuile jusqu'à la décompression
+    uint8_t *tile_stage; // Données compressées reçues, par tuile
+    uint16_t *tile_filled; // Octets reçus de chaque tuile
+    uint32_t stage_capacity; // Tuiles que peuvent accueillir ces buffers
+    uint32_t tiles_decoded; // Tuiles décompressées dans le canvas
+    uint32_t tiles_failed; // Tuiles aux données compressées invalides
+    conceal_map_t conceal; // Lignes valides du canvas, pour combler les pertes
+    uint32_t concealed; // Tuiles comblées dans l'image enregistrée
+    // Bilan de l'image pour la régulation du débit de l'émetteur (nack.c)
+    uint64_t first_arrival_us; // Arrivée du premier paquet de l'image
+    uint64_t last_arrival_us; // Et du dernier paquet envoyé du premier coup
+    uint64_t complete_us; // Image complète (0 = pas encore)
+    uint64_t deadline_us; // Terminée à cette heure si plus rien n'arrive
+    struct report_packet reports[REPORT_BACKLOG]; // Bilans prêts à partir (ordre réseau)
+    unsigned reports_pending; // Bilans pas encore partis
+    int reported; // Le bilan de l'image en cours est fait
+    int published; // L'image en cours est publiée en mémoire partagée
+    int retired; // L'image en cours est terminée et enregistrée
+    // Paquets des images suivantes arrivés avant la fin de l'image en cours,
+    // rejoués dans l'ordre des images une fois celle-ci terminée
+    uint8_t *held; // Paquets mis de côté : longueur (uint16_t) puis datagramme
+    size_t held_len; // Octets utilisés dans held
+    size_t held_capacity; // Taille allouée de held (0 ou REORDER_BYTES)
+    uint64_t held_since_us; // Début de l'attente de l'image en cours (0 = rien de côté)
+    size_t memory; // Octets alloués pour ce flux (canvas, masque, tuiles compressées)
+    uint64_t last_activity_us; // Dernier paquet reçu (horloge du lot, streams->now_us)
     int active; // Indique si une réception est en cours
+    int synced; // Une image clé a été reçue depuis l'allocation du canvas
+    struct reception_state *next; // Flux suivant dans le même seau de la table
 } reception_state_t;
 
-// État de réception global
-extern reception_state_t rx_state;
-
-void reset_reception_state(void);
-void save_image(void);
-void process_packet(char *data, ssize_t len);
+void reset_reception_state(struct stream_table *streams, reception_state_t *rx);
+size_t tile_data_length(const reception_state_t *rx, uint32_t tile_id, uint32_t offset);
+void read_tile_data(const reception_state_t *rx, uint32_t tile_id, uint32_t offset,
+                    uint8_t *dst, size_t len);
+void receive_data(reception_state_t *rx, uint32_t seq, const uint8_t *tile_header,
+                  const uint8_t *payload, size_t len);
+void save_image(const struct stream_table *streams, reception_state_t *rx, int wait);
+void finish_stream(struct stream_table *streams, reception_state_t *rx, int wait);
+void expire_frames(struct stream_table *streams, uint64_t now_us);
+void process_packet(struct stream_table *streams, const struct sockaddr_in *from,
+                    char *data, ssize_t len);
 
 #endif // RECEPTION_H
-            
\ No newline at end of file
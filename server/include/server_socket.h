@@ -2,6 +2,8 @@
 #ifndef SERVER_SOCKET_H
 #define SERVER_SOCKET_H
 
-int setup_server_socket(void);
+#include <stdint.h>
+
+int setup_server_socket(uint16_t port, int *gro, int reuseport);
 
 #endif // SERVER_SOCKET_H
\ No newline at end of file
@@ -0,0 +1,71 @@
+#ifndef SINK_H
+#define SINK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Image à enregistrer : pixels BGRx (4 octets, X ignoré)
+typedef struct frame_image {
+    uint32_t width, height;
+    const uint8_t *pixels;
+    size_t stride; // Octets entre deux lignes
+} frame_image_t;
+
+// Fichier encodé en mémoire. Le buffer est aligné sur SINK_ALIGN et sa
+// capacité est un multiple de SINK_ALIGN : il peut être écrit avec O_DIRECT
+// en arrondissant la longueur.
+typedef struct sink_buffer {
+    uint8_t *data;
+    size_t len; // Octets du fichier
+    size_t capacity;
+} sink_buffer_t;
+
+#define SINK_ALIGN 4096
+
+// Format de sortie des images reçues, choisi au lancement (-o)
+typedef struct frame_sink {
+    const char *name; // Nom de l'option, et extension des fichiers
+    // Encode l'image dans out, alloué par l'encodeur. Retourne -1 en cas
+    // d'erreur.
+    int (*encode)(const frame_image_t *img, sink_buffer_t *out);
+} frame_sink_t;
+
+extern const frame_sink_t ppm_sink; // PPM binaire (P6)
+extern const frame_sink_t qoi_sink; // QOI, sans perte et rapide
+extern const frame_sink_t png_sink; // PNG, bandes compressées en parallèle
+
+// Niveau zlib des PNG, et lignes minimales d'une bande compressée par un
+// thread
+#define PNG_LEVEL        1
+#define PNG_STRIPE_ROWS  32
+
+// Choisit le noyau de conversion selon le CPU et compte les coeurs (avant
+// de démarrer les workers)
+void sink_init(void);
+
+// Format de sortie d'après son nom, NULL si inconnu
+const frame_sink_t *sink_find(const char *name);
+
+// Convertit width pixels BGRx en RGB (3 octets) avec le meilleur noyau
+void bgrx_to_rgb(const uint8_t *src, uint8_t *dst, uint32_t width);
+
+// Noyau de conversion pour un niveau d'instructions
+typedef struct swizzle_kernel {
+    const char *name;
+    void (*bgrx_to_rgb)(const uint8_t *src, uint8_t *dst, uint32_t width);
+} swizzle_kernel_t;
+
+// Tous les noyaux supportés par le CPU, du plus simple au plus rapide
+const swizzle_kernel_t *swizzle_kernels(unsigned *count);
+
+// Nombre de coeurs, pour les encodeurs parallèles
+unsigned sink_cores(void);
+
+// Alloue au moins capacity octets alignés. Retourne -1 en cas d'erreur.
+int sink_buffer_alloc(sink_buffer_t *buf, size_t capacity);
+void sink_buffer_free(sink_buffer_t *buf);
+
+// Encode l'image et l'écrit dans fd d'un coup. Retourne -1 en cas d'erreur.
+int sink_write(const frame_sink_t *sink, const frame_image_t *img, int fd);
+
+#endif // SINK_H
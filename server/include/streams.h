@@ -0,0 +1,45 @@
+#ifndef STREAMS_H
+#define STREAMS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+#include "reception.h"
+
+// Table de hachage des flux en cours de réception (chaînage par seau)
+typedef struct stream_table {
+    reception_state_t *buckets[STREAM_BUCKETS];
+    unsigned count; // Nombre de flux dans la table
+    unsigned max_streams; // Flux acceptés dans toutes les tables
+    size_t memory; // Mémoire allouée par les flux de cette table
+    size_t memory_limit; // Mémoire maximale pour toutes les tables
+    unsigned closing; // Fermetures en cours : aucun flux n'est évincé pendant ce temps
+    uint64_t now_us; // Horloge monotone lue pour le lot de paquets en cours
+    uint64_t deadline_us; // Au plus tard, prochaine échéance d'une image (0 = aucune)
+    uint64_t nack_due_us; // Prochain examen des NACK utile (0 = aucune image à compléter)
+    uint64_t frame_timeout_us; // Attente d'une image incomplète sans nouveau paquet
+    uint64_t hold_timeout_us; // Attente de l'image en cours quand les suivantes arrivent
+    struct frame_writer *writer; // Enregistre les images terminées
+    struct frame_publisher *publisher; // Les publie en mémoire partagée (NULL = non)
+    struct rx_metrics *stats; // Statistiques du worker
+} stream_table_t;
+
+// Rapproche la prochaine échéance de la table. Elle peut être en avance :
+// expire_frames la recalcule.
+static inline void stream_deadline(stream_table_t *streams, uint64_t at_us)
+{
+    if (!streams->deadline_us || at_us < streams->deadline_us)
+    {
+        streams->deadline_us = at_us;
+    }
+}
+
+void stream_table_init(stream_table_t *streams, unsigned max_streams, size_t memory_limit);
+void stream_table_nack(stream_table_t *streams);
+reception_state_t *stream_lookup(stream_table_t *streams, const stream_key_t *key);
+int stream_reserve(stream_table_t *streams, reception_state_t *rx, size_t bytes);
+void stream_release(stream_table_t *streams, reception_state_t *rx, size_t bytes);
+void expire_idle_streams(stream_table_t *streams, uint64_t now_us, int timeout);
+void close_all_streams(stream_table_t *streams);
+
+#endif // STREAMS_H
@@ -2,8 +2,31 @@
 #define URING_UTILS_H
 
 #include <liburing.h>
+#include <sys/socket.h>
+#include "streams.h"
+#include "metrics.h"
 
-void prime_uring_requests(struct io_uring *ring, int sock);
-void run_server_loop(struct io_uring *ring, int sock);
+// Réception io_uring : une ring de buffers fournis au noyau et une requête
+// recvmsg multishot qui y dépose chaque datagramme
+typedef struct rx_ring {
+    struct io_uring ring;
+    struct io_uring_buf_ring *br; // Buffers rendus au noyau après traitement
+    char *buffers; // nb_buffers buffers contigus de buffer_size octets
+    unsigned nb_buffers;
+    size_t buffer_size;
+    struct msghdr msgh; // Gabarit du recvmsg multishot (taille du contrôle)
+    int sock;
+    int gro;
+    int armed; // Une requête multishot est en cours
+    int nack; // Demander la retransmission des paquets perdus
+    stream_table_t *streams; // Flux alimentés par cette ring
+    uint32_t drops_seen; // Dernier compteur SO_RXQ_OVFL de la socket
+    rx_metrics_t stats; // Statistiques de réception
+} rx_ring_t;
+
+int setup_rx_ring(rx_ring_t *rx, int sock, int gro, stream_table_t *streams);
+void destroy_rx_ring(rx_ring_t *rx);
+int prime_uring_requests(rx_ring_t *rx);
+void run_server_loop(rx_ring_t *rx);
 
 #endif // URING_UTILS_H
@@ -0,0 +1,29 @@
+#ifndef WORKER_H
+#define WORKER_H
+
+#include <pthread.h>
+#include "uring_utils.h"
+#include "streams.h"
+
+// Un thread de réception : sa socket SO_REUSEPORT, sa ring io_uring et les
+// flux qui lui arrivent. Seules les limites de flux et de mémoire sont
+// communes à tous les workers (streams.c).
+typedef struct worker {
+    pthread_t thread;
+    unsigned id;
+    int cpu; // Coeur sur lequel épingler le thread (-1 = libre)
+    int sock;
+    int gro;
+    int nack; // Envoyer des NACK aux émetteurs
+    struct frame_writer *writer; // Enregistre les images terminées
+    struct frame_publisher *publisher; // Les publie en mémoire partagée (NULL = non)
+    int ready; // La ring a été créée (à détruire en fin de programme)
+    int done; // Le thread a terminé (accès atomique)
+    rx_ring_t rx;
+    stream_table_t streams;
+} worker_t;
+
+int start_worker(worker_t *w);
+void join_worker(worker_t *w);
+
+#endif // WORKER_H
@@ -0,0 +1,59 @@
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <liburing.h>
+#include "sink.h"
+#include "metrics.h"
+
+// Image à enregistrer : une copie du canvas d'un flux, prise au moment de la
+// sauvegarde pour que la réception continue sur le canvas
+typedef struct write_job {
+    unsigned stream; // Numéro du flux (nom du fichier, messages)
+    uint32_t image_id;
+    uint32_t width, height;
+    uint32_t format; // Format des pixels copiés (PIXEL_FORMAT_*)
+    size_t stride; // Octets d'une ligne de blocs
+    uint8_t *pixels; // Copie du canvas (buffer_pool)
+    size_t bytes; // Taille de la copie
+    char details[256]; // Bilan de réception, affiché une fois l'image écrite
+    uint64_t queued_us; // Mise en file, pour la latence d'enregistrement
+    // Écriture en cours (thread du writer)
+    char filename[64];
+    sink_buffer_t file; // Image encodée
+    size_t write_len; // Octets à écrire (arrondis pour O_DIRECT)
+    size_t done; // Octets déjà écrits
+    int fd;
+    struct write_job *next; // Image suivante dans la file
+} write_job_t;
+
+// Enregistrement des images hors des threads de réception. Les workers
+// déposent leurs images dans une file bornée. Un thread les encode et soumet
+// les écritures à sa propre ring io_uring, jusqu'à WRITER_DEPTH à la fois.
+typedef struct frame_writer {
+    pthread_t thread;
+    const frame_sink_t *sink; // Format des fichiers
+    int direct; // Ouvrir les fichiers en O_DIRECT
+    struct io_uring ring;
+    pthread_mutex_t lock;
+    pthread_cond_t work; // Une image attend, ou arrêt demandé
+    pthread_cond_t room; // Une place s'est libérée dans la file
+    write_job_t *head, *tail; // Images à encoder, dans l'ordre d'arrivée
+    unsigned queued; // Images dans la file ou en cours de copie
+    int stopping; // Plus d'image à venir : vider la file puis s'arrêter
+    unsigned in_flight; // Écritures soumises à la ring
+    // Statistiques, relevées aussi pendant la réception (metrics.c)
+    unsigned long long written, dropped, failed, bytes;
+    unsigned max_queued, max_in_flight;
+    metrics_hist_t latency_us; // De la mise en file à la fin de l'écriture
+    uint64_t max_latency_us;
+} frame_writer_t;
+
+int start_writer(frame_writer_t *wr, const frame_sink_t *sink, int direct);
+write_job_t *writer_reserve(frame_writer_t *wr, size_t bytes, int wait);
+void writer_submit(frame_writer_t *wr, write_job_t *job);
+void stop_writer(frame_writer_t *wr);
+
+#endif // WRITER_H
@@ -0,0 +1,199 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include "buffer_pool.h"
+
+#define PAGE_SIZE 4096
+
+// Buffer libre en réserve
+typedef struct pool_block {
+    void *data;
+    size_t size; // Taille du mapping (multiple de POOL_ALIGN)
+} pool_block_t;
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pool_block_t free_blocks[POOL_MAX_FREE];
+static unsigned nb_free;
+static size_t cached; // Octets des buffers libres
+static int use_hugetlb;
+// Statistiques
+static unsigned long long requests, reused, mapped;
+static size_t mapped_bytes;
+
+static size_t pool_size(size_t size)
+{
+    return (size + POOL_ALIGN - 1) & ~(POOL_ALIGN - 1);
+}
+
+// Nouveau mapping de size octets (multiple de POOL_ALIGN), toutes ses pages
+// déjà présentes
+static void *map_block(size_t size)
+{
+    if (__atomic_load_n(&use_hugetlb, __ATOMIC_RELAXED))
+    {
+        void *p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+        if (p != MAP_FAILED)
+        {
+            return p;
+        }
+        // Plus de pages réservées : les suivantes seront transparentes
+        if (__atomic_exchange_n(&use_hugetlb, 0, __ATOMIC_RELAXED))
+        {
+            fprintf(stderr, "MAP_HUGETLB: %s, using transparent huge pages\n", strerror(errno));
+        }
+    }
+
+    // Sur-allocation d'une page énorme pour aligner le début du buffer
+    uint8_t *raw = mmap(NULL, size + POOL_ALIGN, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED)
+    {
+        perror("mmap");
+        return NULL;
+    }
+    uint8_t *p = (uint8_t *)(((uintptr_t)raw + POOL_ALIGN - 1) & ~(uintptr_t)(POOL_ALIGN - 1));
+    if (p > raw)
+    {
+        munmap(raw, p - raw);
+    }
+    munmap(p + size, raw + POOL_ALIGN - p);
+    madvise(p, size, MADV_HUGEPAGE);
+
+    // Les défauts de page ont lieu ici, un par page énorme, plutôt qu'à la
+    // première écriture de l'image
+    for (size_t off = 0; off < size; off += PAGE_SIZE)
+    {
+        p[off] = 0;
+    }
+    return p;
+}
+
+void *pool_alloc(size_t size)
+{
+    if (size < POOL_MIN_SIZE)
+    {
+        void *p;
+        int ret = posix_memalign(&p, PAGE_SIZE, size);
+        if (ret != 0)
+        {
+            fprintf(stderr, "posix_memalign: %s\n", strerror(ret));
+            return NULL;
+        }
+        return p;
+    }
+
+    // Un buffer libre de la même taille arrondie, sinon un nouveau mapping
+    size = pool_size(size);
+    pthread_mutex_lock(&pool_lock);
+    requests++;
+    for (unsigned i = 0; i < nb_free; i++)
+    {
+        if (free_blocks[i].size == size)
+        {
+            void *p = free_blocks[i].data;
+            free_blocks[i] = free_blocks[--nb_free];
+            cached -= size;
+            reused++;
+            pthread_mutex_unlock(&pool_lock);
+            return p;
+        }
+    }
+    pthread_mutex_unlock(&pool_lock);
+
+    void *p = map_block(size);
+    if (p)
+    {
+        pthread_mutex_lock(&pool_lock);
+        mapped++;
+        mapped_bytes += size;
+        pthread_mutex_unlock(&pool_lock);
+    }
+    return p;
+}
+
+void pool_free(void *ptr, size_t size)
+{
+    if (!ptr)
+    {
+        return;
+    }
+    if (size < POOL_MIN_SIZE)
+    {
+        free(ptr);
+        return;
+    }
+
+    size = pool_size(size);
+    pthread_mutex_lock(&pool_lock);
+
+    // Réserve pleine : les buffers libres les plus anciens sont rendus au
+    // noyau (ceux d'une résolution qui n'est plus reçue, en général)
+    while (nb_free && (nb_free == POOL_MAX_FREE || cached + size > POOL_MAX_CACHED))
+    {
+        munmap(free_blocks[0].data, free_blocks[0].size);
+        cached -= free_blocks[0].size;
+        memmove(free_blocks, free_blocks + 1, --nb_free * sizeof(free_blocks[0]));
+    }
+    if (size <= POOL_MAX_CACHED)
+    {
+        free_blocks[nb_free++] = (pool_block_t){ ptr, size };
+        cached += size;
+        ptr = NULL;
+    }
+    pthread_mutex_unlock(&pool_lock);
+
+    if (ptr)
+    {
+        munmap(ptr, size);
+    }
+}
+
+void pool_init(int hugetlb, size_t size, unsigned count)
+{
+    use_hugetlb = hugetlb;
+    if (!size || size < POOL_MIN_SIZE)
+    {
+        return;
+    }
+
+    // Les buffers sont créés tous ensemble avant d'être rendus, sinon le
+    // même resservirait à chaque fois
+    void *blocks[POOL_MAX_FREE];
+    if (count > POOL_MAX_FREE)
+    {
+        count = POOL_MAX_FREE;
+    }
+    unsigned n;
+    for (n = 0; n < count; n++)
+    {
+        blocks[n] = pool_alloc(size);
+        if (!blocks[n])
+        {
+            break;
+        }
+    }
+    for (unsigned i = 0; i < n; i++)
+    {
+        pool_free(blocks[i], size);
+    }
+
+    printf("Buffer pool: %u buffers of %.1f MB ready (%s)\n", n, pool_size(size) / 1e6,
+           use_hugetlb ? "MAP_HUGETLB" : "transparent huge pages");
+}
+
+void pool_report(void)
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+
+    printf("Buffer pool: %llu requests, %llu reused (%.1f%%), %llu mapped (%.1f MB), "
+           "%ld minor page faults in total\n",
+           requests, reused, requests ? 100.0 * reused / requests : 0.0, mapped,
+           mapped_bytes / 1e6, ru.ru_minflt);
+}
@@ -0,0 +1,36 @@
+#include <lz4.h>
+#include <zstd.h>
+#include "codec.h"
+
+static const char *const codec_names[TILE_CODECS] = {
+    "raw", "lz4", "zstd"
+};
+
+// Contexte Zstd de chaque worker, gardé d'une tuile à l'autre
+static __thread ZSTD_DCtx *zstd_ctx;
+
+const char *codec_name(uint32_t codec)
+{
+    return codec < TILE_CODECS ? codec_names[codec] : "?";
+}
+
+size_t codec_decompress(uint32_t codec, const uint8_t *src, size_t len,
+                        uint8_t *dst, size_t capacity)
+{
+    if (codec == TILE_CODEC_LZ4)
+    {
+        int n = LZ4_decompress_safe((const char *)src, (char *)dst, len, capacity);
+        return n > 0 ? (size_t)n : 0;
+    }
+    if (codec != TILE_CODEC_ZSTD)
+    {
+        return 0;
+    }
+
+    if (!zstd_ctx && !(zstd_ctx = ZSTD_createDCtx()))
+    {
+        return 0;
+    }
+    size_t n = ZSTD_decompressDCtx(zstd_ctx, dst, capacity, src, len);
+    return ZSTD_isError(n) ? 0 : n;
+}
@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "conceal.h"
+#include "pixel_format.h"
+
+size_t conceal_size(uint32_t format, uint32_t width, uint32_t height)
+{
+    uint32_t tile = TILE_SIZE / pixel_block(format);
+    size_t tiles = (size_t)((pixel_blocks(format, width) + tile - 1) / tile) *
+                   ((pixel_blocks(format, height) + tile - 1) / tile);
+
+    return tiles * (sizeof(uint64_t) + CONCEAL_ROWS * sizeof(uint16_t) + sizeof(uint32_t));
+}
+
+int conceal_init(conceal_map_t *m, uint32_t format, uint32_t width, uint32_t height)
+{
+    memset(m, 0, sizeof(*m));
+    m->format  = format;
+    m->width   = pixel_blocks(format, width);
+    m->height  = pixel_blocks(format, height);
+    m->tile    = TILE_SIZE / pixel_block(format);
+    m->tiles_x = (m->width + m->tile - 1) / m->tile;
+    m->tiles_y = (m->height + m->tile - 1) / m->tile;
+
+    size_t tiles = (size_t)m->tiles_x * m->tiles_y;
+    m->valid  = calloc(tiles, sizeof(*m->valid));
+    m->filled = calloc(tiles * CONCEAL_ROWS, sizeof(*m->filled));
+    m->stamp  = calloc(tiles, sizeof(*m->stamp));
+    if (!m->valid || !m->filled || !m->stamp)
+    {
+        perror("calloc");
+        conceal_free(m);
+        return -1;
+    }
+    return 0;
+}
+
+void conceal_free(conceal_map_t *m)
+{
+    free(m->valid);
+    free(m->filled);
+    free(m->stamp);
+    memset(m, 0, sizeof(*m));
+}
+
+static inline int row_valid(const conceal_map_t *m, uint32_t tx, uint32_t y)
+{
+    return (m->valid[(y / m->tile) * m->tiles_x + tx] >> (y % m->tile)) & 1;
+}
+
+// dst = a + (b - a) * k / d, octet par octet. En RGB565 les octets ne sont
+// pas des composantes : on prend le plus proche des deux.
+static void blend(uint32_t format, uint8_t *dst, const uint8_t *a, const uint8_t *b, size_t len,
+                  uint32_t k, uint32_t d)
+{
+    if (format == PIXEL_FORMAT_RGB565)
+    {
+        memcpy(dst, 2 * k <= d ? a : b, len);
+        return;
+    }
+    for (size_t i = 0; i < len; i++)
+    {
+        dst[i] = (a[i] * (d - k) + b[i] * k + d / 2) / d;
+    }
+}
+
+// Comble les lignes [y0, y1[ d'une colonne de tuiles (span octets à partir
+// de x) entre les lignes valides top et bottom (-1 ou height si absentes)
+static void fill_rows(const conceal_map_t *m, uint8_t *canvas, size_t stride, size_t x,
+                      size_t span, int64_t top, int64_t bottom, uint32_t y0, uint32_t y1)
+{
+    for (uint32_t y = y0; y < y1; y++)
+    {
+        uint8_t *dst = canvas + y * stride + x;
+        if (top >= 0 && bottom < m->height)
+        {
+            blend(m->format, dst, canvas + top * stride + x, canvas + bottom * stride + x, span,
+                  y - top, bottom - top);
+        }
+        else
+        {
+            memcpy(dst, canvas + (top >= 0 ? top : bottom) * stride + x, span);
+        }
+    }
+}
+
+// Colonnes de tuiles [a, b] sans aucune ligne valide : interpolation entre
+// la dernière colonne de blocs à leur gauche et la première à leur droite
+static void fill_columns(const conceal_map_t *m, uint8_t *canvas, size_t stride,
+                         uint32_t a, uint32_t b)
+{
+    uint32_t bytes = pixel_block_bytes(m->format);
+    int64_t left = a > 0 ? (int64_t)a * m->tile - 1 : -1;
+    int64_t right = b + 1 < m->tiles_x ? (int64_t)(b + 1) * m->tile : m->width;
+    uint32_t x1 = (b + 1) * m->tile < m->width ? (b + 1) * m->tile : m->width;
+
+    for (uint32_t y = 0; y < m->height; y++)
+    {
+        uint8_t *row = canvas + y * stride;
+        for (uint32_t x = a * m->tile; x < x1; x++)
+        {
+            if (left >= 0 && right < m->width)
+            {
+                blend(m->format, row + x * bytes, row + left * bytes, row + right * bytes, bytes,
+                      x - left, right - left);
+            }
+            else
+            {
+                memcpy(row + x * bytes, row + (left >= 0 ? left : right) * bytes, bytes);
+            }
+        }
+    }
+}
+
+uint32_t conceal_fill(const conceal_map_t *m, uint8_t *canvas, size_t stride)
+{
+    uint32_t bytes = pixel_block_bytes(m->format);
+    uint32_t empty_from = 0, nonempty = 0;
+    int in_empty = 0;
+
+    // Tuiles à combler : celles dont des lignes ne sont pas valides
+    uint32_t damaged = 0;
+    for (uint32_t ty = 0; ty < m->tiles_y; ty++)
+    {
+        uint32_t rows = m->height - ty * m->tile < m->tile ? m->height - ty * m->tile : m->tile;
+        uint64_t full = rows == 64 ? ~0ULL : (1ULL << rows) - 1;
+        for (uint32_t tx = 0; tx < m->tiles_x; tx++)
+        {
+            damaged += (m->valid[ty * m->tiles_x + tx] & full) != full;
+        }
+    }
+    if (!damaged)
+    {
+        return 0;
+    }
+
+    // Verticalement, colonne de tuiles par colonne de tuiles
+    for (uint32_t tx = 0; tx < m->tiles_x; tx++)
+    {
+        size_t x = (size_t)tx * m->tile * bytes;
+        uint32_t width = m->width - tx * m->tile < m->tile ? m->width - tx * m->tile : m->tile;
+        size_t span = (size_t)width * bytes;
+        int64_t prev = -1;
+
+        for (uint32_t y = 0; y < m->height; y++)
+        {
+            if (!row_valid(m, tx, y))
+            {
+                continue;
+            }
+            if (prev + 1 < y)
+            {
+                fill_rows(m, canvas, stride, x, span, prev, y, prev + 1, y);
+            }
+            prev = y;
+        }
+
+        if (prev < 0)
+        {
+            // Rien à interpoler dans cette colonne : voir ses voisines
+            if (!in_empty)
+            {
+                empty_from = tx;
+                in_empty = 1;
+            }
+            continue;
+        }
+        if (prev + 1 < m->height)
+        {
+            fill_rows(m, canvas, stride, x, span, prev, m->height, prev + 1, m->height);
+        }
+        nonempty++;
+        if (in_empty)
+        {
+            fill_columns(m, canvas, stride, empty_from, tx - 1);
+            in_empty = 0;
+        }
+    }
+
+    // Aucune ligne valide nulle part : rien pour combler
+    if (!nonempty)
+    {
+        return 0;
+    }
+    if (in_empty)
+    {
+        fill_columns(m, canvas, stride, empty_from, m->tiles_x - 1);
+    }
+    return damaged;
+}
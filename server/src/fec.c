@@ -0,0 +1,328 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "fec.h"
+#include "gf256.h"
+#include "streams.h"
+
+// Prépare la correction d'erreurs d'une nouvelle image : un tile_header par
+// paquet attendu et le stock de parités, alloués une fois par flux
+int fec_begin_image(stream_table_t *streams, reception_state_t *rx)
+{
+    if (rx->total_packets > rx->headers_capacity)
+    {
+        size_t grow = (size_t)(rx->total_packets - rx->headers_capacity) * sizeof(struct tile_header);
+        if (stream_reserve(streams, rx, grow) < 0)
+        {
+            return -1;
+        }
+        uint8_t *headers = realloc(rx->tile_headers,
+                                   (size_t)rx->total_packets * sizeof(struct tile_header));
+        if (!headers)
+        {
+            perror("realloc");
+            return -1;
+        }
+        rx->tile_headers = headers;
+        rx->headers_capacity = rx->total_packets;
+    }
+
+    if (!rx->parities)
+    {
+        if (stream_reserve(streams, rx, FEC_MAX_PENDING * sizeof(fec_parity_t)) < 0)
+        {
+            return -1;
+        }
+        rx->parities = calloc(FEC_MAX_PENDING, sizeof(fec_parity_t));
+        if (!rx->parities)
+        {
+            perror("calloc");
+            return -1;
+        }
+    }
+    else
+    {
+        for (unsigned i = 0; i < FEC_MAX_PENDING; i++)
+        {
+            rx->parities[i].used = 0;
+        }
+    }
+    rx->parities_pending = 0;
+    return 0;
+}
+
+// Libère les buffers (la mémoire est rendue avec celle du flux)
+void fec_free(reception_state_t *rx)
+{
+    free(rx->tile_headers);
+    free(rx->parities);
+    rx->tile_headers = NULL;
+    rx->parities = NULL;
+    rx->headers_capacity = 0;
+    rx->parities_pending = 0;
+}
+
+// Même matrice que l'émetteur : 1 / (x_j + y_i) avec x_j = j et
+// y_i = 128 + i, chaque colonne multipliée par (x_0 + y_i)
+uint8_t fec_coef(unsigned j, unsigned i)
+{
+    uint8_t y = 128 + i;
+    return gf256_mul(y, gf256_inv(j ^ y));
+}
+
+// Inverse la matrice n x n a dans inv (Gauss-Jordan dans GF(2^8)).
+// Retourne -1 si elle n'est pas inversible.
+static int invert_matrix(uint8_t a[FEC_MAX_LOST][FEC_MAX_LOST],
+                         uint8_t inv[FEC_MAX_LOST][FEC_MAX_LOST], unsigned n)
+{
+    for (unsigned r = 0; r < n; r++)
+    {
+        memset(inv[r], 0, n);
+        inv[r][r] = 1;
+    }
+
+    for (unsigned col = 0; col < n; col++)
+    {
+        unsigned pivot = col;
+        while (pivot < n && !a[pivot][col])
+        {
+            pivot++;
+        }
+        if (pivot == n)
+        {
+            return -1;
+        }
+        if (pivot != col)
+        {
+            for (unsigned c = 0; c < n; c++)
+            {
+                uint8_t t = a[col][c]; a[col][c] = a[pivot][c]; a[pivot][c] = t;
+                t = inv[col][c]; inv[col][c] = inv[pivot][c]; inv[pivot][c] = t;
+            }
+        }
+
+        uint8_t scale = gf256_inv(a[col][col]);
+        for (unsigned c = 0; c < n; c++)
+        {
+            a[col][c] = gf256_mul(a[col][c], scale);
+            inv[col][c] = gf256_mul(inv[col][c], scale);
+        }
+
+        for (unsigned r = 0; r < n; r++)
+        {
+            uint8_t f = a[r][col];
+            if (r == col || !f)
+            {
+                continue;
+            }
+            for (unsigned c = 0; c < n; c++)
+            {
+                a[r][c] ^= gf256_mul(f, a[col][c]);
+                inv[r][c] ^= gf256_mul(f, inv[col][c]);
+            }
+        }
+    }
+    return 0;
+}
+
+// Refait le symbole d'un paquet déjà reçu : son tile_header puis ses pixels
+// relus dans le canvas. Retourne le nombre d'octets utiles (le reste vaut 0).
+static size_t rebuild_symbol(const reception_state_t *rx, uint32_t seq, uint8_t *sym)
+{
+    struct tile_header th;
+    memcpy(&th, rx->tile_headers + (size_t)seq * sizeof(th), sizeof(th));
+    memcpy(sym, &th, sizeof(th));
+
+    size_t len = tile_data_length(rx, ntohl(th.tile_id), ntohl(th.offset));
+    read_tile_data(rx, ntohl(th.tile_id), ntohl(th.offset), sym + sizeof(th), len);
+    return sizeof(th) + len;
+}
+
+static void release_group(reception_state_t *rx, uint32_t first)
+{
+    for (unsigned i = 0; i < FEC_MAX_PENDING; i++)
+    {
+        if (rx->parities[i].used && rx->parities[i].first == first)
+        {
+            rx->parities[i].used = 0;
+            rx->parities_pending--;
+        }
+    }
+}
+
+// Reconstruit les paquets perdus du groupe qui commence à first s'il a
+// reçu assez de parités : les données reçues sont retirées des parités,
+// il reste un système e x e dont les inconnues sont les paquets perdus
+static void try_group(reception_state_t *rx, uint32_t first)
+{
+    uint32_t size = rx->total_packets - first < rx->fec_k ?
+                    rx->total_packets - first : rx->fec_k;
+    unsigned lost[FEC_MAX_LOST];
+    unsigned nb_lost = 0;
+
+    for (uint32_t i = 0; i < size; i++)
+    {
+        if (!rx->received_mask[first + i])
+        {
+            if (nb_lost == FEC_MAX_LOST)
+            {
+                return;
+            }
+            lost[nb_lost++] = i;
+        }
+    }
+    if (!nb_lost)
+    {
+        release_group(rx, first);
+        return;
+    }
+
+    const fec_parity_t *rows[FEC_MAX_LOST];
+    unsigned nb_rows = 0;
+    for (unsigned i = 0; i < FEC_MAX_PENDING && nb_rows < nb_lost; i++)
+    {
+        if (rx->parities[i].used && rx->parities[i].first == first)
+        {
+            rows[nb_rows++] = &rx->parities[i];
+        }
+    }
+    if (nb_rows < nb_lost)
+    {
+        return;
+    }
+
+    // Retire des parités la contribution des paquets reçus
+    uint8_t syndromes[FEC_MAX_LOST][FEC_SYMBOL];
+    uint8_t sym[FEC_SYMBOL];
+
+    for (unsigned r = 0; r < nb_lost; r++)
+    {
+        memcpy(syndromes[r], rows[r]->symbol, FEC_SYMBOL);
+    }
+    for (uint32_t i = 0; i < size; i++)
+    {
+        if (!rx->received_mask[first + i])
+        {
+            continue;
+        }
+        size_t n = rebuild_symbol(rx, first + i, sym);
+        for (unsigned r = 0; r < nb_lost; r++)
+        {
+            gf256_mul_add(syndromes[r], sym, n, fec_coef(rows[r]->index, i));
+        }
+    }
+
+    uint8_t a[FEC_MAX_LOST][FEC_MAX_LOST], inv[FEC_MAX_LOST][FEC_MAX_LOST];
+    for (unsigned r = 0; r < nb_lost; r++)
+    {
+        for (unsigned c = 0; c < nb_lost; c++)
+        {
+            a[r][c] = fec_coef(rows[r]->index, lost[c]);
+        }
+    }
+    if (invert_matrix(a, inv, nb_lost) < 0)
+    {
+        release_group(rx, first);
+        return;
+    }
+
+    for (unsigned c = 0; c < nb_lost; c++)
+    {
+        memset(sym, 0, sizeof(sym));
+        for (unsigned r = 0; r < nb_lost; r++)
+        {
+            gf256_mul_add(sym, syndromes[r], FEC_SYMBOL, inv[c][r]);
+        }
+
+        // Le symbole reconstruit commence par le tile_header du paquet, la
+        // taille de ses données se déduit de la géométrie de la tuile
+        struct tile_header th;
+        memcpy(&th, sym, sizeof(th));
+        size_t len = tile_data_length(rx, ntohl(th.tile_id), ntohl(th.offset));
+        if (!len)
+        {
+            continue;
+        }
+        receive_data(rx, first + lost[c], sym, sym + sizeof(th), len);
+        rx->fec_recovered++;
+    }
+    release_group(rx, first);
+}
+
+void fec_parity_received(reception_state_t *rx, uint32_t first, uint32_t index,
+                         const uint8_t *symbol, size_t len)
+{
+    rx->parity_received++;
+
+    if (!rx->fec_k || !rx->parities || len != FEC_SYMBOL ||
+        first >= rx->total_packets || first % rx->fec_k || index >= FEC_MAX_K)
+    {
+        return;
+    }
+
+    // Le cas courant : rien n'a été perdu dans le groupe
+    uint32_t size = rx->total_packets - first < rx->fec_k ?
+                    rx->total_packets - first : rx->fec_k;
+    if (memchr(rx->received_mask + first, 0, size) == NULL)
+    {
+        return;
+    }
+
+    fec_parity_t *slot = NULL;
+    for (unsigned i = 0; i < FEC_MAX_PENDING; i++)
+    {
+        fec_parity_t *p = &rx->parities[i];
+        if (p->used && p->first == first && p->index == index)
+        {
+            return;
+        }
+        if (!p->used && !slot)
+        {
+            slot = p;
+        }
+    }
+    if (!slot)
+    {
+        // Stock plein : le groupe le plus ancien de l'image a le moins de
+        // chances d'être complété, ses parités laissent la place
+        uint32_t oldest = first;
+        for (unsigned i = 0; i < FEC_MAX_PENDING; i++)
+        {
+            fec_parity_t *p = &rx->parities[i];
+            if (p->first != first && (oldest == first || p->first < oldest))
+            {
+                oldest = p->first;
+                slot = p;
+            }
+        }
+        if (!slot)
+        {
+            // Toutes les places sont déjà prises par ce groupe
+            return;
+        }
+        release_group(rx, oldest);
+    }
+
+    slot->first = first;
+    slot->index = index;
+    slot->used = 1;
+    memcpy(slot->symbol, symbol, FEC_SYMBOL);
+    rx->parities_pending++;
+
+    try_group(rx, first);
+}
+
+void fec_data_received(reception_state_t *rx, uint32_t seq)
+{
+    uint32_t first = seq - seq % rx->fec_k;
+
+    for (unsigned i = 0; i < FEC_MAX_PENDING; i++)
+    {
+        if (rx->parities[i].used && rx->parities[i].first == first)
+        {
+            try_group(rx, first);
+            return;
+        }
+    }
+}
@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "frame_shm.h"
+
+static uint64_t monotonic_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int publisher_start(frame_publisher_t *pub, const char *name, unsigned slots,
+                    uint32_t width, uint32_t height)
+{
+    memset(pub, 0, sizeof(*pub));
+    pub->name = name;
+
+    // Une place : son en-tête puis les pixels, arrondie à la page
+    uint64_t capacity = (uint64_t)width * height * 4;
+    uint64_t page = sysconf(_SC_PAGESIZE);
+    uint64_t slot_size = (sizeof(frame_shm_slot_t) + capacity + page - 1) / page * page;
+    pub->map_size = sizeof(frame_shm_header_t) + slots * slot_size;
+
+    // Zone d'une exécution précédente : remplacée
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Shared memory %s: %s\n", name, strerror(errno));
+        return -1;
+    }
+    if (ftruncate(fd, pub->map_size) < 0)
+    {
+        fprintf(stderr, "Shared memory %s: %s\n", name, strerror(errno));
+        close(fd);
+        shm_unlink(name);
+        return -1;
+    }
+
+    // Pages touchées dès maintenant : la première image ne paie pas leurs
+    // défauts de page
+    void *map = mmap(NULL, pub->map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        fprintf(stderr, "Shared memory %s: %s\n", name, strerror(errno));
+        shm_unlink(name);
+        return -1;
+    }
+
+    pub->hdr = map;
+    pub->hdr->version = FRAME_SHM_VERSION;
+    pub->hdr->slots = slots;
+    pub->hdr->slot_size = slot_size;
+    pub->hdr->capacity = slot_size - sizeof(frame_shm_slot_t);
+    __atomic_store_n(&pub->hdr->magic, FRAME_SHM_MAGIC, __ATOMIC_RELEASE);
+    pthread_mutex_init(&pub->lock, NULL);
+
+    printf("Publishing frames to shared memory %s (%u slots of %llu bytes)\n",
+           name, slots, (unsigned long long)pub->hdr->capacity);
+    return 0;
+}
+
+static void wake_readers(frame_shm_header_t *hdr)
+{
+    // Les lecteurs s'inscrivent avant de relire generation : sans inscrit,
+    // pas d'appel système
+    if (__atomic_load_n(&hdr->waiters, __ATOMIC_SEQ_CST))
+    {
+        syscall(SYS_futex, &hdr->generation, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    }
+}
+
+int publisher_publish(frame_publisher_t *pub, frame_shm_slot_t *meta, const uint8_t *pixels)
+{
+    frame_shm_header_t *hdr = pub->hdr;
+    if (meta->bytes > hdr->capacity)
+    {
+        return -1;
+    }
+
+    pthread_mutex_lock(&pub->lock);
+    uint32_t generation = hdr->generation + 1;
+    if (!generation)
+    {
+        generation = 1;
+    }
+    frame_shm_slot_t *slot = frame_shm_slot(hdr, generation);
+
+    // Verrou de séquence : impair pendant la copie, les lecteurs de cette
+    // place recommencent
+    uint32_t seq = slot->seq;
+    __atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    meta->seq = seq + 1;
+    meta->generation = generation;
+    memcpy(slot + 1, pixels, meta->bytes);
+    meta->published_us = monotonic_us();
+    *slot = *meta;
+
+    __atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&hdr->generation, generation, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&pub->lock);
+
+    wake_readers(hdr);
+    return 0;
+}
+
+void publisher_stop(frame_publisher_t *pub)
+{
+    if (!pub->hdr)
+    {
+        return;
+    }
+    // Les lecteurs endormis se réveillent et voient closed
+    __atomic_store_n(&pub->hdr->closed, 1, __ATOMIC_SEQ_CST);
+    wake_readers(pub->hdr);
+
+    munmap(pub->hdr, pub->map_size);
+    shm_unlink(pub->name);
+    pthread_mutex_destroy(&pub->lock);
+    pub->hdr = NULL;
+}
@@ -0,0 +1,189 @@
+#include "gf256.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GF256_X86 1
+#endif
+
+static uint8_t gf_exp[512];    // Doublée pour éviter un modulo dans gf256_mul
+static uint8_t gf_log[256];
+
+// Pour chaque constante c, produits de c par les 16 valeurs d'un quartet bas
+// puis d'un quartet haut : c * x = low[x & 15] ^ high[x >> 4]
+static uint8_t gf_nibbles[256][32];
+
+uint8_t gf256_mul(uint8_t a, uint8_t b)
+{
+    if (!a || !b)
+    {
+        return 0;
+    }
+    return gf_exp[gf_log[a] + gf_log[b]];
+}
+
+uint8_t gf256_inv(uint8_t a)
+{
+    return a ? gf_exp[255 - gf_log[a]] : 0;
+}
+
+static void mul_add_scalar(uint8_t *dst, const uint8_t *src, size_t len, uint8_t c)
+{
+    const uint8_t *t = gf_nibbles[c];
+
+    for (size_t i = 0; i < len; i++)
+    {
+        dst[i] ^= t[src[i] & 15] ^ t[16 + (src[i] >> 4)];
+    }
+}
+
+#ifdef GF256_X86
+
+// pshufb sert de table de 16 entrées : chaque quartet de la source choisit
+// son produit, les deux moitiés sont combinées par un XOR
+__attribute__((target("ssse3")))
+static void mul_add_ssse3(uint8_t *dst, const uint8_t *src, size_t len, uint8_t c)
+{
+    const __m128i low  = _mm_loadu_si128((const __m128i *)gf_nibbles[c]);
+    const __m128i high = _mm_loadu_si128((const __m128i *)(gf_nibbles[c] + 16));
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    size_t i = 0;
+
+    for (; i + 16 <= len; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i l = _mm_shuffle_epi8(low, _mm_and_si128(v, mask));
+        __m128i h = _mm_shuffle_epi8(high, _mm_and_si128(_mm_srli_epi64(v, 4), mask));
+        __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(d, _mm_xor_si128(l, h)));
+    }
+    mul_add_scalar(dst + i, src + i, len - i, c);
+}
+
+__attribute__((target("avx2")))
+static void mul_add_avx2(uint8_t *dst, const uint8_t *src, size_t len, uint8_t c)
+{
+    const __m256i low  = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)gf_nibbles[c]));
+    const __m256i high = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(gf_nibbles[c] + 16)));
+    const __m256i mask = _mm256_set1_epi8(0x0F);
+    size_t i = 0;
+
+    for (; i + 32 <= len; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i l = _mm256_shuffle_epi8(low, _mm256_and_si256(v, mask));
+        __m256i h = _mm256_shuffle_epi8(high, _mm256_and_si256(_mm256_srli_epi64(v, 4), mask));
+        __m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(d, _mm256_xor_si256(l, h)));
+    }
+    // Le noyau ssse3 est en encodage SSE : sans vzeroupper, chaque appel
+    // paierait la transition AVX -> SSE
+    _mm256_zeroupper();
+    mul_add_ssse3(dst + i, src + i, len - i, c);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void mul_add_avx512(uint8_t *dst, const uint8_t *src, size_t len, uint8_t c)
+{
+    const __m512i low  = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)gf_nibbles[c]));
+    const __m512i high = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)(gf_nibbles[c] + 16)));
+    const __m512i mask = _mm512_set1_epi8(0x0F);
+    size_t i = 0;
+
+    for (; i + 64 <= len; i += 64)
+    {
+        __m512i v = _mm512_loadu_si512(src + i);
+        __m512i l = _mm512_shuffle_epi8(low, _mm512_and_si512(v, mask));
+        __m512i h = _mm512_shuffle_epi8(high, _mm512_and_si512(_mm512_srli_epi64(v, 4), mask));
+        __m512i d = _mm512_loadu_si512(dst + i);
+        _mm512_storeu_si512(dst + i, _mm512_xor_si512(d, _mm512_xor_si512(l, h)));
+    }
+    mul_add_avx2(dst + i, src + i, len - i, c);
+}
+
+static int has_ssse3(void)
+{
+    return __builtin_cpu_supports("ssse3");
+}
+
+static int has_avx2(void)
+{
+    return __builtin_cpu_supports("avx2");
+}
+
+static int has_avx512(void)
+{
+    return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+}
+
+#endif // GF256_X86
+
+// Du plus simple au plus rapide ; gf256_init garde le dernier supporté
+static const struct {
+    gf256_kernel_t kernel;
+    int (*supported)(void);    // NULL = toujours disponible
+} all_kernels[] = {
+    { { "scalar", mul_add_scalar }, NULL },
+#ifdef GF256_X86
+    { { "ssse3",  mul_add_ssse3 },  has_ssse3 },
+    { { "avx2",   mul_add_avx2 },   has_avx2 },
+    { { "avx512", mul_add_avx512 }, has_avx512 },
+#endif
+};
+
+static gf256_kernel_t supported[sizeof(all_kernels) / sizeof(all_kernels[0])];
+static unsigned nb_supported;
+
+void gf256_init(void)
+{
+    if (nb_supported)
+    {
+        return;
+    }
+
+    unsigned x = 1;
+    for (unsigned i = 0; i < 255; i++)
+    {
+        gf_exp[i] = gf_exp[i + 255] = x;
+        gf_log[x] = i;
+        x <<= 1;
+        if (x & 0x100)
+        {
+            x ^= 0x11D;
+        }
+    }
+
+    for (unsigned c = 0; c < 256; c++)
+    {
+        for (unsigned n = 0; n < 16; n++)
+        {
+            gf_nibbles[c][n] = gf256_mul(c, n);
+            gf_nibbles[c][16 + n] = gf256_mul(c, n << 4);
+        }
+    }
+
+#ifdef GF256_X86
+    __builtin_cpu_init();
+#endif
+    for (unsigned i = 0; i < sizeof(all_kernels) / sizeof(all_kernels[0]); i++)
+    {
+        if (!all_kernels[i].supported || all_kernels[i].supported())
+        {
+            supported[nb_supported++] = all_kernels[i].kernel;
+        }
+    }
+}
+
+const gf256_kernel_t *gf256_kernels(unsigned *count)
+{
+    gf256_init();
+    *count = nb_supported;
+    return supported;
+}
+
+void gf256_mul_add(uint8_t *dst, const uint8_t *src, size_t len, uint8_t c)
+{
+    if (c)
+    {
+        supported[nb_supported - 1].mul_add(dst, src, len, c);
+    }
+}
@@ -2,50 +2,159 @@
 #include <signal.h>
 #include <unistd.h>
 #include <stdlib.h>
-#include <liburing.h>
 
 #include "config.h"
+#include "options.h"
 #include "server_socket.h"
-#include "uring_utils.h"
-#include "reception.h"
+#include "worker.h"
+#include "gf256.h"
+#include "sink.h"
+#include "writer.h"
+#include "buffer_pool.h"
+#include "metrics.h"
+#include "frame_shm.h"
 
 volatile int running = 1;
 
 
-int main(void)
+int main(int argc, char **argv)
 {
-    // Setup de la socket du serveur
-    int sock = setup_server_socket();
-    
-    // Si la socket n'a pas pu être créée, on quitte
-    if (sock < 0)
+    server_options_t opts;
+    if (parse_options(argc, argv, &opts) < 0)
     {
         return 1;
     }
 
-    struct io_uring ring;
+    // Tables de la correction d'erreurs, partagées en lecture par les workers
+    gf256_init();
 
-    // Initialisation de io_uring
-    if (io_uring_queue_init(RECV_BUFFERS + 1, &ring, 0) < 0) {
-        perror("io_uring_queue_init");
-        close(sock);
+    // Noyau de conversion des images enregistrées
+    sink_init();
+
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned cores = online > 0 ? (unsigned)online : 1;
+    unsigned nb_workers = opts.workers ? opts.workers : cores;
+    // Un worker au-delà de MAX_STREAMS n'aurait jamais de flux à recevoir
+    if (nb_workers > MAX_STREAMS)
+    {
+        nb_workers = MAX_STREAMS;
+    }
+
+    // Buffers des images : un canvas par worker, une copie par place de la
+    // file du writer et un fichier encodé par écriture en cours
+    pool_init(opts.hugetlb, (size_t)opts.prefault_width * opts.prefault_height * PIXEL_BYTES,
+              nb_workers + WRITER_QUEUE + WRITER_DEPTH);
+
+    // Les images terminées sont enregistrées par un thread à part
+    frame_writer_t writer;
+    if (start_writer(&writer, opts.sink, opts.direct) < 0)
+    {
+        return 1;
+    }
+
+    // Et publiées en mémoire partagée pour les lecteurs locaux
+    frame_publisher_t publisher = { 0 };
+    if (opts.shm_name &&
+        publisher_start(&publisher, opts.shm_name, FRAME_SHM_SLOTS,
+                        opts.prefault_width ? opts.prefault_width : FRAME_SHM_WIDTH,
+                        opts.prefault_height ? opts.prefault_height : FRAME_SHM_HEIGHT) < 0)
+    {
+        stop_writer(&writer);
+        return 1;
+    }
+
+    worker_t *workers = calloc(nb_workers, sizeof(*workers));
+    if (!workers)
+    {
+        perror("calloc");
+        publisher_stop(&publisher);
+        stop_writer(&writer);
+        return 1;
+    }
+
+    // Setup des sockets du serveur, toutes liées au même port avant de
+    // recevoir quoi que ce soit pour que la répartition des émetteurs ne
+    // change plus ensuite
+    unsigned nb_sockets;
+    for (nb_sockets = 0; nb_sockets < nb_workers; nb_sockets++)
+    {
+        worker_t *w = &workers[nb_sockets];
+        w->id = nb_sockets;
+        w->cpu = opts.pin ? (int)(nb_sockets % cores) : -1;
+        w->gro = opts.gro;
+        w->nack = opts.nack;
+        w->writer = &writer;
+        w->publisher = opts.shm_name ? &publisher : NULL;
+        w->sock = setup_server_socket(opts.port, &w->gro, nb_workers > 1);
+
+        // Si la socket n'a pas pu être créée, on quitte
+        if (w->sock < 0)
+        {
+            break;
+        }
+    }
+
+    // Statistiques : ligne périodique et socket Unix, servies par le
+    // thread principal pendant que les workers reçoivent
+    metrics_reporter_t metrics;
+    if (nb_sockets < nb_workers ||
+        metrics_start(&metrics, workers, nb_workers, &writer, opts.metrics_interval,
+                      opts.metrics_socket) < 0)
+    {
+        for (unsigned i = 0; i < nb_sockets; i++)
+        {
+            close(workers[i].sock);
+        }
+        free(workers);
+        publisher_stop(&publisher);
+        stop_writer(&writer);
         return 1;
     }
 
-    printf("Serveur UDP démarré sur le port %d. Arrêt auto après %d sec d'inactivité.\n", PORT, SHUTDOWN_TIMEOUT);
+    printf("Serveur UDP démarré sur le port %d avec %u worker(s). Arrêt auto après %d sec d'inactivité.\n",
+           opts.port, nb_workers, SHUTDOWN_TIMEOUT);
+
+    // Chaque worker gère sa socket, sa ring et ses flux
+    unsigned started;
+    for (started = 0; started < nb_workers; started++)
+    {
+        if (start_worker(&workers[started]) < 0)
+        {
+            running = 0;
+            break;
+        }
+    }
+
+    // Jusqu'à l'arrêt, ou la fin de tous les workers (erreurs)
+    for (unsigned i = 0; i < started && running; )
+    {
+        if (__atomic_load_n(&workers[i].done, __ATOMIC_ACQUIRE))
+        {
+            i++;
+            continue;
+        }
+        metrics_wait(&metrics, 100);
+    }
 
-    // Initialise les requêtes de réception dans io_uring
-    prime_uring_requests(&ring, sock);
+    for (unsigned i = 0; i < started; i++)
+    {
+        join_worker(&workers[i]);
+    }
 
-    // Boucle principale du serveur, gérant la réception et le timeout
-    run_server_loop(&ring, sock);
+    // Les dernières images des workers sont écrites avant de quitter
+    stop_writer(&writer);
+    publisher_stop(&publisher);
+    metrics_stop(&metrics);
+    pool_report();
 
     printf("Arrêt du serveur...\n");
 
-    // Réinitialise l'état de réception et free les ressources
-    reset_reception_state();
-    io_uring_queue_exit(&ring);
-    close(sock);
+    // Free les ressources
+    for (unsigned i = 0; i < nb_workers; i++)
+    {
+        close(workers[i].sock);
+    }
+    free(workers);
 
     return 0;
-}
\ No newline at end of file
+}
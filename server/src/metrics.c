@@ -0,0 +1,263 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "metrics.h"
+#include "worker.h"
+#include "writer.h"
+#include "config.h"
+
+#define METRICS_LINE 2048
+
+static uint64_t monotonic_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+#define LOAD(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+
+// Borne haute du seau qui contient le centile p (0 à 1)
+uint64_t metrics_hist_percentile(const metrics_hist_t *h, double p)
+{
+    uint64_t count = LOAD(h->count);
+    if (!count)
+    {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(p * count);
+    if (rank == 0)
+    {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (unsigned b = 0; b < METRICS_BUCKETS; b++)
+    {
+        seen += LOAD(h->buckets[b]);
+        if (seen >= rank)
+        {
+            return b ? (1ULL << b) - 1 : 0;
+        }
+    }
+    return (1ULL << (METRICS_BUCKETS - 1)) - 1;
+}
+
+// Additionne les compteurs des workers, lus pendant qu'ils reçoivent
+static void collect(const worker_t *w, unsigned nb, rx_metrics_t *sum)
+{
+    uint64_t *dst = (uint64_t *)sum;
+
+    memset(sum, 0, sizeof(*sum));
+    for (unsigned i = 0; i < nb; i++)
+    {
+        const uint64_t *src = (const uint64_t *)&w[i].rx.stats;
+        for (size_t f = 0; f < sizeof(*sum) / sizeof(uint64_t); f++)
+        {
+            dst[f] += LOAD(src[f]);
+        }
+    }
+}
+
+// Une ligne « metrics » de paires clé=valeur, débits calculés depuis prev
+// (elapsed secondes plus tôt). L'ordre et le nom des clés ne changent pas :
+// seules des clés peuvent s'ajouter à la fin.
+static int format_line(const metrics_reporter_t *mr, const rx_metrics_t *cur,
+                       const rx_metrics_t *prev, double elapsed, char *buf, size_t size)
+{
+    const frame_writer_t *wr = mr->writer;
+    double uptime = (monotonic_us() - mr->start_us) / 1e6;
+    uint64_t batches = cur->batches - prev->batches;
+
+    return snprintf(buf, size,
+                    "metrics uptime_s=%.3f interval_s=%.3f rx_pps=%.0f rx_bytes_s=%.0f "
+                    "datagrams=%llu bytes=%llu completions=%llu batches=%llu "
+                    "batch_avg=%.1f batch_p50=%llu batch_p99=%llu rearms=%llu "
+                    "no_buffers=%llu socket_drops=%llu duplicates=%llu stale=%llu "
+                    "streams=%llu images=%llu incomplete=%llu lost=%llu nacks=%llu "
+                    "reports=%llu reassembly_p50_us=%llu reassembly_p99_us=%llu "
+                    "saved=%llu save_dropped=%llu save_failed=%llu save_bytes=%llu "
+                    "save_in_flight=%u save_p50_us=%llu save_p99_us=%llu save_max_us=%llu "
+                    "published=%llu publish_skipped=%llu publish_p50_us=%llu "
+                    "publish_p99_us=%llu concealed=%llu held=%llu held_expired=%llu "
+                    "expired=%llu\n",
+                    uptime, elapsed,
+                    elapsed > 0 ? (cur->datagrams - prev->datagrams) / elapsed : 0.0,
+                    elapsed > 0 ? (cur->bytes - prev->bytes) / elapsed : 0.0,
+                    (unsigned long long)cur->datagrams, (unsigned long long)cur->bytes,
+                    (unsigned long long)cur->completions, (unsigned long long)cur->batches,
+                    batches ? (double)(cur->completions - prev->completions) / batches : 0.0,
+                    (unsigned long long)metrics_hist_percentile(&cur->batch, 0.5),
+                    (unsigned long long)metrics_hist_percentile(&cur->batch, 0.99),
+                    (unsigned long long)cur->rearms, (unsigned long long)cur->no_buffers,
+                    (unsigned long long)cur->socket_drops, (unsigned long long)cur->duplicates,
+                    (unsigned long long)cur->stale, (unsigned long long)cur->streams,
+                    (unsigned long long)cur->images, (unsigned long long)cur->incomplete,
+                    (unsigned long long)cur->lost, (unsigned long long)cur->nacks,
+                    (unsigned long long)cur->reports,
+                    (unsigned long long)metrics_hist_percentile(&cur->reassembly_us, 0.5),
+                    (unsigned long long)metrics_hist_percentile(&cur->reassembly_us, 0.99),
+                    LOAD(wr->written), LOAD(wr->dropped), LOAD(wr->failed), LOAD(wr->bytes),
+                    LOAD(wr->in_flight),
+                    (unsigned long long)metrics_hist_percentile(&wr->latency_us, 0.5),
+                    (unsigned long long)metrics_hist_percentile(&wr->latency_us, 0.99),
+                    (unsigned long long)LOAD(wr->max_latency_us),
+                    (unsigned long long)cur->published, (unsigned long long)cur->publish_skipped,
+                    (unsigned long long)metrics_hist_percentile(&cur->publish_us, 0.5),
+                    (unsigned long long)metrics_hist_percentile(&cur->publish_us, 0.99),
+                    (unsigned long long)cur->concealed, (unsigned long long)cur->held,
+                    (unsigned long long)cur->held_expired, (unsigned long long)cur->expired);
+}
+
+// Ligne périodique : débits depuis la ligne précédente
+static void print_line(metrics_reporter_t *mr, uint64_t now)
+{
+    char line[METRICS_LINE];
+    rx_metrics_t cur;
+
+    collect(mr->workers, mr->nb_workers, &cur);
+    format_line(mr, &cur, &mr->last, (now - mr->last_us) / 1e6, line, sizeof(line));
+    fputs(line, stdout);
+    fflush(stdout);
+    mr->last = cur;
+    mr->last_us = now;
+}
+
+// Répond aux connexions en attente sur la socket : l'état courant (débits
+// moyens depuis le démarrage) puis une ligne par worker, et fermeture
+static void serve_clients(metrics_reporter_t *mr)
+{
+    char buf[METRICS_LINE * 2];
+    rx_metrics_t cur, zero;
+    int client;
+
+    while ((client = accept4(mr->listen_fd, NULL, NULL, SOCK_CLOEXEC)) >= 0)
+    {
+        collect(mr->workers, mr->nb_workers, &cur);
+        memset(&zero, 0, sizeof(zero));
+        int len = format_line(mr, &cur, &zero, (monotonic_us() - mr->start_us) / 1e6,
+                              buf, sizeof(buf));
+
+        for (unsigned i = 0; i < mr->nb_workers && len < (int)sizeof(buf); i++)
+        {
+            collect(&mr->workers[i], 1, &cur);
+            len += snprintf(buf + len, sizeof(buf) - len,
+                            "metrics_worker id=%u datagrams=%llu bytes=%llu socket_drops=%llu "
+                            "no_buffers=%llu streams=%llu images=%llu lost=%llu\n",
+                            i, (unsigned long long)cur.datagrams, (unsigned long long)cur.bytes,
+                            (unsigned long long)cur.socket_drops,
+                            (unsigned long long)cur.no_buffers, (unsigned long long)cur.streams,
+                            (unsigned long long)cur.images, (unsigned long long)cur.lost);
+        }
+        if (len > (int)sizeof(buf))
+        {
+            len = sizeof(buf);
+        }
+
+        // Quelques Ko tiennent dans le buffer de la socket : pas d'attente
+        if (send(client, buf, len, MSG_NOSIGNAL | MSG_DONTWAIT) < 0)
+        {
+            perror("metrics: send");
+        }
+        close(client);
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+    {
+        perror("metrics: accept");
+    }
+}
+
+static int listen_unix(const char *path)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "Metrics socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    // Socket laissée par une exécution précédente : remplacée. Tout autre
+    // fichier à cet endroit est laissé tel quel (bind échouera).
+    struct stat st;
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+    {
+        unlink(path);
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        perror("socket(AF_UNIX)");
+        return -1;
+    }
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 8) < 0)
+    {
+        fprintf(stderr, "Metrics socket %s: %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int metrics_start(metrics_reporter_t *mr, worker_t *workers, unsigned nb_workers,
+                  frame_writer_t *writer, unsigned interval, const char *path)
+{
+    memset(mr, 0, sizeof(*mr));
+    mr->workers = workers;
+    mr->nb_workers = nb_workers;
+    mr->writer = writer;
+    mr->interval = interval;
+    mr->path = path;
+    mr->listen_fd = -1;
+    mr->start_us = mr->last_us = monotonic_us();
+
+    if (path)
+    {
+        mr->listen_fd = listen_unix(path);
+        if (mr->listen_fd < 0)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Attend au plus timeout_ms en répondant aux lecteurs de la socket, et
+// affiche la ligne périodique quand elle est due
+void metrics_wait(metrics_reporter_t *mr, int timeout_ms)
+{
+    struct pollfd pfd = { .fd = mr->listen_fd, .events = POLLIN };
+
+    if (poll(&pfd, mr->listen_fd >= 0, timeout_ms) > 0)
+    {
+        serve_clients(mr);
+    }
+
+    uint64_t now = monotonic_us();
+    if (mr->interval && now - mr->last_us >= mr->interval * 1000000ULL)
+    {
+        print_line(mr, now);
+    }
+}
+
+// Dernière ligne (depuis la précédente) et fermeture de la socket
+void metrics_stop(metrics_reporter_t *mr)
+{
+    if (mr->interval)
+    {
+        print_line(mr, monotonic_us());
+    }
+    if (mr->listen_fd >= 0)
+    {
+        close(mr->listen_fd);
+        unlink(mr->path);
+        mr->listen_fd = -1;
+    }
+}
@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "nack.h"
+#include "packet.h"
+#include "config.h"
+
+// Construit et envoie un NACK pour les trous du masque dans [from, limit).
+// Un datagramme contient au plus NACK_MAX_RANGES plages : les suivantes
+// partiront au prochain examen. Retourne 1 si un NACK a été envoyé.
+static int nack_stream(reception_state_t *rx, int sock, uint32_t from, uint32_t limit)
+{
+    struct {
+        struct nack_header hdr;
+        struct nack_range ranges[NACK_MAX_RANGES];
+    } msg;
+    uint32_t nb = 0, seq = from;
+
+    while (seq < limit && nb < NACK_MAX_RANGES)
+    {
+        const uint8_t *hole = memchr(rx->received_mask + seq, 0, limit - seq);
+        if (!hole)
+        {
+            seq = limit;
+            break;
+        }
+        uint32_t first = hole - rx->received_mask;
+        uint32_t end = first + 1;
+        while (end < limit && !rx->received_mask[end])
+        {
+            end++;
+        }
+
+        msg.ranges[nb].seq = htonl(first);
+        msg.ranges[nb].count = htonl(end - first);
+        nb++;
+        seq = end;
+
+        // Une nouvelle demande après NACK_RETRY_MS repart du début du
+        // masque : chaque paquet n'est compté qu'à sa première demande
+        if (end > rx->nack_counted)
+        {
+            rx->nacked += end - (first > rx->nack_counted ? first : rx->nack_counted);
+            rx->nack_counted = end;
+        }
+    }
+    rx->nack_next = seq;
+
+    if (!nb)
+    {
+        return 0;
+    }
+
+    msg.hdr.magic = htonl(NACK_MAGIC);
+    msg.hdr.stream_id = htonl(rx->key.stream_id);
+    msg.hdr.image_id = htonl(rx->current_image_id);
+    msg.hdr.nb_ranges = htonl(nb);
+
+    struct sockaddr_in to = {
+        .sin_family = AF_INET,
+        .sin_port = rx->key.port,
+        .sin_addr.s_addr = rx->key.addr
+    };
+
+    // Envoi direct : un NACK est rare et petit, et la socket de réception
+    // du worker est aussi celle que l'émetteur connaît
+    size_t len = sizeof(msg.hdr) + nb * sizeof(msg.ranges[0]);
+    if (sendto(sock, &msg, len, MSG_DONTWAIT, (struct sockaddr *)&to, sizeof(to)) < 0)
+    {
+        perror("sendto(NACK)");
+        return 0;
+    }
+    return 1;
+}
+
+// Décide ce qu'il faut redemander pour l'image en cours d'un flux. Pendant
+// la réception, seuls les trous sous le plus grand paquet reçu sont
+// signalés ; si plus rien n'arrive, la fin de l'image est perdue aussi.
+static int check_stream(reception_state_t *rx, int sock, uint64_t now_ms)
+{
+    if (!rx->active || rx->retired || rx->packets_received == rx->total_packets)
+    {
+        return 0;
+    }
+
+    // Premier examen de cette image : le délai de grâce commence
+    if (!rx->nack_deadline_ms)
+    {
+        rx->nack_deadline_ms = now_ms + NACK_DEADLINE_MS;
+        rx->nack_last_ms = now_ms;
+        rx->nack_rescan_ms = now_ms;
+        rx->nack_progress = rx->packets_received;
+        return 0;
+    }
+
+    // Trop tard : l'émetteur n'a plus l'image, on n'insiste pas
+    if (now_ms >= rx->nack_deadline_ms || now_ms - rx->nack_last_ms < NACK_INTERVAL_MS)
+    {
+        return 0;
+    }
+
+    uint32_t limit = rx->packets_received == rx->nack_progress ?
+                     rx->total_packets : rx->next_seq;
+    rx->nack_progress = rx->packets_received;
+    rx->nack_last_ms = now_ms;
+
+    // Les paquets déjà demandés ne le sont à nouveau qu'après NACK_RETRY_MS
+    // (la retransmission peut encore être en route)
+    uint32_t from = rx->nack_next;
+    if (now_ms - rx->nack_rescan_ms >= NACK_RETRY_MS)
+    {
+        from = 0;
+        rx->nack_rescan_ms = now_ms;
+    }
+    if (from >= limit)
+    {
+        return 0;
+    }
+    return nack_stream(rx, sock, from, limit);
+}
+
+unsigned send_nacks(stream_table_t *streams, int sock, uint64_t now_ms)
+{
+    unsigned sent = 0;
+    uint64_t due_ms = 0;
+
+    for (unsigned b = 0; b < STREAM_BUCKETS; b++)
+    {
+        for (reception_state_t *rx = streams->buckets[b]; rx; rx = rx->next)
+        {
+            sent += check_stream(rx, sock, now_ms);
+
+            // Image encore incomplète et demandes pas abandonnées : prochain
+            // examen NACK_INTERVAL_MS après le dernier
+            if (rx->active && !rx->retired && rx->packets_received < rx->total_packets &&
+                now_ms < rx->nack_deadline_ms)
+            {
+                uint64_t at = rx->nack_last_ms + NACK_INTERVAL_MS;
+                due_ms = !due_ms || at < due_ms ? at : due_ms;
+            }
+        }
+    }
+    streams->nack_due_us = due_ms * 1000;
+    return sent;
+}
+
+unsigned send_reports(stream_table_t *streams, int sock)
+{
+    unsigned sent = 0;
+
+    for (unsigned b = 0; b < STREAM_BUCKETS; b++)
+    {
+        for (reception_state_t *rx = streams->buckets[b]; rx; rx = rx->next)
+        {
+            struct sockaddr_in to = {
+                .sin_family = AF_INET,
+                .sin_port = rx->key.port,
+                .sin_addr.s_addr = rx->key.addr
+            };
+
+            for (unsigned i = 0; i < rx->reports_pending; i++)
+            {
+                if (sendto(sock, &rx->reports[i], sizeof(rx->reports[i]), MSG_DONTWAIT,
+                           (struct sockaddr *)&to, sizeof(to)) < 0)
+                {
+                    perror("sendto(report)");
+                    continue;
+                }
+                sent++;
+            }
+            rx->reports_pending = 0;
+        }
+    }
+    return sent;
+}
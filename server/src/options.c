@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <getopt.h>
+#include <unistd.h>
+#include "options.h"
+#include "sink.h"
+#include "config.h"
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [-P port] [-G] [-w workers] [-p] [-N] [-o format] [-d]\n"
+            "       [-H] [-R WxH] [-m seconds] [-M path] [-F name]\n"
+            "  -P port     UDP port to listen on (default %d)\n"
+            "  -G          receive one datagram per buffer (disable UDP GRO)\n"
+            "  -w workers  receive threads, each with its own SO_REUSEPORT socket\n"
+            "              and io_uring, 1 to the number of cores (default: one\n"
+            "              per core)\n"
+            "  -p          pin worker N to CPU N\n"
+            "  -N          never ask senders to retransmit lost packets\n"
+            "  -o format   saved images: ppm (default), qoi or png (compressed in\n"
+            "              parallel stripes)\n"
+            "  -d          write images with O_DIRECT, bypassing the page cache\n"
+            "  -H          back image buffers with reserved huge pages (MAP_HUGETLB,\n"
+            "              see vm.nr_hugepages) instead of transparent huge pages\n"
+            "  -R WxH      expected resolution: image buffers are mapped and faulted\n"
+            "              in at startup instead of on the first images\n"
+            "  -m seconds  print a machine-readable \"metrics key=value ...\" line\n"
+            "              every N seconds (default 0 = never)\n"
+            "  -M path     serve the current metrics on a Unix socket: each\n"
+            "              connection receives them, then the socket is closed\n"
+            "  -F name     also publish each finished image to the POSIX shared\n"
+            "              memory /name (%d slots sized for -R, default %dx%d) for\n"
+            "              local viewers, see include/frame_shm.h\n",
+            prog, PORT, FRAME_SHM_SLOTS, FRAME_SHM_WIDTH, FRAME_SHM_HEIGHT);
+}
+
+// Remplit opts à partir de argv, retourne -1 si un argument est invalide
+int parse_options(int argc, char **argv, server_options_t *opts)
+{
+    // Valeurs par défaut
+    opts->port = PORT;
+    opts->gro = 1;
+    opts->workers = 0;
+    opts->pin = 0;
+    opts->nack = 1;
+    opts->sink = &ppm_sink;
+    opts->direct = 0;
+    opts->hugetlb = 0;
+    opts->prefault_width = opts->prefault_height = 0;
+    opts->metrics_interval = 0;
+    opts->metrics_socket = NULL;
+    opts->shm_name = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "P:Gw:pNo:dHR:m:M:F:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'P':
+        {
+            char *end;
+            unsigned long port = strtoul(optarg, &end, 10);
+            if (end == optarg || *end || port == 0 || port > 65535)
+            {
+                fprintf(stderr, "Invalid port: %s\n", optarg);
+                usage(argv[0]);
+                return -1;
+            }
+            opts->port = port;
+            break;
+        }
+        case 'G':
+            opts->gro = 0;
+            break;
+        case 'w':
+        {
+            // Au plus un worker par coeur, et pas plus de workers que de
+            // flux acceptés en tout (MAX_STREAMS)
+            long online = sysconf(_SC_NPROCESSORS_ONLN);
+            unsigned long max = online > 0 ? (unsigned long)online : 1;
+            if (max > MAX_STREAMS)
+            {
+                max = MAX_STREAMS;
+            }
+            char *end;
+            unsigned long workers = strtoul(optarg, &end, 10);
+            if (end == optarg || *end || workers == 0 || workers > max)
+            {
+                fprintf(stderr, "Invalid number of workers: %s (1 to %lu)\n", optarg, max);
+                usage(argv[0]);
+                return -1;
+            }
+            opts->workers = workers;
+            break;
+        }
+        case 'p':
+            opts->pin = 1;
+            break;
+        case 'N':
+            opts->nack = 0;
+            break;
+        case 'o':
+            opts->sink = sink_find(optarg);
+            if (!opts->sink)
+            {
+                fprintf(stderr, "Unknown image format: %s\n", optarg);
+                usage(argv[0]);
+                return -1;
+            }
+            break;
+        case 'd':
+            opts->direct = 1;
+            break;
+        case 'H':
+            opts->hugetlb = 1;
+            break;
+        case 'R':
+            if (sscanf(optarg, "%ux%u", &opts->prefault_width, &opts->prefault_height) != 2 ||
+                !opts->prefault_width || !opts->prefault_height ||
+                opts->prefault_width > MAX_DIMENSION || opts->prefault_height > MAX_DIMENSION)
+            {
+                fprintf(stderr, "Invalid resolution: %s\n", optarg);
+                usage(argv[0]);
+                return -1;
+            }
+            break;
+        case 'm':
+        {
+            char *end;
+            unsigned long interval = strtoul(optarg, &end, 10);
+            if (end == optarg || *end || optarg[0] == '-' || interval > UINT_MAX)
+            {
+                fprintf(stderr, "Invalid metrics interval: %s\n", optarg);
+                usage(argv[0]);
+                return -1;
+            }
+            opts->metrics_interval = interval;
+            break;
+        }
+        case 'M':
+            opts->metrics_socket = optarg;
+            break;
+        case 'F':
+            // shm_open veut un nom de la forme /nom
+            if (optarg[0] != '/' || !optarg[1] || strchr(optarg + 1, '/'))
+            {
+                fprintf(stderr, "Invalid shared memory name: %s (expected /name)\n", optarg);
+                usage(argv[0]);
+                return -1;
+            }
+            opts->shm_name = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return -1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include <string.h>
+#include "pixel_format.h"
+
+static const char *const format_names[PIXEL_FORMATS] = {
+    "bgrx", "bgr24", "rgb565", "yuv420"
+};
+
+const char *pixel_format_name(uint32_t format)
+{
+    return format < PIXEL_FORMATS ? format_names[format] : "?";
+}
+
+void pixel_clear(uint32_t format, uint8_t *pixels, size_t bytes)
+{
+    memset(pixels, 0, bytes);
+
+    // Le noir en YCbCr a une chrominance de 128
+    if (format == PIXEL_FORMAT_YUV420)
+    {
+        for (size_t i = 0; i + 6 <= bytes; i += 6)
+        {
+            pixels[i + 4] = 128;
+            pixels[i + 5] = 128;
+        }
+    }
+}
+
+static inline uint8_t clamp(int v)
+{
+    return v < 0 ? 0 : v > 255 ? 255 : (uint8_t)v;
+}
+
+// Un pixel à partir de sa luminance et de la chrominance de son bloc
+// (coefficients BT.601 sur 16 bits)
+static inline void yuv_to_bgrx(uint8_t y, int cb, int cr, uint8_t *dst)
+{
+    int l = (int)y << 16;
+
+    dst[0] = clamp((l + 116130 * cb + 32768) >> 16);
+    dst[1] = clamp((l - 22554 * cb - 46802 * cr + 32768) >> 16);
+    dst[2] = clamp((l + 91881 * cr + 32768) >> 16);
+    dst[3] = 0xFF;
+}
+
+void pixel_row_to_bgrx(uint32_t format, const uint8_t *src, uint32_t width,
+                       uint8_t *dst, size_t dst_stride)
+{
+    switch (format)
+    {
+    case PIXEL_FORMAT_BGR24:
+        for (uint32_t x = 0; x < width; x++, src += 3, dst += 4)
+        {
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+            dst[3] = 0xFF;
+        }
+        break;
+    case PIXEL_FORMAT_RGB565:
+        // Les bits manquants reprennent les bits de poids fort : 31 -> 255
+        for (uint32_t x = 0; x < width; x++, src += 2, dst += 4)
+        {
+            uint32_t v = src[0] | (uint32_t)src[1] << 8;
+            uint32_t r = v >> 11, g = (v >> 5) & 0x3F, b = v & 0x1F;
+            dst[0] = (uint8_t)(b << 3 | b >> 2);
+            dst[1] = (uint8_t)(g << 2 | g >> 4);
+            dst[2] = (uint8_t)(r << 3 | r >> 2);
+            dst[3] = 0xFF;
+        }
+        break;
+    case PIXEL_FORMAT_YUV420:
+        // Une largeur impaire laisse un bloc à moitié hors de l'image
+        for (uint32_t x = 0; x < width; x += 2, src += 6, dst += 8)
+        {
+            int cb = src[4] - 128, cr = src[5] - 128;
+            yuv_to_bgrx(src[0], cb, cr, dst);
+            yuv_to_bgrx(src[2], cb, cr, dst + dst_stride);
+            if (x + 1 < width)
+            {
+                yuv_to_bgrx(src[1], cb, cr, dst + 4);
+                yuv_to_bgrx(src[3], cb, cr, dst + dst_stride + 4);
+            }
+        }
+        break;
+    default:
+        memcpy(dst, src, (size_t)width * 4);
+        break;
+    }
+}
@@ -1,131 +1,963 @@
 #include "reception.h"
+#include "streams.h"
 #include "config.h"
+#include "fec.h"
+#include "pixel_format.h"
+#include "codec.h"
+#include "writer.h"
+#include "buffer_pool.h"
+#include "metrics.h"
+#include "frame_shm.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <arpa/inet.h>
-#include <time.h>
 
-// État de réception des images
-reception_state_t rx_state = {0};
+// Réinitialise l'état de réception d'un flux et libère son canvas
+void reset_reception_state(stream_table_t *streams, reception_state_t *rx)
+{
+    if (rx->canvas)
+    {
+        pool_free(rx->canvas, pixel_image_bytes(rx->format, rx->width, rx->height));
+    }
+    free(rx->received_mask);
+    free(rx->tile_stage);
+    free(rx->tile_filled);
+    conceal_free(&rx->conceal);
+    free(rx->held);
+    fec_free(rx);
+    stream_release(streams, rx, rx->memory);
+
+    // Le flux garde sa place dans la table
+    stream_key_t key = rx->key;
+    unsigned index = rx->index;
+    uint64_t last_activity_us = rx->last_activity_us;
+    reception_state_t *next = rx->next;
+
+    memset(rx, 0, sizeof(*rx));
+    rx->key = key;
+    rx->index = index;
+    rx->last_activity_us = last_activity_us;
+    rx->next = next;
+}
+
+// Prépare la réception d'une nouvelle image. Le canvas est conservé d'une
+// image à l'autre tant que la résolution ne change pas : les images delta
+// n'apportent que les tuiles modifiées.
+static int begin_image(stream_table_t *streams, reception_state_t *rx,
+                       const struct packet_header *hdr)
+{
+    uint32_t width  = ntohl(hdr->width);
+    uint32_t height = ntohl(hdr->height);
+    uint32_t total  = ntohl(hdr->total_packets);
+    uint32_t format = FRAME_FORMAT(ntohl(hdr->flags));
+    uint32_t codec  = FRAME_CODEC(ntohl(hdr->flags));
+
+    if (width == 0 || height == 0 || width > MAX_DIMENSION || height > MAX_DIMENSION ||
+        format >= PIXEL_FORMATS || codec >= TILE_CODECS)
+    {
+        return -1;
+    }
+
+    // Nouvelle résolution ou nouveau format : on repart d'un canvas noir
+    if (!rx->canvas || width != rx->width || height != rx->height || format != rx->format)
+    {
+        size_t bytes = pixel_image_bytes(format, width, height);
+
+        if (rx->canvas)
+        {
+            size_t old = pixel_image_bytes(rx->format, rx->width, rx->height);
+            stream_release(streams, rx, old);
+            pool_free(rx->canvas, old);
+            rx->canvas = NULL;
+        }
+        if (stream_reserve(streams, rx, bytes) < 0)
+        {
+            reset_reception_state(streams, rx);
+            return -1;
+        }
+        rx->canvas = pool_alloc(bytes);
+        if (!rx->canvas)
+        {
+            reset_reception_state(streams, rx);
+            return -1;
+        }
+        pixel_clear(format, rx->canvas, bytes);
+
+        // Rien n'est encore valide dans le nouveau canvas
+        stream_release(streams, rx, conceal_size(rx->format, rx->width, rx->height));
+        conceal_free(&rx->conceal);
+        if (stream_reserve(streams, rx, conceal_size(format, width, height)) < 0 ||
+            conceal_init(&rx->conceal, format, width, height) < 0)
+        {
+            reset_reception_state(streams, rx);
+            return -1;
+        }
+        rx->width   = width;
+        rx->height  = height;
+        rx->format  = format;
+        rx->stride  = (size_t)pixel_blocks(format, width) * pixel_block_bytes(format);
+        rx->tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+        rx->tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+        rx->synced  = 0;
+    }
+
+    // Le masque ne grandit que si l'image a plus de paquets que les précédentes
+    if (total > rx->mask_capacity)
+    {
+        if (stream_reserve(streams, rx, total - rx->mask_capacity) < 0)
+        {
+            reset_reception_state(streams, rx);
+            return -1;
+        }
+        uint8_t *mask = realloc(rx->received_mask, total);
+        if (!mask)
+        {
+            perror("realloc");
+            reset_reception_state(streams, rx);
+            return -1;
+        }
+        rx->received_mask = mask;
+        rx->mask_capacity = total;
+    }
+    memset(rx->received_mask, 0, total);
+
+    // Tuiles compressées : une place par tuile, gardée pour les images
+    // suivantes comme le masque
+    uint32_t tiles = rx->tiles_x * rx->tiles_y;
+    if (codec && tiles > rx->stage_capacity)
+    {
+        size_t grow = (size_t)(tiles - rx->stage_capacity) * (TILE_MAX_BYTES + sizeof(uint16_t));
+        if (stream_reserve(streams, rx, grow) < 0)
+        {
+            reset_reception_state(streams, rx);
+            return -1;
+        }
+        uint8_t *stage = realloc(rx->tile_stage, (size_t)tiles * TILE_MAX_BYTES);
+        if (stage)
+        {
+            rx->tile_stage = stage;
+        }
+        uint16_t *filled = realloc(rx->tile_filled, (size_t)tiles * sizeof(uint16_t));
+        if (filled)
+        {
+            rx->tile_filled = filled;
+        }
+        if (!stage || !filled)
+        {
+            perror("realloc");
+            reset_reception_state(streams, rx);
+            return -1;
+        }
+        rx->stage_capacity = tiles;
+    }
+    if (codec)
+    {
+        memset(rx->tile_filled, 0, (size_t)tiles * sizeof(uint16_t));
+    }
+
+    rx->active            = 1;
+    rx->current_image_id  = ntohl(hdr->image_id);
+    rx->total_packets     = total;
+    rx->flags             = ntohl(hdr->flags) & FRAME_FLAGS_MASK;
+    rx->codec             = codec;
+    rx->fec_k             = PACKET_FEC_K(ntohl(hdr->flags));
+    if (rx->fec_k > FEC_MAX_K)
+    {
+        rx->fec_k = 0;
+    }
+    rx->packets_received  = 0;
+    rx->next_seq          = 0;
+    rx->recovered         = 0;
+    rx->nack_deadline_ms  = 0;
+    rx->nack_next         = 0;
+    rx->nack_counted      = 0;
+    rx->nacked            = 0;
+    rx->parity_received   = 0;
+    rx->fec_recovered     = 0;
+    rx->tiles_decoded     = 0;
+    rx->tiles_failed      = 0;
+    rx->first_arrival_us  = streams->now_us;
+    rx->last_arrival_us   = streams->now_us;
+    rx->complete_us       = 0;
+    rx->reported          = 0;
+    rx->published         = 0;
+    rx->retired           = 0;
+    rx->concealed         = 0;
+    conceal_begin(&rx->conceal);
+
+    // Avec des parités, on garde de quoi reconstruire les symboles reçus
+    if (rx->fec_k && fec_begin_image(streams, rx) < 0)
+    {
+        reset_reception_state(streams, rx);
+        return -1;
+    }
+    return 0;
+}
+
+// Situe dans le canvas la zone d'une tuile (les tuiles de bord sont plus
+// petites). Retourne la taille de la tuile en octets, 0 si elle n'existe pas.
+// Positions et tailles sont en blocs du format (des pixels sauf en 4:2:0).
+static size_t tile_geometry(const reception_state_t *rx, uint32_t tile_id,
+                            uint8_t **base, size_t *row_bytes)
+{
+    if (tile_id >= rx->tiles_x * rx->tiles_y)
+    {
+        return 0;
+    }
+
+    uint32_t bytes  = pixel_block_bytes(rx->format);
+    uint32_t tile   = TILE_SIZE / pixel_block(rx->format);
+    uint32_t width  = pixel_blocks(rx->format, rx->width);
+    uint32_t height = pixel_blocks(rx->format, rx->height);
+    uint32_t x0 = (tile_id % rx->tiles_x) * tile;
+    uint32_t y0 = (tile_id / rx->tiles_x) * tile;
+    uint32_t tw = width - x0 < tile ? width - x0 : tile;
+    uint32_t th = height - y0 < tile ? height - y0 : tile;
+
+    *base = rx->canvas + y0 * rx->stride + (size_t)x0 * bytes;
+    *row_bytes = (size_t)tw * bytes;
+    return *row_bytes * th;
+}
+
+// Vrai si offset (champ du tile_header) situe le paquet dans une tuile
+// compressée
+static inline int tile_packed(const reception_state_t *rx, uint32_t offset)
+{
+    return rx->codec && TILE_PACKED_SIZE(offset);
+}
+
+// Taille des données du paquet qui commence à offset dans la tuile : un
+// paquet est plein sauf le dernier de sa tuile. 0 si la position est invalide.
+size_t tile_data_length(const reception_state_t *rx, uint32_t tile_id, uint32_t offset)
+{
+    uint8_t *base;
+    size_t row_bytes;
+    size_t size = tile_geometry(rx, tile_id, &base, &row_bytes);
+
+    // Les paquets d'une tuile compressée découpent ses données compressées,
+    // toujours plus petites que la tuile
+    if (tile_packed(rx, offset))
+    {
+        size = TILE_PACKED_SIZE(offset) < size ? TILE_PACKED_SIZE(offset) : 0;
+        offset = TILE_PACKED_OFFSET(offset);
+    }
+
+    if (offset >= size)
+    {
+        return 0;
+    }
+    return size - offset < PACKET_PAYLOAD ? size - offset : PACKET_PAYLOAD;
+}
+
+// Copie les données d'un paquet à leur place dans le canvas
+static void apply_tile_data(reception_state_t *rx, uint32_t tile_id, uint32_t offset,
+                            const uint8_t *data, size_t len)
+{
+    uint8_t *base;
+    size_t row_bytes;
+    size_t size = tile_geometry(rx, tile_id, &base, &row_bytes);
+
+    // On ignore un paquet qui déborderait de sa tuile
+    if (!size || offset > size || len > size - offset)
+    {
+        return;
+    }
+
+    size_t stride = rx->stride;
+    size_t row = offset / row_bytes;
+    size_t col = offset % row_bytes;
+
+    // Les données du paquet couvrent une fin de ligne, des lignes entières
+    // puis un début de ligne de la tuile
+    while (len)
+    {
+        size_t chunk = row_bytes - col;
+        if (chunk > len)
+        {
+            chunk = len;
+        }
+        memcpy(base + row * stride + col, data, chunk);
+        conceal_received(&rx->conceal, tile_id, row, chunk, row_bytes);
+        data += chunk;
+        len -= chunk;
+        row++;
+        col = 0;
+    }
+}
+
+// Accumule les données d'un paquet de tuile compressée, puis décompresse
+// la tuile dans le canvas dès qu'elle est complète. Une tuile incomplète
+// laisse le canvas tel qu'il était.
+static void stage_tile_data(reception_state_t *rx, uint32_t tile_id, uint32_t offset,
+                            const uint8_t *data, size_t len)
+{
+    uint8_t *base;
+    size_t row_bytes;
+    size_t size = tile_geometry(rx, tile_id, &base, &row_bytes);
+    size_t packed = TILE_PACKED_SIZE(offset);
+
+    offset = TILE_PACKED_OFFSET(offset);
+    if (!size || packed >= size || offset > packed || len > packed - offset)
+    {
+        return;
+    }
+
+    uint8_t *stage = rx->tile_stage + (size_t)tile_id * TILE_MAX_BYTES;
+    memcpy(stage + offset, data, len);
+    rx->tile_filled[tile_id] += len;
+    if (rx->tile_filled[tile_id] != packed)
+    {
+        return;
+    }
+
+    uint8_t raw[TILE_MAX_BYTES];
+    if (codec_decompress(rx->codec, stage, packed, raw, sizeof(raw)) != size)
+    {
+        rx->tiles_failed++;
+        return;
+    }
+    apply_tile_data(rx, tile_id, 0, raw, size);
+    rx->tiles_decoded++;
+}
 
-// Réinitialise l'état de réception
-void reset_reception_state(void)
+// Relit les données d'un paquet déjà appliqué : dans le canvas, ou parmi les
+// données compressées de sa tuile
+void read_tile_data(const reception_state_t *rx, uint32_t tile_id, uint32_t offset,
+                    uint8_t *dst, size_t len)
 {
-    free(rx_state.image_buffer);
-    free(rx_state.received_mask);
-    memset(&rx_state, 0, sizeof(rx_state));
+    uint8_t *base;
+    size_t row_bytes;
+
+    if (tile_packed(rx, offset))
+    {
+        if (len && len <= tile_data_length(rx, tile_id, offset))
+        {
+            memcpy(dst, rx->tile_stage + (size_t)tile_id * TILE_MAX_BYTES +
+                   TILE_PACKED_OFFSET(offset), len);
+        }
+        return;
+    }
+
+    size_t size = tile_geometry(rx, tile_id, &base, &row_bytes);
+
+    if (!size || offset > size || len > size - offset)
+    {
+        return;
+    }
+
+    size_t stride = rx->stride;
+    size_t row = offset / row_bytes;
+    size_t col = offset % row_bytes;
+
+    while (len)
+    {
+        size_t chunk = row_bytes - col;
+        if (chunk > len)
+        {
+            chunk = len;
+        }
+        memcpy(dst, base + row * stride + col, chunk);
+        dst += chunk;
+        len -= chunk;
+        row++;
+        col = 0;
+    }
 }
 
-/// Sauvegarde l’image en mémoire sous forme de fichier PPM
-void save_image(void)
+// Prépare le bilan de l'image en cours pour l'émetteur, une fois par image :
+// quand elle est complète ou quand la suivante commence
+static void finish_report(reception_state_t *rx)
 {
-    
-    // Si pas actif ou pas de buffer d'image
-    if (!rx_state.active || !rx_state.image_buffer)
+    if (rx->reported)
     {
         return;
     }
+    rx->reported = 1;
+    if (rx->reports_pending == REPORT_BACKLOG)
+    {
+        return;
+    }
+
+    struct report_packet *report = &rx->reports[rx->reports_pending++];
+    uint32_t received = rx->packets_received - rx->recovered - rx->fec_recovered;
+    uint64_t span = rx->last_arrival_us - rx->first_arrival_us;
+
+    report->magic = htonl(REPORT_MAGIC);
+    report->stream_id = htonl(rx->key.stream_id);
+    report->image_id = htonl(rx->current_image_id);
+    report->total_packets = htonl(rx->total_packets);
+    report->received = htonl(received);
+    report->parity = htonl(rx->parity_received);
+    report->span_us = htonl(span < UINT32_MAX ? span : UINT32_MAX);
+}
+
+// Enregistre un paquet de données de l'image en cours (reçu ou reconstruit)
+void receive_data(reception_state_t *rx, uint32_t seq, const uint8_t *tile_header,
+                  const uint8_t *payload, size_t len)
+{
+    struct tile_header th;
+    memcpy(&th, tile_header, sizeof(th));
+
+    // Marque le paquet comme reçu
+    rx->received_mask[seq] = 1;
+    rx->packets_received++;
+
+    // Son tile_header servira à refaire son symbole si son groupe est
+    // incomplet
+    if (rx->tile_headers)
+    {
+        memcpy(rx->tile_headers + (size_t)seq * sizeof(th), tile_header, sizeof(th));
+    }
 
-    // Nom du fichier
-    char filename[64];
+    // Copie les données du paquet dans la tuile du canvas, ou les garde
+    // jusqu'à ce que sa tuile compressée soit complète
+    if (tile_packed(rx, ntohl(th.offset)))
+    {
+        stage_tile_data(rx, ntohl(th.tile_id), ntohl(th.offset), payload, len);
+    }
+    else
+    {
+        apply_tile_data(rx, ntohl(th.tile_id), ntohl(th.offset), payload, len);
+    }
 
-    // Génère le nom du fichier avec l'ID de l'image actuelle
-    snprintf(filename, sizeof(filename), "image_%u.ppm", rx_state.current_image_id);
-    
-    // Ouvre le fichier en écriture binaire
-    FILE *f = fopen(filename, "wb");
+    if (rx->packets_received == rx->total_packets)
+    {
+        // Une image clé complète recale entièrement le canvas
+        if (rx->flags & FRAME_FLAG_KEYFRAME)
+        {
+            rx->synced = 1;
+        }
+        finish_report(rx);
+    }
+}
 
-    if (!f)
+// Publie le canvas pour les lecteurs locaux, une fois par image : dès
+// qu'elle est complète, sinon au moment de l'enregistrer
+static void publish_image(const stream_table_t *streams, reception_state_t *rx)
+{
+    if (!streams->publisher || rx->published)
     {
-        perror("fopen");
         return;
     }
-    
-    // Écrit l'en-tête PPM
-    fprintf(f, "P6 %u %u 255\n", rx_state.width, rx_state.height);
+    rx->published = 1;
 
-    // Itere sur les pixels de l'image et écrit les données RGB
-    for (size_t i = 0; i < (size_t)rx_state.width * rx_state.height * PIXEL_BYTES; i += PIXEL_BYTES) {
-        fputc(rx_state.image_buffer[i + 2], f);
-        fputc(rx_state.image_buffer[i + 1], f);
-        fputc(rx_state.image_buffer[i + 0], f);
+    frame_shm_slot_t meta = {
+        .stream      = rx->index,
+        .image_id    = rx->current_image_id,
+        .width       = rx->width,
+        .height      = rx->height,
+        .format      = rx->format,
+        .stride      = rx->stride,
+        .bytes       = pixel_image_bytes(rx->format, rx->width, rx->height),
+        .complete_us = rx->complete_us,
+    };
+    if (rx->flags & FRAME_FLAG_KEYFRAME)
+    {
+        meta.flags |= FRAME_SHM_KEYFRAME;
+    }
+    if (rx->packets_received < rx->total_packets)
+    {
+        meta.flags |= FRAME_SHM_INCOMPLETE;
+    }
+    if (!rx->synced)
+    {
+        meta.flags |= FRAME_SHM_UNSYNCED;
     }
 
-    // Ferme le fichier
-    fclose(f);
-    
-    printf("Image %u saved: %s (%.1f%% complete)\n",
-           rx_state.current_image_id, filename,
-           (100.0 * rx_state.packets_received) / rx_state.total_packets);
+    rx_metrics_t *stats = streams->stats;
+    if (publisher_publish(streams->publisher, &meta, rx->canvas) < 0)
+    {
+        METRIC_ADD(stats->publish_skipped, 1);
+        return;
+    }
+    METRIC_ADD(stats->published, 1);
+    if (rx->complete_us)
+    {
+        metrics_hist_add(&stats->publish_us, meta.published_us - rx->complete_us);
+    }
 }
 
-/// Traite un paquet, extrait les données et met à jour l'état de réception
-void process_packet(char *data, ssize_t len)
+/// Sauvegarde l’image en mémoire dans le format de sortie choisi : une copie
+// part au writer avec son bilan de réception. File pleine : l'image est
+// perdue, sauf si wait est vrai (le flux se ferme, c'est sa dernière image).
+void save_image(const stream_table_t *streams, reception_state_t *rx, int wait)
+{
+    // Si pas actif, pas de canvas ou déjà enregistrée
+    if (!rx->active || !rx->canvas || rx->retired)
+    {
+        return;
+    }
+
+    // L'image est terminée, enregistrée ou non
+    rx_metrics_t *stats = streams->stats;
+    uint32_t missing = rx->total_packets - rx->packets_received;
+    METRIC_ADD(stats->images, 1);
+    if (missing)
+    {
+        METRIC_ADD(stats->incomplete, 1);
+        METRIC_ADD(stats->lost, missing);
+    }
+    uint64_t done_us = rx->complete_us ? rx->complete_us : streams->now_us;
+    metrics_hist_add(&stats->reassembly_us, done_us - rx->first_arrival_us);
+
+    // Image incomplète : les lignes perdues sont comblées à partir des
+    // lignes reçues voisines, puis elle est publiée
+    if (missing)
+    {
+        rx->concealed = conceal_fill(&rx->conceal, rx->canvas, rx->stride);
+        if (rx->concealed)
+        {
+            METRIC_ADD(stats->concealed, 1);
+        }
+    }
+    publish_image(streams, rx);
+
+    size_t bytes = pixel_image_bytes(rx->format, rx->width, rx->height);
+    write_job_t *job = writer_reserve(streams->writer, bytes, wait);
+    if (!job)
+    {
+        printf("Stream %u: image %u dropped (writer queue full)\n", rx->index,
+               rx->current_image_id);
+        return;
+    }
+
+    job->stream   = rx->index;
+    job->image_id = rx->current_image_id;
+    job->width    = rx->width;
+    job->height   = rx->height;
+    job->format   = rx->format;
+    job->stride   = rx->stride;
+    memcpy(job->pixels, rx->canvas, bytes);
+
+    // Bilan des retransmissions : paquets demandés, rattrapés et abandonnés
+    char nack[72] = "";
+    if (rx->nacked)
+    {
+        snprintf(nack, sizeof(nack), ", %u requested, %u recovered, %u abandoned",
+                 rx->nacked, rx->recovered, missing);
+    }
+
+    // Et de la correction d'erreurs : parités reçues, paquets reconstruits
+    char fec[48] = "";
+    if (rx->fec_k)
+    {
+        snprintf(fec, sizeof(fec), ", %u parity, %u rebuilt",
+                 rx->parity_received, rx->fec_recovered);
+    }
+
+    // Et des tuiles compressées : décompressées, ou invalides
+    char codec[48] = "";
+    if (rx->codec)
+    {
+        int n = snprintf(codec, sizeof(codec), ", %s %u tiles", codec_name(rx->codec),
+                         rx->tiles_decoded);
+        if (rx->tiles_failed)
+        {
+            snprintf(codec + n, sizeof(codec) - n, " (%u invalid)", rx->tiles_failed);
+        }
+    }
+
+    // Et des tuiles comblées par interpolation
+    char conceal[32] = "";
+    if (rx->concealed)
+    {
+        snprintf(conceal, sizeof(conceal), ", %u tiles concealed", rx->concealed);
+    }
+
+    snprintf(job->details, sizeof(job->details), "%s, %s%s, %.1f%% complete%s%s%s%s",
+             (rx->flags & FRAME_FLAG_KEYFRAME) ? "keyframe" : "delta",
+             pixel_format_name(rx->format), codec,
+             (100.0 * rx->packets_received) / rx->total_packets, fec, nack, conceal,
+             rx->synced ? "" : ", waiting for keyframe");
+
+    writer_submit(streams->writer, job);
+}
+
+// Termine l'image en cours : son bilan part et elle est enregistrée. Ses
+// paquets arrivés ensuite sont ignorés.
+static void retire_image(stream_table_t *streams, reception_state_t *rx, int wait)
 {
-    // Si la longueur du paquet est inférieure à l'en-tête, on ignore
-    if (len < (ssize_t)sizeof(struct packet_header))
+    if (!rx->active || rx->retired)
     {
         return;
     }
-    
-    // Copie l'en-tête du paquet dans une structure
+    finish_report(rx);
+    save_image(streams, rx, wait);
+    rx->retired = 1;
+}
+
+// Applique un paquet à l'image en cours du flux, ou commence son image
+static void handle_packet(stream_table_t *streams, reception_state_t *rx, char *data,
+                          size_t len)
+{
+    size_t headers = sizeof(struct packet_header) + sizeof(struct tile_header);
+
+    // Copie l'en-tête du paquet dans une structure (le tile_header est lu
+    // par receive_data)
     struct packet_header hdr;
     memcpy(&hdr, data, sizeof(hdr));
 
-    // On extrait les informations de l'en-tête
     uint32_t img_id = ntohl(hdr.image_id);
     uint32_t seq    = ntohl(hdr.seq);
+    uint32_t flags = ntohl(hdr.flags);
 
     // Si état de réception pas actif ou ID de l'image correspond pas
-    if (!rx_state.active || img_id != rx_state.current_image_id)
-    {
-        // Si une image est déjà en cours, on la sauvegarde
-        if (rx_state.active)
-        {
-            save_image();
-        }
-
-        // Réinitialise l'état de réception
-        reset_reception_state();
-
-        // Met à jour l'état de réception avec les nouvelles données
-        rx_state.active            = 1;
-        rx_state.current_image_id  = img_id;
-        rx_state.total_packets     = ntohl(hdr.total_packets);
-        rx_state.width             = ntohl(hdr.width);
-        rx_state.height            = ntohl(hdr.height);
-        rx_state.packet_payload_size = PACKET_SIZE - sizeof(struct packet_header);
-        
-        // Alloue le buffer pour l'image et le masque de réception
-        size_t image_size = (size_t)rx_state.total_packets * rx_state.packet_payload_size;
-        rx_state.image_buffer = calloc(1, image_size);
-        rx_state.received_mask = calloc(rx_state.total_packets, 1);
-        
-        // Si l'allocation échoue, on réinitialise l'état de réception
-        if (!rx_state.image_buffer || !rx_state.received_mask)
-        {
-            perror("calloc");
-            reset_reception_state();
+    if (!rx->active || img_id != rx->current_image_id)
+    {
+        // Si une image est encore en cours, on la termine
+        retire_image(streams, rx, 0);
+
+        // Prépare l'état de réception pour la nouvelle image
+        if (begin_image(streams, rx, &hdr) < 0)
+        {
+            rx->active = 0;
             return;
         }
 
-        printf("New image %u: %ux%u, %u packets expected.\n",
-               img_id, rx_state.width, rx_state.height, rx_state.total_packets);
+        printf("Stream %u: new image %u: %ux%u %s%s%s, %u packets expected (%s).\n",
+               rx->index, img_id, rx->width, rx->height, pixel_format_name(rx->format),
+               rx->codec ? " " : "", rx->codec ? codec_name(rx->codec) : "",
+               rx->total_packets, (rx->flags & FRAME_FLAG_KEYFRAME) ? "keyframe" : "delta");
     }
 
-    // Met à jour l'heure de la dernière activité
-    rx_state.last_activity = time(NULL);
+    // L'image attend ses paquets suivants jusqu'à cette échéance
+    rx->deadline_us = streams->now_us + streams->frame_timeout_us;
+    stream_deadline(streams, rx->deadline_us);
 
+    // Dernière arrivée de l'envoi initial de l'image
+    if (!(flags & PACKET_FLAG_RETRANSMIT))
+    {
+        rx->last_arrival_us = streams->now_us;
+    }
+
+    // Parité : elle ne sert que si son groupe a perdu des paquets
+    if (flags & PACKET_FLAG_PARITY)
+    {
+        fec_parity_received(rx, seq, PACKET_FEC_INDEX(flags),
+                            (const uint8_t *)data + sizeof(hdr), len - sizeof(hdr));
+    }
     // Si la séquence est valide et pas déjà reçue
-    if (seq < rx_state.total_packets && !rx_state.received_mask[seq])
+    else if (seq < rx->total_packets && !rx->received_mask[seq])
+    {
+        if (flags & PACKET_FLAG_RETRANSMIT)
+        {
+            rx->recovered++;
+        }
+        else if (seq >= rx->next_seq)
+        {
+            rx->next_seq = seq + 1;
+        }
+
+        receive_data(rx, seq, (const uint8_t *)data + sizeof(hdr),
+                     (const uint8_t *)data + headers, len - headers);
+
+        // Des parités attendaient peut-être ce paquet
+        if (rx->parities_pending)
+        {
+            fec_data_received(rx, seq);
+        }
+    }
+    else if (seq < rx->total_packets)
+    {
+        METRIC_ADD(streams->stats->duplicates, 1);
+    }
+
+    // Fin du réassemblage, directement ou par réparation
+    if (!rx->complete_us && rx->packets_received == rx->total_packets)
+    {
+        rx->complete_us = streams->now_us;
+
+        // Publiée et enregistrée sans attendre l'image suivante
+        retire_image(streams, rx, 0);
+    }
+}
+
+// Paquets mis de côté : chacun est précédé de sa longueur
+static size_t held_size(const uint8_t *record)
+{
+    uint16_t len;
+    memcpy(&len, record, sizeof(len));
+    return sizeof(len) + len;
+}
+
+static uint32_t held_image(const uint8_t *record)
+{
+    struct packet_header hdr;
+    memcpy(&hdr, record + sizeof(uint16_t), sizeof(hdr));
+    return ntohl(hdr.image_id);
+}
+
+// Plus ancienne image parmi les paquets mis de côté. Retourne 0 s'il n'y en
+// a aucun.
+static int oldest_held(const reception_state_t *rx, uint32_t *id)
+{
+    int found = 0;
+
+    for (size_t off = 0; off < rx->held_len; off += held_size(rx->held + off))
+    {
+        uint32_t image = held_image(rx->held + off);
+        if (!found || (int32_t)(image - *id) < 0)
+        {
+            *id = image;
+            found = 1;
+        }
+    }
+    return found;
+}
+
+// Met de côté un paquet d'une image suivante. Retourne -1 s'il n'y a plus
+// de place.
+static int hold_packet(stream_table_t *streams, reception_state_t *rx, const char *data,
+                       size_t len)
+{
+    uint16_t size = len;
+
+    if (len > UINT16_MAX)
+    {
+        return -1;
+    }
+    if (!rx->held_capacity)
+    {
+        if (stream_reserve(streams, rx, REORDER_BYTES) < 0)
+        {
+            return -1;
+        }
+        rx->held = malloc(REORDER_BYTES);
+        if (!rx->held)
+        {
+            perror("malloc");
+            stream_release(streams, rx, REORDER_BYTES);
+            return -1;
+        }
+        rx->held_capacity = REORDER_BYTES;
+    }
+    if (rx->held_len + sizeof(size) + len > rx->held_capacity)
+    {
+        return -1;
+    }
+
+    memcpy(rx->held + rx->held_len, &size, sizeof(size));
+    memcpy(rx->held + rx->held_len + sizeof(size), data, len);
+    rx->held_len += sizeof(size) + len;
+    if (!rx->held_since_us)
+    {
+        rx->held_since_us = streams->now_us;
+        stream_deadline(streams, rx->held_since_us + streams->hold_timeout_us);
+    }
+    METRIC_ADD(streams->stats->held, 1);
+    return 0;
+}
+
+// Rejoue les paquets mis de côté de l'image id dans leur ordre d'arrivée ;
+// ceux des autres images restent de côté
+static void replay_image(stream_table_t *streams, reception_state_t *rx, uint32_t id)
+{
+    // Détachés pendant le rejeu : un échec de begin_image réinitialise le
+    // flux
+    uint8_t *held = rx->held;
+    size_t len = rx->held_len, kept = 0;
+    rx->held = NULL;
+    rx->held_len = 0;
+
+    for (size_t off = 0; off < len;)
+    {
+        size_t size = held_size(held + off);
+        if (held_image(held + off) == id)
+        {
+            handle_packet(streams, rx, (char *)held + off + sizeof(uint16_t),
+                          size - sizeof(uint16_t));
+        }
+        else
+        {
+            memmove(held + kept, held + off, size);
+            kept += size;
+        }
+        off += size;
+    }
+
+    // Flux réinitialisé : sa mémoire est déjà rendue, le reste est perdu
+    if (!rx->held_capacity)
+    {
+        free(held);
+        return;
+    }
+    rx->held = held;
+    rx->held_len = kept;
+    rx->held_since_us = 0;
+    if (kept)
+    {
+        rx->held_since_us = streams->now_us;
+        stream_deadline(streams, rx->held_since_us + streams->hold_timeout_us);
+    }
+}
+
+// Enchaîne les images mises de côté tant que l'image en cours est terminée.
+// Les ID peuvent sauter : le client n'envoie rien pour une image inchangée.
+static void replay_next(stream_table_t *streams, reception_state_t *rx)
+{
+    uint32_t id;
+
+    while ((!rx->active || rx->retired) && oldest_held(rx, &id))
+    {
+        replay_image(streams, rx, id);
+    }
+}
+
+// Fenêtre dépassée : l'image en cours et les images mises de côté plus
+// anciennes que id sont terminées dans l'ordre, complètes ou non
+static void skip_to(stream_table_t *streams, reception_state_t *rx, uint32_t id)
+{
+    uint32_t oldest;
+
+    retire_image(streams, rx, 0);
+    while (oldest_held(rx, &oldest) && (int32_t)(oldest - id) < 0)
+    {
+        replay_image(streams, rx, oldest);
+        retire_image(streams, rx, 0);
+    }
+}
+
+/// Termine un flux qui se ferme : l'image en cours puis celles mises de
+/// côté, dans l'ordre
+void finish_stream(stream_table_t *streams, reception_state_t *rx, int wait)
+{
+    uint32_t id;
+
+    retire_image(streams, rx, wait);
+    while (oldest_held(rx, &id))
+    {
+        replay_image(streams, rx, id);
+        retire_image(streams, rx, wait);
+    }
+}
+
+// Échéance de l'image en cours d'un flux (0 = aucune) : plus aucun paquet
+// depuis frame_timeout_us, ou des images suivantes en attente depuis
+// hold_timeout_us
+static uint64_t frame_deadline(const stream_table_t *streams, const reception_state_t *rx,
+                               int *held)
+{
+    uint64_t at = rx->active && !rx->retired ? rx->deadline_us : 0;
+
+    *held = 0;
+    if (rx->held_len && (!at || rx->held_since_us + streams->hold_timeout_us < at))
+    {
+        at = rx->held_since_us + streams->hold_timeout_us;
+        *held = 1;
+    }
+    return at;
+}
+
+/// Termine les images arrivées à échéance : l'image incomplète est
+/// enregistrée telle quelle et les images mises de côté prennent la suite.
+/// Ne parcourt la table qu'une fois la plus proche échéance passée.
+void expire_frames(stream_table_t *streams, uint64_t now_us)
+{
+    if (!streams->deadline_us || now_us < streams->deadline_us)
+    {
+        return;
+    }
+    streams->deadline_us = 0;
+
+    for (unsigned b = 0; b < STREAM_BUCKETS; b++)
+    {
+        for (reception_state_t *rx = streams->buckets[b]; rx; rx = rx->next)
+        {
+            int held;
+            uint64_t at = frame_deadline(streams, rx, &held);
+            if (at && now_us >= at)
+            {
+                if (rx->active && !rx->retired && held)
+                {
+                    METRIC_ADD(streams->stats->held_expired, 1);
+                }
+                else if (rx->active && !rx->retired)
+                {
+                    METRIC_ADD(streams->stats->expired, 1);
+                }
+                retire_image(streams, rx, 0);
+                replay_next(streams, rx);
+                at = frame_deadline(streams, rx, &held);
+            }
+            if (at)
+            {
+                stream_deadline(streams, at);
+            }
+        }
+    }
+}
+
+/// Traite un paquet, extrait les données et met à jour l'état de réception
+/// du flux auquel il appartient. Les paquets d'une image suivante arrivés
+/// avant la fin de l'image en cours sont mis de côté (REORDER_WINDOW images
+/// au plus), ceux d'une image déjà terminée sont ignorés.
+void process_packet(stream_table_t *streams, const struct sockaddr_in *from,
+                    char *data, ssize_t len)
+{
+    // Si la longueur du paquet est inférieure aux en-têtes, on ignore
+    if (len < (ssize_t)(sizeof(struct packet_header) + sizeof(struct tile_header)))
+    {
+        return;
+    }
+
+    struct packet_header hdr;
+    memcpy(&hdr, data, sizeof(hdr));
+    uint32_t img_id = ntohl(hdr.image_id);
+
+    // Retrouve (ou crée) le contexte du flux de ce paquet
+    stream_key_t key = {
+        .addr = from->sin_addr.s_addr,
+        .port = from->sin_port,
+        .stream_id = ntohl(hdr.stream_id)
+    };
+    reception_state_t *rx = stream_lookup(streams, &key);
+    if (!rx)
+    {
+        return;
+    }
+
+    // Met à jour l'heure de la dernière activité (horloge lue une fois par
+    // lot, pas à chaque paquet)
+    rx->last_activity_us = streams->now_us;
+
+    // Écart avec l'image en cours, modulo 2^32 : un grand recul veut dire
+    // que l'émetteur a recommencé, les paquets mis de côté ne servent plus
+    int32_t ahead = (int32_t)(img_id - rx->current_image_id);
+    if (rx->active && ahead <= -REORDER_RESYNC)
+    {
+        rx->held_len = 0;
+        rx->held_since_us = 0;
+    }
+    else if (rx->active)
     {
-        // Marque le paquet comme reçu
-        rx_state.received_mask[seq] = 1;
-        rx_state.packets_received++;
+        // Image déjà terminée : retransmission ou paquet arrivé trop tard.
+        // Les parités d'une image complète ne servent plus, sans plus.
+        if (ahead < 0 || (ahead == 0 && rx->retired))
+        {
+            if (!(ntohl(hdr.flags) & PACKET_FLAG_PARITY))
+            {
+                METRIC_ADD(streams->stats->stale, 1);
+            }
+            return;
+        }
 
-        // Copie les données du paquet dans le buffer d'image
-        memcpy(rx_state.image_buffer + seq * rx_state.packet_payload_size,
-               data + sizeof(struct packet_header), len - sizeof(struct packet_header));
+        // Image suivante alors que l'image en cours n'est pas finie : mise
+        // de côté tant qu'elle reste dans la fenêtre, sinon les images plus
+        // anciennes sont terminées
+        if (ahead > 0 && !rx->retired)
+        {
+            if (ahead < REORDER_WINDOW && hold_packet(streams, rx, data, len) == 0)
+            {
+                return;
+            }
+            skip_to(streams, rx, img_id);
+        }
     }
+
+    handle_packet(streams, rx, data, len);
+
+    // L'image vient peut-être de se terminer : les suivantes mises de côté
+    // prennent la suite
+    replay_next(streams, rx);
 }
@@ -2,11 +2,20 @@
 #include <unistd.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
+#include <netinet/udp.h>
 #include "server_socket.h"
 #include "config.h"
 
-// Setup une socket serveur UDP
-int setup_server_socket(void)
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+// Setup une socket serveur UDP. Si *gro est vrai, demande au noyau de
+// regrouper les datagrammes consécutifs ; *gro est remis à 0 si c'est refusé.
+// Avec reuseport, plusieurs sockets se partagent le port : le noyau répartit
+// les émetteurs selon un hachage de leur adresse et de leur port, tous les
+// paquets d'un émetteur arrivent donc sur la même socket.
+int setup_server_socket(uint16_t port, int *gro, int reuseport)
 {
     // Création d'une socket UDP en IPv4
     int sock = socket(AF_INET, SOCK_DGRAM, 0);
@@ -22,15 +31,39 @@ int setup_server_socket(void)
     // On configure le buffer de réception de la socket
     setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
     
+    // Chaque réception indique combien de paquets la socket a dû jeter,
+    // faute de place dans son buffer (SO_RXQ_OVFL)
+    int on = 1;
+    setsockopt(sock, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on));
+
     // Permettre la réutilisation de l'adresse immédiatement après la fermeture
     int reuse = 1;
     setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
 
+    if (reuseport && setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)) < 0)
+    {
+        perror("setsockopt(SO_REUSEPORT)");
+        close(sock);
+        return -1;
+    }
+
+    // Le noyau concatène les datagrammes d'un même flux dans un seul buffer,
+    // la taille des segments est donnée dans un message de contrôle
+    if (*gro)
+    {
+        if (setsockopt(sock, SOL_UDP, UDP_GRO, &on, sizeof(on)) < 0)
+        {
+            perror("setsockopt(UDP_GRO)");
+            printf("UDP GRO not supported, receiving one datagram per buffer\n");
+            *gro = 0;
+        }
+    }
+
     // Configuration de l'adresse du serveur
     struct sockaddr_in addr = {
         .sin_family = AF_INET,
         .sin_addr = { .s_addr = INADDR_ANY },
-        .sin_port = htons(PORT)
+        .sin_port = htons(port)
     };
 
     // On lie la socket à l'adresse et au port
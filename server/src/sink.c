@@ -0,0 +1,213 @@
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "sink.h"
+#include "buffer_pool.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SINK_X86 1
+#endif
+
+static void bgrx_to_rgb_scalar(const uint8_t *src, uint8_t *dst, uint32_t width)
+{
+    for (uint32_t x = 0; x < width; x++, src += 4, dst += 3)
+    {
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = src[0];
+    }
+}
+
+#ifdef SINK_X86
+
+// pshufb remet R, G, B dans l'ordre et jette X : 4 pixels donnent 12 octets
+#define SWIZZLE_MASK 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1
+
+// Chaque écriture de 16 octets déborde de 4 : on s'arrête avant la fin de
+// la ligne
+__attribute__((target("ssse3")))
+static void bgrx_to_rgb_ssse3(const uint8_t *src, uint8_t *dst, uint32_t width)
+{
+    const __m128i mask = _mm_setr_epi8(SWIZZLE_MASK);
+    uint32_t x = 0;
+
+    for (; x + 6 <= width; x += 4)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + 4 * x));
+        _mm_storeu_si128((__m128i *)(dst + 3 * x), _mm_shuffle_epi8(v, mask));
+    }
+    bgrx_to_rgb_scalar(src + 4 * x, dst + 3 * x, width - x);
+}
+
+// Les deux moitiés de 12 octets sont recollées par une permutation de mots
+__attribute__((target("avx2")))
+static void bgrx_to_rgb_avx2(const uint8_t *src, uint8_t *dst, uint32_t width)
+{
+    const __m256i mask = _mm256_setr_epi8(SWIZZLE_MASK, SWIZZLE_MASK);
+    const __m256i pack = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+    uint32_t x = 0;
+
+    for (; x + 11 <= width; x += 8)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + 4 * x));
+        v = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v, mask), pack);
+        _mm256_storeu_si256((__m256i *)(dst + 3 * x), v);
+    }
+    _mm256_zeroupper();
+    bgrx_to_rgb_ssse3(src + 4 * x, dst + 3 * x, width - x);
+}
+
+static int has_ssse3(void)
+{
+    return __builtin_cpu_supports("ssse3");
+}
+
+static int has_avx2(void)
+{
+    return __builtin_cpu_supports("avx2");
+}
+
+#endif // SINK_X86
+
+// Du plus simple au plus rapide ; sink_init garde le dernier supporté
+static const struct {
+    swizzle_kernel_t kernel;
+    int (*supported)(void);    // NULL = toujours disponible
+} all_kernels[] = {
+    { { "scalar", bgrx_to_rgb_scalar }, NULL },
+#ifdef SINK_X86
+    { { "ssse3",  bgrx_to_rgb_ssse3 },  has_ssse3 },
+    { { "avx2",   bgrx_to_rgb_avx2 },   has_avx2 },
+#endif
+};
+
+static swizzle_kernel_t supported[sizeof(all_kernels) / sizeof(all_kernels[0])];
+static unsigned nb_supported;
+static unsigned cores = 1;
+
+static const frame_sink_t *const sinks[] = { &ppm_sink, &qoi_sink, &png_sink };
+
+void sink_init(void)
+{
+    if (nb_supported)
+    {
+        return;
+    }
+
+#ifdef SINK_X86
+    __builtin_cpu_init();
+#endif
+    for (unsigned i = 0; i < sizeof(all_kernels) / sizeof(all_kernels[0]); i++)
+    {
+        if (!all_kernels[i].supported || all_kernels[i].supported())
+        {
+            supported[nb_supported++] = all_kernels[i].kernel;
+        }
+    }
+
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    cores = online > 0 ? (unsigned)online : 1;
+}
+
+const swizzle_kernel_t *swizzle_kernels(unsigned *count)
+{
+    sink_init();
+    *count = nb_supported;
+    return supported;
+}
+
+unsigned sink_cores(void)
+{
+    return cores;
+}
+
+void bgrx_to_rgb(const uint8_t *src, uint8_t *dst, uint32_t width)
+{
+    supported[nb_supported - 1].bgrx_to_rgb(src, dst, width);
+}
+
+const frame_sink_t *sink_find(const char *name)
+{
+    for (unsigned i = 0; i < sizeof(sinks) / sizeof(sinks[0]); i++)
+    {
+        if (strcmp(name, sinks[i]->name) == 0)
+        {
+            return sinks[i];
+        }
+    }
+    return NULL;
+}
+
+int sink_buffer_alloc(sink_buffer_t *buf, size_t capacity)
+{
+    capacity = (capacity + SINK_ALIGN - 1) & ~(size_t)(SINK_ALIGN - 1);
+    buf->data = pool_alloc(capacity);
+    if (!buf->data)
+    {
+        return -1;
+    }
+    buf->len = 0;
+    buf->capacity = capacity;
+    return 0;
+}
+
+void sink_buffer_free(sink_buffer_t *buf)
+{
+    pool_free(buf->data, buf->capacity);
+    buf->data = NULL;
+    buf->len = buf->capacity = 0;
+}
+
+int sink_write(const frame_sink_t *sink, const frame_image_t *img, int fd)
+{
+    sink_buffer_t file;
+    if (sink->encode(img, &file) < 0)
+    {
+        return -1;
+    }
+
+    // Reprend après une écriture partielle
+    for (size_t done = 0; done < file.len;)
+    {
+        ssize_t n = write(fd, file.data + done, file.len - done);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror("write");
+            sink_buffer_free(&file);
+            return -1;
+        }
+        done += n;
+    }
+    sink_buffer_free(&file);
+    return 0;
+}
+
+// PPM : l'en-tête puis toute l'image convertie en RGB, dans un seul buffer
+static int ppm_encode(const frame_image_t *img, sink_buffer_t *out)
+{
+    char header[32];
+    int n = snprintf(header, sizeof(header), "P6 %u %u 255\n", img->width, img->height);
+    size_t line = (size_t)img->width * 3;
+
+    if (sink_buffer_alloc(out, n + line * img->height) < 0)
+    {
+        return -1;
+    }
+    memcpy(out->data, header, n);
+    for (uint32_t y = 0; y < img->height; y++)
+    {
+        bgrx_to_rgb(img->pixels + y * img->stride, out->data + n + y * line, img->width);
+    }
+    out->len = n + line * img->height;
+    return 0;
+}
+
+const frame_sink_t ppm_sink = { "ppm", ppm_encode };
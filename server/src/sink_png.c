@@ -0,0 +1,224 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include "sink.h"
+#include "buffer_pool.h"
+
+// PNG en parallèle : l'image est découpée en bandes horizontales compressées
+// chacune par un thread. Toutes les bandes sauf la dernière se terminent par
+// un Z_SYNC_FLUSH (bloc vide aligné sur un octet, sans fin de flux) : mises
+// bout à bout, elles forment un seul flux deflate. Adler-32 et CRC-32 de
+// chaque bande sont combinés au lieu d'être recalculés sur l'ensemble.
+
+// Une bande de lignes [y0, y1) et son résultat
+typedef struct png_stripe {
+    const frame_image_t *img;
+    uint32_t y0, y1;
+    int last; // Dernière bande : termine le flux deflate
+    uint8_t *out; // Données compressées
+    size_t out_len;
+    size_t capacity; // Taille de out
+    size_t raw_len; // Octets avant compression (lignes filtrées)
+    uint32_t adler; // Adler-32 des lignes filtrées
+    uint32_t crc; // CRC-32 des données compressées
+    int error;
+    pthread_t thread;
+} png_stripe_t;
+
+static uint8_t *put_be32(uint8_t *p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+    return p + 4;
+}
+
+// Chaque ligne est précédée de son filtre : Up (différence avec la ligne du
+// dessus), sauf la première de l'image qui n'a pas de ligne au-dessus
+static void *compress_stripe(void *arg)
+{
+    png_stripe_t *s = arg;
+    const frame_image_t *img = s->img;
+    size_t line = (size_t)img->width * 3;
+    uint8_t *rows = malloc(3 * line + 1);
+
+    s->raw_len = (line + 1) * (s->y1 - s->y0);
+    s->adler = adler32(0, NULL, 0);
+
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    // Un Z_SYNC_FLUSH ajoute au plus quelques octets à la borne de deflate
+    size_t capacity = deflateBound(&zs, s->raw_len) + 64;
+    s->out = pool_alloc(capacity);
+    s->capacity = capacity;
+    if (!rows || !s->out ||
+        deflateInit2(&zs, PNG_LEVEL, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        free(rows);
+        s->error = 1;
+        return NULL;
+    }
+
+    uint8_t *prev = rows, *cur = rows + line, *filtered = rows + 2 * line;
+    if (s->y0 > 0)
+    {
+        bgrx_to_rgb(img->pixels + (s->y0 - 1) * img->stride, prev, img->width);
+    }
+
+    zs.next_out = s->out;
+    zs.avail_out = capacity;
+    for (uint32_t y = s->y0; y < s->y1; y++)
+    {
+        bgrx_to_rgb(img->pixels + y * img->stride, cur, img->width);
+        if (y == 0)
+        {
+            filtered[0] = 0;
+            memcpy(filtered + 1, cur, line);
+        }
+        else
+        {
+            filtered[0] = 2;
+            for (size_t i = 0; i < line; i++)
+            {
+                filtered[i + 1] = cur[i] - prev[i];
+            }
+        }
+        s->adler = adler32(s->adler, filtered, line + 1);
+
+        int flush = y + 1 < s->y1 ? Z_NO_FLUSH : s->last ? Z_FINISH : Z_SYNC_FLUSH;
+        zs.next_in = filtered;
+        zs.avail_in = line + 1;
+        int ret = deflate(&zs, flush);
+        if (ret == Z_STREAM_ERROR || zs.avail_in || (flush == Z_FINISH && ret != Z_STREAM_END))
+        {
+            s->error = 1;
+            break;
+        }
+
+        uint8_t *tmp = prev;
+        prev = cur;
+        cur = tmp;
+    }
+
+    s->out_len = capacity - zs.avail_out;
+    s->crc = crc32(0, s->out, s->out_len);
+    deflateEnd(&zs);
+    free(rows);
+    return NULL;
+}
+
+static int png_encode(const frame_image_t *img, sink_buffer_t *out)
+{
+    // Une bande par coeur, sans descendre sous PNG_STRIPE_ROWS lignes
+    unsigned nb = (img->height + PNG_STRIPE_ROWS - 1) / PNG_STRIPE_ROWS;
+    if (nb > sink_cores())
+    {
+        nb = sink_cores();
+    }
+    if (nb < 1)
+    {
+        nb = 1;
+    }
+
+    png_stripe_t *stripes = calloc(nb, sizeof(*stripes));
+    if (!stripes)
+    {
+        perror("calloc");
+        return -1;
+    }
+
+    // Les workers épinglés (-p) ne doivent pas entraîner les bandes sur
+    // leur coeur
+    pthread_attr_t attr;
+    cpu_set_t all;
+    CPU_ZERO(&all);
+    for (unsigned c = 0; c < sink_cores() && c < CPU_SETSIZE; c++)
+    {
+        CPU_SET(c, &all);
+    }
+    pthread_attr_init(&attr);
+    pthread_attr_setaffinity_np(&attr, sizeof(all), &all);
+
+    for (unsigned i = 0; i < nb; i++)
+    {
+        png_stripe_t *s = &stripes[i];
+        s->img = img;
+        s->y0 = (uint64_t)img->height * i / nb;
+        s->y1 = (uint64_t)img->height * (i + 1) / nb;
+        s->last = i + 1 == nb;
+
+        // La première bande est faite par le thread appelant
+        if (i && pthread_create(&s->thread, &attr, compress_stripe, s) != 0)
+        {
+            s->thread = 0;
+            compress_stripe(s);
+        }
+    }
+    compress_stripe(&stripes[0]);
+    pthread_attr_destroy(&attr);
+
+    int ret = 0;
+    size_t idat = 2 + 4;        // En-tête et Adler-32 du flux zlib
+    for (unsigned i = 0; i < nb; i++)
+    {
+        if (i && stripes[i].thread)
+        {
+            pthread_join(stripes[i].thread, NULL);
+        }
+        ret |= -stripes[i].error;
+        idat += stripes[i].out_len;
+    }
+
+    // Signature, IHDR, en-tête du chunk IDAT et du flux zlib, les bandes,
+    // puis Adler-32 du flux, CRC de IDAT et IEND
+    size_t head = 8 + 25 + 8 + 2;
+    if (ret == 0 && sink_buffer_alloc(out, head + idat - 2 + 4 + 12) < 0)
+    {
+        ret = -1;
+    }
+    if (ret == 0)
+    {
+        uint8_t *p = out->data;
+        memcpy(p, "\x89PNG\r\n\x1a\n", 8);
+        p = put_be32(p + 8, 13);
+        memcpy(p, "IHDR", 4);
+        p = put_be32(p + 4, img->width);
+        p = put_be32(p, img->height);
+        memcpy(p, "\x08\x02\x00\x00\x00", 5); // 8 bits, RGB
+        p = put_be32(p + 5, crc32(0, out->data + 12, 17));
+        p = put_be32(p, idat);
+        memcpy(p, "IDAT\x78\x01", 6);
+        p += 6;
+
+        uint32_t crc = crc32(0, p - 6, 6);
+        uint32_t adler = adler32(0, NULL, 0);
+        for (unsigned i = 0; i < nb; i++)
+        {
+            crc = crc32_combine(crc, stripes[i].crc, stripes[i].out_len);
+            adler = adler32_combine(adler, stripes[i].adler, stripes[i].raw_len);
+            memcpy(p, stripes[i].out, stripes[i].out_len);
+            p += stripes[i].out_len;
+        }
+
+        put_be32(p, adler);
+        crc = crc32(crc, p, 4);
+        p = put_be32(p + 4, crc);
+        p = put_be32(p, 0);
+        memcpy(p, "IEND", 4);
+        p = put_be32(p + 4, crc32(0, p, 4));
+        out->len = p - out->data;
+    }
+
+    for (unsigned i = 0; i < nb; i++)
+    {
+        pool_free(stripes[i].out, stripes[i].capacity);
+    }
+    free(stripes);
+    return ret;
+}
+
+const frame_sink_t png_sink = { "png", png_encode };
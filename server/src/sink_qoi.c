@@ -0,0 +1,118 @@
+#include <string.h>
+#include "sink.h"
+
+// Format QOI (qoiformat.org) : chaque pixel est codé d'après le précédent,
+// une table de 64 couleurs récentes ou une répétition. Les images reçues
+// sont opaques : on écrit du RGB (3 canaux), alpha vaut toujours 255.
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF  0x40
+#define QOI_OP_LUMA  0x80
+#define QOI_OP_RUN   0xC0
+#define QOI_OP_RGB   0xFE
+
+#define QOI_HEADER   14
+#define QOI_PADDING  8          // Fin de fichier : 7 zéros puis 1
+#define QOI_MAX_RUN  62
+
+static uint8_t *put_be32(uint8_t *p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+    return p + 4;
+}
+
+static int qoi_encode(const frame_image_t *img, sink_buffer_t *out)
+{
+    // Au pire 4 octets par pixel (QOI_OP_RGB)
+    if (sink_buffer_alloc(out, QOI_HEADER + (size_t)img->width * img->height * 4 +
+                          QOI_PADDING) < 0)
+    {
+        return -1;
+    }
+
+    uint8_t *p = out->data;
+    memcpy(p, "qoif", 4);
+    p = put_be32(p + 4, img->width);
+    p = put_be32(p, img->height);
+    *p++ = 3;                   // RGB
+    *p++ = 0;                   // sRGB
+
+    // Couleurs rangées en 0xAARRGGBB : les entrées vides de la table (alpha
+    // nul) ne ressemblent à aucun pixel
+    uint32_t index[64] = {0};
+    uint32_t prev = 0xFF000000u;
+    unsigned run = 0;
+
+    for (uint32_t y = 0; y < img->height; y++)
+    {
+        const uint8_t *row = img->pixels + y * img->stride;
+
+        for (uint32_t x = 0; x < img->width; x++, row += 4)
+        {
+            uint32_t px = 0xFF000000u | (uint32_t)row[2] << 16 | (uint32_t)row[1] << 8 | row[0];
+
+            if (px == prev)
+            {
+                if (++run == QOI_MAX_RUN)
+                {
+                    *p++ = QOI_OP_RUN | (run - 1);
+                    run = 0;
+                }
+                continue;
+            }
+            if (run)
+            {
+                *p++ = QOI_OP_RUN | (run - 1);
+                run = 0;
+            }
+
+            uint8_t r = px >> 16, g = px >> 8, b = px;
+            unsigned hash = (r * 3 + g * 5 + b * 7 + 255 * 11) % 64;
+            if (index[hash] == px)
+            {
+                *p++ = QOI_OP_INDEX | hash;
+                prev = px;
+                continue;
+            }
+            index[hash] = px;
+
+            int8_t dr = r - (uint8_t)(prev >> 16);
+            int8_t dg = g - (uint8_t)(prev >> 8);
+            int8_t db = b - (uint8_t)prev;
+            int8_t dr_dg = dr - dg;
+            int8_t db_dg = db - dg;
+
+            if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+            {
+                *p++ = QOI_OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2);
+            }
+            else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 &&
+                     db_dg >= -8 && db_dg <= 7)
+            {
+                *p++ = QOI_OP_LUMA | (dg + 32);
+                *p++ = (dr_dg + 8) << 4 | (db_dg + 8);
+            }
+            else
+            {
+                *p++ = QOI_OP_RGB;
+                *p++ = r;
+                *p++ = g;
+                *p++ = b;
+            }
+            prev = px;
+        }
+    }
+    if (run)
+    {
+        *p++ = QOI_OP_RUN | (run - 1);
+    }
+    memcpy(p, "\0\0\0\0\0\0\0\1", QOI_PADDING);
+    p += QOI_PADDING;
+
+    out->len = p - out->data;
+    return 0;
+}
+
+const frame_sink_t qoi_sink = { "qoi", qoi_encode };
@@ -0,0 +1,213 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "streams.h"
+#include "metrics.h"
+
+// Mélange adresse, port et identifiant du flux pour choisir un seau
+static unsigned stream_hash(const stream_key_t *key)
+{
+    uint64_t h = ((uint64_t)key->addr << 16 | key->port) * 0x9E3779B97F4A7C15ULL;
+    h ^= key->stream_id * 0xC2B2AE3D27D4EB4FULL;
+    h ^= h >> 32;
+    return (unsigned)h & (STREAM_BUCKETS - 1);
+}
+
+static int same_key(const stream_key_t *a, const stream_key_t *b)
+{
+    return a->addr == b->addr && a->port == b->port && a->stream_id == b->stream_id;
+}
+
+// Numéro du prochain flux, partagé par toutes les tables (un par worker)
+static unsigned next_stream_index;
+
+// Flux ouverts et mémoire allouée dans toutes les tables : les limites sont
+// communes, un worker peut en utiliser l'essentiel si les flux lui arrivent
+static unsigned total_streams;
+static size_t total_memory;
+
+void stream_table_init(stream_table_t *streams, unsigned max_streams, size_t memory_limit)
+{
+    memset(streams, 0, sizeof(*streams));
+    streams->max_streams = max_streams ? max_streams : 1;
+    streams->memory_limit = memory_limit;
+    streams->frame_timeout_us = FRAME_TIMEOUT_MS * 1000ULL;
+    streams->hold_timeout_us = REORDER_TIMEOUT_MS * 1000ULL;
+}
+
+// Délais des images quand les flux demandent des retransmissions : les
+// paquets perdus peuvent arriver jusqu'à l'abandon des demandes. L'image
+// suivante arrivée, l'image en cours attend encore la deuxième demande (la
+// première part au plus NACK_INTERVAL_MS après l'examen qui arme le délai)
+// et son aller-retour.
+void stream_table_nack(stream_table_t *streams)
+{
+    uint64_t hold_ms = NACK_INTERVAL_MS + NACK_RETRY_MS;
+    if (hold_ms < REORDER_TIMEOUT_MS)
+    {
+        hold_ms = REORDER_TIMEOUT_MS;
+    }
+    streams->frame_timeout_us = NACK_DEADLINE_MS * 1000ULL;
+    streams->hold_timeout_us = (hold_ms + NACK_RTT_MARGIN_MS) * 1000;
+}
+
+// Retire un flux de la table et libère ses buffers
+static void remove_stream(stream_table_t *streams, reception_state_t *rx)
+{
+    reception_state_t **p = &streams->buckets[stream_hash(&rx->key)];
+    while (*p != rx)
+    {
+        p = &(*p)->next;
+    }
+    *p = rx->next;
+
+    reset_reception_state(streams, rx);
+    free(rx);
+    streams->count--;
+    __atomic_sub_fetch(&total_streams, 1, __ATOMIC_RELAXED);
+    METRIC_SET(streams->stats->streams, streams->count);
+}
+
+// Sauvegarde l'image en cours du flux et celles mises de côté, puis le
+// retire de la table. À l'arrêt (wait), la sauvegarde attend une place chez le writer plutôt que d'être
+// abandonnée. Les images rejouées peuvent réserver de la mémoire : pendant
+// la fermeture, ces réservations échouent au lieu de fermer d'autres flux,
+// que l'appelant est peut-être en train de parcourir ou de servir.
+static void close_stream(stream_table_t *streams, reception_state_t *rx, const char *reason,
+                         int wait)
+{
+    printf("Stream %u closed (%s).\n", rx->index, reason);
+    streams->closing++;
+    finish_stream(streams, rx, wait);
+    streams->closing--;
+    remove_stream(streams, rx);
+}
+
+// Flux le moins récemment actif, autre que except
+static reception_state_t *least_recent(stream_table_t *streams, const reception_state_t *except)
+{
+    reception_state_t *oldest = NULL;
+
+    for (unsigned b = 0; b < STREAM_BUCKETS; b++)
+    {
+        for (reception_state_t *rx = streams->buckets[b]; rx; rx = rx->next)
+        {
+            if (rx != except && (!oldest || rx->last_activity_us < oldest->last_activity_us))
+            {
+                oldest = rx;
+            }
+        }
+    }
+    return oldest;
+}
+
+// Retrouve le flux d'un paquet, ou le crée. Quand la table est pleine, le
+// flux resté muet le plus longtemps laisse sa place.
+reception_state_t *stream_lookup(stream_table_t *streams, const stream_key_t *key)
+{
+    unsigned bucket = stream_hash(key);
+
+    for (reception_state_t *rx = streams->buckets[bucket]; rx; rx = rx->next)
+    {
+        if (same_key(&rx->key, key))
+        {
+            return rx;
+        }
+    }
+
+    // Limite atteinte : le flux de cette table resté muet le plus longtemps
+    // laisse sa place (ceux des autres workers ne sont pas à ce thread)
+    if (__atomic_add_fetch(&total_streams, 1, __ATOMIC_RELAXED) > streams->max_streams)
+    {
+        reception_state_t *victim = least_recent(streams, NULL);
+        if (!victim)
+        {
+            __atomic_sub_fetch(&total_streams, 1, __ATOMIC_RELAXED);
+            return NULL;
+        }
+        close_stream(streams, victim, "too many streams", 0);
+    }
+
+    reception_state_t *rx = calloc(1, sizeof(*rx));
+    if (!rx)
+    {
+        perror("calloc");
+        __atomic_sub_fetch(&total_streams, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    rx->key = *key;
+    rx->index = __atomic_fetch_add(&next_stream_index, 1, __ATOMIC_RELAXED);
+    rx->last_activity_us = streams->now_us;
+    rx->next = streams->buckets[bucket];
+    streams->buckets[bucket] = rx;
+    streams->count++;
+    METRIC_SET(streams->stats->streams, streams->count);
+
+    char addr[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &key->addr, addr, sizeof(addr));
+    printf("New stream %u from %s:%u (stream id %u), %u active.\n",
+           rx->index, addr, ntohs(key->port), key->stream_id, streams->count);
+    return rx;
+}
+
+// Réserve de la mémoire pour un flux. Au-delà de la limite commune, les
+// autres flux de la table sont fermés du moins récemment actif au plus
+// récent, sauf pendant une fermeture. Ceux des autres workers appartiennent à leur thread : un worker
+// dont les flux occupent presque toute la limite fait échouer les
+// réservations des autres tant que ses flux restent ouverts.
+int stream_reserve(stream_table_t *streams, reception_state_t *rx, size_t bytes)
+{
+    while (__atomic_add_fetch(&total_memory, bytes, __ATOMIC_RELAXED) > streams->memory_limit)
+    {
+        __atomic_sub_fetch(&total_memory, bytes, __ATOMIC_RELAXED);
+        reception_state_t *victim = streams->closing ? NULL : least_recent(streams, rx);
+        if (!victim)
+        {
+            fprintf(stderr, "Stream %u: memory limit reached (%zu bytes requested)\n",
+                    rx->index, bytes);
+            return -1;
+        }
+        close_stream(streams, victim, "memory limit", 0);
+    }
+    streams->memory += bytes;
+    rx->memory += bytes;
+    return 0;
+}
+
+void stream_release(stream_table_t *streams, reception_state_t *rx, size_t bytes)
+{
+    __atomic_sub_fetch(&total_memory, bytes, __ATOMIC_RELAXED);
+    streams->memory -= bytes;
+    rx->memory -= bytes;
+}
+
+// Sauvegarde et libère les flux muets depuis timeout secondes (close_stream
+// ne ferme aucun autre flux, next reste valide)
+void expire_idle_streams(stream_table_t *streams, uint64_t now_us, int timeout)
+{
+    for (unsigned b = 0; b < STREAM_BUCKETS; b++)
+    {
+        reception_state_t *next;
+        for (reception_state_t *rx = streams->buckets[b]; rx; rx = next)
+        {
+            next = rx->next;
+            if (now_us - rx->last_activity_us >= timeout * 1000000ULL)
+            {
+                close_stream(streams, rx, "idle", 0);
+            }
+        }
+    }
+}
+
+// Sauvegarde et libère tous les flux (arrêt du serveur)
+void close_all_streams(stream_table_t *streams)
+{
+    for (unsigned b = 0; b < STREAM_BUCKETS; b++)
+    {
+        while (streams->buckets[b])
+        {
+            close_stream(streams, streams->buckets[b], "shutdown", 1);
+        }
+    }
+}
@@ -1,98 +1,356 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include <liburing.h>
 #include <sys/socket.h>
+#include <netinet/udp.h>
 #include <time.h>
 #include "uring_utils.h"
 #include "config.h"
 #include "reception.h"
+#include "nack.h"
+
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
 
 extern volatile int running;
 
-// Initialise les requêtes de réception dans io_uring
-void prime_uring_requests(struct io_uring *ring, int sock)
+// Dernier paquet reçu par un des workers (horloge monotone, en µs) : le
+// serveur s'arrête quand plus aucun worker ne reçoit rien
+static uint64_t server_last_activity;
+static int server_active;
+
+// Prépare la ring io_uring et la ring de buffers fournis. Chaque buffer
+// reçoit l'en-tête io_uring_recvmsg_out, l'adresse de l'émetteur, les
+// messages de contrôle (taille des segments GRO, paquets jetés par le noyau)
+// puis les données : un datagramme ou, avec GRO, jusqu'à 64 Ko
+// de datagrammes regroupés.
+int setup_rx_ring(rx_ring_t *rx, int sock, int gro, stream_table_t *streams)
+{
+    memset(rx, 0, sizeof(*rx));
+    rx->sock = sock;
+    rx->gro = gro;
+    rx->streams = streams;
+    rx->nb_buffers = gro ? GRO_BUFFERS : RECV_BUFFERS;
+    rx->msgh.msg_namelen = sizeof(struct sockaddr_in);
+    rx->msgh.msg_controllen = (gro ? CMSG_SPACE(sizeof(int)) : 0) + CMSG_SPACE(sizeof(uint32_t));
+    rx->buffer_size = sizeof(struct io_uring_recvmsg_out) + rx->msgh.msg_namelen +
+                      rx->msgh.msg_controllen + (gro ? GRO_BUFFER_SIZE : PACKET_SIZE);
+
+    // Peu de soumissions (une requête multishot) mais beaucoup de complétions
+    struct io_uring_params params = {
+        .flags = IORING_SETUP_CQSIZE,
+        .cq_entries = RX_CQ_ENTRIES
+    };
+
+    int ret = io_uring_queue_init_params(8, &rx->ring, &params);
+    if (ret < 0)
+    {
+        fprintf(stderr, "io_uring_queue_init: %s\n", strerror(-ret));
+        return -1;
+    }
+
+    // Un seul bloc pour tous les buffers, alloué une fois pour toutes
+    rx->buffers = malloc(rx->nb_buffers * rx->buffer_size);
+    if (!rx->buffers)
+    {
+        perror("malloc");
+        io_uring_queue_exit(&rx->ring);
+        return -1;
+    }
+
+    rx->br = io_uring_setup_buf_ring(&rx->ring, rx->nb_buffers, RX_BUFFER_GROUP, 0, &ret);
+    if (!rx->br)
+    {
+        fprintf(stderr, "io_uring_setup_buf_ring: %s (Linux 6.0+ required)\n", strerror(-ret));
+        free(rx->buffers);
+        io_uring_queue_exit(&rx->ring);
+        return -1;
+    }
+
+    // Tous les buffers sont donnés au noyau
+    int mask = io_uring_buf_ring_mask(rx->nb_buffers);
+    for (unsigned i = 0; i < rx->nb_buffers; i++)
+    {
+        io_uring_buf_ring_add(rx->br, rx->buffers + i * rx->buffer_size,
+                              rx->buffer_size, i, mask, i);
+    }
+    io_uring_buf_ring_advance(rx->br, rx->nb_buffers);
+
+    return 0;
+}
+
+// Libère la ring et les buffers
+void destroy_rx_ring(rx_ring_t *rx)
+{
+    const rx_metrics_t *st = &rx->stats;
+    if (st->completions)
+    {
+        printf("Received %llu datagrams in %llu completions (%.1f per completion), "
+               "%llu batches (%.1f completions per batch), %llu re-arms, "
+               "%llu out-of-buffer events, %llu dropped by the socket, %llu duplicates, "
+               "%llu NACKs sent, %llu reports sent\n",
+               (unsigned long long)st->datagrams, (unsigned long long)st->completions,
+               (double)st->datagrams / st->completions, (unsigned long long)st->batches,
+               st->batches ? (double)st->completions / st->batches : 0.0,
+               (unsigned long long)st->rearms, (unsigned long long)st->no_buffers,
+               (unsigned long long)st->socket_drops, (unsigned long long)st->duplicates,
+               (unsigned long long)st->nacks, (unsigned long long)st->reports);
+    }
+    io_uring_free_buf_ring(&rx->ring, rx->br, rx->nb_buffers, RX_BUFFER_GROUP);
+    io_uring_queue_exit(&rx->ring);
+    free(rx->buffers);
+    rx->buffers = NULL;
+}
+
+// Arme la requête recvmsg multishot : elle produit une complétion par
+// datagramme jusqu'à ce que le noyau n'ait plus de buffer libre ou qu'une
+// erreur survienne. La soumission se fait avec l'attente suivante.
+int prime_uring_requests(rx_ring_t *rx)
+{
+    // Récupère un SQE (Submission Queue Entry) de io_uring
+    struct io_uring_sqe *sqe = io_uring_get_sqe(&rx->ring);
+    if (!sqe)
+    {
+        return -1;
+    }
+
+    // Le noyau choisit le buffer dans le groupe RX_BUFFER_GROUP
+    io_uring_prep_recvmsg_multishot(sqe, rx->sock, &rx->msgh, 0);
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+    sqe->buf_group = RX_BUFFER_GROUP;
+    rx->armed = 1;
+    return 0;
+}
+
+// Lit les messages de contrôle d'un buffer reçu : compte les paquets jetés
+// par le noyau depuis le précédent, et retourne la taille des segments d'un
+// datagramme regroupé (0 s'il n'y en a qu'un)
+static int read_control(rx_ring_t *rx, struct io_uring_recvmsg_out *out)
 {
-    // Prépare les buffers de réception
-    for (int i = 0; i < RECV_BUFFERS; i++)
+    int size = 0;
+
+    for (struct cmsghdr *cmsg = io_uring_recvmsg_cmsg_firsthdr(out, &rx->msgh); cmsg;
+         cmsg = io_uring_recvmsg_cmsg_nexthdr(out, &rx->msgh, cmsg))
     {
-        // Alloue un buffer pour recevoir les paquets
-        char *buf = malloc(PACKET_SIZE);
-        if (!buf)
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
         {
-            break;
+            memcpy(&size, CMSG_DATA(cmsg), sizeof(size));
+        }
+        else if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL)
+        {
+            // Total des paquets jetés par la socket depuis sa création
+            uint32_t drops;
+            memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+            METRIC_ADD(rx->stats.socket_drops, (uint32_t)(drops - rx->drops_seen));
+            rx->drops_seen = drops;
+        }
+    }
+    return size;
+}
+
+// Redécoupe un buffer reçu en paquets : chaque segment commence par son
+// propre packet_header, seul le dernier peut être plus court
+static void dispatch_datagrams(rx_ring_t *rx, char *buf, int res)
+{
+    struct io_uring_recvmsg_out *out = io_uring_recvmsg_validate(buf, res, &rx->msgh);
+    if (!out || (out->flags & MSG_TRUNC) || out->namelen < sizeof(struct sockaddr_in))
+    {
+        return;
+    }
+
+    // Adresse de l'émetteur : elle identifie le flux avec le stream_id
+    struct sockaddr_in from;
+    memcpy(&from, io_uring_recvmsg_name(out), sizeof(from));
+
+    char *data = io_uring_recvmsg_payload(out, &rx->msgh);
+    int len = io_uring_recvmsg_payload_length(out, res, &rx->msgh);
+    int seg = read_control(rx, out);
+    if (seg <= 0 || seg > len)
+    {
+        seg = len;
+    }
+
+    for (int off = 0; off < len; off += seg)
+    {
+        int n = len - off < seg ? len - off : seg;
+        process_packet(rx->streams, &from, data + off, n);
+        METRIC_ADD(rx->stats.datagrams, 1);
+        METRIC_ADD(rx->stats.bytes, n);
+    }
+}
+
+// Traite toutes les complétions disponibles d'un coup, puis rend les
+// buffers au noyau en une seule fois
+static void reap_completions(rx_ring_t *rx)
+{
+    struct io_uring_cqe *cqes[RX_CQE_BATCH];
+    unsigned count = io_uring_peek_batch_cqe(&rx->ring, cqes, RX_CQE_BATCH);
+    int mask = io_uring_buf_ring_mask(rx->nb_buffers);
+    int returned = 0;
+
+    if (!count)
+    {
+        return;
+    }
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        struct io_uring_cqe *cqe = cqes[i];
+
+        // Sans IORING_CQE_F_MORE, la requête multishot est terminée
+        if (!(cqe->flags & IORING_CQE_F_MORE))
+        {
+            rx->armed = 0;
         }
 
-        // Récupère un SQE (Submission Queue Entry) de io_uring
-        struct io_uring_sqe *sqe = io_uring_get_sqe(ring);
+        if (cqe->res == -ENOBUFS)
+        {
+            METRIC_ADD(rx->stats.no_buffers, 1);
+        }
+        else if (cqe->res < 0)
+        {
+            // Erreur de la socket elle-même : inutile de réarmer
+            fprintf(stderr, "recvmsg: %s\n", strerror(-cqe->res));
+            running = 0;
+        }
 
-        if (!sqe)
+        if (cqe->flags & IORING_CQE_F_BUFFER)
         {
-            free(buf);
-            break;
+            unsigned bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+            char *buf = rx->buffers + bid * rx->buffer_size;
+
+            if (cqe->res > 0)
+            {
+                dispatch_datagrams(rx, buf, cqe->res);
+            }
+
+            // Le buffer est recyclé, il sera visible du noyau à l'avance
+            io_uring_buf_ring_add(rx->br, buf, rx->buffer_size, bid, mask, returned++);
         }
-        
-        // Prépare la requête de réception
-        io_uring_prep_recv(sqe, sock, buf, PACKET_SIZE, 0);
-        // Associe le buffer à la SQE pour le libérer plus tard
-        io_uring_sqe_set_data(sqe, buf);
     }
-    // Soumet les requêtes à io_uring
-    io_uring_submit(ring);
-    printf("Waiting for packets...\n");
+
+    io_uring_buf_ring_advance(rx->br, returned);
+    io_uring_cq_advance(&rx->ring, count);
+    METRIC_ADD(rx->stats.completions, count);
+    METRIC_ADD(rx->stats.batches, 1);
+    metrics_hist_add(&rx->stats.batch, count);
+}
+
+static uint64_t monotonic_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Temps écoulé depuis le dernier paquet reçu par un des workers. Signé : un
+// autre worker a pu enregistrer un paquet après la lecture de now.
+static int64_t since_last_activity(uint64_t now)
+{
+    return (int64_t)(now - __atomic_load_n(&server_last_activity, __ATOMIC_RELAXED));
 }
 
 // Boucle principale du serveur, gérant la réception et le timeout
-void run_server_loop(struct io_uring *ring, int sock)
+void run_server_loop(rx_ring_t *rx)
 {
+    if (prime_uring_requests(rx) < 0)
+    {
+        fprintf(stderr, "io_uring: no SQE available\n");
+        return;
+    }
+
+    uint64_t last_expiry = monotonic_us();
 
     while (running)
     {
         struct io_uring_cqe *cqe;
-        
-        // Timeout pour permettre à la boucle de vérifier l'inactivité
+        stream_table_t *streams = rx->streams;
+
+        // L'attente s'arrête à la plus proche échéance : examen des flux
+        // muets (chaque seconde), arrêt pour inactivité, prochaine image à
+        // terminer, et prochain examen des NACK tant qu'une image en cours
+        // peut avoir des paquets à redemander
+        uint64_t now = monotonic_us();
+        uint64_t wake = last_expiry + 1000000;
+        if (__atomic_load_n(&server_active, __ATOMIC_RELAXED))
+        {
+            int64_t left = SHUTDOWN_TIMEOUT * 1000000LL - since_last_activity(now);
+            uint64_t idle = left > 0 ? now + left : now;
+            wake = idle < wake ? idle : wake;
+        }
+        if (rx->nack && streams->nack_due_us && streams->nack_due_us < wake)
+        {
+            wake = streams->nack_due_us;
+        }
+        if (streams->deadline_us && streams->deadline_us < wake)
+        {
+            wake = streams->deadline_us;
+        }
+        uint64_t wait = wake > now ? wake - now : 0;
         struct __kernel_timespec ts = {
-            .tv_sec = 1,
-            .tv_nsec = 0
+            .tv_sec = wait / 1000000,
+            .tv_nsec = wait % 1000000 * 1000
         };
 
-        // Attendre une complétion avec timeout
-        int ret = io_uring_wait_cqe_timeout(ring, &cqe, &ts);
+        // Soumet le réarmement éventuel et attend au moins une complétion :
+        // un seul appel système par lot
+        int ret = io_uring_submit_and_wait_timeout(&rx->ring, &cqe, 1, &ts, NULL);
+
+        // Horloge du lot : lue une fois pour ses paquets et ses échéances
+        now = monotonic_us();
+        streams->now_us = now;
+
+        // Si des flux ont été reçus et que plus rien n'arrive depuis le délai,
+        // on arrête le serveur (chaque worker sauvegarde ensuite ses flux)
+        if (__atomic_load_n(&server_active, __ATOMIC_RELAXED) &&
+            since_last_activity(now) >= SHUTDOWN_TIMEOUT * 1000000LL)
+        {
+            if (__atomic_exchange_n(&running, 0, __ATOMIC_RELAXED))
+            {
+                printf("Inactivity detected. Saving and shutting down.\n");
+            }
+            continue;
+        }
 
-        // Si l'état de réception est actif et que le délai d'inactivité est dépassé
-        if (rx_state.active && (time(NULL) - rx_state.last_activity) >= SHUTDOWN_TIMEOUT)
+        // Une fois par seconde, les flux muets libèrent leur place
+        if (now - last_expiry >= 1000000)
         {
-            printf("Inactivity detected. Saving and shutting down.\n");
+            expire_idle_streams(streams, now, STREAM_IDLE_TIMEOUT);
+            last_expiry = now;
+        }
 
-            // Sauvegarde l'image reçue
-            save_image();
+        if (ret < 0 && ret != -ETIME && ret != -EINTR)
+        {
+            fprintf(stderr, "io_uring_wait: %s\n", strerror(-ret));
+            break;
+        }
 
-            // On arrête le serveur
-            running = 0;
-            continue;
+        uint64_t before = rx->stats.datagrams;
+        reap_completions(rx);
+        if (rx->stats.datagrams != before)
+        {
+            __atomic_store_n(&server_last_activity, now, __ATOMIC_RELAXED);
+            __atomic_store_n(&server_active, 1, __ATOMIC_RELAXED);
         }
 
-        // Si le wait a expiré, on continue la boucle
-        if (ret == -ETIME)
+        // Images arrivées à échéance sans tous leurs paquets
+        expire_frames(streams, now);
+
+        if (rx->nack)
         {
-            continue;
+            METRIC_ADD(rx->stats.nacks, send_nacks(streams, rx->sock, now / 1000));
         }
-        if (ret < 0)
+        METRIC_ADD(rx->stats.reports, send_reports(streams, rx->sock));
+
+        // Plus de buffer libre ou erreur : la requête multishot s'est arrêtée,
+        // on la relance (les buffers viennent d'être rendus)
+        if (!rx->armed)
         {
-            if (ret != -EINTR)
-            {
-                perror("io_uring_wait");
-                break;
-            }
+            METRIC_ADD(rx->stats.rearms, 1);
+            prime_uring_requests(rx);
         }
-        char *buf = io_uring_cqe_get_data(cqe);
-        if (cqe->res > 0) process_packet(buf, cqe->res);
-
-        struct io_uring_sqe *sqe = io_uring_get_sqe(ring);
-        io_uring_prep_recv(sqe, sock, buf, PACKET_SIZE, 0);
-        io_uring_sqe_set_data(sqe, buf);
-        io_uring_submit(ring);
-        
-        io_uring_cqe_seen(ring, cqe);
     }
 }
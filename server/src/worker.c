@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+#include "worker.h"
+#include "config.h"
+
+extern volatile int running;
+
+// Boucle d'un worker : la ring et les buffers sont créés dans le thread,
+// donc sur le noeud mémoire du coeur qui va les utiliser
+static void *worker_main(void *arg)
+{
+    worker_t *w = arg;
+
+    if (w->cpu >= 0)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(w->cpu, &set);
+        int ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (ret != 0)
+        {
+            fprintf(stderr, "Worker %u: cannot pin to CPU %d: %s\n", w->id, w->cpu, strerror(ret));
+        }
+    }
+
+    // Les limites valent pour l'ensemble des workers : les flux ne se
+    // répartissent pas également entre les sockets SO_REUSEPORT
+    stream_table_init(&w->streams, MAX_STREAMS, MAX_STREAM_MEMORY);
+    w->streams.writer = w->writer;
+    w->streams.publisher = w->publisher;
+    w->streams.stats = &w->rx.stats;
+
+    if (w->nack)
+    {
+        stream_table_nack(&w->streams);
+    }
+
+    if (setup_rx_ring(&w->rx, w->sock, w->gro, &w->streams) < 0)
+    {
+        running = 0;
+        __atomic_store_n(&w->done, 1, __ATOMIC_RELEASE);
+        return NULL;
+    }
+    w->rx.nack = w->nack;
+    w->ready = 1;
+
+    printf("Worker %u waiting for packets (%u buffers of %zu bytes%s%s)...\n",
+           w->id, w->rx.nb_buffers, w->rx.buffer_size, w->gro ? ", UDP GRO" : "",
+           w->cpu >= 0 ? ", pinned" : "");
+
+    run_server_loop(&w->rx);
+
+    // Sauvegarde les flux encore ouverts de ce worker
+    close_all_streams(&w->streams);
+    __atomic_store_n(&w->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+int start_worker(worker_t *w)
+{
+    int ret = pthread_create(&w->thread, NULL, worker_main, w);
+    if (ret != 0)
+    {
+        fprintf(stderr, "pthread_create: %s\n", strerror(ret));
+        return -1;
+    }
+    return 0;
+}
+
+// Attend la fin du worker et libère sa ring
+void join_worker(worker_t *w)
+{
+    pthread_join(w->thread, NULL);
+    if (w->ready)
+    {
+        if (w->rx.stats.completions)
+        {
+            printf("Worker %u: ", w->id);
+        }
+        destroy_rx_ring(&w->rx);
+    }
+}
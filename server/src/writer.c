@@ -0,0 +1,348 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include "writer.h"
+#include "config.h"
+#include "pixel_format.h"
+#include "buffer_pool.h"
+
+static uint64_t monotonic_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void free_job(write_job_t *job)
+{
+    pool_free(job->pixels, job->bytes);
+    sink_buffer_free(&job->file);
+    free(job);
+}
+
+// Réserve une place dans la file et alloue l'image à remplir. File pleine :
+// l'image est abandonnée (NULL), ou attend une place si wait est vrai.
+write_job_t *writer_reserve(frame_writer_t *wr, size_t bytes, int wait)
+{
+    pthread_mutex_lock(&wr->lock);
+    while (wait && wr->queued >= WRITER_QUEUE && !wr->stopping)
+    {
+        pthread_cond_wait(&wr->room, &wr->lock);
+    }
+    if (wr->queued >= WRITER_QUEUE || wr->stopping)
+    {
+        wr->dropped++;
+        pthread_mutex_unlock(&wr->lock);
+        return NULL;
+    }
+    wr->queued++;
+    if (wr->queued > wr->max_queued)
+    {
+        wr->max_queued = wr->queued;
+    }
+    pthread_mutex_unlock(&wr->lock);
+
+    write_job_t *job = calloc(1, sizeof(*job));
+    if (job)
+    {
+        job->pixels = pool_alloc(bytes);
+        job->bytes = bytes;
+    }
+    if (!job || !job->pixels)
+    {
+        if (!job)
+        {
+            perror("calloc");
+        }
+        free(job);
+        pthread_mutex_lock(&wr->lock);
+        wr->queued--;
+        wr->dropped++;
+        pthread_cond_signal(&wr->room);
+        pthread_mutex_unlock(&wr->lock);
+        return NULL;
+    }
+    job->fd = -1;
+    return job;
+}
+
+// Met en file une image réservée et remplie
+void writer_submit(frame_writer_t *wr, write_job_t *job)
+{
+    job->queued_us = monotonic_us();
+
+    pthread_mutex_lock(&wr->lock);
+    if (wr->tail)
+    {
+        wr->tail->next = job;
+    }
+    else
+    {
+        wr->head = job;
+    }
+    wr->tail = job;
+    pthread_cond_signal(&wr->work);
+    pthread_mutex_unlock(&wr->lock);
+}
+
+// Soumet la suite de l'écriture d'un fichier, à son offset
+static void queue_write(frame_writer_t *wr, write_job_t *job)
+{
+    struct io_uring_sqe *sqe = io_uring_get_sqe(&wr->ring);
+
+    // La ring a WRITER_DEPTH entrées : il y a toujours une place
+    io_uring_prep_write(sqe, job->fd, job->file.data + job->done,
+                        job->write_len - job->done, job->done);
+    io_uring_sqe_set_data(sqe, job);
+    io_uring_submit(&wr->ring);
+}
+
+// Encode l'image, ouvre son fichier et lance son écriture
+static void start_write(frame_writer_t *wr, write_job_t *job)
+{
+    // Les encodeurs lisent du BGRx : les formats compacts sont convertis
+    // d'abord, une ligne de blocs à la fois (deux lignes de pixels en 4:2:0)
+    frame_image_t img = {
+        .width  = job->width,
+        .height = job->height,
+        .pixels = job->pixels,
+        .stride = job->stride
+    };
+    uint8_t *bgrx = NULL;
+    size_t bgrx_bytes = 0;
+
+    if (job->format != PIXEL_FORMAT_BGRX)
+    {
+        uint32_t block = pixel_block(job->format);
+        uint32_t blocks = pixel_blocks(job->format, job->height);
+        size_t line = (size_t)job->width * PIXEL_BYTES;
+
+        bgrx_bytes = line * blocks * block;
+        bgrx = pool_alloc(bgrx_bytes);
+        if (!bgrx)
+        {
+            goto fail;
+        }
+        for (uint32_t by = 0; by < blocks; by++)
+        {
+            pixel_row_to_bgrx(job->format, job->pixels + by * job->stride, job->width,
+                              bgrx + (size_t)by * block * line, line);
+        }
+        img.pixels = bgrx;
+        img.stride = line;
+    }
+
+    int encoded = wr->sink->encode(&img, &job->file);
+    pool_free(bgrx, bgrx_bytes);
+    pool_free(job->pixels, job->bytes);
+    job->pixels = NULL;
+    if (encoded < 0)
+    {
+        goto fail;
+    }
+
+    snprintf(job->filename, sizeof(job->filename), "stream%u_image_%u.%s", job->stream,
+             job->image_id, wr->sink->name);
+
+    // O_DIRECT écrit des blocs entiers : le fichier est recoupé à la fin.
+    // Les systèmes de fichiers qui le refusent (tmpfs) repassent par le cache.
+    if (wr->direct)
+    {
+        job->fd = open(job->filename, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+        if (job->fd < 0 && errno == EINVAL)
+        {
+            fprintf(stderr, "O_DIRECT not supported here, writing through the page cache\n");
+            wr->direct = 0;
+        }
+    }
+    if (!wr->direct)
+    {
+        job->fd = open(job->filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+    if (job->fd < 0)
+    {
+        perror("open");
+        goto fail;
+    }
+    job->write_len = job->file.len;
+    if (wr->direct)
+    {
+        job->write_len = (job->file.len + SINK_ALIGN - 1) & ~(size_t)(SINK_ALIGN - 1);
+    }
+
+    queue_write(wr, job);
+    METRIC_ADD(wr->in_flight, 1);
+    if (wr->in_flight > wr->max_in_flight)
+    {
+        wr->max_in_flight = wr->in_flight;
+    }
+    return;
+
+fail:
+    fprintf(stderr, "Stream %u: cannot save image %u\n", job->stream, job->image_id);
+    METRIC_ADD(wr->failed, 1);
+    free_job(job);
+}
+
+// Fin d'une écriture : relance la suite si elle est partielle, sinon ferme
+// le fichier et affiche le bilan de l'image
+static void complete_write(frame_writer_t *wr, write_job_t *job, int res)
+{
+    if (res == -EINTR || res == -EAGAIN)
+    {
+        queue_write(wr, job);
+        return;
+    }
+    if (res > 0)
+    {
+        job->done += res;
+        if (job->done < job->write_len)
+        {
+            queue_write(wr, job);
+            return;
+        }
+    }
+
+    METRIC_SET(wr->in_flight, wr->in_flight - 1);
+    if (res <= 0 || (job->write_len != job->file.len && ftruncate(job->fd, job->file.len) < 0))
+    {
+        fprintf(stderr, "Stream %u: cannot write %s: %s\n", job->stream, job->filename,
+                strerror(res < 0 ? -res : res == 0 ? EIO : errno));
+        METRIC_ADD(wr->failed, 1);
+    }
+    else
+    {
+        uint64_t latency = monotonic_us() - job->queued_us;
+        METRIC_ADD(wr->written, 1);
+        METRIC_ADD(wr->bytes, job->file.len);
+        metrics_hist_add(&wr->latency_us, latency);
+        if (latency > wr->max_latency_us)
+        {
+            wr->max_latency_us = latency;
+        }
+        printf("Stream %u: image %u saved: %s (%s)\n", job->stream, job->image_id,
+               job->filename, job->details);
+    }
+    close(job->fd);
+    free_job(job);
+}
+
+// Traite les écritures terminées, en attendant la première si wait est vrai
+static void reap_writes(frame_writer_t *wr, int wait)
+{
+    struct io_uring_cqe *cqe;
+    int ret = wait ? io_uring_wait_cqe(&wr->ring, &cqe) : io_uring_peek_cqe(&wr->ring, &cqe);
+
+    while (ret == 0)
+    {
+        write_job_t *job = io_uring_cqe_get_data(cqe);
+        int res = cqe->res;
+        io_uring_cqe_seen(&wr->ring, cqe);
+        complete_write(wr, job, res);
+        ret = io_uring_peek_cqe(&wr->ring, &cqe);
+    }
+}
+
+// Boucle du writer : encode une image dès qu'une écriture peut être
+// soumise, sinon attend une fin d'écriture ou une nouvelle image
+static void *writer_main(void *arg)
+{
+    frame_writer_t *wr = arg;
+
+    for (;;)
+    {
+        reap_writes(wr, 0);
+
+        pthread_mutex_lock(&wr->lock);
+        while (!wr->head && !wr->in_flight && !wr->stopping)
+        {
+            pthread_cond_wait(&wr->work, &wr->lock);
+        }
+        write_job_t *job = NULL;
+        if (wr->head && wr->in_flight < WRITER_DEPTH)
+        {
+            job = wr->head;
+            wr->head = job->next;
+            if (!wr->head)
+            {
+                wr->tail = NULL;
+            }
+            wr->queued--;
+            pthread_cond_signal(&wr->room);
+        }
+        pthread_mutex_unlock(&wr->lock);
+
+        if (job)
+        {
+            start_write(wr, job);
+        }
+        else if (wr->in_flight)
+        {
+            reap_writes(wr, 1);
+        }
+        else
+        {
+            // Arrêt demandé, file vide et plus rien en cours
+            break;
+        }
+    }
+    return NULL;
+}
+
+int start_writer(frame_writer_t *wr, const frame_sink_t *sink, int direct)
+{
+    memset(wr, 0, sizeof(*wr));
+    wr->sink = sink;
+    wr->direct = direct;
+
+    int ret = io_uring_queue_init(WRITER_DEPTH, &wr->ring, 0);
+    if (ret < 0)
+    {
+        fprintf(stderr, "io_uring_queue_init: %s\n", strerror(-ret));
+        return -1;
+    }
+    pthread_mutex_init(&wr->lock, NULL);
+    pthread_cond_init(&wr->work, NULL);
+    pthread_cond_init(&wr->room, NULL);
+
+    ret = pthread_create(&wr->thread, NULL, writer_main, wr);
+    if (ret != 0)
+    {
+        fprintf(stderr, "pthread_create: %s\n", strerror(ret));
+        io_uring_queue_exit(&wr->ring);
+        return -1;
+    }
+    return 0;
+}
+
+// Écrit les images encore en file, arrête le thread et affiche le bilan
+void stop_writer(frame_writer_t *wr)
+{
+    pthread_mutex_lock(&wr->lock);
+    wr->stopping = 1;
+    pthread_cond_signal(&wr->work);
+    pthread_cond_broadcast(&wr->room);
+    pthread_mutex_unlock(&wr->lock);
+    pthread_join(wr->thread, NULL);
+
+    if (wr->written || wr->dropped || wr->failed)
+    {
+        printf("Writer: %llu images saved (%.1f MB%s), %llu dropped (queue full), "
+               "%llu failed, queue max %u/%d, writes in flight max %u/%d, "
+               "latency avg %.1f ms max %.1f ms\n",
+               wr->written, wr->bytes / 1e6, wr->direct ? ", O_DIRECT" : "",
+               wr->dropped, wr->failed, wr->max_queued, WRITER_QUEUE,
+               wr->max_in_flight, WRITER_DEPTH,
+               wr->latency_us.count ? wr->latency_us.sum / 1e3 / wr->latency_us.count : 0.0,
+               wr->max_latency_us / 1e3);
+    }
+
+    io_uring_queue_exit(&wr->ring);
+    pthread_mutex_destroy(&wr->lock);
+    pthread_cond_destroy(&wr->work);
+    pthread_cond_destroy(&wr->room);
+}